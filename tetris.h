@@ -6,15 +6,17 @@
 #include <dwrite.h>
 #include <wincodec.h>
 #include <stdint.h>
-
-#define WIDTH 10
-#define HEIGHT 30
-
-/* Tetromino structure */
-typedef struct {
-    uint16_t mask[4];
-    int color;
-} Tetromino;
+#include "tetris_core.h"
+#include "tetris_hint.h"
+#include "tetris_render.h"
+#include "tetris_layers.h"
+#include "tetris_dirty.h"
+#include "tetris_glyphs.h"
+#include "tetris_spectate.h"
+#include "tetris_sim.h"
+#include "tetris_trace.h"
+#include "tetris_metrics.h"
+#include "tetris_leaderboard.h"
 
 /* Constants */
 extern const int cell_size;
@@ -23,56 +25,67 @@ extern const int board_left;
 extern const int board_top;
 extern const int side_panel_left_offset;
 
-/* Game state */
-extern int board[HEIGHT][WIDTH];
-extern int cur_piece, cur_rot;
-extern int cur_x, cur_y;
-extern int score, level, lines_total;
-extern int next_piece, hold_piece, hold_used;
-extern int speed_ms, game_over;
-extern int animation_frame;
-
 /* D2D objects */
 extern ID2D1Factory* d2d_factory;
 extern ID2D1HwndRenderTarget* render_target;
 extern ID2D1Bitmap* background_bitmap;
-extern ID2D1SolidColorBrush* brushes[8];
-extern ID2D1SolidColorBrush* brush_border;
-extern ID2D1SolidColorBrush* brush_bg;
-extern ID2D1SolidColorBrush* brush_label;
-extern ID2D1SolidColorBrush* brush_label_score;
-extern ID2D1SolidColorBrush* brush_label_level;
-extern ID2D1SolidColorBrush* brush_label_lines;
-extern ID2D1SolidColorBrush* brush_value;
+extern ID2D1SolidColorBrush* palette_brushes[RCOL_COUNT];
+extern ID2D1SolidColorBrush* brush_dynamic;
+extern ID2D1LinearGradientBrush* gradient_brushes[RENDER_CACHE_SLOTS];
+extern ID2D1BitmapRenderTarget* layer_targets[RLAYER_COUNT];
+extern ID2D1Bitmap* layer_bitmaps[RLAYER_COUNT];
+
+/* Frame commands and the backend resource cache */
+extern RenderList render_list;
+extern RenderCache render_cache;
+extern LayerCache layer_cache;
+extern DirtyStats dirty_stats;
 
 /* DirectWrite objects */
 extern IDWriteFactory* dwrite_factory;
 extern IDWriteTextFormat* text_format;
 
-/* Tetromino definitions */
-extern Tetromino pieces[7];
+/* HUD text atlas, rasterized from text_format */
+extern GlyphAtlas hud_atlas;
+extern ID2D1Bitmap* hud_atlas_bitmap;
+extern TextLayoutCache hud_layouts;
+
+/* Spectator view: bot games shown as a grid of mini-boards, stepped and
+   drawn on the render thread */
+#define SPECTATE_STEP_MS 100
+extern int spectate_on;
+extern GameState* spectate_games;
+extern SpectateLayout spectate_view;
+extern SpectateBatch spectate_batch;
+
+/* Game functions. The game itself runs on the simulation thread
+   (tetris_sim.h); the window thread only posts input to it. */
+void game_start(const char* probe_path);
+void game_stop(void);
+void game_report(void);
+void spectate_toggle(void);
+void spectate_tick(void);
+void game_dump_trace(void);
 
-/* Game functions */
-void update_speed(void);
-int fits_piece(int piece, int px, int py, int rot);
-void lock_piece(void);
-int clear_lines(void);
-void spawn_piece(void);
-void set_current_piece(int piece);
-void game_tick(HWND hwnd);
+/* render_thread_wake flags */
+#define RENDER_WAKE_FRAME 1      /* new frame or hint */
+#define RENDER_WAKE_FULL 2       /* repaint the whole window */
+#define RENDER_WAKE_RESIZE 4
+#define RENDER_WAKE_SPECTATE 8   /* toggle the spectator grid */
+#define RENDER_WAKE_STOP 16
 
-/* Graphics functions */
+/* Graphics functions. Every Direct2D object is created, used and
+   released on the render thread. */
+void render_thread_start(HWND hwnd);
+void render_thread_stop(void);
+void render_thread_wake(int flags);
 void create_d2d_resources(HWND hwnd);
 void discard_d2d_resources(void);
-void on_paint(HWND hwnd);
+void build_render_scene(HWND hwnd, const SimFrame* frame, RenderScene* scene);
+void replay_render_list(ID2D1RenderTarget* rt, const RenderList* list, const RenderRect* clip);
 ID2D1Bitmap* load_image_from_file(ID2D1RenderTarget* rt, const wchar_t* filename);
 
 /* Utility functions */
 void safe_release(IUnknown* p);
-uint16_t rotate_mask_once(uint16_t m);
-uint16_t rotate_mask(uint16_t m, int rot);
-uint16_t get_mask(int piece, int rot);
-void draw_cell(ID2D1RenderTarget* rt, int bx, int by, ID2D1SolidColorBrush* brush);
-void reset_timer(HWND hwnd);
 
 #endif /* TETRIS_H */
\ No newline at end of file
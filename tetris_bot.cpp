@@ -0,0 +1,296 @@
+#include "tetris_bot.h"
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+
+const BotWeights bot_default_weights = { {
+    -0.510066f,  /* aggregate height */
+    -0.356630f,  /* holes */
+    -0.184483f,  /* bumpiness */
+     0.760666f,  /* lines */
+     0.0f,       /* max height */
+    -0.05f,      /* wells */
+    -0.05f,      /* row transitions */
+    -0.05f,      /* column transitions */
+} };
+
+const char* const bot_weight_names[BOT_WEIGHT_COUNT] = {
+    "agg_height", "holes", "bumpiness", "lines",
+    "max_height", "wells", "row_transitions", "col_transitions"
+};
+
+/* Cells of a placement packed into one key so duplicate rotations collapse */
+static uint64_t placement_key(int piece, int px, int py, int rot) {
+    uint16_t m = get_mask(piece, rot);
+    uint64_t key = 0;
+    for (int i = 0; i < 16; i++) {
+        if ((m >> i) & 1u) {
+            int cell = (i / 4 + py) * WIDTH + (i % 4 + px);
+            key = (key << 12) | (uint64_t)cell;
+        }
+    }
+    return key;
+}
+
+int bot_placements(const int b[HEIGHT][WIDTH], int piece, Placement* out) {
+    uint64_t keys[BOT_MAX_PLACEMENTS];
+    int n = 0;
+    for (int rot = 0; rot < 4; rot++) {
+        for (int px = -3; px < WIDTH; px++) {
+            if (!board_fits(b, piece, px, 0, rot)) continue;
+            int py = 0;
+            while (board_fits(b, piece, px, py + 1, rot)) py++;
+            uint64_t key = placement_key(piece, px, py, rot);
+            int dup = 0;
+            for (int i = 0; i < n; i++) {
+                if (keys[i] == key) { dup = 1; break; }
+            }
+            if (dup || n >= BOT_MAX_PLACEMENTS) continue;
+            keys[n] = key;
+            out[n].rot = rot;
+            out[n].x = px;
+            out[n].y = py;
+            n++;
+        }
+    }
+    return n;
+}
+
+void bot_features(const int b[HEIGHT][WIDTH], int lines, float* f) {
+    int heights[WIDTH];
+    int holes = 0, col_trans = 0;
+    for (int x = 0; x < WIDTH; x++) {
+        int y = 0;
+        while (y < HEIGHT && b[y][x] == 0) y++;
+        heights[x] = HEIGHT - y;
+        int prev = 0;
+        for (; y < HEIGHT; y++) {
+            int filled = b[y][x] != 0;
+            if (!filled) holes++;
+            if (filled != prev) col_trans++;
+            prev = filled;
+        }
+        if (!prev) col_trans++;  /* floor counts as filled */
+    }
+
+    int agg = 0, bump = 0, max_h = 0, wells = 0;
+    for (int x = 0; x < WIDTH; x++) {
+        agg += heights[x];
+        if (heights[x] > max_h) max_h = heights[x];
+        if (x + 1 < WIDTH) {
+            int d = heights[x] - heights[x + 1];
+            bump += d < 0 ? -d : d;
+        }
+        int left = x > 0 ? heights[x - 1] : HEIGHT;
+        int right = x + 1 < WIDTH ? heights[x + 1] : HEIGHT;
+        int rim = left < right ? left : right;
+        if (rim > heights[x]) wells += rim - heights[x];
+    }
+
+    int row_trans = 0;
+    for (int y = HEIGHT - max_h; y < HEIGHT; y++) {
+        int prev = 1;  /* walls count as filled */
+        for (int x = 0; x < WIDTH; x++) {
+            int filled = b[y][x] != 0;
+            if (filled != prev) row_trans++;
+            prev = filled;
+        }
+        if (!prev) row_trans++;
+    }
+
+    f[BOT_AGG_HEIGHT] = (float)agg;
+    f[BOT_HOLES] = (float)holes;
+    f[BOT_BUMPINESS] = (float)bump;
+    f[BOT_LINES] = (float)lines;
+    f[BOT_MAX_HEIGHT] = (float)max_h;
+    f[BOT_WELLS] = (float)wells;
+    f[BOT_ROW_TRANSITIONS] = (float)row_trans;
+    f[BOT_COL_TRANSITIONS] = (float)col_trans;
+}
+
+float bot_evaluate(const int b[HEIGHT][WIDTH], int lines, const BotWeights* wt) {
+    float f[BOT_WEIGHT_COUNT];
+    bot_features(b, lines, f);
+    float v = 0.0f;
+    for (int i = 0; i < BOT_WEIGHT_COUNT; i++) v += wt->w[i] * f[i];
+    return v;
+}
+
+static uint64_t now_ns(void) {
+    using namespace std::chrono;
+    return (uint64_t)duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+/* Best placement of one piece on the current board */
+static int best_placement(const int b[HEIGHT][WIDTH], int piece, const BotWeights* wt,
+                          Placement* best, float* best_value) {
+    Placement places[BOT_MAX_PLACEMENTS];
+    int n = bot_placements(b, piece, places);
+    int found = 0;
+    for (int i = 0; i < n; i++) {
+        int tmp[HEIGHT][WIDTH];
+        memcpy(tmp, b, sizeof(tmp));
+        board_lock(tmp, piece, places[i].x, places[i].y, places[i].rot);
+        int lines = board_clear_lines(tmp);
+        float v = bot_evaluate(tmp, lines, wt);
+        if (!found || v > *best_value) {
+            *best = places[i];
+            *best_value = v;
+            found = 1;
+        }
+    }
+    return found;
+}
+
+/* Value of the best placement of piece on b; cached by board */
+float bot_best_value(const int b[HEIGHT][WIDTH], int piece, const BotWeights* wt,
+                     EvalCache* cache) {
+    EvalCacheKey key;
+    float v;
+    if (cache) {
+        eval_cache_key(b, piece, &key);
+        if (eval_cache_lookup(cache, &key, &v)) return v;
+    }
+    uint64_t t0 = cache ? now_ns() : 0;
+    Placement p;
+    if (!best_placement(b, piece, wt, &p, &v)) v = BOT_DEAD_VALUE;
+    if (cache) {
+        eval_cache_note_compute(cache, now_ns() - t0);
+        eval_cache_store(cache, &key, v);
+    }
+    return v;
+}
+
+/* Best value of the follow-up piece, averaged over all seven when unknown */
+static float follow_value(const int b[HEIGHT][WIDTH], int follow, const BotWeights* wt, EvalCache* cache) {
+    if (follow >= 0) return bot_best_value(b, follow, wt, cache);
+    float sum = 0.0f;
+    for (int k = 0; k < 7; k++) sum += bot_best_value(b, k, wt, cache);
+    return sum / 7.0f;
+}
+
+/* Place piece, then (depth 2) the follow-up piece on each result */
+static int search_piece(const int b[HEIGHT][WIDTH], int piece, int follow, int depth,
+                        const BotWeights* wt, EvalCache* cache,
+                        Placement* best, float* best_value) {
+    if (depth < 2) return best_placement(b, piece, wt, best, best_value);
+
+    Placement places[BOT_MAX_PLACEMENTS];
+    int n = bot_placements(b, piece, places);
+    int found = 0;
+    for (int i = 0; i < n; i++) {
+        int tmp[HEIGHT][WIDTH];
+        memcpy(tmp, b, sizeof(tmp));
+        board_lock(tmp, piece, places[i].x, places[i].y, places[i].rot);
+        int lines = board_clear_lines(tmp);
+        float v = follow_value(tmp, follow, wt, cache) + wt->w[BOT_LINES] * lines;
+        if (!found || v > *best_value) {
+            *best = places[i];
+            *best_value = v;
+            found = 1;
+        }
+    }
+    return found;
+}
+
+int bot_choose(const GameState* s, const BotWeights* wt, BotMove* out) {
+    return bot_search(s, wt, 1, NULL, out);
+}
+
+int bot_search(const GameState* s, const BotWeights* wt, int depth, EvalCache* cache, BotMove* out) {
+    if (s->game_over) return 0;
+    Placement p;
+    float v;
+    int found = 0;
+    if (search_piece(s->board, s->cur_piece, s->next_piece, depth, wt, cache, &p, &v)) {
+        out->use_hold = 0;
+        out->piece = s->cur_piece;
+        out->place = p;
+        out->value = v;
+        found = 1;
+    }
+    if (!s->hold_used) {
+        /* Holding into an empty slot brings in next_piece; what follows it is
+           unknown, so depth 2 averages over it */
+        int alt = s->hold_piece >= 0 ? s->hold_piece : s->next_piece;
+        int follow = s->hold_piece >= 0 ? s->next_piece : -1;
+        if (alt >= 0 && alt != s->cur_piece &&
+            search_piece(s->board, alt, follow, depth, wt, cache, &p, &v)) {
+            if (!found || v > out->value) {
+                out->use_hold = 1;
+                out->piece = alt;
+                out->place = p;
+                out->value = v;
+                found = 1;
+            }
+        }
+    }
+    return found;
+}
+
+/* Hold (if asked) and hard drop exactly as the player would; returns lines cleared */
+int bot_apply(GameState* s, const BotMove* mv) {
+    if (mv->use_hold && state_hold(s) && s->game_over) return 0;
+    s->cur_rot = mv->place.rot;
+    s->cur_x = mv->place.x;
+    s->cur_y = 0;
+    return state_hard_drop(s);
+}
+
+/* Replans whenever a piece locked or hold swapped it */
+int bot_pilot_input(BotPilot* p, const GameState* s, const BotWeights* wt) {
+    if (s->game_over) return -1;
+    if (!p->planned || p->placed != s->pieces_placed || p->hold_used != s->hold_used) {
+        if (!bot_choose(s, wt, &p->mv)) return INPUT_HARD_DROP;
+        p->planned = 1;
+        p->placed = s->pieces_placed;
+        p->hold_used = s->hold_used;
+        p->moves = 0;
+    }
+    if (++p->moves > 12) return INPUT_HARD_DROP;   /* blocked on the way */
+    if (p->mv.use_hold && !s->hold_used) return INPUT_HOLD;
+    if (s->cur_rot != p->mv.place.rot) return INPUT_ROTATE;
+    if (s->cur_x < p->mv.place.x) return INPUT_RIGHT;
+    if (s->cur_x > p->mv.place.x) return INPUT_LEFT;
+    return INPUT_HARD_DROP;
+}
+
+int64_t bot_play_game(uint32_t seed, const BotWeights* wt, int depth, EvalCache* cache,
+                      int max_pieces, GameState* result) {
+    GameState s;
+    state_init(&s, seed);
+    while (!s.game_over && s.pieces_placed < max_pieces) {
+        BotMove mv;
+        if (!bot_search(&s, wt, depth, cache, &mv)) {
+            s.game_over = 1;
+            break;
+        }
+        bot_apply(&s, &mv);
+    }
+    if (result) *result = s;
+    return s.score;
+}
+
+int bot_save_weights(const char* path, const BotWeights* wt) {
+    FILE* f = fopen(path, "w");
+    if (!f) return 0;
+    for (int i = 0; i < BOT_WEIGHT_COUNT; i++)
+        fprintf(f, "%s %.9g\n", bot_weight_names[i], wt->w[i]);
+    return fclose(f) == 0;
+}
+
+int bot_load_weights(const char* path, BotWeights* wt) {
+    FILE* f = fopen(path, "r");
+    if (!f) return 0;
+    BotWeights loaded = bot_default_weights;
+    char name[64];
+    float value;
+    while (fscanf(f, "%63s %f", name, &value) == 2) {
+        for (int i = 0; i < BOT_WEIGHT_COUNT; i++) {
+            if (strcmp(name, bot_weight_names[i]) == 0) loaded.w[i] = value;
+        }
+    }
+    fclose(f);
+    *wt = loaded;
+    return 1;
+}
@@ -0,0 +1,67 @@
+#ifndef TETRIS_BOT_H
+#define TETRIS_BOT_H
+
+#include "tetris_core.h"
+#include "tetris_eval_cache.h"
+
+/* Heuristic features, in weight order */
+enum {
+    BOT_AGG_HEIGHT = 0,
+    BOT_HOLES,
+    BOT_BUMPINESS,
+    BOT_LINES,
+    BOT_MAX_HEIGHT,
+    BOT_WELLS,
+    BOT_ROW_TRANSITIONS,
+    BOT_COL_TRANSITIONS,
+    BOT_WEIGHT_COUNT
+};
+
+#define BOT_MAX_PLACEMENTS 64
+#define BOT_DEAD_VALUE -1.0e9f
+
+typedef struct {
+    float w[BOT_WEIGHT_COUNT];
+} BotWeights;
+
+/* A hard-drop placement: rotation, column and landing row */
+typedef struct {
+    int rot, x, y;
+} Placement;
+
+typedef struct {
+    int use_hold;
+    int piece;
+    Placement place;
+    float value;
+} BotMove;
+
+/* Plays a placement through single inputs, for bots that share a timed
+   game with people: hold, rotate, shift, then hard drop. Zero it to start. */
+typedef struct {
+    BotMove mv;
+    int planned, placed, hold_used;
+    int moves;                    /* inputs spent on this plan */
+} BotPilot;
+
+extern const BotWeights bot_default_weights;
+extern const char* const bot_weight_names[BOT_WEIGHT_COUNT];
+
+/* Bot functions */
+int bot_placements(const int b[HEIGHT][WIDTH], int piece, Placement* out);
+void bot_features(const int b[HEIGHT][WIDTH], int lines, float* f);
+float bot_evaluate(const int b[HEIGHT][WIDTH], int lines, const BotWeights* wt);
+int bot_choose(const GameState* s, const BotWeights* wt, BotMove* out);
+float bot_best_value(const int b[HEIGHT][WIDTH], int piece, const BotWeights* wt, EvalCache* cache);
+int bot_search(const GameState* s, const BotWeights* wt, int depth, EvalCache* cache, BotMove* out);
+int bot_apply(GameState* s, const BotMove* mv);
+/* The next INPUT_* toward the planned placement, or -1 once over */
+int bot_pilot_input(BotPilot* p, const GameState* s, const BotWeights* wt);
+int64_t bot_play_game(uint32_t seed, const BotWeights* wt, int depth, EvalCache* cache,
+                      int max_pieces, GameState* result);
+
+/* Weights file: one "name value" pair per line */
+int bot_save_weights(const char* path, const BotWeights* wt);
+int bot_load_weights(const char* path, BotWeights* wt);
+
+#endif /* TETRIS_BOT_H */
@@ -0,0 +1,170 @@
+#include "tetris_broadcast.h"
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <new>
+#include "tetris_net.h"
+
+/* Immutable once queued; freed by whoever drops the last reference */
+typedef struct {
+    std::atomic<int> refs;
+    int keyframe;
+    size_t len;
+    uint8_t data[NET_MESSAGE_MAX];
+} BcastBuf;
+
+struct BcastSubscriber {
+    alignas(64) std::atomic<uint32_t> tail;     /* publisher */
+    int owe_keyframe;
+    int slot;
+    alignas(64) std::atomic<uint32_t> head;     /* reader */
+    size_t offset;                              /* bytes of the head message taken */
+    uint64_t skipped;
+    BcastBuf* ring[BCAST_QUEUE];
+};
+
+struct BcastChannel {
+    BcastSubscriber** subs;
+    int count, max;
+    GameState last;
+    int have_last;
+    BcastStats stats;
+};
+
+static BcastBuf* buf_new(void) {
+    BcastBuf* b = (BcastBuf*)malloc(sizeof(BcastBuf));
+    if (!b) return NULL;
+    new (&b->refs) std::atomic<int>(1);
+    return b;
+}
+
+static void buf_release(BcastBuf* b) {
+    if (b && b->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) free(b);
+}
+
+BcastChannel* bcast_create(int max_subscribers) {
+    BcastChannel* c = (BcastChannel*)calloc(1, sizeof(BcastChannel));
+    if (!c) return NULL;
+    c->subs = (BcastSubscriber**)calloc((size_t)max_subscribers, sizeof(BcastSubscriber*));
+    if (!c->subs) {
+        free(c);
+        return NULL;
+    }
+    c->max = max_subscribers;
+    return c;
+}
+
+void bcast_destroy(BcastChannel* c) {
+    if (!c) return;
+    while (c->count) bcast_unsubscribe(c, c->subs[c->count - 1]);
+    free(c->subs);
+    free(c);
+}
+
+BcastSubscriber* bcast_subscribe(BcastChannel* c) {
+    if (c->count == c->max) return NULL;
+    BcastSubscriber* s = new BcastSubscriber();
+    s->tail.store(0);
+    s->head.store(0);
+    s->offset = 0;
+    s->skipped = 0;
+    s->owe_keyframe = 1;
+    s->slot = c->count;
+    c->subs[c->count++] = s;
+    return s;
+}
+
+void bcast_unsubscribe(BcastChannel* c, BcastSubscriber* s) {
+    for (uint32_t k = s->head.load(); k != s->tail.load(); k++) buf_release(s->ring[k % BCAST_QUEUE]);
+    BcastSubscriber* moved = c->subs[--c->count];
+    c->subs[s->slot] = moved;
+    moved->slot = s->slot;
+    delete s;
+}
+
+/* Encodes at most one delta and one keyframe, only if someone takes it */
+void bcast_publish(BcastChannel* c, const GameState* s, uint32_t tick) {
+    BcastBuf *delta = NULL, *key = NULL;
+    for (int i = 0; i < c->count; i++) {
+        BcastSubscriber* sub = c->subs[i];
+        uint32_t tail = sub->tail.load(std::memory_order_relaxed);
+        uint32_t queued = tail - sub->head.load(std::memory_order_acquire);
+        if (queued == BCAST_QUEUE) {
+            sub->owe_keyframe = 1;
+            c->stats.overflows++;
+            continue;
+        }
+        /* The last free slot only takes a keyframe, so a reader that fell
+           behind finds one at the end of its queue and skips to it */
+        BcastBuf* b;
+        if (sub->owe_keyframe || !c->have_last || queued == BCAST_QUEUE - 1) {
+            if (!key && (key = buf_new())) {
+                key->keyframe = 1;
+                key->len = net_put_state(key->data, s, tick, 0);
+                c->stats.keyframes++;
+                c->stats.keyframe_bytes += key->len;
+            }
+            b = key;
+        } else {
+            if (!delta && (delta = buf_new())) {
+                delta->keyframe = 0;
+                delta->len = net_put_delta(delta->data, &c->last, s, tick);
+                c->stats.deltas++;
+                c->stats.delta_bytes += delta->len;
+            }
+            b = delta;
+        }
+        if (!b) {
+            sub->owe_keyframe = 1;
+            continue;
+        }
+        sub->owe_keyframe = 0;
+        b->refs.fetch_add(1, std::memory_order_relaxed);
+        sub->ring[tail % BCAST_QUEUE] = b;
+        sub->tail.store(tail + 1, std::memory_order_release);
+        c->stats.enqueued++;
+    }
+    buf_release(delta);
+    buf_release(key);
+    c->last = *s;
+    c->have_last = 1;
+    c->stats.ticks++;
+}
+
+void bcast_stats(const BcastChannel* c, BcastStats* out) {
+    *out = c->stats;
+    out->subscribers = c->count;
+}
+
+size_t bcast_peek(BcastSubscriber* s, const uint8_t** data) {
+    uint32_t head = s->head.load(std::memory_order_relaxed);
+    uint32_t tail = s->tail.load(std::memory_order_acquire);
+    if (head == tail) return 0;
+    if (s->offset == 0 && tail - head > 1) {
+        /* A newer keyframe supersedes everything queued before it */
+        for (uint32_t k = tail - 1; k != head; k--) {
+            if (!s->ring[k % BCAST_QUEUE]->keyframe) continue;
+            for (; head != k; head++) buf_release(s->ring[head % BCAST_QUEUE]);
+            s->skipped += k - s->head.load(std::memory_order_relaxed);
+            s->head.store(head, std::memory_order_release);
+            break;
+        }
+    }
+    BcastBuf* b = s->ring[head % BCAST_QUEUE];
+    *data = b->data + s->offset;
+    return b->len - s->offset;
+}
+
+void bcast_consume(BcastSubscriber* s, size_t n) {
+    uint32_t head = s->head.load(std::memory_order_relaxed);
+    BcastBuf* b = s->ring[head % BCAST_QUEUE];
+    s->offset += n;
+    if (s->offset < b->len) return;
+    s->offset = 0;
+    buf_release(b);
+    s->head.store(head + 1, std::memory_order_release);
+}
+
+uint64_t bcast_skipped(const BcastSubscriber* s) {
+    return s->skipped;
+}
@@ -0,0 +1,55 @@
+#ifndef TETRIS_BROADCAST_H
+#define TETRIS_BROADCAST_H
+
+/* Live games streamed to many spectators. Each published tick is encoded
+   once, as a NET_DELTA against the previous tick or a NET_STATE keyframe,
+   into an immutable reference-counted buffer, and every subscriber's queue
+   gets a pointer to that same buffer; nothing is copied per subscriber.
+
+   A subscriber's queue holds BCAST_QUEUE messages and its last free slot
+   only ever takes a keyframe. Once full, the subscriber misses ticks and
+   is owed a fresh keyframe as soon as it has room. A reader skips
+   straight to the newest keyframe in its queue, so a slow spectator costs
+   a bounded queue and jumps back to the present instead of replaying the
+   past.
+
+   One thread publishes on a channel and may subscribe and unsubscribe;
+   each subscriber is read by one thread at a time, any thread. Encodes
+   with tetris_net, so it builds where that does. */
+
+#include <stddef.h>
+#include <stdint.h>
+#include "tetris_core.h"
+
+#define BCAST_QUEUE 64            /* messages a subscriber may fall behind; power of two */
+
+typedef struct BcastChannel BcastChannel;
+typedef struct BcastSubscriber BcastSubscriber;
+
+typedef struct {
+    uint64_t ticks;
+    uint64_t deltas, delta_bytes;
+    uint64_t keyframes, keyframe_bytes;
+    uint64_t enqueued;            /* buffer references handed to subscribers */
+    uint64_t overflows;           /* ticks a full subscriber missed */
+    int subscribers;
+} BcastStats;
+
+BcastChannel* bcast_create(int max_subscribers);
+/* Every subscriber must be unsubscribed or no longer read */
+void bcast_destroy(BcastChannel* c);
+/* Publisher side. A new subscriber starts with a keyframe; NULL when full.
+   Unsubscribe once the subscriber's reader has stopped. */
+BcastSubscriber* bcast_subscribe(BcastChannel* c);
+void bcast_unsubscribe(BcastChannel* c, BcastSubscriber* s);
+void bcast_publish(BcastChannel* c, const GameState* s, uint32_t tick);
+void bcast_stats(const BcastChannel* c, BcastStats* out);
+
+/* Reader side: the untaken bytes of the next message, 0 if none. The
+   bytes stay valid until bcast_consume takes all of them. */
+size_t bcast_peek(BcastSubscriber* s, const uint8_t** data);
+void bcast_consume(BcastSubscriber* s, size_t n);
+/* Messages dropped by jumping to a newer keyframe */
+uint64_t bcast_skipped(const BcastSubscriber* s);
+
+#endif /* TETRIS_BROADCAST_H */
@@ -0,0 +1,229 @@
+// Broadcast benchmark - bot games published to thousands of in-process
+// spectators that decode every message; some spectators read rarely to
+// force keyframe catch-up. At the end every spectator must hold its
+// game's exact last state. Reports CPU per subscriber on both sides.
+// Build: g++ -O2 -std=c++17 -pthread tetris_broadcast_bench.cpp tetris_broadcast.cpp tetris_net.cpp tetris_bot.cpp tetris_eval_cache.cpp tetris_core.cpp -o tetris_broadcast_bench
+//        POSIX only (tetris_net, thread CPU clocks)
+// Usage: tetris_broadcast_bench --games 10 --subscribers 10000 --seconds 10
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "tetris_bot.h"
+#include "tetris_broadcast.h"
+#include "tetris_net.h"
+
+typedef struct {
+    BcastChannel* channel;
+    GameState game;
+    BotPilot pilot;
+    int gravity_ms;
+    uint32_t seed;
+} Game;
+
+/* One spectator: what it has rebuilt from its stream */
+typedef struct {
+    BcastSubscriber* sub;
+    int game;
+    int slow;
+    GameState view;
+    uint64_t messages, bytes;
+    int corrupt;
+} Spectator;
+
+static int tick_ms = 16;
+static int slow_ms = 2000;
+static std::atomic<int> running(1);
+static std::vector<Game> games;
+static std::vector<Spectator> spectators;
+
+static double now_s(clockid_t clock) {
+    struct timespec t;
+    clock_gettime(clock, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static void usage(void) {
+    printf("Usage: tetris_broadcast_bench [options]\n"
+           "  --games N        games published (default 10)\n"
+           "  --subscribers N  spectators, spread over the games (default 10000)\n"
+           "  --readers N      spectator reader threads (default 2)\n"
+           "  --slow PCT       spectators read only every --slow-ms (default 5)\n"
+           "  --slow-ms MS     (default 2000, queue holds %d ticks)\n"
+           "  --tick-ms MS     publish interval (default 16)\n"
+           "  --seconds N      (default 10)\n", BCAST_QUEUE);
+}
+
+static void game_step(Game* g) {
+    GameState* s = &g->game;
+    if (s->game_over) {
+        state_init(s, ++g->seed);
+        memset(&g->pilot, 0, sizeof(g->pilot));
+        g->gravity_ms = 0;
+    }
+    int in = bot_pilot_input(&g->pilot, s, &bot_default_weights);
+    if (in >= 0) state_input(s, in);
+    for (g->gravity_ms += tick_ms; !s->game_over && g->gravity_ms >= s->speed_ms; g->gravity_ms -= s->speed_ms)
+        state_tick(s);
+}
+
+/* Reads everything queued for one spectator */
+static void drain(Spectator* sp) {
+    const uint8_t* data;
+    size_t n;
+    while ((n = bcast_peek(sp->sub, &data)) > 0) {
+        int type;
+        const uint8_t* payload;
+        size_t len;
+        uint32_t tick, ack;
+        int ok = net_frame(data, n, &type, &payload, &len) == (int)n;
+        if (ok && type == NET_STATE) ok = net_get_state(payload, len, &sp->view, &tick, &ack);
+        else if (ok && type == NET_DELTA) ok = net_get_delta(payload, len, &sp->view, &tick);
+        else ok = 0;
+        if (!ok) sp->corrupt++;
+        sp->messages++;
+        sp->bytes += n;
+        bcast_consume(sp->sub, n);
+    }
+}
+
+static void reader(int index, int readers, double* cpu_s) {
+    double next_slow = now_s(CLOCK_MONOTONIC) + slow_ms / 1000.0;
+    double cpu0 = now_s(CLOCK_THREAD_CPUTIME_ID);
+    while (running.load()) {
+        int slow_turn = now_s(CLOCK_MONOTONIC) >= next_slow;
+        if (slow_turn) next_slow += slow_ms / 1000.0;
+        for (size_t i = (size_t)index; i < spectators.size(); i += (size_t)readers)
+            if (!spectators[i].slow || slow_turn) drain(&spectators[i]);
+        struct timespec pause = { 0, (long)tick_ms * 500000 };
+        nanosleep(&pause, NULL);
+    }
+    *cpu_s = now_s(CLOCK_THREAD_CPUTIME_ID) - cpu0;
+}
+
+/* What NET_STATE carries; speed_ms follows level */
+static int same_view(const GameState* a, const GameState* b) {
+    return !memcmp(a->board, b->board, sizeof(a->board)) && a->cur_piece == b->cur_piece &&
+           a->cur_rot == b->cur_rot && a->cur_x == b->cur_x && a->cur_y == b->cur_y &&
+           a->next_piece == b->next_piece && a->hold_piece == b->hold_piece && a->hold_used == b->hold_used &&
+           a->game_over == b->game_over && a->level == b->level && a->lines_total == b->lines_total &&
+           a->score == b->score;
+}
+
+int main(int argc, char** argv) {
+    int game_count = 10, subscribers = 10000, readers = 2, slow_pct = 5, seconds = 10;
+
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        const char* v = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!strcmp(a, "--help")) { usage(); return 0; }
+        if (!v) { usage(); return 1; }
+        if (!strcmp(a, "--games")) game_count = atoi(v);
+        else if (!strcmp(a, "--subscribers")) subscribers = atoi(v);
+        else if (!strcmp(a, "--readers")) readers = atoi(v);
+        else if (!strcmp(a, "--slow")) slow_pct = atoi(v);
+        else if (!strcmp(a, "--slow-ms")) slow_ms = atoi(v);
+        else if (!strcmp(a, "--tick-ms")) tick_ms = atoi(v);
+        else if (!strcmp(a, "--seconds")) seconds = atoi(v);
+        else { usage(); return 1; }
+        i++;
+    }
+    if (game_count < 1 || subscribers < 1 || readers < 1 || tick_ms < 1 || slow_ms < 1) { usage(); return 1; }
+
+    games.resize((size_t)game_count);
+    for (int g = 0; g < game_count; g++) {
+        Game* gm = &games[g];
+        memset(&gm->pilot, 0, sizeof(gm->pilot));
+        gm->gravity_ms = 0;
+        gm->seed = (uint32_t)g * 7919 + 1;
+        state_init(&gm->game, gm->seed);
+        gm->channel = bcast_create(subscribers / game_count + 1);
+    }
+    spectators.resize((size_t)subscribers);
+    for (int i = 0; i < subscribers; i++) {
+        Spectator* sp = &spectators[i];
+        memset(sp, 0, sizeof(*sp));
+        sp->game = i % game_count;
+        sp->slow = (i * 100 / subscribers) < slow_pct;
+        sp->sub = bcast_subscribe(games[sp->game].channel);
+    }
+
+    std::vector<double> reader_cpu((size_t)readers);
+    std::vector<std::thread> pool;
+    for (int r = 0; r < readers; r++) pool.emplace_back(reader, r, readers, &reader_cpu[r]);
+
+    /* Publisher: this thread, on a fixed tick */
+    double start = now_s(CLOCK_MONOTONIC), next = start, publish_s = 0.0;
+    double cpu0 = now_s(CLOCK_THREAD_CPUTIME_ID);
+    uint32_t tick = 0;
+    while (now_s(CLOCK_MONOTONIC) - start < seconds) {
+        for (Game& g : games) game_step(&g);
+        double t0 = now_s(CLOCK_MONOTONIC);
+        for (Game& g : games) bcast_publish(g.channel, &g.game, tick);
+        publish_s += now_s(CLOCK_MONOTONIC) - t0;
+        tick++;
+        next += tick_ms / 1000.0;
+        double wait = next - now_s(CLOCK_MONOTONIC);
+        if (wait > 0) {
+            struct timespec pause = { (time_t)wait, (long)((wait - (time_t)wait) * 1e9) };
+            nanosleep(&pause, NULL);
+        }
+    }
+    double publisher_cpu = now_s(CLOCK_THREAD_CPUTIME_ID) - cpu0;
+    running = 0;
+    for (std::thread& t : pool) t.join();
+    double elapsed = now_s(CLOCK_MONOTONIC) - start;
+
+    /* Readers are stopped. Drain, let one more tick pay the keyframes owed
+       to full queues, and every spectator must land on its game. */
+    for (Spectator& sp : spectators) drain(&sp);
+    for (Game& g : games) bcast_publish(g.channel, &g.game, tick);
+    uint64_t messages = 0, bytes = 0, skipped = 0, stale = 0, corrupt = 0;
+    for (Spectator& sp : spectators) {
+        drain(&sp);
+        messages += sp.messages;
+        bytes += sp.bytes;
+        skipped += bcast_skipped(sp.sub);
+        corrupt += sp.corrupt;
+        if (!same_view(&sp.view, &games[sp.game].game)) stale++;
+    }
+    BcastStats total;
+    memset(&total, 0, sizeof(total));
+    for (Game& g : games) {
+        BcastStats st;
+        bcast_stats(g.channel, &st);
+        total.deltas += st.deltas;
+        total.delta_bytes += st.delta_bytes;
+        total.keyframes += st.keyframes;
+        total.keyframe_bytes += st.keyframe_bytes;
+        total.enqueued += st.enqueued;
+        total.overflows += st.overflows;
+        bcast_destroy(g.channel);
+    }
+    double readers_cpu = 0.0;
+    for (double c : reader_cpu) readers_cpu += c;
+
+    printf("%d games to %d spectators (%d%% slow) for %.1f s, %u ticks\n", game_count, subscribers, slow_pct,
+           elapsed, tick);
+    printf("encoded %llu deltas (avg %.1f bytes), %llu keyframes (avg %.1f bytes)\n",
+           (unsigned long long)total.deltas, total.deltas ? (double)total.delta_bytes / total.deltas : 0.0,
+           (unsigned long long)total.keyframes,
+           total.keyframes ? (double)total.keyframe_bytes / total.keyframes : 0.0);
+    printf("fan-out: %llu buffer refs queued, %.1f per encoded message; %llu missed on full queues, "
+           "%llu skipped by catch-up\n",
+           (unsigned long long)total.enqueued,
+           (double)total.enqueued / (double)(total.deltas + total.keyframes ? total.deltas + total.keyframes : 1),
+           (unsigned long long)total.overflows, (unsigned long long)skipped);
+    printf("publish: %.1f ns per subscriber message, %.2f us per subscriber-second "
+           "(thread CPU %.2f s with the bots)\n",
+           total.enqueued ? publish_s * 1e9 / total.enqueued : 0.0, publish_s * 1e6 / subscribers / elapsed,
+           publisher_cpu);
+    printf("readers: %llu messages, %.1f MB decoded, %.2f us CPU per subscriber-second\n",
+           (unsigned long long)messages, bytes / 1e6, readers_cpu * 1e6 / subscribers / elapsed);
+    printf("spectators in sync at the end: %d of %d, %llu corrupt messages\n", subscribers - (int)stale,
+           subscribers, (unsigned long long)corrupt);
+    return stale || corrupt ? 1 : 0;
+}
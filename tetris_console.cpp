@@ -0,0 +1,313 @@
+// Terminal Tetris for Linux and other POSIX systems - ANSI escape output,
+// sending only the cells that changed, one write per frame, driven by a
+// poll loop over the keyboard and the gravity timer
+// Build: g++ -O2 -std=c++17 -pthread tetris_console.cpp tetris_term.cpp tetris_latency.cpp tetris_shm.cpp tetris_leaderboard.cpp tetris_bot.cpp tetris_eval_cache.cpp tetris_core.cpp -o tetris_console
+// Usage: tetris_console                    (play)
+//        tetris_console --bot 200          (watch the bot place 200 pieces)
+//        tetris_console --latency lag.txt  (play, then write input latency percentiles)
+//        tetris_console --shm /tetris-bot  (also take moves from a bot process, see tetris_shm.h)
+//        tetris_console --scores DIR --name NAME  (leaderboard; default tetris_scores, $USER)
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/timerfd.h>
+#endif
+#include "tetris_term.h"
+#include "tetris_latency.h"
+#include "tetris_bot.h"
+#include "tetris_shm.h"
+#include "tetris_leaderboard.h"
+
+static struct termios saved_tty;
+static int tty_raw = 0;
+static int screen_active = 0;
+
+static void restore_terminal(void) {
+    static const char leave[] = "\x1b[0m\x1b[?25h\x1b[?1049l";
+    if (screen_active && write(STDOUT_FILENO, leave, sizeof(leave) - 1) < 0) {}
+    if (tty_raw) tcsetattr(STDIN_FILENO, TCSANOW, &saved_tty);
+    screen_active = 0;
+    tty_raw = 0;
+}
+
+static void on_signal(int sig) {
+    restore_terminal();
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+
+/* No echo, no line buffering, reads never block; alternate screen with
+   the cursor hidden */
+static void setup_terminal(void) {
+    if (isatty(STDIN_FILENO) && tcgetattr(STDIN_FILENO, &saved_tty) == 0) {
+        struct termios raw = saved_tty;
+        raw.c_lflag &= ~(ICANON | ECHO);
+        raw.c_cc[VMIN] = 0;
+        raw.c_cc[VTIME] = 0;
+        tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+        tty_raw = 1;
+    }
+    fcntl(STDIN_FILENO, F_SETFL, fcntl(STDIN_FILENO, F_GETFL) | O_NONBLOCK);
+    static const char enter[] = "\x1b[?1049h\x1b[?25l\x1b[2J";
+    if (write(STDOUT_FILENO, enter, sizeof(enter) - 1) < 0) {}
+    screen_active = 1;
+    atexit(restore_terminal);
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+}
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1.0e6;
+}
+
+/* Gravity runs on its own clock: a timerfd on Linux, so poll wakes for
+   it like for a key; elsewhere a monotonic deadline becomes the poll
+   timeout */
+typedef struct {
+    int fd;
+    int period_ms;
+    double deadline;
+} GravityClock;
+
+static void gravity_start(GravityClock* g, int period_ms) {
+    g->period_ms = period_ms;
+    g->deadline = now_ms() + period_ms;
+#ifdef __linux__
+    if (g->fd < 0) g->fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (g->fd >= 0) {
+        struct itimerspec its;
+        its.it_value.tv_sec = its.it_interval.tv_sec = period_ms / 1000;
+        its.it_value.tv_nsec = its.it_interval.tv_nsec = (long)(period_ms % 1000) * 1000000L;
+        timerfd_settime(g->fd, 0, &its, NULL);
+    }
+#endif
+}
+
+static int gravity_timeout(const GravityClock* g) {
+    if (g->fd >= 0) return -1;
+    double left = g->deadline - now_ms();
+    return left <= 0.0 ? 0 : (int)left + 1;
+}
+
+/* Number of gravity steps that came due */
+static int gravity_due(GravityClock* g, short revents) {
+    if (g->fd >= 0) {
+        uint64_t expirations = 0;
+        if (!(revents & POLLIN) || read(g->fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+            return 0;
+        return (int)expirations;
+    }
+    int due = 0;
+    for (double now = now_ms(); now >= g->deadline; g->deadline += g->period_ms) due++;
+    return due;
+}
+
+/* Maps keys, including arrow escape sequences, to inputs; -2 for quit,
+   -1 for anything else, -3 for an escape sequence cut short by the end
+   of the read. *used is the number of bytes consumed. */
+static int decode_key(const unsigned char* k, int n, int* used) {
+    *used = 1;
+    if (k[0] == 0x1b && n < 3 && (n == 1 || k[1] == '[')) return -3;
+    if (k[0] == 0x1b && n >= 3 && k[1] == '[') {
+        *used = 3;
+        switch (k[2]) {
+        case 'A': return INPUT_ROTATE;
+        case 'B': return INPUT_SOFT_DROP;
+        case 'C': return INPUT_RIGHT;
+        case 'D': return INPUT_LEFT;
+        }
+        return -1;
+    }
+    switch (k[0]) {
+    case 'w': case 'W': return INPUT_ROTATE;
+    case 's': case 'S': return INPUT_SOFT_DROP;
+    case 'a': case 'A': return INPUT_LEFT;
+    case 'd': case 'D': return INPUT_RIGHT;
+    case ' ': return INPUT_HARD_DROP;
+    case 'c': case 'C': return INPUT_HOLD;
+    case 'q': case 'Q': return -2;
+    }
+    return -1;
+}
+
+int main(int argc, char** argv) {
+    int bot_pieces = 0;
+    const char* latency_path = NULL;
+    const char* shm_name = NULL;
+    const char* scores_dir = "tetris_scores";
+    const char* player = getenv("USER");
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--bot") && i + 1 < argc) bot_pieces = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--latency") && i + 1 < argc) latency_path = argv[++i];
+        else if (!strcmp(argv[i], "--shm") && i + 1 < argc) shm_name = argv[++i];
+        else if (!strcmp(argv[i], "--scores") && i + 1 < argc) scores_dir = argv[++i];
+        else if (!strcmp(argv[i], "--name") && i + 1 < argc) player = argv[++i];
+        else {
+            printf("Usage: tetris_console [--bot PIECES] [--latency FILE] [--shm NAME] [--scores DIR] [--name NAME]\n");
+            return !strcmp(argv[i], "--help") ? 0 : 1;
+        }
+    }
+
+    TermScreen screen;
+    if (!term_init(&screen, TERM_COLS, TERM_ROWS)) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    GameState game;
+    uint32_t seed = (uint32_t)time(NULL);
+    state_init(&game, seed);
+    double started_ms = now_ms();
+    ShmBot* link = NULL;
+    uint32_t link_ack = 0;
+    if (shm_name && !(link = shm_bot_create(shm_name))) {
+        fprintf(stderr, "cannot create shared memory %s\n", shm_name);
+        return 1;
+    }
+    if (link) shm_bot_publish(link, &game, 0);
+    setup_terminal();
+
+    /* Every key that is waiting is applied as soon as poll returns, and
+       the screen is redrawn once per wakeup if anything changed. Each key
+       that changed the game is tagged from the wakeup that brought it to
+       the end of the write that shows its effect. */
+    LatencyLog latency;
+    LatencyTag batch[256];
+    int batched = 0;
+    latency_log_init(&latency);
+    uint64_t wakeups = 0, gravity_steps = 0;
+    unsigned char keys[256];
+    int pending = 0;
+    GravityClock gravity = { -1, 0, 0.0 };
+    gravity_start(&gravity, game.speed_ms);
+    struct pollfd fds[2];
+    fds[0].fd = STDIN_FILENO;
+    fds[0].events = POLLIN;
+    fds[1].fd = gravity.fd;
+    fds[1].events = POLLIN;
+
+    int quit = 0, changed = 1;
+    while (!quit && !(bot_pieces && (game.game_over || game.pieces_placed >= bot_pieces))) {
+        if (changed) {
+            term_compose(&screen, &game);
+            term_flush(&screen, STDOUT_FILENO);
+            changed = 0;
+        }
+        fds[0].revents = fds[1].revents = 0;
+        /* The bot link has no descriptor to wake on, so check it every ms */
+        int timeout = bot_pieces ? 0 : gravity_timeout(&gravity);
+        if (link && (timeout < 0 || timeout > 1)) timeout = 1;
+        int ready = poll(fds, 2, timeout);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        wakeups++;
+        double woke = now_ms();
+
+        if (fds[0].revents & (POLLIN | POLLHUP)) {
+            for (;;) {
+                ssize_t n = read(STDIN_FILENO, keys + pending, sizeof(keys) - pending);
+                if (n == 0 && !bot_pieces) quit = 1;       /* end of input */
+                if (n == 0) fds[0].fd = -1;
+                if (n <= 0) break;
+                int total = pending + (int)n, i = 0, used;
+                for (; i < total; i += used) {
+                    int input = decode_key(keys + i, total - i, &used);
+                    if (input == -3) break;
+                    if (input == -2) quit = 1;
+                    else if (input >= 0 && !bot_pieces && state_input(&game, input) &&
+                             batched < (int)(sizeof(batch) / sizeof(batch[0]))) {
+                        batch[batched].t[LAT_ARRIVE] = woke;
+                        batch[batched].t[LAT_APPLY] = now_ms();
+                        batched++;
+                    }
+                }
+                pending = total - i;
+                memmove(keys, keys + i, pending);
+            }
+        }
+        int due = gravity_due(&gravity, fds[1].revents);
+        for (int i = 0; i < due && !game.game_over && !bot_pieces; i++) {
+            state_tick(&game);
+            gravity_steps++;
+            changed = 1;
+        }
+        if (bot_pieces && !game.game_over) {
+            BotMove mv;
+            if (bot_search(&game, &bot_default_weights, 0, NULL, &mv)) bot_apply(&game, &mv);
+            else game.game_over = 1;
+            changed = 1;
+        }
+        if (link) {
+            ShmCommand c;
+            int moved = 0;
+            while (shm_bot_next_command(link, &c)) {
+                shm_bot_apply(&game, &c);
+                link_ack = c.seq;
+                moved = 1;
+            }
+            if (moved || changed || batched) shm_bot_publish(link, &game, link_ack);
+            if (moved) changed = 1;
+        }
+        if (game.speed_ms != gravity.period_ms) gravity_start(&gravity, game.speed_ms);
+
+        if (batched) {
+            double composed = now_ms();
+            term_compose(&screen, &game);
+            term_flush(&screen, STDOUT_FILENO);
+            double shown = now_ms();
+            for (int i = 0; i < batched; i++) {
+                batch[i].t[LAT_PUBLISH] = composed;
+                batch[i].t[LAT_DISPLAY] = shown;
+                latency_log_add(&latency, &batch[i]);
+            }
+            batched = 0;
+            changed = 0;
+        }
+    }
+    if (gravity.fd >= 0) close(gravity.fd);
+    shm_bot_close(link);
+    restore_terminal();
+
+    const TermStats* st = &screen.stats;
+    printf("%s Final score: %lld\n", game.game_over ? "Game Over!" : "Quit.", (long long)game.score);
+    if (bot_pieces) player = "bot";
+    if (!player || !*player) player = "player";
+    Leaderboard* lb = game.pieces_placed ? lb_open(scores_dir, 0) : NULL;
+    if (lb) {
+        ScoreRecord r, best, top[100];
+        lb_record_game(&r, player, &game, seed, (uint32_t)(now_ms() - started_ms));
+        if (lb_insert(lb, &r) && lb_player_best(lb, player, &best)) {
+            int n = lb_top(lb, top, 100), rank = 0;
+            for (int i = 0; i < n && !rank; i++)
+                if (!memcmp(&top[i], &r, sizeof(r))) rank = i + 1;
+            if (rank) printf("Best for %.*s: %lld. This game is number %d on the leaderboard.\n", LB_NAME_MAX,
+                              best.player, (long long)best.score, rank);
+            else printf("Best for %.*s: %lld.\n", LB_NAME_MAX, best.player, (long long)best.score);
+        }
+        lb_close(lb);
+    }
+    printf("%llu frames, %.0f bytes and %.1f cells per frame on average, %llu bytes at most, %llu bytes total\n",
+           (unsigned long long)st->frames, st->frames ? (double)st->bytes / st->frames : 0.0,
+           st->frames ? (double)st->cells / st->frames : 0.0, (unsigned long long)st->max_bytes,
+           (unsigned long long)st->bytes);
+    LatencySummary lag;
+    latency_summary(&latency, LAT_STAGE_TOTAL, &lag);
+    printf("%llu wakeups, %llu gravity steps, %zu inputs shown: latency ms p50 %.3f p99 %.3f max %.3f\n",
+           (unsigned long long)wakeups, (unsigned long long)gravity_steps, lag.count, lag.p50, lag.p99, lag.max);
+    if (latency_path && !latency_write_report(&latency, latency_path, "tetris_console"))
+        fprintf(stderr, "cannot write %s\n", latency_path);
+    latency_log_free(&latency);
+    term_free(&screen);
+    return 0;
+}
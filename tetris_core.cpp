@@ -0,0 +1,264 @@
+#include "tetris_core.h"
+#include "tetris_trace.h"
+#include <string.h>
+
+/* Tetromino pieces */
+Tetromino pieces[7] = {
+    /* I */
+    { { 0x00F0, 0, 0, 0 }, 1 },
+    /* O */
+    { { 0x0066, 0, 0, 0 }, 2 },
+    /* T */
+    { { 0x0072, 0, 0, 0 }, 3 },
+    /* S */
+    { { 0x0036, 0, 0, 0 }, 4 },
+    /* Z */
+    { { 0x0063, 0, 0, 0 }, 5 },
+    /* J */
+    { { 0x0071, 0, 0, 0 }, 6 },
+    /* L */
+    { { 0x0074, 0, 0, 0 }, 7 },
+};
+
+const int line_scores[5] = {0, 100, 300, 500, 800};
+
+uint16_t rotate_mask_once(uint16_t m) {
+    uint16_t out = 0;
+    for (int b = 0; b < 16; b++) {
+        if ((m >> b) & 1u) {
+            int x = b % 4;
+            int y = b / 4;
+            int nx = y;
+            int ny = 3 - x;
+            int nb = ny * 4 + nx;
+            out |= (1u << nb);
+        }
+    }
+    return out;
+}
+
+uint16_t rotate_mask(uint16_t m, int rot) {
+    rot &= 3;
+    uint16_t r = m;
+    for (int i = 0; i < rot; i++) r = rotate_mask_once(r);
+    return r;
+}
+
+/* Rotations are computed once; the bots call get_mask millions of times */
+typedef struct {
+    uint16_t mask[7][4];
+} MaskTable;
+
+static MaskTable build_mask_table(void) {
+    MaskTable t;
+    for (int p = 0; p < 7; p++)
+        for (int r = 0; r < 4; r++)
+            t.mask[p][r] = rotate_mask(pieces[p].mask[0], r);
+    return t;
+}
+
+uint16_t get_mask(int piece, int rot) {
+    static const MaskTable table = build_mask_table();
+    if (piece < 0 || piece >= 7) return 0;
+    return table.mask[piece][rot & 3];
+}
+
+int board_fits(const int b[HEIGHT][WIDTH], int piece, int px, int py, int rot) {
+    TRACE_COUNT("board_fits");
+    uint16_t m = get_mask(piece, rot);
+    for (int i = 0; i < 16; i++) {
+        if ((m >> i) & 1u) {
+            int x = i % 4 + px;
+            int y = i / 4 + py;
+            if (x < 0 || x >= WIDTH || y < 0 || y >= HEIGHT) return 0;
+            if (b[y][x]) return 0;
+        }
+    }
+    return 1;
+}
+
+void board_lock(int b[HEIGHT][WIDTH], int piece, int px, int py, int rot) {
+    uint16_t m = get_mask(piece, rot);
+    for (int i = 0; i < 16; i++) {
+        if ((m >> i) & 1u) {
+            int x = i % 4 + px;
+            int y = i / 4 + py;
+            if (y >= 0 && y < HEIGHT && x >= 0 && x < WIDTH)
+                b[y][x] = pieces[piece].color;
+        }
+    }
+}
+
+int board_clear_lines(int b[HEIGHT][WIDTH]) {
+    TRACE_SCOPE("board_clear_lines");
+    int y, x, full, cleared = 0;
+    for (y = HEIGHT - 1; y >= 0; y--) {
+        full = 1;
+        for (x = 0; x < WIDTH; x++) {
+            if (b[y][x] == 0) { full = 0; break; }
+        }
+        if (full) {
+            int yy;
+            for (yy = y; yy > 0; yy--) {
+                for (x = 0; x < WIDTH; x++) b[yy][x] = b[yy-1][x];
+            }
+            for (x = 0; x < WIDTH; x++) b[0][x] = 0;
+            cleared++;
+            y++;
+        }
+    }
+    return cleared;
+}
+
+int speed_for_level(int level) {
+    int ms = 600 - (level - 1) * 25;
+    if (ms < 60) ms = 60;
+    return ms;
+}
+
+int score_for_clear(int cleared, int level) {
+    if (cleared < 0) cleared = 0;
+    if (cleared > 4) cleared = 4;
+    return line_scores[cleared] * level;
+}
+
+/* One move of the rows that stay, then only the new rows are written */
+int board_insert_garbage(int b[HEIGHT][WIDTH], int rows, int hole, int color) {
+    if (rows <= 0) return 0;
+    if (rows > HEIGHT) rows = HEIGHT;
+    int overflow = 0;
+    for (int y = 0; y < rows && !overflow; y++)
+        for (int x = 0; x < WIDTH; x++)
+            if (b[y][x]) { overflow = 1; break; }
+    memmove(b[0], b[rows], sizeof(b[0]) * (HEIGHT - rows));
+    for (int y = HEIGHT - rows; y < HEIGHT; y++)
+        for (int x = 0; x < WIDTH; x++) b[y][x] = x == hole ? 0 : color;
+    return overflow;
+}
+
+uint32_t rng_next(uint32_t* state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+int rng_piece(uint32_t* state) {
+    return (int)(rng_next(state) % 7);
+}
+
+void state_init(GameState* s, uint32_t seed) {
+    memset(s, 0, sizeof(*s));
+    s->rng = seed ? seed : 0x9E3779B9u;
+    s->level = 1;
+    s->next_piece = -1;
+    s->hold_piece = -1;
+    s->speed_ms = speed_for_level(1);
+    state_spawn_piece(s);
+}
+
+void state_set_piece(GameState* s, int piece) {
+    s->cur_piece = piece;
+    s->cur_rot = 0;
+    s->cur_x = SPAWN_X;
+    s->cur_y = 0;
+    if (!board_fits(s->board, piece, s->cur_x, s->cur_y, 0)) s->game_over = 1;
+}
+
+void state_spawn_piece(GameState* s) {
+    if (s->next_piece < 0) s->next_piece = rng_piece(&s->rng);
+    state_set_piece(s, s->next_piece);
+    s->next_piece = rng_piece(&s->rng);
+    s->hold_used = 0;
+}
+
+/* Lock the current piece, score the clear and spawn the next one */
+int state_lock_piece(GameState* s) {
+    board_lock(s->board, s->cur_piece, s->cur_x, s->cur_y, s->cur_rot);
+    int cleared = board_clear_lines(s->board);
+    if (cleared > 0) {
+        s->score += score_for_clear(cleared, s->level);
+        s->lines_total += cleared;
+        s->level = s->lines_total / 10 + 1;
+        s->speed_ms = speed_for_level(s->level);
+    }
+    s->pieces_placed++;
+    state_spawn_piece(s);
+    return cleared;
+}
+
+int state_hard_drop(GameState* s) {
+    int drop = 0;
+    while (board_fits(s->board, s->cur_piece, s->cur_x, s->cur_y + 1, s->cur_rot)) {
+        s->cur_y++;
+        drop++;
+    }
+    s->score += drop * 2;
+    return state_lock_piece(s);
+}
+
+void state_tick(GameState* s) {
+    if (s->game_over) return;
+    if (board_fits(s->board, s->cur_piece, s->cur_x, s->cur_y + 1, s->cur_rot)) {
+        s->cur_y++;
+    } else {
+        state_lock_piece(s);
+    }
+}
+
+/* Swap with the hold slot once per piece; returns 0 if hold is used up */
+int state_hold(GameState* s) {
+    if (s->game_over || s->hold_used) return 0;
+    if (s->hold_piece < 0) {
+        s->hold_piece = s->cur_piece;
+        state_spawn_piece(s);
+    } else {
+        int temp = s->hold_piece;
+        s->hold_piece = s->cur_piece;
+        state_set_piece(s, temp);
+    }
+    s->hold_used = 1;
+    return 1;
+}
+
+/* Returns 1 if the input changed the state */
+int state_input(GameState* s, int input) {
+    static const int kicks[8][2] = {
+        {0,0}, {-1,0}, {1,0}, {-2,0}, {2,0}, {0,-1}, {-1,-1}, {1,-1}
+    };
+    if (s->game_over) return 0;
+    switch (input) {
+    case INPUT_LEFT:
+    case INPUT_RIGHT: {
+        int dx = input == INPUT_LEFT ? -1 : 1;
+        if (!board_fits(s->board, s->cur_piece, s->cur_x + dx, s->cur_y, s->cur_rot)) return 0;
+        s->cur_x += dx;
+        return 1;
+    }
+    case INPUT_ROTATE: {
+        int nr = (s->cur_rot + 1) % 4;
+        for (int k = 0; k < 8; k++) {
+            if (board_fits(s->board, s->cur_piece, s->cur_x + kicks[k][0], s->cur_y + kicks[k][1], nr)) {
+                s->cur_x += kicks[k][0];
+                s->cur_y += kicks[k][1];
+                s->cur_rot = nr;
+                return 1;
+            }
+        }
+        return 0;
+    }
+    case INPUT_SOFT_DROP:
+        if (!board_fits(s->board, s->cur_piece, s->cur_x, s->cur_y + 1, s->cur_rot)) return 0;
+        s->cur_y++;
+        s->score += 1;
+        return 1;
+    case INPUT_HARD_DROP:
+        state_hard_drop(s);
+        return 1;
+    case INPUT_HOLD:
+        return state_hold(s);
+    }
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,84 @@
+#ifndef TETRIS_CORE_H
+#define TETRIS_CORE_H
+
+/* Platform-neutral game rules. Shared by the Win32 game and the headless tools,
+   so nothing in here may include windows.h. */
+
+#include <stdint.h>
+
+#ifndef WIDTH
+#define WIDTH 10
+#endif
+#ifndef HEIGHT
+#define HEIGHT 30
+#endif
+
+#define SPAWN_X ((WIDTH - 4) / 2)
+
+/* Tetromino structure */
+typedef struct {
+    uint16_t mask[4];
+    int color;
+} Tetromino;
+
+/* Tetromino definitions */
+extern Tetromino pieces[7];
+
+/* Points per cleared line count, multiplied by level */
+extern const int line_scores[5];
+
+/* Self-contained game state for headless play (bots, tools, servers) */
+typedef struct {
+    int board[HEIGHT][WIDTH];
+    int cur_piece, cur_rot;
+    int cur_x, cur_y;
+    int64_t score;
+    int level, lines_total;
+    int next_piece, hold_piece, hold_used;
+    int speed_ms, game_over;
+    int pieces_placed;
+    uint32_t rng;
+} GameState;
+
+/* Mask helpers */
+uint16_t rotate_mask_once(uint16_t m);
+uint16_t rotate_mask(uint16_t m, int rot);
+uint16_t get_mask(int piece, int rot);
+
+/* Board rules, used by both the global game and GameState */
+int board_fits(const int b[HEIGHT][WIDTH], int piece, int px, int py, int rot);
+void board_lock(int b[HEIGHT][WIDTH], int piece, int px, int py, int rot);
+int board_clear_lines(int b[HEIGHT][WIDTH]);
+/* Pushes the stack up by rows and fills them from the bottom, solid but
+   for the hole column. Returns 1 if a filled cell went off the top. */
+int board_insert_garbage(int b[HEIGHT][WIDTH], int rows, int hole, int color);
+int speed_for_level(int level);
+int score_for_clear(int cleared, int level);
+
+/* Seeded piece generator (xorshift32) */
+uint32_t rng_next(uint32_t* state);
+int rng_piece(uint32_t* state);
+
+/* GameState functions */
+void state_init(GameState* s, uint32_t seed);
+void state_set_piece(GameState* s, int piece);
+void state_spawn_piece(GameState* s);
+int state_lock_piece(GameState* s);
+int state_hard_drop(GameState* s);
+void state_tick(GameState* s);
+int state_hold(GameState* s);
+
+/* Player input on a GameState, with the window's controls and kicks */
+enum {
+    INPUT_LEFT = 0,
+    INPUT_RIGHT,
+    INPUT_ROTATE,
+    INPUT_SOFT_DROP,
+    INPUT_HARD_DROP,
+    INPUT_HOLD,
+    INPUT_COUNT
+};
+
+int state_input(GameState* s, int input);
+
+#endif /* TETRIS_CORE_H */
@@ -0,0 +1,216 @@
+#include "tetris_dirty.h"
+#include <string.h>
+
+void dirty_capture(const RenderScene* s, int window_height, DirtyState* out) {
+    memset(out, 0, sizeof(*out));
+    memcpy(out->board, s->board, sizeof(out->board));
+    out->cur_piece = s->cur_piece;
+    out->cur_rot = s->cur_rot;
+    out->cur_x = s->cur_x;
+    out->cur_y = s->cur_y;
+    out->next_piece = s->next_piece;
+    out->hold_piece = s->hold_piece;
+    out->score = s->score;
+    out->level = s->level;
+    out->lines_total = s->lines_total;
+    out->board_phase = s->animation_frame % 60;
+    out->panel_phase = s->animation_frame % 120;
+    out->have_hint = s->have_hint;
+    if (s->have_hint) {
+        out->hint_piece = s->hint_piece;
+        out->hint_rot = s->hint_rot;
+        out->hint_x = s->hint_x;
+        out->hint_y = s->hint_y;
+        out->hint_depth = s->hint_depth;
+        out->hint_hold = s->hint_hold;
+        out->hint_latency_ms = s->hint_latency_ms;
+    }
+    out->window_width = s->window_width;
+    out->window_height = window_height;
+    out->cell_size = s->cell_size;
+    out->cell_gap = s->cell_gap;
+    out->board_left = s->board_left;
+    out->board_top = s->board_top;
+    out->side_left = s->side_left;
+    out->logo_width = s->logo_width;
+    out->logo_height = s->logo_height;
+}
+
+static DirtyRect make_rect(int l, int t, int r, int b) {
+    DirtyRect x = { l, t, r, b };
+    return x;
+}
+
+static int overlaps(const DirtyRect* a, const DirtyRect* b) {
+    return a->left < b->right && b->left < a->right && a->top < b->bottom && b->top < a->bottom;
+}
+
+static DirtyRect unite(const DirtyRect* a, const DirtyRect* b) {
+    return make_rect(a->left < b->left ? a->left : b->left, a->top < b->top ? a->top : b->top,
+                     a->right > b->right ? a->right : b->right, a->bottom > b->bottom ? a->bottom : b->bottom);
+}
+
+static int64_t area(const DirtyRect* r) {
+    return (int64_t)(r->right - r->left) * (r->bottom - r->top);
+}
+
+/* Adds r, merging it with anything it overlaps so the list stays
+   disjoint; when full, r joins the rect it grows least */
+void dirty_add(DirtyList* list, DirtyRect r) {
+    if (list->full || r.right <= r.left || r.bottom <= r.top) return;
+    for (int i = 0; i < list->count; ) {
+        if (overlaps(&list->rect[i], &r)) {
+            r = unite(&list->rect[i], &r);
+            list->rect[i] = list->rect[--list->count];
+            i = 0;
+        } else {
+            i++;
+        }
+    }
+    if (list->count < DIRTY_MAX_RECTS) {
+        list->rect[list->count++] = r;
+        return;
+    }
+    int best = 0;
+    int64_t best_growth = 0;
+    for (int i = 0; i < list->count; i++) {
+        DirtyRect u = unite(&list->rect[i], &r);
+        int64_t growth = area(&u) - area(&list->rect[i]);
+        if (i == 0 || growth < best_growth) {
+            best = i;
+            best_growth = growth;
+        }
+    }
+    DirtyRect u = unite(&list->rect[best], &r);
+    list->rect[best] = list->rect[--list->count];
+    dirty_add(list, u);
+}
+
+/* Cell bounds plus a pixel for the border stroke */
+static DirtyRect cell_rect(const DirtyState* s, int x, int y) {
+    int pitch = s->cell_size + s->cell_gap;
+    int l = s->board_left + x * pitch;
+    int t = s->board_top + y * pitch;
+    return make_rect(l - 1, t - 1, l + s->cell_size + 1, t + s->cell_size + 1);
+}
+
+static void add_footprint(DirtyList* list, const DirtyState* s, int piece, int rot, int px, int py) {
+    if (piece < 0) return;
+    uint16_t m = get_mask(piece, rot);
+    DirtyRect box;
+    int any = 0;
+    for (int b = 0; b < 16; b++) {
+        if (!((m >> b) & 1u)) continue;
+        int x = b % 4 + px;
+        int y = b / 4 + py;
+        if (x < 0 || x >= WIDTH || y < 0 || y >= HEIGHT) continue;
+        DirtyRect c = cell_rect(s, x, y);
+        box = any ? unite(&box, &c) : c;
+        any = 1;
+    }
+    if (any) dirty_add(list, box);
+}
+
+static DirtyRect board_frame(const DirtyState* s) {
+    int pitch = s->cell_size + s->cell_gap;
+    return make_rect(s->board_left - 4, s->board_top - 4,
+                     s->board_left + WIDTH * pitch + s->cell_gap + 5,
+                     s->board_top + HEIGHT * pitch + s->cell_gap + 5);
+}
+
+static DirtyRect preview_rect(const DirtyState* s, int ox, int oy) {
+    int span = (int)(4 * (s->cell_size / 1.5f + 2.0f)) + 1;
+    return make_rect(ox - 1, oy - 1, ox + span, oy + span);
+}
+
+static void diff_board(const DirtyState* a, const DirtyState* b, DirtyList* out) {
+    if (a->board_phase != b->board_phase) {
+        dirty_add(out, board_frame(b));
+        return;
+    }
+    for (int y = 0; y < HEIGHT; y++) {
+        int lo = -1, hi = -1;
+        for (int x = 0; x < WIDTH; x++) {
+            if (a->board[y][x] == b->board[y][x]) continue;
+            if (lo < 0) lo = x;
+            hi = x;
+        }
+        if (lo < 0) continue;
+        DirtyRect l = cell_rect(b, lo, y);
+        DirtyRect r = cell_rect(b, hi, y);
+        dirty_add(out, unite(&l, &r));
+    }
+    if (a->cur_piece != b->cur_piece || a->cur_rot != b->cur_rot ||
+        a->cur_x != b->cur_x || a->cur_y != b->cur_y) {
+        add_footprint(out, a, a->cur_piece, a->cur_rot, a->cur_x, a->cur_y);
+        add_footprint(out, b, b->cur_piece, b->cur_rot, b->cur_x, b->cur_y);
+    }
+    if (a->have_hint != b->have_hint || a->hint_piece != b->hint_piece || a->hint_rot != b->hint_rot ||
+        a->hint_x != b->hint_x || a->hint_y != b->hint_y) {
+        if (a->have_hint) add_footprint(out, a, a->hint_piece, a->hint_rot, a->hint_x, a->hint_y);
+        if (b->have_hint) add_footprint(out, b, b->hint_piece, b->hint_rot, b->hint_x, b->hint_y);
+    }
+}
+
+static void diff_panel(const DirtyState* a, const DirtyState* b, DirtyList* out) {
+    int sx = b->side_left;
+    int sy = b->board_top;
+    int hy = sy + 110;
+    DirtyRect values = make_rect(sx + 60, hy + 50, sx + 260, hy + 120);
+    DirtyRect hint_text = make_rect(sx, hy + 120, sx + 300, hy + 165);
+    if (a->panel_phase != b->panel_phase) {
+        /* Panel plus text that runs past its right edge */
+        dirty_add(out, make_rect(sx - 11, sy - 28, sx + 171, sy + 361));
+        dirty_add(out, values);
+        dirty_add(out, hint_text);
+        return;
+    }
+    if (a->next_piece != b->next_piece) dirty_add(out, preview_rect(b, sx, sy));
+    if (a->hold_piece != b->hold_piece) dirty_add(out, preview_rect(b, sx, hy));
+    if (a->score != b->score) dirty_add(out, make_rect(sx + 60, hy + 50, sx + 260, hy + 80));
+    if (a->level != b->level) dirty_add(out, make_rect(sx + 60, hy + 70, sx + 260, hy + 100));
+    if (a->lines_total != b->lines_total) dirty_add(out, make_rect(sx + 60, hy + 90, sx + 260, hy + 120));
+    if (a->have_hint != b->have_hint ||
+        (b->have_hint && (a->hint_depth != b->hint_depth || a->hint_hold != b->hint_hold ||
+                          (int)(a->hint_latency_ms * 10.0f) != (int)(b->hint_latency_ms * 10.0f))))
+        dirty_add(out, hint_text);
+}
+
+/* prev == NULL, a new window size or a new layout repaints everything */
+void dirty_diff(const DirtyState* prev, const DirtyState* cur, DirtyList* out) {
+    out->count = 0;
+    out->full = 0;
+    if (!prev || prev->window_width != cur->window_width || prev->window_height != cur->window_height ||
+        prev->cell_size != cur->cell_size || prev->cell_gap != cur->cell_gap ||
+        prev->board_left != cur->board_left || prev->board_top != cur->board_top ||
+        prev->side_left != cur->side_left ||
+        prev->logo_width != cur->logo_width || prev->logo_height != cur->logo_height) {
+        out->full = 1;
+        return;
+    }
+    diff_board(prev, cur, out);
+    diff_panel(prev, cur, out);
+}
+
+/* Pixels inside the window covered by the list */
+uint64_t dirty_area(const DirtyList* list, int window_width, int window_height) {
+    if (list->full) return (uint64_t)window_width * (uint64_t)window_height;
+    uint64_t total = 0;
+    for (int i = 0; i < list->count; i++) {
+        DirtyRect r = list->rect[i];
+        if (r.left < 0) r.left = 0;
+        if (r.top < 0) r.top = 0;
+        if (r.right > window_width) r.right = window_width;
+        if (r.bottom > window_height) r.bottom = window_height;
+        if (r.right > r.left && r.bottom > r.top) total += (uint64_t)area(&r);
+    }
+    return total;
+}
+
+void dirty_stats_add(DirtyStats* st, const DirtyList* list, int window_width, int window_height) {
+    st->frames++;
+    if (list->full) st->full_frames++;
+    st->rects += list->full ? 1 : (uint64_t)list->count;
+    st->last_pixels = dirty_area(list, window_width, window_height);
+    st->pixels += st->last_pixels;
+}
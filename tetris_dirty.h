@@ -0,0 +1,54 @@
+#ifndef TETRIS_DIRTY_H
+#define TETRIS_DIRTY_H
+
+/* Dirty rectangles from state diffs. dirty_capture copies what a frame
+   depends on; dirty_diff compares two captures and lists the window
+   areas whose pixels can differ. Both are pure and portable. */
+
+#include "tetris_render.h"
+
+#define DIRTY_MAX_RECTS 16
+
+typedef struct {
+    int left, top, right, bottom;
+} DirtyRect;
+
+typedef struct {
+    DirtyRect rect[DIRTY_MAX_RECTS];
+    int count;
+    int full;               /* whole window */
+} DirtyList;
+
+/* Render-relevant state, by value */
+typedef struct {
+    int board[HEIGHT][WIDTH];
+    int cur_piece, cur_rot, cur_x, cur_y;
+    int next_piece, hold_piece;
+    int64_t score;
+    int level, lines_total;
+    int board_phase, panel_phase;    /* animation steps of the two pulses */
+    int have_hint;
+    int hint_piece, hint_rot, hint_x, hint_y;
+    int hint_depth, hint_hold;
+    float hint_latency_ms;
+    int window_width, window_height;
+    int cell_size, cell_gap;
+    int board_left, board_top, side_left;
+    float logo_width, logo_height;
+} DirtyState;
+
+typedef struct {
+    uint64_t frames;
+    uint64_t full_frames;
+    uint64_t rects;
+    uint64_t pixels;        /* total repainted */
+    uint64_t last_pixels;   /* repainted by the latest frame */
+} DirtyStats;
+
+void dirty_capture(const RenderScene* scene, int window_height, DirtyState* out);
+void dirty_diff(const DirtyState* prev, const DirtyState* cur, DirtyList* out);
+void dirty_add(DirtyList* list, DirtyRect r);
+uint64_t dirty_area(const DirtyList* list, int window_width, int window_height);
+void dirty_stats_add(DirtyStats* st, const DirtyList* list, int window_width, int window_height);
+
+#endif /* TETRIS_DIRTY_H */
@@ -0,0 +1,145 @@
+// Dirty rectangle check - captures two frames of the default layout, diffs
+// them and compares the result with the exact rectangles expected: no
+// change, one cell, a run of cells, the score, both at once, a pulse step
+// and the cases that repaint the whole window
+// Build: g++ -O2 -std=c++17 tetris_dirty_check.cpp tetris_dirty.cpp tetris_render.cpp tetris_core.cpp -o tetris_dirty_check
+//        cl /O2 /std:c++17 /EHsc tetris_dirty_check.cpp tetris_dirty.cpp tetris_render.cpp tetris_core.cpp
+// Usage: tetris_dirty_check                     (exit status 1 on any failure)
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tetris_dirty.h"
+
+static int failures = 0;
+
+static void check(int ok, const char* what) {
+    if (!ok) {
+        printf("FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+static void capture(const GameState* s, int animation_frame, DirtyState* out) {
+    RenderScene scene;
+    render_scene_from_state(&scene, s, animation_frame);
+    dirty_capture(&scene, RENDER_WINDOW_HEIGHT, out);
+}
+
+/* The list must hold exactly the wanted rects, in any order */
+static void check_rects(const char* what, const DirtyList* got, const DirtyRect* want, int count) {
+    int ok = !got->full && got->count == count;
+    for (int i = 0; ok && i < count; i++) {
+        int found = 0;
+        for (int j = 0; j < got->count; j++)
+            if (!memcmp(&got->rect[j], &want[i], sizeof(DirtyRect))) found = 1;
+        ok = found;
+    }
+    if (!ok) {
+        printf("%s: got%s", what, got->full ? " full" : "");
+        for (int j = 0; j < got->count; j++)
+            printf(" (%d,%d,%d,%d)", got->rect[j].left, got->rect[j].top, got->rect[j].right, got->rect[j].bottom);
+        printf("\n");
+    }
+    check(ok, what);
+}
+
+/* Default layout: cells at 24 + 30x, 72 + 30y, 28 px square; panel at 372 */
+static void check_diffs(void) {
+    GameState s;
+    state_init(&s, 1);
+    DirtyState a, b;
+    DirtyList dl;
+
+    capture(&s, 0, &a);
+    capture(&s, 0, &b);
+    dirty_diff(&a, &b, &dl);
+    check_rects("an unchanged frame is clean", &dl, NULL, 0);
+
+    capture(&s, 120, &b);
+    dirty_diff(&a, &b, &dl);
+    check_rects("a frame in the same pulse phase is clean", &dl, NULL, 0);
+
+    s.board[10][3] = 1;
+    capture(&s, 0, &b);
+    dirty_diff(&a, &b, &dl);
+    static const DirtyRect one_cell[] = { {113, 371, 143, 401} };
+    check_rects("one cell repaints its bounds plus the border", &dl, one_cell, 1);
+
+    s.board[29][1] = 2;
+    s.board[29][6] = 2;
+    capture(&s, 0, &a);
+    s.board[29][1] = 0;
+    s.board[29][6] = 0;
+    capture(&s, 0, &b);
+    dirty_diff(&a, &b, &dl);
+    static const DirtyRect run[] = { {53, 941, 233, 971} };
+    check_rects("cells changed in one row repaint the span between them", &dl, run, 1);
+
+    capture(&s, 0, &a);
+    s.score += 40;
+    capture(&s, 0, &b);
+    dirty_diff(&a, &b, &dl);
+    static const DirtyRect score[] = { {432, 232, 632, 262} };
+    check_rects("a new score repaints its value only", &dl, score, 1);
+
+    capture(&s, 0, &a);
+    s.board[10][3] = 0;
+    s.score += 40;
+    capture(&s, 0, &b);
+    dirty_diff(&a, &b, &dl);
+    static const DirtyRect both[] = { {113, 371, 143, 401}, {432, 232, 632, 262} };
+    check_rects("a cell and the score give two disjoint rects", &dl, both, 2);
+
+    capture(&s, 1, &b);
+    dirty_diff(&a, &b, &dl);
+    static const DirtyRect pulse[] = {
+        {20, 68, 331, 979},     /* board frame */
+        {361, 44, 672, 433},    /* panel with its values and hint text */
+    };
+    check_rects("a pulse step repaints the board frame and the panel", &dl, pulse, 2);
+}
+
+static void check_full_repaints(void) {
+    GameState s;
+    state_init(&s, 1);
+    DirtyState a, b;
+    DirtyList dl;
+    capture(&s, 0, &a);
+
+    dirty_diff(NULL, &a, &dl);
+    check(dl.full && !dl.count, "the first frame repaints everything");
+    check(dirty_area(&dl, RENDER_WINDOW_WIDTH, RENDER_WINDOW_HEIGHT) ==
+          (uint64_t)RENDER_WINDOW_WIDTH * RENDER_WINDOW_HEIGHT, "a full repaint covers the window");
+
+    b = a;
+    b.window_width += 40;
+    dirty_diff(&a, &b, &dl);
+    check(dl.full && !dl.count, "a resize repaints everything");
+
+    b = a;
+    b.window_height -= 10;
+    dirty_diff(&a, &b, &dl);
+    check(dl.full, "a new window height repaints everything");
+
+    b = a;
+    b.logo_width = 120.0f;
+    dirty_diff(&a, &b, &dl);
+    check(dl.full, "a loaded logo repaints everything");
+
+    b = a;
+    dirty_diff(&a, &b, &dl);
+    check(!dl.full && !dl.count && !dirty_area(&dl, RENDER_WINDOW_WIDTH, RENDER_WINDOW_HEIGHT),
+          "a clean frame covers no pixels");
+}
+
+int main(int argc, char** argv) {
+    (void)argv;
+    if (argc > 1) {
+        printf("Usage: tetris_dirty_check\n");
+        return 0;
+    }
+    check_diffs();
+    check_full_repaints();
+    printf("%s\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
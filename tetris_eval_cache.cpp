@@ -0,0 +1,213 @@
+#include "tetris_eval_cache.h"
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <new>
+
+#define EVAL_CACHE_WAYS 4
+#define EVAL_CACHE_USED_BIT (1ull << 63)
+
+static_assert(WIDTH <= 16, "a row must fit half a key word");
+
+/* One entry guarded by a sequence counter: odd while a writer owns it.
+   The hash is 0 in an empty slot. */
+typedef struct {
+    std::atomic<uint32_t> seq;
+    std::atomic<uint32_t> value;
+    std::atomic<uint64_t> key;
+    std::atomic<uint32_t> words[EVAL_CACHE_KEY_WORDS];
+} CacheSlot;
+
+/* Shared counters live on their own cache lines */
+typedef struct {
+    alignas(64) std::atomic<uint64_t> value;
+} CacheCounter;
+
+struct EvalCache {
+    CacheSlot* slots;
+    std::atomic<uint8_t>* ref;  /* clock reference bits, one per slot */
+    size_t slot_count;
+    size_t bucket_mask;
+    CacheCounter lookups, hits, stores, evictions, lookup_ns, computes, compute_ns;
+};
+
+static uint64_t mix64(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ull;
+    x ^= x >> 33;
+    return x;
+}
+
+static uint32_t float_bits(float f) {
+    uint32_t u;
+    memcpy(&u, &f, sizeof(u));
+    return u;
+}
+
+static float bits_float(uint32_t u) {
+    float f;
+    memcpy(&f, &u, sizeof(f));
+    return f;
+}
+
+static void count(CacheCounter* c, uint64_t n) {
+    c->value.fetch_add(n, std::memory_order_relaxed);
+}
+
+EvalCache* eval_cache_create(size_t budget_bytes) {
+    size_t per_slot = sizeof(CacheSlot) + sizeof(std::atomic<uint8_t>);
+    size_t buckets = 1;
+    while ((buckets * 2) * EVAL_CACHE_WAYS * per_slot <= budget_bytes) buckets *= 2;
+
+    EvalCache* c = new (std::nothrow) EvalCache();
+    if (!c) return NULL;
+    c->slot_count = buckets * EVAL_CACHE_WAYS;
+    c->bucket_mask = buckets - 1;
+    c->slots = new (std::nothrow) CacheSlot[c->slot_count];
+    c->ref = new (std::nothrow) std::atomic<uint8_t>[c->slot_count];
+    if (!c->slots || !c->ref) {
+        eval_cache_destroy(c);
+        return NULL;
+    }
+    eval_cache_clear(c);
+    return c;
+}
+
+void eval_cache_destroy(EvalCache* c) {
+    if (!c) return;
+    delete[] c->slots;
+    delete[] c->ref;
+    delete c;
+}
+
+/* Not safe against concurrent lookups; call between searches */
+void eval_cache_clear(EvalCache* c) {
+    for (size_t i = 0; i < c->slot_count; i++) {
+        c->slots[i].seq.store(0, std::memory_order_relaxed);
+        c->slots[i].value.store(0, std::memory_order_relaxed);
+        c->slots[i].key.store(0, std::memory_order_relaxed);
+        for (int w = 0; w < EVAL_CACHE_KEY_WORDS; w++) c->slots[i].words[w].store(0, std::memory_order_relaxed);
+        c->ref[i].store(0, std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+void eval_cache_key(const int b[HEIGHT][WIDTH], int piece, EvalCacheKey* out) {
+    memset(out->words, 0, sizeof(out->words));
+    uint64_t hash = (uint64_t)(piece + 1);
+    for (int y = 0; y < HEIGHT; y++) {
+        uint32_t row = 0;
+        for (int x = 0; x < WIDTH; x++)
+            if (b[y][x]) row |= 1u << x;
+        out->words[y / 2] |= row << (16 * (y & 1));
+        hash = mix64(hash ^ row) + (uint64_t)y;
+    }
+    out->words[EVAL_CACHE_KEY_WORDS - 1] = (uint32_t)(piece + 1);
+    out->hash = hash | EVAL_CACHE_USED_BIT;
+}
+
+static CacheSlot* bucket_of(EvalCache* c, uint64_t key, size_t* first) {
+    *first = (size_t)(mix64(key) & c->bucket_mask) * EVAL_CACHE_WAYS;
+    return &c->slots[*first];
+}
+
+static uint64_t now_ns(void) {
+    using namespace std::chrono;
+    return (uint64_t)duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+int eval_cache_lookup(EvalCache* c, const EvalCacheKey* key, float* value) {
+    uint64_t t0 = now_ns();
+    size_t first;
+    CacheSlot* bucket = bucket_of(c, key->hash, &first);
+    int hit = 0;
+    for (int i = 0; i < EVAL_CACHE_WAYS && !hit; i++) {
+        CacheSlot* s = &bucket[i];
+        uint32_t s1 = s->seq.load(std::memory_order_acquire);
+        if (s1 & 1u) continue;
+        if (s->key.load(std::memory_order_relaxed) != key->hash) continue;
+        /* Same hash; the board itself decides */
+        int same = 1;
+        for (int w = 0; w < EVAL_CACHE_KEY_WORDS; w++)
+            same &= s->words[w].load(std::memory_order_relaxed) == key->words[w];
+        uint32_t v = s->value.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (s->seq.load(std::memory_order_relaxed) != s1 || !same) continue;
+        c->ref[first + i].store(1, std::memory_order_relaxed);
+        *value = bits_float(v);
+        hit = 1;
+    }
+    count(&c->lookups, 1);
+    if (hit) count(&c->hits, 1);
+    count(&c->lookup_ns, now_ns() - t0);
+    return hit;
+}
+
+void eval_cache_store(EvalCache* c, const EvalCacheKey* key, float value) {
+    size_t first;
+    CacheSlot* bucket = bucket_of(c, key->hash, &first);
+
+    /* Reuse a way with the same hash or an empty one, else run the clock
+       over the bucket */
+    int victim = -1;
+    for (int i = 0; i < EVAL_CACHE_WAYS; i++) {
+        uint64_t k = bucket[i].key.load(std::memory_order_relaxed);
+        if (k == key->hash || k == 0) { victim = i; break; }
+    }
+    if (victim < 0) {
+        int start = (int)(mix64(key->hash) >> 60) % EVAL_CACHE_WAYS;
+        for (int step = 0; step < 2 * EVAL_CACHE_WAYS; step++) {
+            int i = (start + step) % EVAL_CACHE_WAYS;
+            if (c->ref[first + i].exchange(0, std::memory_order_relaxed) == 0) {
+                victim = i;
+                break;
+            }
+        }
+        if (victim < 0) victim = start;
+        count(&c->evictions, 1);
+    }
+
+    CacheSlot* s = &bucket[victim];
+    uint32_t seq = s->seq.load(std::memory_order_relaxed);
+    if ((seq & 1u) || !s->seq.compare_exchange_strong(seq, seq + 1, std::memory_order_relaxed))
+        return;
+    std::atomic_thread_fence(std::memory_order_release);
+    s->key.store(key->hash, std::memory_order_relaxed);
+    for (int w = 0; w < EVAL_CACHE_KEY_WORDS; w++) s->words[w].store(key->words[w], std::memory_order_relaxed);
+    s->value.store(float_bits(value), std::memory_order_relaxed);
+    s->seq.store(seq + 2, std::memory_order_release);
+    c->ref[first + victim].store(1, std::memory_order_relaxed);
+    count(&c->stores, 1);
+}
+
+void eval_cache_note_compute(EvalCache* c, uint64_t ns) {
+    count(&c->computes, 1);
+    count(&c->compute_ns, ns);
+}
+
+void eval_cache_stats(const EvalCache* c, EvalCacheStats* out) {
+    out->lookups = c->lookups.value.load(std::memory_order_relaxed);
+    out->hits = c->hits.value.load(std::memory_order_relaxed);
+    out->misses = out->lookups - out->hits;
+    out->stores = c->stores.value.load(std::memory_order_relaxed);
+    out->evictions = c->evictions.value.load(std::memory_order_relaxed);
+    out->lookup_ns = c->lookup_ns.value.load(std::memory_order_relaxed);
+    out->computes = c->computes.value.load(std::memory_order_relaxed);
+    out->compute_ns = c->compute_ns.value.load(std::memory_order_relaxed);
+    out->slots = c->slot_count;
+    out->bytes = c->slot_count * (sizeof(CacheSlot) + sizeof(std::atomic<uint8_t>));
+}
+
+double eval_cache_hit_rate(const EvalCacheStats* st) {
+    return st->lookups ? (double)st->hits / (double)st->lookups : 0.0;
+}
+
+/* Hits times the average cost of a miss, minus the time spent looking up */
+double eval_cache_saved_ms(const EvalCacheStats* st) {
+    if (!st->computes) return 0.0;
+    double per_compute = (double)st->compute_ns / (double)st->computes;
+    return (st->hits * per_compute - (double)st->lookup_ns) / 1e6;
+}
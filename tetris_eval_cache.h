@@ -0,0 +1,49 @@
+#ifndef TETRIS_EVAL_CACHE_H
+#define TETRIS_EVAL_CACHE_H
+
+#include <stddef.h>
+#include "tetris_core.h"
+
+/* Search value cache keyed by the exact board and piece to place. A hash
+   picks the bucket and a hit is only taken once the stored board matches
+   cell for cell, so a cached value is the value of this very board.
+   Lookups never block; stores skip a slot another thread is writing.
+   Values depend on the bot weights, so clear the cache when they change. */
+
+#define EVAL_CACHE_KEY_WORDS ((HEIGHT + 1) / 2 + 1)
+
+typedef struct EvalCache EvalCache;
+
+/* Occupied cells as one bit per column, two rows per word, then the piece */
+typedef struct {
+    uint64_t hash;
+    uint32_t words[EVAL_CACHE_KEY_WORDS];
+} EvalCacheKey;
+
+typedef struct {
+    uint64_t lookups;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t stores;
+    uint64_t evictions;
+    uint64_t lookup_ns;   /* total time spent inside lookups */
+    uint64_t computes;    /* values computed by callers after a miss */
+    uint64_t compute_ns;  /* total time spent computing them */
+    size_t slots;
+    size_t bytes;
+} EvalCacheStats;
+
+EvalCache* eval_cache_create(size_t budget_bytes);
+void eval_cache_destroy(EvalCache* c);
+void eval_cache_clear(EvalCache* c);
+
+void eval_cache_key(const int b[HEIGHT][WIDTH], int piece, EvalCacheKey* out);
+int eval_cache_lookup(EvalCache* c, const EvalCacheKey* key, float* value);
+void eval_cache_store(EvalCache* c, const EvalCacheKey* key, float value);
+void eval_cache_note_compute(EvalCache* c, uint64_t ns);
+
+void eval_cache_stats(const EvalCache* c, EvalCacheStats* out);
+double eval_cache_hit_rate(const EvalCacheStats* st);
+double eval_cache_saved_ms(const EvalCacheStats* st);
+
+#endif /* TETRIS_EVAL_CACHE_H */
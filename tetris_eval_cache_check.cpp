@@ -0,0 +1,117 @@
+// Evaluation cache check - boards that look alike but differ never share a
+// value, a hash collision is caught by the stored board, and a depth-2
+// search plays the same moves with and without the cache
+// Build: g++ -O2 -std=c++17 tetris_eval_cache_check.cpp tetris_bot.cpp tetris_eval_cache.cpp tetris_core.cpp -o tetris_eval_cache_check
+//        cl /O2 /std:c++17 /EHsc tetris_eval_cache_check.cpp tetris_bot.cpp tetris_eval_cache.cpp tetris_core.cpp
+// Usage: tetris_eval_cache_check                (exit status 1 on any failure)
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tetris_bot.h"
+
+static int failures = 0;
+
+static void check(int ok, const char* what) {
+    if (!ok) {
+        printf("FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+/* Bottom rows given top first, '#' filled; the rest of the board is empty */
+static void make_board(int b[HEIGHT][WIDTH], const char* const* rows, int count) {
+    memset(b, 0, sizeof(int) * HEIGHT * WIDTH);
+    for (int r = 0; r < count; r++)
+        for (int x = 0; x < WIDTH && rows[r][x]; x++)
+            b[HEIGHT - count + r][x] = rows[r][x] == '#';
+}
+
+/* Same column heights, hole count and rows with holes; the holes sit in
+   different columns */
+static void check_lookalike_boards(EvalCache* c) {
+    static const char* const a_rows[] = { "##########", "#.########", "##########" };
+    static const char* const b_rows[] = { "##########", "########.#", "##########" };
+    int a[HEIGHT][WIDTH], b[HEIGHT][WIDTH];
+    make_board(a, a_rows, 3);
+    make_board(b, b_rows, 3);
+    EvalCacheKey ka, kb;
+    eval_cache_key(a, 0, &ka);
+    eval_cache_key(b, 0, &kb);
+    eval_cache_clear(c);
+    eval_cache_store(c, &ka, 1.0f);
+    float v = 0;
+    check(!eval_cache_lookup(c, &kb, &v), "a board with its hole elsewhere misses");
+    check(eval_cache_lookup(c, &ka, &v) && v == 1.0f, "the stored board hits with its own value");
+
+    EvalCacheKey ka_other_piece;
+    eval_cache_key(a, 1, &ka_other_piece);
+    check(!eval_cache_lookup(c, &ka_other_piece, &v), "the same board with another piece misses");
+}
+
+/* Two boards forced onto one hash: the stored cells tell them apart */
+static void check_forced_collision(EvalCache* c) {
+    static const char* const a_rows[] = { "#...######" };
+    static const char* const b_rows[] = { "######...#" };
+    int a[HEIGHT][WIDTH], b[HEIGHT][WIDTH];
+    make_board(a, a_rows, 1);
+    make_board(b, b_rows, 1);
+    EvalCacheKey ka, kb;
+    eval_cache_key(a, 2, &ka);
+    eval_cache_key(b, 2, &kb);
+    kb.hash = ka.hash;
+    eval_cache_clear(c);
+    eval_cache_store(c, &ka, 5.0f);
+    float v = 0;
+    check(!eval_cache_lookup(c, &kb, &v), "a colliding hash with another board misses");
+    eval_cache_store(c, &kb, 7.0f);
+    v = 0;
+    check(!eval_cache_lookup(c, &ka, &v) || v == 5.0f, "a colliding store never hands its value to the other board");
+    check(eval_cache_lookup(c, &kb, &v) && v == 7.0f, "the colliding board hits with its own value");
+}
+
+/* The cache may only save time: the moves chosen must not change */
+static void check_search_unchanged(EvalCache* c) {
+    eval_cache_clear(c);
+    int differ = 0, moves = 0;
+    for (uint32_t seed = 1; seed <= 4; seed++) {
+        GameState with, without;
+        state_init(&with, seed);
+        state_init(&without, seed);
+        while (!with.game_over && with.pieces_placed < 150) {
+            BotMove m1, m2;
+            int f1 = bot_search(&with, &bot_default_weights, 2, c, &m1);
+            int f2 = bot_search(&without, &bot_default_weights, 2, NULL, &m2);
+            if (f1 != f2 || (f1 && memcmp(&m1, &m2, sizeof(m1)))) {
+                differ++;
+                break;
+            }
+            if (!f1) break;
+            bot_apply(&with, &m1);
+            bot_apply(&without, &m2);
+            moves++;
+        }
+    }
+    EvalCacheStats st;
+    eval_cache_stats(c, &st);
+    printf("depth-2 search: %d moves, cache hit rate %.1f%%\n", moves, eval_cache_hit_rate(&st) * 100.0);
+    check(!differ, "a depth-2 search picks the same moves with and without the cache");
+}
+
+int main(int argc, char** argv) {
+    (void)argv;
+    if (argc > 1) {
+        printf("Usage: tetris_eval_cache_check\n");
+        return 0;
+    }
+    EvalCache* c = eval_cache_create(4u << 20);
+    if (!c) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    check_lookalike_boards(c);
+    check_forced_collision(c);
+    check_search_unchanged(c);
+    eval_cache_destroy(c);
+    printf("%s\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,329 @@
+// Replay video exporter - re-simulates a recorded game and streams it as
+// Y4M video or a PPM sequence, rendering frames on a thread pool
+// Build: g++ -O2 -std=c++17 -pthread tetris_export.cpp tetris_replay.cpp tetris_soft.cpp tetris_glyphs.cpp tetris_render.cpp tetris_font.cpp tetris_bot.cpp tetris_eval_cache.cpp tetris_core.cpp -o tetris_export
+//        cl /O2 /std:c++17 /EHsc tetris_export.cpp tetris_replay.cpp tetris_soft.cpp tetris_glyphs.cpp tetris_render.cpp tetris_font.cpp tetris_bot.cpp tetris_eval_cache.cpp tetris_core.cpp
+// Usage: tetris_export --replay game.rep --out game.y4m
+//        tetris_export --bot 7 --record game.rep --out - | ffplay -
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
+#include "tetris_replay.h"
+#include "tetris_soft.h"
+#include "tetris_bot.h"
+
+enum { FORMAT_Y4M, FORMAT_PPM };
+enum { SLOT_FREE, SLOT_QUEUED, SLOT_DONE };
+
+/* One frame in flight: the state to draw and, once rendered, its bytes */
+typedef struct {
+    int state;
+    int index;
+    GameState game;
+    std::vector<unsigned char> out;
+} Slot;
+
+/* Simulation, render and output stages share a ring of slots, so at most
+   `slots` frames exist at once however fast each stage runs */
+typedef struct {
+    const Replay* replay;
+    int format;
+    int fps;
+    int frames;
+    int slots;
+    std::vector<Slot> slot;
+    std::mutex lock;
+    std::condition_variable produced, rendered, written;
+    int queued;         /* frames handed to the renderers */
+    int taken;          /* frames a renderer has started */
+    int done_writing;   /* frames written */
+} Pipeline;
+
+static void usage(void) {
+    printf("Usage: tetris_export [options]\n"
+           "  --replay FILE    recorded game to export\n"
+           "  --bot SEED       record a bot game instead\n"
+           "  --pieces N       bot game length (default 200)\n"
+           "  --pps X          bot pieces per second (default 2)\n"
+           "  --record FILE    save the bot game as a replay\n"
+           "  --out FILE       output file, - for stdout (default -)\n"
+           "  --format F       y4m or ppm (default y4m)\n"
+           "  --fps N          frames per second of game time (default 60)\n"
+           "  --threads N      render threads (default: all cores)\n");
+}
+
+static size_t frame_bytes(int format) {
+    size_t pixels = (size_t)RENDER_WINDOW_WIDTH * RENDER_WINDOW_HEIGHT;
+    return format == FORMAT_Y4M ? pixels * 3 / 2 : pixels * 3;
+}
+
+/* Full-range BT.601 4:2:0, chroma from the average of each 2x2 block */
+static void to_y4m(const SoftFrame* f, unsigned char* out) {
+    int w = f->width, h = f->height;
+    unsigned char* yp = out;
+    unsigned char* up = out + (size_t)w * h;
+    unsigned char* vp = up + (size_t)(w / 2) * (h / 2);
+    /* Frames are mostly runs of one color, so repeat the last result
+       instead of converting every pixel */
+    uint32_t last = 0;
+    unsigned char last_y = 0;
+    for (int y = 0; y < h; y++) {
+        const uint32_t* p = f->pixels + (size_t)y * f->stride;
+        for (int x = 0; x < w; x++) {
+            if (p[x] != last) {
+                int r = (p[x] >> 16) & 255, g = (p[x] >> 8) & 255, b = p[x] & 255;
+                last = p[x];
+                last_y = (unsigned char)((77 * r + 150 * g + 29 * b + 128) >> 8);
+            }
+            yp[(size_t)y * w + x] = last_y;
+        }
+    }
+    uint32_t last_q[4] = { 0, 0, 0, 0 };
+    unsigned char last_u = 128, last_v = 128;
+    for (int y = 0; y < h / 2; y++) {
+        const uint32_t* p0 = f->pixels + (size_t)(2 * y) * f->stride;
+        const uint32_t* p1 = p0 + f->stride;
+        for (int x = 0; x < w / 2; x++) {
+            uint32_t q[4] = { p0[2 * x], p0[2 * x + 1], p1[2 * x], p1[2 * x + 1] };
+            if (memcmp(q, last_q, sizeof(q))) {
+                int r = 0, g = 0, b = 0;
+                for (int i = 0; i < 4; i++) {
+                    r += (q[i] >> 16) & 255;
+                    g += (q[i] >> 8) & 255;
+                    b += q[i] & 255;
+                }
+                memcpy(last_q, q, sizeof(q));
+                last_u = (unsigned char)(((-43 * r - 85 * g + 128 * b + 512) >> 10) + 128);
+                last_v = (unsigned char)(((128 * r - 107 * g - 21 * b + 512) >> 10) + 128);
+            }
+            up[(size_t)y * (w / 2) + x] = last_u;
+            vp[(size_t)y * (w / 2) + x] = last_v;
+        }
+    }
+}
+
+static void to_ppm(const SoftFrame* f, unsigned char* out) {
+    for (int y = 0; y < f->height; y++) {
+        const uint32_t* p = f->pixels + (size_t)y * f->stride;
+        for (int x = 0; x < f->width; x++) {
+            *out++ = (unsigned char)(p[x] >> 16);
+            *out++ = (unsigned char)(p[x] >> 8);
+            *out++ = (unsigned char)p[x];
+        }
+    }
+}
+
+static void render_worker(Pipeline* p) {
+    static thread_local RenderList list;
+    SoftFrame frame;
+    if (!soft_frame_init(&frame, RENDER_WINDOW_WIDTH, RENDER_WINDOW_HEIGHT)) return;
+    for (;;) {
+        int index;
+        {
+            std::unique_lock<std::mutex> lk(p->lock);
+            p->produced.wait(lk, [p] { return p->taken < p->queued || p->taken == p->frames; });
+            if (p->taken == p->frames) break;
+            index = p->taken++;
+        }
+        Slot* s = &p->slot[index % p->slots];
+        RenderScene scene;
+        render_scene_from_state(&scene, &s->game, index);
+        render_build(&scene, RENDER_INLINE_LAYERS, &list);
+        soft_render_list(&frame, &list);
+        s->out.resize(frame_bytes(p->format));
+        if (p->format == FORMAT_Y4M) to_y4m(&frame, s->out.data());
+        else to_ppm(&frame, s->out.data());
+        {
+            std::lock_guard<std::mutex> lk(p->lock);
+            s->state = SLOT_DONE;
+        }
+        p->rendered.notify_all();
+    }
+    soft_frame_free(&frame);
+}
+
+/* Game time of each frame; the piece in play falls from the spawn row
+   towards where the next record locks it */
+static void simulate(Pipeline* p) {
+    const Replay* r = p->replay;
+    GameState g;
+    state_init(&g, r->header.seed);
+    uint32_t m = 0;
+    for (int k = 0; k < p->frames; k++) {
+        uint32_t t = (uint32_t)((uint64_t)k * 1000 / p->fps);
+        while (m < r->header.moves && r->move[m].t_ms <= t) {
+            if (replay_apply(&g, &r->move[m]) < 0) g.game_over = 1;
+            m++;
+        }
+        GameState shown = g;
+        if (m < r->header.moves && !g.game_over && !(r->move[m].flags & REPLAY_HOLD)) {
+            const ReplayMove* mv = &r->move[m];
+            uint32_t t0 = m ? r->move[m - 1].t_ms : 0;
+            uint32_t span = mv->t_ms > t0 ? mv->t_ms - t0 : 1;
+            int y = (int)((int64_t)mv->y * (t - t0) / span);
+            if (board_fits(g.board, g.cur_piece, mv->x, y, mv->rot & 3)) {
+                shown.cur_rot = mv->rot & 3;
+                shown.cur_x = mv->x;
+                shown.cur_y = y;
+            }
+        }
+
+        Slot* s = &p->slot[k % p->slots];
+        {
+            std::unique_lock<std::mutex> lk(p->lock);
+            p->written.wait(lk, [p, k] { return k - p->done_writing < p->slots; });
+        }
+        s->index = k;
+        s->game = shown;
+        {
+            std::lock_guard<std::mutex> lk(p->lock);
+            s->state = SLOT_QUEUED;
+            p->queued++;
+        }
+        p->produced.notify_one();
+    }
+}
+
+static int record_bot_game(Replay* r, uint32_t seed, int pieces, double pps) {
+    EvalCache* cache = eval_cache_create(16u << 20);
+    GameState s;
+    state_init(&s, seed);
+    replay_begin(r, seed);
+    while (!s.game_over && s.pieces_placed < pieces) {
+        BotMove mv;
+        if (!bot_search(&s, &bot_default_weights, 1, cache, &mv)) break;
+        uint32_t t = (uint32_t)((s.pieces_placed + 1) * 1000.0 / pps);
+        if (!replay_add(r, t, mv.use_hold, mv.place.rot, mv.place.x, mv.place.y)) break;
+        bot_apply(&s, &mv);
+    }
+    uint32_t end = r->header.moves ? r->move[r->header.moves - 1].t_ms : 0;
+    replay_finish(r, &s, end + 1000);
+    eval_cache_destroy(cache);
+    return r->header.moves > 0;
+}
+
+int main(int argc, char** argv) {
+    const char* replay_path = NULL;
+    const char* record_path = NULL;
+    const char* out_path = "-";
+    int bot_seed = -1, pieces = 200, fps = 60;
+    int format = FORMAT_Y4M;
+    double pps = 2.0;
+    int threads = (int)std::thread::hardware_concurrency();
+
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        const char* v = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!strcmp(a, "--help")) { usage(); return 0; }
+        if (!v) { usage(); return 1; }
+        if (!strcmp(a, "--replay")) replay_path = v;
+        else if (!strcmp(a, "--bot")) bot_seed = atoi(v);
+        else if (!strcmp(a, "--pieces")) pieces = atoi(v);
+        else if (!strcmp(a, "--pps")) pps = atof(v);
+        else if (!strcmp(a, "--record")) record_path = v;
+        else if (!strcmp(a, "--out")) out_path = v;
+        else if (!strcmp(a, "--format")) format = !strcmp(v, "ppm") ? FORMAT_PPM : FORMAT_Y4M;
+        else if (!strcmp(a, "--fps")) fps = atoi(v);
+        else if (!strcmp(a, "--threads")) threads = atoi(v);
+        else { usage(); return 1; }
+        i++;
+    }
+    if (threads < 1) threads = 1;
+    if (fps < 1) fps = 1;
+    if (pps <= 0.0) pps = 2.0;
+
+    Replay replay;
+    if (replay_path) {
+        if (!replay_load(&replay, replay_path)) {
+            fprintf(stderr, "cannot read replay %s\n", replay_path);
+            return 1;
+        }
+    } else if (bot_seed >= 0) {
+        if (!record_bot_game(&replay, (uint32_t)bot_seed, pieces, pps)) {
+            fprintf(stderr, "bot game is empty\n");
+            return 1;
+        }
+        if (record_path && !replay_save(&replay, record_path)) {
+            fprintf(stderr, "cannot write %s\n", record_path);
+            return 1;
+        }
+    } else {
+        usage();
+        return 1;
+    }
+
+    FILE* out = stdout;
+    if (strcmp(out_path, "-")) {
+        out = fopen(out_path, "wb");
+        if (!out) {
+            fprintf(stderr, "cannot write %s\n", out_path);
+            return 1;
+        }
+    } else {
+#ifdef _WIN32
+        _setmode(_fileno(stdout), _O_BINARY);
+#endif
+    }
+
+    Pipeline p;
+    p.replay = &replay;
+    p.format = format;
+    p.fps = fps;
+    p.frames = (int)((uint64_t)replay.header.duration_ms * fps / 1000) + 1;
+    p.slots = threads * 2 + 2;
+    p.slot.resize(p.slots);
+    for (Slot& s : p.slot) s.state = SLOT_FREE;
+    p.queued = p.taken = p.done_writing = 0;
+
+    if (format == FORMAT_Y4M)
+        fprintf(out, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", RENDER_WINDOW_WIDTH, RENDER_WINDOW_HEIGHT, fps);
+
+    auto t0 = std::chrono::steady_clock::now();
+    std::thread sim(simulate, &p);
+    std::vector<std::thread> pool;
+    for (int i = 0; i < threads; i++) pool.emplace_back(render_worker, &p);
+
+    /* Output stage: frames leave in order whatever order they finish in */
+    int ok = 1;
+    for (int k = 0; k < p.frames; k++) {
+        Slot* s = &p.slot[k % p.slots];
+        {
+            std::unique_lock<std::mutex> lk(p.lock);
+            p.rendered.wait(lk, [s, k] { return s->state == SLOT_DONE && s->index == k; });
+        }
+        if (format == FORMAT_Y4M) fputs("FRAME\n", out);
+        else fprintf(out, "P6\n%d %d\n255\n", RENDER_WINDOW_WIDTH, RENDER_WINDOW_HEIGHT);
+        if (ok && fwrite(s->out.data(), 1, s->out.size(), out) != s->out.size()) ok = 0;
+        {
+            std::lock_guard<std::mutex> lk(p.lock);
+            s->state = SLOT_FREE;
+            p.done_writing++;
+        }
+        p.written.notify_one();
+    }
+    sim.join();
+    p.produced.notify_all();
+    for (std::thread& t : pool) t.join();
+    if (out != stdout) ok = fclose(out) == 0 && ok;
+    else fflush(out);
+
+    double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    double video = p.frames / (double)fps;
+    fprintf(stderr, "%d frames (%u pieces, %.1f s of game) in %.2f s: %.1f frames/s, %.1fx real time, %d render threads\n",
+            p.frames, replay.header.moves, video, s, p.frames / s, video / s, threads);
+    replay_free(&replay);
+    if (!ok) {
+        fprintf(stderr, "write failed\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,19 @@
+#ifndef TETRIS_FONT_H
+#define TETRIS_FONT_H
+
+/* Built-in 5x7 bitmap font for printable ASCII, used where DirectWrite is
+   not available (software rendering, tools). Column-major: bit y of
+   column x is the pixel at (x, y), row 0 at the top. */
+
+#include <stdint.h>
+
+#define FONT_FIRST 32
+#define FONT_LAST 126
+#define FONT_COLS 5
+#define FONT_ROWS 7
+
+extern const uint8_t font5x7[FONT_LAST - FONT_FIRST + 1][FONT_COLS];
+
+int font_pixel(char ch, int x, int y);
+
+#endif /* TETRIS_FONT_H */
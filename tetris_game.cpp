@@ -1,123 +1,135 @@
 #include "tetris.h"
 #include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
 
 void safe_release(IUnknown* p) {
     if (p) p->Release();
 }
 
-uint16_t rotate_mask_once(uint16_t m) {
-    uint16_t out = 0;
-    for (int b = 0; b < 16; b++) {
-        if ((m >> b) & 1u) {
-            int x = b % 4;
-            int y = b / 4;
-            int nx = y;
-            int ny = 3 - x;
-            int nb = ny * 4 + nx;
-            out |= (1u << nb);
-        }
-    }
-    return out;
+/* Simulation thread: give the hint worker half a gravity step to refine
+   its answer for the new piece */
+static void piece_spawned(const GameState* s, void* ctx) {
+    (void)ctx;
+    hint_submit(s, s->speed_ms / 2);
 }
 
-uint16_t rotate_mask(uint16_t m, int rot) {
-    rot &= 3;
-    uint16_t r = m;
-    for (int i = 0; i < rot; i++) r = rotate_mask_once(r);
-    return r;
+static void frame_published(void* ctx) {
+    (void)ctx;
+    render_thread_wake(RENDER_WAKE_FRAME);
 }
 
-uint16_t get_mask(int piece, int rot) {
-    if (piece < 0 || piece >= 7) return 0;
-    uint16_t base = pieces[piece].mask[0];
-    return rotate_mask(base, rot & 3);
-}
+static LatencyLog latency_log;
+static const char* latency_path = NULL;
+static uint32_t game_seed;
+static double game_started_ms;
 
-int fits_piece(int piece, int px, int py, int rot) {
-    uint16_t m = get_mask(piece, rot);
-    for (int b = 0; b < 16; b++) {
-        if ((m >> b) & 1u) {
-            int bx = b % 4;
-            int by = b / 4;
-            int x = bx + px;
-            int y = by + py;
-            if (x < 0 || x >= WIDTH || y < 0 || y >= HEIGHT) return 0;
-            if (board[y][x]) return 0;
-        }
+/* probe_path: where to write input latency percentiles on exit, or NULL */
+void game_start(const char* probe_path) {
+    SimConfig cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.seed = (uint32_t)time(NULL) | 1;
+    game_seed = cfg.seed;
+    game_started_ms = sim_now_ms();
+    cfg.on_spawn = piece_spawned;
+    cfg.on_frame = frame_published;
+    if (probe_path) {
+        latency_log_init(&latency_log);
+        latency_path = probe_path;
+        cfg.probe = &latency_log;
     }
-    return 1;
+    sim_start(&cfg);
 }
 
-void update_speed(void) {
-    int ms = 600 - (level - 1) * 25;
-    if (ms < 60) ms = 60;
-    speed_ms = ms;
+/* Played games go to the leaderboard in tetris_scores under the
+   working directory, by the Windows user name */
+static void record_score(void) {
+    const GameState* s = sim_final_state();
+    if (!s->pieces_placed) return;
+    Leaderboard* lb = lb_open("tetris_scores", 0);
+    if (!lb) return;
+    const char* player = getenv("USERNAME");
+    ScoreRecord r;
+    lb_record_game(&r, player && *player ? player : "player", s, game_seed,
+                   (uint32_t)(sim_now_ms() - game_started_ms));
+    lb_insert(lb, &r);
+    lb_close(lb);
 }
 
-void set_current_piece(int piece) {
-    cur_piece = piece;
-    cur_rot = 0;
-    cur_x = 3;
-    cur_y = 0;
-    if (!fits_piece(cur_piece, cur_x, cur_y, cur_rot)) game_over = 1;
+void game_stop(void) {
+    sim_stop();
+    record_score();
 }
 
-void spawn_piece(void) {
-    if (next_piece < 0) next_piece = rand() % 7;
-    set_current_piece(next_piece);
-    next_piece = rand() % 7;
-    hold_used = 0;
+/* Once the render thread is gone too: per-stage timings to the debugger
+   output and the latency probe to its file */
+void game_report(void) {
+    const SimStats* st = sim_stats();
+    char line[160];
+    snprintf(line, sizeof(line), "tetris: %llu inputs, %llu frames published, %llu drawn\n",
+             (unsigned long long)st->inputs, (unsigned long long)st->frames_published,
+             (unsigned long long)st->frames_shown);
+    OutputDebugStringA(line);
+    for (int i = 0; i < SIM_STAGE_COUNT; i++) {
+        SimSummary sum;
+        sim_series_summary(&st->stage[i], &sum);
+        snprintf(line, sizeof(line), "tetris: %-18s n %llu mean %.3f p50 %.3f p99 %.3f max %.3f jitter %.3f ms\n",
+                 sim_stage_names[i], (unsigned long long)sum.count, sum.mean, sum.p50, sum.p99, sum.max,
+                 sum.jitter);
+        OutputDebugStringA(line);
+    }
+    if (latency_path) {
+        latency_write_report(&latency_log, latency_path, "tetris_game");
+        latency_log_free(&latency_log);
+        latency_path = NULL;
+    }
 }
 
-void lock_piece(void) {
-    uint16_t m = get_mask(cur_piece, cur_rot);
-    for (int b = 0; b < 16; b++) {
-        if ((m >> b) & 1u) {
-            int bx = b % 4;
-            int by = b / 4;
-            int x = bx + cur_x;
-            int y = by + cur_y;
-            if (y >= 0 && y < HEIGHT && x >= 0 && x < WIDTH)
-                board[y][x] = pieces[cur_piece].color;
-        }
+/* 'T': timings so far, next to the executable; a no-op unless built
+   with TETRIS_TRACE */
+void game_dump_trace(void) {
+#ifdef TETRIS_TRACE
+    trace_write_chrome("tetris_trace.json");
+    FILE* fp = fopen("tetris_trace.txt", "w");
+    if (fp) {
+        trace_write_histograms(fp);
+        fclose(fp);
     }
+#endif
 }
 
-int clear_lines(void) {
-    int y, x, full, cleared = 0;
-    for (y = HEIGHT - 1; y >= 0; y--) {
-        full = 1;
-        for (x = 0; x < WIDTH; x++) {
-            if (board[y][x] == 0) { full = 0; break; }
-        }
-        if (full) {
-            int yy;
-            for (yy = y; yy > 0; yy--) {
-                for (x = 0; x < WIDTH; x++) board[yy][x] = board[yy-1][x];
-            }
-            for (x = 0; x < WIDTH; x++) board[0][x] = 0;
-            cleared++;
-            y++;
+static uint32_t spectate_seed = 1;
+
+/* Switches between the player's game and the spectator grid; the bot
+   games are created on first use and keep their progress while hidden,
+   counting as active games only while shown. Render thread only. */
+void spectate_toggle(void) {
+    if (!spectate_games) {
+        spectate_games = (GameState*)malloc(SPECTATE_MAX_BOARDS * sizeof(GameState));
+        if (!spectate_games) return;
+        if (!spectate_batch_init(&spectate_batch, SPECTATE_MAX_BOARDS, HEIGHT)) {
+            free(spectate_games);
+            spectate_games = NULL;
+            return;
         }
+        for (int i = 0; i < SPECTATE_MAX_BOARDS; i++) state_init(&spectate_games[i], spectate_seed++);
+        metrics_note_alloc("spectate_games", SPECTATE_MAX_BOARDS * sizeof(GameState));
     }
-    return cleared;
+    spectate_on = !spectate_on;
+    /* spectate_tick only runs while the grid is shown */
+    metrics_gauge_add(metrics_gauge("tetris_active_games", "", "Games being simulated"),
+                      spectate_on ? SPECTATE_MAX_BOARDS : -SPECTATE_MAX_BOARDS);
 }
 
-void game_tick(HWND hwnd) {
-    if (fits_piece(cur_piece, cur_x, cur_y + 1, cur_rot)) {
-        cur_y++;
-    } else {
-        lock_piece();
-        int cleared = clear_lines();
-        if (cleared > 0) {
-            const int line_scores[5] = {0, 100, 300, 500, 800};
-            score += line_scores[cleared] * level;
-            lines_total += cleared;
-            level = lines_total / 10 + 1;
-            update_speed();
-            reset_timer(hwnd);
-        }
-        spawn_piece();
+/* One greedy placement per game; finished games start over */
+void spectate_tick(void) {
+    for (int i = 0; i < SPECTATE_MAX_BOARDS; i++) {
+        GameState* g = &spectate_games[i];
+        BotMove mv;
+        if (g->game_over || !bot_search(g, &bot_default_weights, 0, NULL, &mv))
+            state_init(g, spectate_seed++);
+        else
+            bot_apply(g, &mv);
     }
-    InvalidateRect(hwnd, NULL, FALSE);
-}
\ No newline at end of file
+}
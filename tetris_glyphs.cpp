@@ -0,0 +1,114 @@
+#include "tetris_glyphs.h"
+#include "tetris_font.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/* Cells in rows of GLYPH_ATLAS_COLUMNS, in character order */
+void glyph_atlas_grid(GlyphAtlas* a, const float* advance, int cell_width, int cell_height) {
+    a->cell_width = cell_width;
+    a->cell_height = cell_height;
+    a->width = GLYPH_ATLAS_COLUMNS * cell_width;
+    a->height = (GLYPH_COUNT + GLYPH_ATLAS_COLUMNS - 1) / GLYPH_ATLAS_COLUMNS * cell_height;
+    for (int i = 0; i < GLYPH_COUNT; i++) {
+        a->glyph[i].x = i % GLYPH_ATLAS_COLUMNS * cell_width;
+        a->glyph[i].y = i / GLYPH_ATLAS_COLUMNS * cell_height;
+        a->glyph[i].advance = advance[i];
+    }
+}
+
+static float overlap(float a0, float a1, float b0, float b1) {
+    float lo = a0 > b0 ? a0 : b0;
+    float hi = a1 < b1 ? a1 : b1;
+    return hi > lo ? hi - lo : 0.0f;
+}
+
+/* The 5x7 font scaled by (scale_x, scale_y); a pixel's coverage is the
+   area of it the scaled font pixels cover, so fractional scales stay
+   smooth */
+int glyph_atlas_build_builtin(GlyphAtlas* a, float scale_x, float scale_y) {
+    float advance[GLYPH_COUNT];
+    for (int i = 0; i < GLYPH_COUNT; i++) advance[i] = (FONT_COLS + 1) * scale_x;
+    memset(a, 0, sizeof(*a));
+    glyph_atlas_grid(a, advance, (int)ceilf(FONT_COLS * scale_x), (int)ceilf(FONT_ROWS * scale_y));
+    a->top = 3.0f;
+    a->alpha = (uint8_t*)calloc((size_t)a->width * a->height, 1);
+    if (!a->alpha) return 0;
+
+    for (int i = 0; i < GLYPH_COUNT; i++) {
+        char ch = (char)(GLYPH_FIRST + i);
+        for (int py = 0; py < a->cell_height; py++) {
+            for (int px = 0; px < a->cell_width; px++) {
+                float cov = 0.0f;
+                for (int gx = 0; gx < FONT_COLS; gx++) {
+                    float ox = overlap((float)px, px + 1.0f, gx * scale_x, (gx + 1) * scale_x);
+                    if (ox <= 0.0f) continue;
+                    for (int gy = 0; gy < FONT_ROWS; gy++)
+                        if (font_pixel(ch, gx, gy))
+                            cov += ox * overlap((float)py, py + 1.0f, gy * scale_y, (gy + 1) * scale_y);
+                }
+                if (cov > 1.0f) cov = 1.0f;
+                a->alpha[(size_t)(a->glyph[i].y + py) * a->width + a->glyph[i].x + px] =
+                    (uint8_t)(cov * 255.0f + 0.5f);
+            }
+        }
+    }
+    return 1;
+}
+
+void glyph_atlas_free(GlyphAtlas* a) {
+    free(a->alpha);
+    a->alpha = NULL;
+}
+
+void text_cache_reset(TextLayoutCache* c) {
+    memset(c, 0, sizeof(*c));
+}
+
+static uint64_t text_key(const char* text, int len) {
+    uint64_t h = 1469598103934665603ull;
+    for (int i = 0; i < len; i++) h = (h ^ (uint8_t)text[i]) * 1099511628211ull;
+    return h ^ (uint64_t)len;
+}
+
+/* Pen positions are rounded to whole pixels so every glyph is an exact
+   copy of its atlas cell; characters outside the atlas draw as spaces.
+   A full cache drops the least recently drawn string, so the fixed
+   captions stay while changing values cycle through. */
+const TextLayout* text_layout(TextLayoutCache* c, const GlyphAtlas* a, const char* text, int len) {
+    if (len > TEXT_MAX_GLYPHS) len = TEXT_MAX_GLYPHS;
+    uint64_t key = text_key(text, len);
+    c->lookups++;
+    for (int i = 0; i < c->used; i++) {
+        TextLayout* t = &c->slot[i];
+        if (t->key == key && t->len == len && !memcmp(t->text, text, len)) {
+            t->last_use = c->lookups;
+            return t;
+        }
+    }
+
+    TextLayout* t;
+    if (c->used < TEXT_LAYOUT_SLOTS) {
+        t = &c->slot[c->used++];
+    } else {
+        t = &c->slot[0];
+        for (int i = 1; i < TEXT_LAYOUT_SLOTS; i++)
+            if (c->slot[i].last_use < t->last_use) t = &c->slot[i];
+        c->evictions++;
+    }
+    t->last_use = c->lookups;
+    c->builds++;
+    t->key = key;
+    t->len = len;
+    memcpy(t->text, text, len);
+    float pen = 0.0f;
+    for (int i = 0; i < len; i++) {
+        int g = (uint8_t)text[i] - GLYPH_FIRST;
+        if (g < 0 || g >= GLYPH_COUNT) g = 0;
+        t->g[i].glyph = (uint8_t)g;
+        t->g[i].x = (int16_t)floorf(pen + 0.5f);
+        pen += a->glyph[g].advance;
+    }
+    t->width = (int)ceilf(pen);
+    return t;
+}
@@ -0,0 +1,64 @@
+#ifndef TETRIS_GLYPHS_H
+#define TETRIS_GLYPHS_H
+
+/* Text from a glyph atlas. Every printable ASCII glyph is rasterized once
+   into a cell of an atlas; a string becomes a cached list of glyph
+   positions, so drawing text is one masked blit per glyph and a string
+   that did not change since the last frame is never laid out again.
+   Portable: the Direct2D side fills the atlas from DirectWrite, the
+   software backend from the built-in 5x7 font. */
+
+#include <stdint.h>
+
+#define GLYPH_FIRST 32
+#define GLYPH_LAST 126
+#define GLYPH_COUNT (GLYPH_LAST - GLYPH_FIRST + 1)
+#define GLYPH_ATLAS_COLUMNS 16
+#define TEXT_MAX_GLYPHS 64
+#define TEXT_LAYOUT_SLOTS 64
+
+typedef struct {
+    int x, y;               /* cell in the atlas */
+    float advance;
+} GlyphInfo;
+
+typedef struct {
+    int width, height;      /* atlas pixels */
+    int cell_width, cell_height;
+    float top;              /* offset from the text rectangle to the cell top */
+    uint8_t* alpha;         /* coverage, width * height; NULL when the backend owns the pixels */
+    GlyphInfo glyph[GLYPH_COUNT];
+} GlyphAtlas;
+
+typedef struct {
+    uint8_t glyph;          /* index into GlyphAtlas.glyph */
+    int16_t x;              /* pen position, whole pixels */
+} PlacedGlyph;
+
+typedef struct {
+    uint64_t key;
+    uint64_t last_use;
+    char text[TEXT_MAX_GLYPHS];
+    int len;
+    int width;
+    PlacedGlyph g[TEXT_MAX_GLYPHS];
+} TextLayout;
+
+typedef struct {
+    TextLayout slot[TEXT_LAYOUT_SLOTS];
+    int used;
+    uint64_t lookups;
+    uint64_t builds;        /* strings laid out since the reset */
+    uint64_t evictions;
+} TextLayoutCache;
+
+/* Atlas */
+void glyph_atlas_grid(GlyphAtlas* a, const float* advance, int cell_width, int cell_height);
+int glyph_atlas_build_builtin(GlyphAtlas* a, float scale_x, float scale_y);
+void glyph_atlas_free(GlyphAtlas* a);
+
+/* Layouts */
+void text_cache_reset(TextLayoutCache* c);
+const TextLayout* text_layout(TextLayoutCache* c, const GlyphAtlas* a, const char* text, int len);
+
+#endif /* TETRIS_GLYPHS_H */
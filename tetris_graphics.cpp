@@ -1,6 +1,8 @@
 #include "tetris.h"
-#include <wchar.h>
-#include <cmath>
+#include <string.h>
+#include <math.h>
+#include <atomic>
+#include <thread>
 
 #pragma comment(lib, "d2d1")
 #pragma comment(lib, "dwrite")
@@ -69,8 +71,53 @@ ID2D1Bitmap* load_image_from_file(ID2D1RenderTarget* rt, const wchar_t* filename
     return bitmap;
 }
 
+/* Rasterizes every HUD glyph once with DirectWrite, white on transparent,
+   so text is drawn as masked blits of atlas cells instead of laid out
+   each frame */
+static void build_glyph_atlas(void) {
+    float advance[GLYPH_COUNT];
+    float widest = 0.0f, line = 0.0f;
+    for (int i = 0; i < GLYPH_COUNT; i++) {
+        wchar_t ch = (wchar_t)(GLYPH_FIRST + i);
+        IDWriteTextLayout* layout = NULL;
+        DWRITE_TEXT_METRICS m;
+        advance[i] = 0.0f;
+        if (SUCCEEDED(dwrite_factory->CreateTextLayout(&ch, 1, text_format, 200.0f, 200.0f, &layout)) &&
+            SUCCEEDED(layout->GetMetrics(&m))) {
+            advance[i] = m.widthIncludingTrailingWhitespace;
+            if (m.widthIncludingTrailingWhitespace > widest) widest = m.widthIncludingTrailingWhitespace;
+            if (m.height > line) line = m.height;
+        }
+        safe_release((IUnknown*)layout);
+    }
+    memset(&hud_atlas, 0, sizeof(hud_atlas));
+    glyph_atlas_grid(&hud_atlas, advance, (int)ceilf(widest) + 2, (int)ceilf(line) + 1);
+    text_cache_reset(&hud_layouts);
+
+    ID2D1BitmapRenderTarget* rt = NULL;
+    if (FAILED(render_target->CreateCompatibleRenderTarget(
+            D2D1::SizeF((FLOAT)hud_atlas.width, (FLOAT)hud_atlas.height), &rt))) return;
+    metrics_note_alloc("glyph_atlas", (size_t)hud_atlas.width * hud_atlas.height * 4);
+    ID2D1SolidColorBrush* white = NULL;
+    rt->CreateSolidColorBrush(D2D1::ColorF(1.0f, 1.0f, 1.0f, 1.0f), &white);
+    rt->BeginDraw();
+    rt->Clear(D2D1::ColorF(0.0f, 0.0f, 0.0f, 0.0f));
+    rt->SetTextAntialiasMode(D2D1_TEXT_ANTIALIAS_MODE_GRAYSCALE);
+    for (int i = 0; white && i < GLYPH_COUNT; i++) {
+        wchar_t ch = (wchar_t)(GLYPH_FIRST + i);
+        const GlyphInfo* g = &hud_atlas.glyph[i];
+        rt->DrawTextW(&ch, 1, text_format, D2D1::RectF((FLOAT)g->x, (FLOAT)g->y,
+                      (FLOAT)(g->x + hud_atlas.cell_width), (FLOAT)(g->y + hud_atlas.cell_height)), white);
+    }
+    if (SUCCEEDED(rt->EndDraw())) rt->GetBitmap(&hud_atlas_bitmap);
+    render_cache_note_creation(&render_cache);
+    safe_release((IUnknown*)white);
+    safe_release((IUnknown*)rt);
+}
+
 void create_d2d_resources(HWND hwnd) {
     if (render_target) return;
+    TRACE_SCOPE("create_d2d_resources");
     if (!d2d_factory) {
         D2D1CreateFactory(D2D1_FACTORY_TYPE_SINGLE_THREADED, &d2d_factory);
     }
@@ -79,7 +126,7 @@ void create_d2d_resources(HWND hwnd) {
     D2D1_SIZE_U size = D2D1::SizeU(rc.right - rc.left, rc.bottom - rc.top);
     d2d_factory->CreateHwndRenderTarget(
         D2D1::RenderTargetProperties(),
-        D2D1::HwndRenderTargetProperties(hwnd, size),
+        D2D1::HwndRenderTargetProperties(hwnd, size, D2D1_PRESENT_OPTIONS_RETAIN_CONTENTS),
         &render_target);
 
     /* Load background image from img folder */
@@ -96,22 +143,15 @@ void create_d2d_resources(HWND hwnd) {
         }
     }
 
-    /* brushes: map piece ids to colors */
-    render_target->CreateSolidColorBrush(D2D1::ColorF(0.2f, 0.8f, 0.9f), &brushes[1]);
-    render_target->CreateSolidColorBrush(D2D1::ColorF(1.0f, 0.85f, 0.2f), &brushes[2]);
-    render_target->CreateSolidColorBrush(D2D1::ColorF(0.8f, 0.3f, 0.9f), &brushes[3]);
-    render_target->CreateSolidColorBrush(D2D1::ColorF(0.3f, 0.9f, 0.5f), &brushes[4]);
-    render_target->CreateSolidColorBrush(D2D1::ColorF(1.0f, 0.3f, 0.3f), &brushes[5]);
-    render_target->CreateSolidColorBrush(D2D1::ColorF(0.3f, 0.6f, 1.0f), &brushes[6]);
-    render_target->CreateSolidColorBrush(D2D1::ColorF(1.0f, 0.6f, 0.2f), &brushes[7]);
-
-    render_target->CreateSolidColorBrush(D2D1::ColorF(0.7f, 0.7f, 0.7f), &brush_border);
-    render_target->CreateSolidColorBrush(D2D1::ColorF(0.12f, 0.12f, 0.12f), &brush_bg);
-    render_target->CreateSolidColorBrush(D2D1::ColorF(0.5f, 0.85f, 0.6f), &brush_label_score);
-    render_target->CreateSolidColorBrush(D2D1::ColorF(0.5f, 0.8f, 1.0f), &brush_label_level);
-    render_target->CreateSolidColorBrush(D2D1::ColorF(0.7f, 0.6f, 1.0f), &brush_label_lines);
-    render_target->CreateSolidColorBrush(D2D1::ColorF(0.8f, 0.9f, 1.0f), &brush_value);
-    render_target->CreateSolidColorBrush(D2D1::ColorF(0.85f, 0.85f, 0.85f), &brush_label);
+    /* One brush per palette color, plus one recolored for dynamic colors */
+    render_cache_reset(&render_cache);
+    for (int i = 1; i < RCOL_DYNAMIC; i++) {
+        const RenderRgba* c = &render_palette[i];
+        render_target->CreateSolidColorBrush(D2D1::ColorF(c->r, c->g, c->b, c->a), &palette_brushes[i]);
+        render_cache_note_creation(&render_cache);
+    }
+    render_target->CreateSolidColorBrush(D2D1::ColorF(0.0f, 0.0f, 0.0f), &brush_dynamic);
+    render_cache_note_creation(&render_cache);
 
     if (!dwrite_factory) {
         DWriteCreateFactory(DWRITE_FACTORY_TYPE_SHARED, __uuidof(IDWriteFactory), reinterpret_cast<IUnknown**>(&dwrite_factory));
@@ -131,27 +171,30 @@ void create_d2d_resources(HWND hwnd) {
             text_format->SetParagraphAlignment(DWRITE_PARAGRAPH_ALIGNMENT_NEAR);
         }
     }
+    if (text_format && !hud_atlas_bitmap) build_glyph_atlas();
 }
 
 void discard_d2d_resources(void) {
-    for (int i = 0; i < 8; i++) {
-        safe_release((IUnknown*)brushes[i]);
-        brushes[i] = NULL;
+    for (int i = 0; i < RCOL_COUNT; i++) {
+        safe_release((IUnknown*)palette_brushes[i]);
+        palette_brushes[i] = NULL;
+    }
+    safe_release((IUnknown*)brush_dynamic);
+    brush_dynamic = NULL;
+    for (int i = 0; i < RENDER_CACHE_SLOTS; i++) {
+        safe_release((IUnknown*)gradient_brushes[i]);
+        gradient_brushes[i] = NULL;
+    }
+    render_cache_reset(&render_cache);
+    for (int i = 0; i < RLAYER_COUNT; i++) {
+        safe_release((IUnknown*)layer_bitmaps[i]);
+        layer_bitmaps[i] = NULL;
+        safe_release((IUnknown*)layer_targets[i]);
+        layer_targets[i] = NULL;
     }
-    safe_release((IUnknown*)brush_border);
-    brush_border = NULL;
-    safe_release((IUnknown*)brush_bg);
-    brush_bg = NULL;
-    safe_release((IUnknown*)brush_label);
-    brush_label = NULL;
-    safe_release((IUnknown*)brush_label_score);
-    brush_label_score = NULL;
-    safe_release((IUnknown*)brush_label_level);
-    brush_label_level = NULL;
-    safe_release((IUnknown*)brush_label_lines);
-    brush_label_lines = NULL;
-    safe_release((IUnknown*)brush_value);
-    brush_value = NULL;
+    layers_device_lost(&layer_cache);
+    safe_release((IUnknown*)hud_atlas_bitmap);
+    hud_atlas_bitmap = NULL;
     safe_release((IUnknown*)background_bitmap);
     background_bitmap = NULL;
     safe_release((IUnknown*)render_target);
@@ -166,319 +209,330 @@ void discard_d2d_resources(void) {
     d2d_factory = NULL;
 }
 
-void draw_cell(ID2D1RenderTarget* rt, int bx, int by, ID2D1SolidColorBrush* brush) {
-    float x = (float)(board_left + bx * (cell_size + cell_gap));
-    float y = (float)(board_top + by * (cell_size + cell_gap));
-    D2D1_RECT_F r = D2D1::RectF(x, y, x + cell_size, y + cell_size);
-
-    /* Main fill */
-    rt->FillRectangle(&r, brush);
-
-    /* Inner highlight - bright edges for 3D effect */
-    ID2D1SolidColorBrush* highlight = NULL;
-    rt->CreateSolidColorBrush(D2D1::ColorF(1.0f, 1.0f, 1.0f, 0.3f), &highlight);
-
-    /* Top highlight - smaller size to fit cell */
-    D2D1_RECT_F top_highlight = D2D1::RectF(x + 1, y + 1, x + cell_size - 1, y + 5);
-    rt->FillRectangle(&top_highlight, highlight);
+/* Gradient brushes are keyed by their colors; a miss creates one into
+   the slot the cache hands out, replacing whatever lived there */
+static ID2D1Brush* gradient_brush(ID2D1RenderTarget* rt, const RenderCmd* c) {
+    int slot;
+    if (!render_cache_acquire(&render_cache, render_gradient_key(c), &slot) || !gradient_brushes[slot]) {
+        safe_release((IUnknown*)gradient_brushes[slot]);
+        gradient_brushes[slot] = NULL;
+        D2D1_GRADIENT_STOP stops[2];
+        stops[0].position = 0.0f;
+        stops[0].color = D2D1::ColorF(c->rgba.r, c->rgba.g, c->rgba.b, c->rgba.a);
+        stops[1].position = 1.0f;
+        stops[1].color = D2D1::ColorF(c->rgba2.r, c->rgba2.g, c->rgba2.b, c->rgba2.a);
+        ID2D1GradientStopCollection* collection = NULL;
+        if (SUCCEEDED(rt->CreateGradientStopCollection(stops, 2, &collection))) {
+            rt->CreateLinearGradientBrush(
+                D2D1::LinearGradientBrushProperties(D2D1::Point2F(0, 0), D2D1::Point2F(0, 1)),
+                collection, &gradient_brushes[slot]);
+            collection->Release();
+        }
+    }
+    ID2D1LinearGradientBrush* brush = gradient_brushes[slot];
+    if (brush) {
+        brush->SetStartPoint(D2D1::Point2F(c->rect.left, c->rect.top));
+        brush->SetEndPoint(D2D1::Point2F(c->rect.left, c->rect.bottom));
+    }
+    return brush;
+}
 
-    /* Left highlight */
-    D2D1_RECT_F left_highlight = D2D1::RectF(x + 1, y + 1, x + 5, y + cell_size - 1);
-    rt->FillRectangle(&left_highlight, highlight);
+static ID2D1Brush* command_brush(const RenderCmd* c) {
+    if (c->color != RCOL_DYNAMIC) return palette_brushes[c->color];
+    if (brush_dynamic) brush_dynamic->SetColor(D2D1::ColorF(c->rgba.r, c->rgba.g, c->rgba.b, c->rgba.a));
+    return brush_dynamic;
+}
 
-    if (highlight) highlight->Release();
+/* Opacity masks need aliased rendering; glyphs sit on whole pixels anyway */
+static void draw_atlas_text(ID2D1RenderTarget* rt, const RenderCmd* c, const char* text, ID2D1Brush* brush) {
+    const TextLayout* t = text_layout(&hud_layouts, &hud_atlas, text, c->text_len);
+    FLOAT x = floorf(c->rect.left + 0.5f);
+    FLOAT y = floorf(c->rect.top + hud_atlas.top + 0.5f);
+    FLOAT w = (FLOAT)hud_atlas.cell_width, h = (FLOAT)hud_atlas.cell_height;
+    D2D1_ANTIALIAS_MODE mode = rt->GetAntialiasMode();
+    rt->SetAntialiasMode(D2D1_ANTIALIAS_MODE_ALIASED);
+    for (int i = 0; i < t->len; i++) {
+        if (t->g[i].glyph == 0) continue;   /* space */
+        const GlyphInfo* g = &hud_atlas.glyph[t->g[i].glyph];
+        D2D1_RECT_F src = D2D1::RectF((FLOAT)g->x, (FLOAT)g->y, g->x + w, g->y + h);
+        D2D1_RECT_F dst = D2D1::RectF(x + t->g[i].x, y, x + t->g[i].x + w, y + h);
+        rt->FillOpacityMask(hud_atlas_bitmap, brush, D2D1_OPACITY_MASK_CONTENT_TEXT_GRAYSCALE, &dst, &src);
+    }
+    rt->SetAntialiasMode(mode);
+}
 
-    /* Dark shadow - bottom and right edges */
-    ID2D1SolidColorBrush* shadow = NULL;
-    rt->CreateSolidColorBrush(D2D1::ColorF(0.0f, 0.0f, 0.0f, 0.4f), &shadow);
+void replay_render_list(ID2D1RenderTarget* rt, const RenderList* list, const RenderRect* clip) {
+    TRACE_SCOPE("replay_render_list");
+    for (int i = 0; i < list->count; i++) {
+        const RenderCmd* c = &list->cmd[i];
+        if (clip && !render_cmd_visible(c, clip)) continue;
+        D2D1_RECT_F r = D2D1::RectF(c->rect.left, c->rect.top, c->rect.right, c->rect.bottom);
+        ID2D1Brush* brush = NULL;
+        switch (c->op) {
+        case RCMD_CLEAR:
+            rt->Clear(D2D1::ColorF(c->rgba.r, c->rgba.g, c->rgba.b, c->rgba.a));
+            break;
+        case RCMD_FILL_RECT:
+            if ((brush = command_brush(c))) rt->FillRectangle(&r, brush);
+            break;
+        case RCMD_STROKE_RECT:
+            if ((brush = command_brush(c))) rt->DrawRectangle(&r, brush, c->width);
+            break;
+        case RCMD_LINE:
+            if ((brush = command_brush(c)))
+                rt->DrawLine(D2D1::Point2F(r.left, r.top), D2D1::Point2F(r.right, r.bottom), brush, c->width);
+            break;
+        case RCMD_GRADIENT:
+            if ((brush = gradient_brush(rt, c))) rt->FillRectangle(&r, brush);
+            break;
+        case RCMD_TEXT:
+            if (hud_atlas_bitmap && (brush = command_brush(c)))
+                draw_atlas_text(rt, c, list->text + c->text_offset, brush);
+            break;
+        case RCMD_BITMAP:
+            if (c->style == RBMP_LOGO && background_bitmap) rt->DrawBitmap(background_bitmap, r, 1.0f);
+            break;
+        case RCMD_LAYER:
+            if (c->style < RLAYER_COUNT && layer_cache.valid[c->style] && layer_bitmaps[c->style]) {
+                D2D1_SIZE_F size = layer_bitmaps[c->style]->GetSize();
+                rt->DrawBitmap(layer_bitmaps[c->style], D2D1::RectF(r.left, r.top, r.left + size.width, r.top + size.height),
+                               1.0f, D2D1_BITMAP_INTERPOLATION_MODE_NEAREST_NEIGHBOR);
+            }
+            break;
+        }
+    }
+}
 
-    /* Bottom shadow */
-    D2D1_RECT_F bottom_shadow = D2D1::RectF(x + 1, y + cell_size - 5, x + cell_size - 1, y + cell_size - 1);
-    rt->FillRectangle(&bottom_shadow, shadow);
+/* Scene for a published simulation frame; the frame must outlive it */
+void build_render_scene(HWND hwnd, const SimFrame* frame, RenderScene* scene) {
+    RECT rc;
+    GetClientRect(hwnd, &rc);
+    render_scene_from_state(scene, &frame->state, frame->animation_frame);
+    scene->window_width = rc.right - rc.left;
+    scene->cell_size = cell_size;
+    scene->cell_gap = cell_gap;
+    scene->board_left = board_left;
+    scene->board_top = board_top;
+    scene->side_left = side_panel_left_offset;
+    if (background_bitmap) {
+        D2D1_SIZE_F logo = background_bitmap->GetSize();
+        scene->logo_width = logo.width;
+        scene->logo_height = logo.height;
+    }
 
-    /* Right shadow */
-    D2D1_RECT_F right_shadow = D2D1::RectF(x + cell_size - 5, y + 1, x + cell_size - 1, y + cell_size - 1);
-    rt->FillRectangle(&right_shadow, shadow);
+    HintResult hint;
+    if (!frame->state.game_over && hint_read(&hint)) {
+        scene->have_hint = 1;
+        scene->hint_piece = hint.move.piece;
+        scene->hint_rot = hint.move.place.rot;
+        scene->hint_x = hint.move.place.x;
+        scene->hint_y = hint.move.place.y;
+        scene->hint_depth = hint.depth;
+        scene->hint_hold = hint.move.use_hold;
+        scene->hint_latency_ms = hint.latency_ms;
+    }
+}
 
-    if (shadow) shadow->Release();
+/* Draws one static layer into its own bitmap, in window coordinates
+   shifted to the layer origin. Text is grayscale since the bitmap is
+   transparent. */
+static void rebuild_layer(const RenderScene* scene, int layer) {
+    TRACE_SCOPE("rebuild_layer");
+    static RenderList layer_list;
+    RenderRect b = layer_cache.bounds[layer];
+    D2D1_SIZE_F size = D2D1::SizeF(ceilf(b.right - b.left), ceilf(b.bottom - b.top));
+    ID2D1BitmapRenderTarget* rt = layer_targets[layer];
+    if (rt) {
+        D2D1_SIZE_F have = rt->GetSize();
+        if (have.width != size.width || have.height != size.height) {
+            safe_release((IUnknown*)layer_bitmaps[layer]);
+            layer_bitmaps[layer] = NULL;
+            safe_release((IUnknown*)rt);
+            rt = layer_targets[layer] = NULL;
+        }
+    }
+    if (!rt) {
+        if (FAILED(render_target->CreateCompatibleRenderTarget(size, &rt))) return;
+        layer_targets[layer] = rt;
+        rt->GetBitmap(&layer_bitmaps[layer]);
+        render_cache_note_creation(&render_cache);
+        metrics_note_alloc("layer_target", (size_t)(size.width * size.height * 4));
+    }
 
-    /* Border outline */
-    ID2D1SolidColorBrush* border = NULL;
-    rt->CreateSolidColorBrush(D2D1::ColorF(0.2f, 0.2f, 0.2f, 0.6f), &border);
-    rt->DrawRectangle(&r, border, 0.8f);
-    if (border) border->Release();
+    render_build_layer(scene, layer, &layer_list);
+    rt->BeginDraw();
+    rt->Clear(D2D1::ColorF(0.0f, 0.0f, 0.0f, 0.0f));
+    rt->SetTransform(D2D1::Matrix3x2F::Translation(-b.left, -b.top));
+    rt->SetTextAntialiasMode(D2D1_TEXT_ANTIALIAS_MODE_GRAYSCALE);
+    replay_render_list(rt, &layer_list, NULL);
+    if (SUCCEEDED(rt->EndDraw())) layers_mark_built(&layer_cache, layer);
 }
 
-void on_paint(HWND hwnd) {
-    create_d2d_resources(hwnd);
-    if (!render_target) return;
+static DirtyState last_state;
+static int have_last_state = 0;
+
+/* Title bar plus every mini-board, one palette brush per color bucket;
+   consecutive fills with the same brush batch inside Direct2D */
+static void paint_spectate(HWND hwnd, const SimFrame* frame) {
+    TRACE_SCOPE("paint_spectate");
+    static RenderList title_list;
+    static int laid_out_width = -1, laid_out_height = -1;
+    RenderScene scene;
+    build_render_scene(hwnd, frame, &scene);
+    render_build_layer(&scene, RLAYER_TITLE, &title_list);
 
     RECT rc;
     GetClientRect(hwnd, &rc);
-    int window_width = rc.right - rc.left;
+    int width = rc.right - rc.left, height = rc.bottom - rc.top;
+    if (width != laid_out_width || height != laid_out_height) {
+        spectate_layout(&spectate_view, SPECTATE_MAX_BOARDS, HEIGHT, 0, 50, width, height - 50);
+        laid_out_width = width;
+        laid_out_height = height;
+    }
+    spectate_build(&spectate_view, spectate_games, SPECTATE_MAX_BOARDS, &spectate_batch);
 
+    const RenderRgba* bg = &render_palette[RCOL_BG];
     render_target->BeginDraw();
-    render_target->Clear(D2D1::ColorF(0.08f, 0.08f, 0.08f));
-
-    /* Draw custom title bar background */
-    D2D1_RECT_F titlebar = D2D1::RectF(0, 0, (float)window_width, 50);
-    ID2D1SolidColorBrush* titlebar_bg = NULL;
-    render_target->CreateSolidColorBrush(D2D1::ColorF(0.02f, 0.08f, 0.12f), &titlebar_bg);
-    render_target->FillRectangle(&titlebar, titlebar_bg);
-    if (titlebar_bg) titlebar_bg->Release();
-
-    /* Draw titlebar bottom border - cyan accent */
-    ID2D1SolidColorBrush* titlebar_accent = NULL;
-    render_target->CreateSolidColorBrush(D2D1::ColorF(0.2f, 0.8f, 0.9f, 0.8f), &titlebar_accent);
-    D2D1_RECT_F titlebar_border_line = D2D1::RectF(0, 48, (float)window_width, 50);
-    render_target->FillRectangle(&titlebar_border_line, titlebar_accent);
-    if (titlebar_accent) titlebar_accent->Release();
-
-    /* Draw close button (X) at top right - dynamically positioned */
-    float close_btn_right = window_width - 15;
-    float close_btn_left = close_btn_right - 25;
-    D2D1_RECT_F close_btn = D2D1::RectF(close_btn_left, 10, close_btn_right, 35);
-    ID2D1SolidColorBrush* close_btn_brush = NULL;
-    render_target->CreateSolidColorBrush(D2D1::ColorF(0.15f, 0.15f, 0.2f), &close_btn_brush);
-    render_target->FillRectangle(&close_btn, close_btn_brush);
-
-    ID2D1SolidColorBrush* close_btn_border = NULL;
-    render_target->CreateSolidColorBrush(D2D1::ColorF(0.8f, 0.3f, 0.3f, 0.7f), &close_btn_border);
-    render_target->DrawRectangle(&close_btn, close_btn_border, 1.5f);
-
-    /* Draw X on close button */
-    if (close_btn_brush && close_btn_border) {
-        D2D1_POINT_2F p1 = D2D1::Point2F(close_btn_left + 5, 15);
-        D2D1_POINT_2F p2 = D2D1::Point2F(close_btn_right - 5, 30);
-        render_target->DrawLine(p1, p2, close_btn_border, 2.0f);
-
-        p1 = D2D1::Point2F(close_btn_right - 5, 15);
-        p2 = D2D1::Point2F(close_btn_left + 5, 30);
-        render_target->DrawLine(p1, p2, close_btn_border, 2.0f);
+    render_target->Clear(D2D1::ColorF(bg->r, bg->g, bg->b, bg->a));
+    replay_render_list(render_target, &title_list, NULL);
+    for (int b = 0; b < SPECTATE_BUCKETS; b++) {
+        ID2D1Brush* brush = palette_brushes[spectate_bucket_color[b]];
+        const RenderRect* r = spectate_batch.rect + spectate_batch.start[b];
+        for (int i = 0; brush && i < spectate_batch.count[b]; i++)
+            render_target->FillRectangle(D2D1::RectF(r[i].left, r[i].top, r[i].right, r[i].bottom), brush);
     }
+    if (render_target->EndDraw() == D2DERR_RECREATE_TARGET) {
+        discard_d2d_resources();
+        render_thread_wake(RENDER_WAKE_FULL);
+    }
+    have_last_state = 0;
+}
 
-    if (close_btn_brush) close_btn_brush->Release();
-    if (close_btn_border) close_btn_border->Release();
+/* Draws a frame, repainting only the areas that differ from the last
+   frame drawn (the rest of the target keeps its pixels, RETAIN_CONTENTS).
+   Returns 0 if nothing changed. */
+static int paint_frame(HWND hwnd, const SimFrame* frame, int full) {
+    TRACE_SCOPE("paint_frame");
+    static DirtyState cur;
+    create_d2d_resources(hwnd);
+    if (!render_target) return 0;
 
-    /* Draw logo image at title bar - left side */
-    if (background_bitmap) {
-        D2D1_SIZE_F logo_size = background_bitmap->GetSize();
-        float logo_height = 35.0f;
-        float logo_width = (logo_height / logo_size.height) * logo_size.width;
-
-        D2D1_RECT_F logo_rect = D2D1::RectF(
-            10.0f,
-            7.0f,
-            10.0f + logo_width,
-            7.0f + logo_height
-        );
-        render_target->DrawBitmap(background_bitmap, logo_rect, 1.0f);
+    RECT rc;
+    GetClientRect(hwnd, &rc);
+    RenderScene scene;
+    build_render_scene(hwnd, frame, &scene);
+    dirty_capture(&scene, rc.bottom - rc.top, &cur);
+    DirtyList dl;
+    dirty_diff(full || !have_last_state ? NULL : &last_state, &cur, &dl);
+    if (!dl.full && dl.count == 0) return 0;
+
+    render_build(&scene, 0, &render_list);
+    render_cache_begin_frame(&render_cache);
+    int stale = layers_begin_frame(&layer_cache, &scene);
+    for (int i = 0; i < RLAYER_COUNT; i++)
+        if (stale & (1 << i)) rebuild_layer(&scene, i);
+    render_target->BeginDraw();
+    if (dl.full) {
+        replay_render_list(render_target, &render_list, NULL);
     } else {
-        /* Fallback text if image not loaded */
-        if (text_format && brush_label) {
-            render_target->DrawTextW(L"TETRIS", 6, text_format, 
-                D2D1::RectF(10.0f, 12.0f, 150.0f, 40.0f), brush_label);
+        for (int i = 0; i < dl.count; i++) {
+            RenderRect clip = { (float)dl.rect[i].left, (float)dl.rect[i].top,
+                                (float)dl.rect[i].right, (float)dl.rect[i].bottom };
+            render_target->PushAxisAlignedClip(D2D1::RectF(clip.left, clip.top, clip.right, clip.bottom),
+                                               D2D1_ANTIALIAS_MODE_ALIASED);
+            replay_render_list(render_target, &render_list, &clip);
+            render_target->PopAxisAlignedClip();
         }
     }
-
-    /* Draw game board background with gradient */
-    int board_width = WIDTH * (cell_size + cell_gap) + cell_gap;
-    int board_height = HEIGHT * (cell_size + cell_gap) + cell_gap;
-    D2D1_RECT_F board_bg = D2D1::RectF(
-        (float)board_left - 4,
-        (float)board_top - 4,
-        (float)(board_left + board_width + 4),
-        (float)(board_top + board_height + 4)
-    );
-
-    /* Draw gradient background on board */
-    float pulse = 0.04f * sinf((animation_frame % 60) * 3.14159f / 30.0f);
-
-    /* Create enhanced gradient effect with better depth */
-    float step_height = board_bg.bottom - board_bg.top;
-    for (float i = 0; i < step_height; i += 1.5f) {
-        float progress = i / step_height;
-        /* Darker at top, lighter at bottom for depth */
-        float r = 0.10f + (0.22f - 0.10f) * progress + pulse * 0.5f;
-        float g = 0.12f + (0.24f - 0.12f) * progress + pulse * 0.5f;
-        float b = 0.15f + (0.28f - 0.15f) * progress + pulse * 0.5f;
-
-        ID2D1SolidColorBrush* line_brush = NULL;
-        render_target->CreateSolidColorBrush(D2D1::ColorF(r, g, b), &line_brush);
-        D2D1_RECT_F line_rect = D2D1::RectF(
-            board_bg.left,
-            board_bg.top + i,
-            board_bg.right,
-            board_bg.top + i + 1.5f
-        );
-        render_target->FillRectangle(&line_rect, line_brush);
-        if (line_brush) line_brush->Release();
+    HRESULT hr;
+    {
+        TRACE_SCOPE("end_draw");
+        hr = render_target->EndDraw();
     }
-
-    /* Add inner shadow for depth */
-    ID2D1SolidColorBrush* inner_shadow = NULL;
-    render_target->CreateSolidColorBrush(D2D1::ColorF(0.0f, 0.0f, 0.0f, 0.2f), &inner_shadow);
-    D2D1_RECT_F inner_shadow_rect = D2D1::RectF(
-        board_bg.left,
-        board_bg.top,
-        board_bg.right,
-        board_bg.top + 8.0f
-    );
-    render_target->FillRectangle(&inner_shadow_rect, inner_shadow);
-    if (inner_shadow) inner_shadow->Release();
-
-    /* Add highlight at top for beveled edge */
-    ID2D1SolidColorBrush* highlight_brush = NULL;
-    render_target->CreateSolidColorBrush(D2D1::ColorF(1.0f, 1.0f, 1.0f, 0.08f), &highlight_brush);
-    D2D1_POINT_2F p1 = D2D1::Point2F(board_bg.left, board_bg.top + 1);
-    D2D1_POINT_2F p2 = D2D1::Point2F(board_bg.right, board_bg.top + 1);
-    render_target->DrawLine(p1, p2, highlight_brush, 1.5f);
-    if (highlight_brush) highlight_brush->Release();
-
-    /* Add dark border at bottom for depth */
-    ID2D1SolidColorBrush* border_brush = NULL;
-    render_target->CreateSolidColorBrush(D2D1::ColorF(0.0f, 0.0f, 0.0f, 0.4f), &border_brush);
-    p1 = D2D1::Point2F(board_bg.left, board_bg.bottom - 1);
-    p2 = D2D1::Point2F(board_bg.right, board_bg.bottom - 1);
-    render_target->DrawLine(p1, p2, border_brush, 1.5f);
-    if (border_brush) border_brush->Release();
-
-    /* draw board cells */
-    for (int y = 0; y < HEIGHT; y++) {
-        for (int x = 0; x < WIDTH; x++) {
-            int c = board[y][x];
-            if (c) {
-                draw_cell(render_target, x, y, brushes[c]);
-            }
-        }
+    dirty_stats_add(&dirty_stats, &dl, rc.right - rc.left, rc.bottom - rc.top);
+    last_state = cur;
+    have_last_state = 1;
+    if (hr == D2DERR_RECREATE_TARGET) {
+        discard_d2d_resources();
+        have_last_state = 0;
+        render_thread_wake(RENDER_WAKE_FULL);
     }
+    return 1;
+}
 
-    /* draw current falling piece */
-    uint16_t m = get_mask(cur_piece, cur_rot);
-    for (int b = 0; b < 16; b++) {
-        if ((m >> b) & 1u) {
-            int bx = b % 4;
-            int by = b / 4;
-            int ax = bx + cur_x;
-            int ay = by + cur_y;
-            if (ay >= 0 && ay < HEIGHT && ax >= 0 && ax < WIDTH) {
-                draw_cell(render_target, ax, ay, brushes[pieces[cur_piece].color]);
-            }
+static std::thread render_thread;
+static HWND render_hwnd = NULL;
+static HANDLE render_event = NULL;
+static std::atomic<int> render_flags(0);
+
+/* Sleeps until woken (or until the next spectator step), then draws the
+   newest simulation frame. A slow frame only delays drawing: the
+   simulation keeps running and later frames replace the skipped ones. */
+static void render_main(void) {
+    TRACE_THREAD("render");
+    HWND hwnd = render_hwnd;
+    double next_step = 0.0;
+    int full = 1;
+    for (;;) {
+        DWORD wait = INFINITE;
+        if (spectate_on) {
+            double left = next_step - sim_now_ms();
+            wait = left > 0.0 ? (DWORD)left + 1 : 0;
         }
-    }
-
-    /* draw side panel: Next */
-    FLOAT sx = (FLOAT)side_panel_left_offset;
-    FLOAT sy = (FLOAT)board_top;
-
-    /* Calculate panel height to match game board */
-    FLOAT panel_bottom = sy + (HEIGHT * (cell_size + cell_gap) + cell_gap) + 4;
-
-    /* Draw animated background for side panel */
-    float hue_shift = (animation_frame % 120) / 120.0f;
-    float panel_brightness = 0.3f + 0.1f * sinf(hue_shift * 3.14159f * 2.0f);
-    ID2D1SolidColorBrush* panel_bg_brush = NULL;
-    render_target->CreateSolidColorBrush(
-        D2D1::ColorF(0.13f + panel_brightness * 0.05f, 0.13f + panel_brightness * 0.05f, 0.16f + panel_brightness * 0.05f),
-        &panel_bg_brush
-    );
-
-    /* Panel background covering all side info - wider and shorter */
-    D2D1_RECT_F panel_rect = D2D1::RectF(sx - 10, sy - 4, sx + 170, sy + 360);
-    render_target->FillRectangle(&panel_rect, panel_bg_brush);
-
-    /* Panel top highlight for 3D bevel */
-    ID2D1SolidColorBrush* panel_highlight = NULL;
-    render_target->CreateSolidColorBrush(D2D1::ColorF(1.0f, 1.0f, 1.0f, 0.12f), &panel_highlight);
-    D2D1_RECT_F panel_top_highlight = D2D1::RectF(sx - 10, sy - 4, sx + 170, sy + 1);
-    render_target->FillRectangle(&panel_top_highlight, panel_highlight);
-    if (panel_highlight) panel_highlight->Release();
-
-    /* Panel left highlight */
-    ID2D1SolidColorBrush* panel_left_highlight = NULL;
-    render_target->CreateSolidColorBrush(D2D1::ColorF(1.0f, 1.0f, 1.0f, 0.10f), &panel_left_highlight);
-    D2D1_RECT_F panel_left_highlight_rect = D2D1::RectF(sx - 10, sy - 4, sx - 6, sy + 360);
-    render_target->FillRectangle(&panel_left_highlight_rect, panel_left_highlight);
-    if (panel_left_highlight) panel_left_highlight->Release();
-
-    /* Panel bottom shadow */
-    ID2D1SolidColorBrush* panel_shadow = NULL;
-    render_target->CreateSolidColorBrush(D2D1::ColorF(0.0f, 0.0f, 0.0f, 0.3f), &panel_shadow);
-    D2D1_RECT_F panel_bottom_shadow = D2D1::RectF(sx - 10, sy + 356, sx + 170, sy + 360);
-    render_target->FillRectangle(&panel_bottom_shadow, panel_shadow);
-    if (panel_shadow) panel_shadow->Release();
-
-    /* Panel right shadow */
-    ID2D1SolidColorBrush* panel_right_shadow = NULL;
-    render_target->CreateSolidColorBrush(D2D1::ColorF(0.0f, 0.0f, 0.0f, 0.25f), &panel_right_shadow);
-    D2D1_RECT_F panel_right_shadow_rect = D2D1::RectF(sx + 166, sy - 4, sx + 170, sy + 360);
-    render_target->FillRectangle(&panel_right_shadow_rect, panel_right_shadow);
-    if (panel_right_shadow) panel_right_shadow->Release();
-    /* Draw border with gradient effect */
-    ID2D1SolidColorBrush* panel_border = NULL;
-    render_target->CreateSolidColorBrush(D2D1::ColorF(0.35f, 0.35f, 0.35f), &panel_border);
-    render_target->DrawRectangle(&panel_rect, panel_border, 1.5f);
-    if (panel_border) panel_border->Release();
-
-    if (panel_bg_brush) panel_bg_brush->Release();
-
-    if (text_format)
-        render_target->DrawTextW(L"Next:", 5, text_format, D2D1::RectF(sx, sy - 28, sx + 200, sy), brush_border);
-    if (next_piece >= 0) {
-        uint16_t nm = get_mask(next_piece, 0);
-        for (int b = 0; b < 16; b++) {
-            if ((nm >> b) & 1u) {
-                int bx = b % 4;
-                int by = b / 4;
-                float px = sx + bx * (cell_size / 1.5f + 2.0f);
-                float py = sy + by * (cell_size / 1.5f + 2.0f);
-                D2D1_RECT_F r = D2D1::RectF(px, py, px + cell_size / 1.5f, py + cell_size / 1.5f);
-                render_target->FillRectangle(&r, brushes[pieces[next_piece].color]);
-                render_target->DrawRectangle(&r, brush_border);
-            }
+        WaitForSingleObject(render_event, wait);
+        int flags = render_flags.exchange(0);
+        if (flags & RENDER_WAKE_STOP) break;
+        if ((flags & RENDER_WAKE_RESIZE) && render_target) {
+            RECT rc;
+            GetClientRect(hwnd, &rc);
+            render_target->Resize(D2D1::SizeU(rc.right - rc.left, rc.bottom - rc.top));
+        }
+        if (flags & (RENDER_WAKE_RESIZE | RENDER_WAKE_FULL)) full = 1;
+        if (flags & RENDER_WAKE_SPECTATE) {
+            spectate_toggle();
+            next_step = sim_now_ms() + SPECTATE_STEP_MS;
+            full = 1;
         }
-    }
 
-    /* draw side panel: Hold */
-    FLOAT hx = sx;
-    FLOAT hy = sy + 110;
-    if (text_format)
-        render_target->DrawTextW(L"Hold:", 5, text_format, D2D1::RectF(hx, hy - 28, hx + 200, hy), brush_border);
-    if (hold_piece >= 0) {
-        uint16_t hm = get_mask(hold_piece, 0);
-        for (int b = 0; b < 16; b++) {
-            if ((hm >> b) & 1u) {
-                int bx = b % 4;
-                int by = b / 4;
-                float px = hx + bx * (cell_size / 1.5f + 2.0f);
-                float py = hy + by * (cell_size / 1.5f + 2.0f);
-                D2D1_RECT_F r = D2D1::RectF(px, py, px + cell_size / 1.5f, py + cell_size / 1.5f);
-                render_target->FillRectangle(&r, brushes[pieces[hold_piece].color]);
-                render_target->DrawRectangle(&r, brush_border);
+        const SimFrame* frame;
+        int fresh = sim_acquire(&frame);
+        if (spectate_on) {
+            if (sim_now_ms() >= next_step) {
+                spectate_tick();
+                next_step += SPECTATE_STEP_MS;
+                full = 1;
             }
+            create_d2d_resources(hwnd);
+            if (full && render_target) paint_spectate(hwnd, frame);
+            full = 0;
+            continue;
         }
+        if (!fresh && !full && !(flags & RENDER_WAKE_FRAME)) continue;
+        double start = sim_now_ms();
+        if (paint_frame(hwnd, frame, full)) sim_frame_shown(frame, start);
+        full = 0;
     }
+    discard_d2d_resources();
+}
 
-    /* draw HUD text */
-    wchar_t hud[128];
-    swprintf(hud, 128, L"%d", score);
-    if (text_format) {
-        render_target->DrawTextW(L"Score:", 6, text_format, D2D1::RectF(sx, hy + 50, sx + 300, hy + 65), brush_label_score);
-        render_target->DrawTextW(hud, (UINT32)wcslen(hud), text_format, D2D1::RectF(sx + 60, hy + 50, sx + 260, hy + 80), brush_label_score);
-    }
-    swprintf(hud, 128, L"%d", level);
-    if (text_format) {
-        render_target->DrawTextW(L"Level:", 6, text_format, D2D1::RectF(sx, hy + 70, sx + 300, hy + 85), brush_label_level);
-        render_target->DrawTextW(hud, (UINT32)wcslen(hud), text_format, D2D1::RectF(sx + 60, hy + 70, sx + 260, hy + 100), brush_label_level);
-    }
-    swprintf(hud, 128, L"%d", lines_total);
-    if (text_format) {
-        render_target->DrawTextW(L"Lines:", 6, text_format, D2D1::RectF(sx, hy + 90, sx + 300, hy + 105), brush_label_lines);
-        render_target->DrawTextW(hud, (UINT32)wcslen(hud), text_format, D2D1::RectF(sx + 60, hy + 90, sx + 260, hy + 120), brush_label_lines);
-    }
+void render_thread_start(HWND hwnd) {
+    if (render_event) return;
+    render_hwnd = hwnd;
+    render_event = CreateEventW(NULL, FALSE, FALSE, NULL);
+    render_thread = std::thread(render_main);
+    render_thread_wake(RENDER_WAKE_FULL);
+}
 
-    HRESULT hr = render_target->EndDraw();
-    if (hr == D2DERR_RECREATE_TARGET) {
-        discard_d2d_resources();
-    }
-}
\ No newline at end of file
+void render_thread_stop(void) {
+    if (!render_event) return;
+    render_thread_wake(RENDER_WAKE_STOP);
+    render_thread.join();
+    CloseHandle(render_event);
+    render_event = NULL;
+}
+
+/* Any thread */
+void render_thread_wake(int flags) {
+    render_flags.fetch_or(flags);
+    if (render_event) SetEvent(render_event);
+}
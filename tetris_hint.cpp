@@ -0,0 +1,215 @@
+#include "tetris_hint.h"
+#include "tetris_trace.h"
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#define HINT_CACHE_BYTES (16u << 20)
+#define HINT_MAX_DEPTH 3
+#define HINT_FRESH 4
+
+typedef std::chrono::steady_clock::time_point HintTime;
+
+/* Latest snapshot waiting for the worker */
+typedef struct {
+    GameState state;
+    int deadline_ms;
+    uint32_t generation;
+    HintTime submitted;
+    int pending;
+} HintRequest;
+
+static std::thread hint_thread;
+static std::mutex request_mutex;
+static std::condition_variable request_cv;
+static HintRequest request;
+static int stopping = 0;
+static int running = 0;
+
+static std::atomic<uint32_t> current_generation(0);
+static BotWeights hint_weights;
+static EvalCache* hint_cache = NULL;
+static HintNotifyFn notify_fn = NULL;
+static void* notify_ctx = NULL;
+
+/* Mailbox: triple buffer, so neither side ever waits. The worker owns
+   write_index, the reader owns read_index, and the middle buffer is
+   swapped atomically; HINT_FRESH marks a middle the reader has not seen. */
+static HintResult mailbox[3];
+static std::atomic<int> mailbox_middle(1);
+static int write_index = 0;
+static int read_index = 2;
+
+static void publish(const HintResult* r) {
+    mailbox[write_index] = *r;
+    write_index = mailbox_middle.exchange(write_index | HINT_FRESH, std::memory_order_acq_rel) & 3;
+}
+
+int hint_read(HintResult* out) {
+    if (mailbox_middle.load(std::memory_order_relaxed) & HINT_FRESH)
+        read_index = mailbox_middle.exchange(read_index, std::memory_order_acq_rel) & 3;
+    const HintResult* r = &mailbox[read_index];
+    if (r->depth == 0 || r->generation != current_generation.load(std::memory_order_relaxed))
+        return 0;
+    *out = *r;
+    return 1;
+}
+
+static int aborted(uint32_t generation, HintTime deadline) {
+    return current_generation.load(std::memory_order_relaxed) != generation ||
+           std::chrono::steady_clock::now() >= deadline;
+}
+
+/* Average best value over all seven possible unseen pieces */
+static float expected_value(const int b[HEIGHT][WIDTH]) {
+    float sum = 0.0f;
+    for (int k = 0; k < 7; k++) sum += bot_best_value(b, k, &hint_weights, hint_cache);
+    return sum / 7.0f;
+}
+
+/* Value of placing follow and then the unknown piece after it */
+static float expect_placement(const int b[HEIGHT][WIDTH], int follow) {
+    Placement places[BOT_MAX_PLACEMENTS];
+    int n = bot_placements(b, follow, places);
+    float best = BOT_DEAD_VALUE;
+    for (int i = 0; i < n; i++) {
+        int tmp[HEIGHT][WIDTH];
+        memcpy(tmp, b, sizeof(tmp));
+        board_lock(tmp, follow, places[i].x, places[i].y, places[i].rot);
+        int lines = board_clear_lines(tmp);
+        float v = expected_value(tmp) + hint_weights.w[BOT_LINES] * lines;
+        if (v > best) best = v;
+    }
+    return best;
+}
+
+/* Depth 3: the piece, its follow-up, then an expectation over the piece
+   after them. Holding into an empty slot leaves the follow-up unknown, so
+   that option averages over it as well and is searched as deep.
+   Returns 0 if the snapshot went stale or the deadline passed. */
+static int expect_search(const GameState* s, uint32_t generation, HintTime deadline, BotMove* out) {
+    int options = 1;
+    int piece[2] = { s->cur_piece, -1 };
+    int follow[2] = { s->next_piece, -1 };
+    if (!s->hold_used) {
+        piece[1] = s->hold_piece >= 0 ? s->hold_piece : s->next_piece;
+        follow[1] = s->hold_piece >= 0 ? s->next_piece : -1;
+        if (piece[1] >= 0 && piece[1] != s->cur_piece) options = 2;
+    }
+
+    int found = 0;
+    for (int o = 0; o < options; o++) {
+        Placement places[BOT_MAX_PLACEMENTS];
+        int n = bot_placements(s->board, piece[o], places);
+        for (int i = 0; i < n; i++) {
+            if (aborted(generation, deadline)) return 0;
+            int tmp[HEIGHT][WIDTH];
+            memcpy(tmp, s->board, sizeof(tmp));
+            board_lock(tmp, piece[o], places[i].x, places[i].y, places[i].rot);
+            int lines = board_clear_lines(tmp);
+            float v = 0.0f;
+            if (follow[o] >= 0) {
+                v = expect_placement(tmp, follow[o]);
+            } else {
+                for (int k = 0; k < 7; k++) {
+                    if (aborted(generation, deadline)) return 0;
+                    v += expect_placement(tmp, k);
+                }
+                v /= 7.0f;
+            }
+            v += hint_weights.w[BOT_LINES] * lines;
+            if (!found || v > out->value) {
+                out->use_hold = o;
+                out->piece = piece[o];
+                out->place = places[i];
+                out->value = v;
+                found = 1;
+            }
+        }
+    }
+    return found;
+}
+
+static void search_snapshot(const HintRequest* req) {
+    TRACE_SCOPE("hint_search");
+    using namespace std::chrono;
+    HintTime deadline = req->submitted + milliseconds(req->deadline_ms);
+    for (int depth = 1; depth <= HINT_MAX_DEPTH; depth++) {
+        if (depth > 1 && aborted(req->generation, deadline)) break;
+        HintResult r;
+        int ok;
+        if (depth < 3) ok = bot_search(&req->state, &hint_weights, depth, hint_cache, &r.move);
+        else ok = expect_search(&req->state, req->generation, deadline, &r.move);
+        if (!ok || current_generation.load(std::memory_order_relaxed) != req->generation) break;
+
+        r.generation = req->generation;
+        r.depth = depth;
+        r.latency_ms = duration<float, std::milli>(steady_clock::now() - req->submitted).count();
+        publish(&r);
+        if (notify_fn) notify_fn(notify_ctx);
+    }
+}
+
+static void worker_main(void) {
+    TRACE_THREAD("hint");
+    for (;;) {
+        HintRequest req;
+        {
+            std::unique_lock<std::mutex> lock(request_mutex);
+            request_cv.wait(lock, [] { return request.pending || stopping; });
+            if (stopping) return;
+            req = request;
+            request.pending = 0;
+        }
+        search_snapshot(&req);
+    }
+}
+
+void hint_start(const BotWeights* wt, HintNotifyFn notify, void* ctx) {
+    if (running) return;
+    hint_weights = *wt;
+    notify_fn = notify;
+    notify_ctx = ctx;
+    hint_cache = eval_cache_create(HINT_CACHE_BYTES);
+    stopping = 0;
+    request.pending = 0;
+    running = 1;
+    hint_thread = std::thread(worker_main);
+}
+
+void hint_stop(void) {
+    if (!running) return;
+    {
+        std::lock_guard<std::mutex> lock(request_mutex);
+        stopping = 1;
+    }
+    current_generation.fetch_add(1);
+    request_cv.notify_one();
+    hint_thread.join();
+    eval_cache_destroy(hint_cache);
+    hint_cache = NULL;
+    running = 0;
+}
+
+/* Called on spawn; bumping the generation cancels any search in flight */
+void hint_submit(const GameState* snapshot, int deadline_ms) {
+    if (!running) return;
+    uint32_t generation = current_generation.fetch_add(1) + 1;
+    {
+        std::lock_guard<std::mutex> lock(request_mutex);
+        request.state = *snapshot;
+        request.deadline_ms = deadline_ms;
+        request.generation = generation;
+        request.submitted = std::chrono::steady_clock::now();
+        request.pending = 1;
+    }
+    request_cv.notify_one();
+}
+
+/* Called on lock or hold: the published hint no longer applies */
+void hint_cancel(void) {
+    current_generation.fetch_add(1);
+}
@@ -0,0 +1,25 @@
+#ifndef TETRIS_HINT_H
+#define TETRIS_HINT_H
+
+#include "tetris_bot.h"
+
+/* Background placement hint. The game hands over a snapshot when a piece
+   spawns; a worker thread deepens the search until the per-piece deadline
+   and publishes each improvement through a lock-free mailbox. */
+
+typedef struct {
+    uint32_t generation;  /* snapshot the hint belongs to */
+    BotMove move;
+    int depth;            /* deepest search level completed */
+    float latency_ms;     /* snapshot to publish */
+} HintResult;
+
+typedef void (*HintNotifyFn)(void* ctx);
+
+void hint_start(const BotWeights* wt, HintNotifyFn notify, void* ctx);
+void hint_stop(void);
+void hint_submit(const GameState* snapshot, int deadline_ms);
+void hint_cancel(void);
+int hint_read(HintResult* out);
+
+#endif /* TETRIS_HINT_H */
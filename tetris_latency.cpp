@@ -0,0 +1,72 @@
+#include "tetris_latency.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+const char* const latency_stage_names[LAT_STAGES] = {
+    "arrive to apply", "apply to publish", "publish to display", "total"
+};
+
+static const int stage_from[LAT_STAGES] = { LAT_ARRIVE, LAT_APPLY, LAT_PUBLISH, LAT_ARRIVE };
+static const int stage_to[LAT_STAGES] = { LAT_APPLY, LAT_PUBLISH, LAT_DISPLAY, LAT_DISPLAY };
+
+void latency_log_init(LatencyLog* log) {
+    memset(log, 0, sizeof(*log));
+}
+
+void latency_log_free(LatencyLog* log) {
+    free(log->tag);
+    memset(log, 0, sizeof(*log));
+}
+
+int latency_log_add(LatencyLog* log, const LatencyTag* tag) {
+    if (log->count == log->capacity) {
+        size_t cap = log->capacity ? log->capacity * 2 : 1024;
+        LatencyTag* grown = (LatencyTag*)realloc(log->tag, cap * sizeof(LatencyTag));
+        if (!grown) return 0;
+        log->tag = grown;
+        log->capacity = cap;
+    }
+    log->tag[log->count++] = *tag;
+    return 1;
+}
+
+static double rank(const double* sorted, size_t n, double pct) {
+    return sorted[(size_t)((n - 1) * pct / 100.0)];
+}
+
+void latency_summary(const LatencyLog* log, int stage, LatencySummary* out) {
+    memset(out, 0, sizeof(*out));
+    if (!log->count) return;
+    double* v = (double*)malloc(log->count * sizeof(double));
+    if (!v) return;
+    double sum = 0.0;
+    for (size_t i = 0; i < log->count; i++) {
+        v[i] = log->tag[i].t[stage_to[stage]] - log->tag[i].t[stage_from[stage]];
+        sum += v[i];
+    }
+    std::sort(v, v + log->count);
+    out->count = log->count;
+    out->mean = sum / log->count;
+    out->p50 = rank(v, log->count, 50);
+    out->p99 = rank(v, log->count, 99);
+    out->p999 = rank(v, log->count, 99.9);
+    out->max = v[log->count - 1];
+    free(v);
+}
+
+int latency_write_report(const LatencyLog* log, const char* path, const char* title) {
+    FILE* fp = strcmp(path, "-") ? fopen(path, "w") : stdout;
+    if (!fp) return 0;
+    fprintf(fp, "# %s: %zu inputs, ms\n", title, log->count);
+    fprintf(fp, "%-20s %9s %9s %9s %9s %9s\n", "stage", "mean", "p50", "p99", "p999", "max");
+    for (int s = 0; s < LAT_STAGES; s++) {
+        LatencySummary sum;
+        latency_summary(log, s, &sum);
+        fprintf(fp, "%-20s %9.3f %9.3f %9.3f %9.3f %9.3f\n", latency_stage_names[s],
+                sum.mean, sum.p50, sum.p99, sum.p999, sum.max);
+    }
+    if (fp == stdout) return fflush(fp) == 0;
+    return fclose(fp) == 0;
+}
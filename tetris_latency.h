@@ -0,0 +1,40 @@
+#ifndef TETRIS_LATENCY_H
+#define TETRIS_LATENCY_H
+
+/* Input-to-display latency probe. Each input carries a tag with the time
+   it arrived, the time the simulation applied it, the time the first
+   frame holding it was published and the time that frame was on screen.
+   Front ends fill tags with whatever clock they run on (real or fake) and
+   write the percentiles out at the end. Portable. */
+
+#include <stddef.h>
+
+enum { LAT_ARRIVE = 0, LAT_APPLY, LAT_PUBLISH, LAT_DISPLAY, LAT_POINTS };
+
+/* Intervals between the points above, plus arrive to display */
+enum { LAT_STAGE_QUEUE = 0, LAT_STAGE_PUBLISH, LAT_STAGE_DISPLAY, LAT_STAGE_TOTAL, LAT_STAGES };
+
+typedef struct {
+    double t[LAT_POINTS];     /* ms */
+} LatencyTag;
+
+typedef struct {
+    LatencyTag* tag;
+    size_t count, capacity;
+} LatencyLog;
+
+typedef struct {
+    size_t count;
+    double mean, p50, p99, p999, max;
+} LatencySummary;
+
+extern const char* const latency_stage_names[LAT_STAGES];
+
+void latency_log_init(LatencyLog* log);
+void latency_log_free(LatencyLog* log);
+int latency_log_add(LatencyLog* log, const LatencyTag* tag);
+void latency_summary(const LatencyLog* log, int stage, LatencySummary* out);
+/* Table of every stage; path "-" is stdout */
+int latency_write_report(const LatencyLog* log, const char* path, const char* title);
+
+#endif /* TETRIS_LATENCY_H */
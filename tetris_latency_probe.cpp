@@ -0,0 +1,176 @@
+// Headless input latency probe - a seeded stream of key presses on a fake
+// clock, through the simulation step and the software renderer, with
+// per-stage latency percentiles written to a file
+// Build: g++ -O2 -std=c++17 tetris_latency_probe.cpp tetris_latency.cpp tetris_soft.cpp tetris_glyphs.cpp tetris_render.cpp tetris_font.cpp tetris_core.cpp -o tetris_latency_probe
+//        cl /O2 /std:c++17 /EHsc tetris_latency_probe.cpp tetris_latency.cpp tetris_soft.cpp tetris_glyphs.cpp tetris_render.cpp tetris_font.cpp tetris_core.cpp
+// Usage: tetris_latency_probe --inputs 5000 --refresh-hz 60 --out latency.txt
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include <vector>
+#include "tetris_latency.h"
+#include "tetris_soft.h"
+
+/* The clock is simulated: keys arrive on a seeded schedule and gravity
+   falls on its deadline, but the work in between is real. Every
+   simulation step and every software-rendered frame is timed and moves
+   the fake clock on by that much. As in the window, the simulation
+   publishes a frame after each change and the renderer, when free, draws
+   the newest one; with a refresh rate a drawn frame shows at the next
+   vblank. */
+
+typedef std::chrono::steady_clock::time_point WallTime;
+
+static GameState game;
+static LatencyLog probe;
+static std::vector<LatencyTag> tags;       /* applied inputs, in order */
+static size_t published_upto = 0, shown_upto = 0;
+
+/* Newest published frame the renderer has not started */
+static GameState pending_state;
+static double pending_publish = 0.0;
+static size_t pending_upto = 0;
+static int pending_valid = 0;
+
+static SoftFrame frame;
+static RenderList list;
+static double render_free = 0.0;
+static double refresh_ms = 0.0;
+static uint64_t frames_published = 0, frames_drawn = 0;
+
+static double elapsed_ms(WallTime since) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+}
+
+static void usage(void) {
+    printf("Usage: tetris_latency_probe [options]\n"
+           "  --inputs N       key presses to send (default 2000)\n"
+           "  --key-ms N       mean gap between key presses (default 25)\n"
+           "  --level N        starting level (default 1)\n"
+           "  --refresh-hz N   show frames at the next vblank, 0 for at once (default 60)\n"
+           "  --seed N         game and key seed (default 1)\n"
+           "  --out FILE       latency report, - for stdout (default -)\n");
+}
+
+/* Draws every pending frame whose start comes no later than `until` */
+static void drain_render(double until) {
+    while (pending_valid) {
+        double start = render_free > pending_publish ? render_free : pending_publish;
+        if (start > until) break;
+        pending_valid = 0;
+        WallTime t0 = std::chrono::steady_clock::now();
+        RenderScene scene;
+        render_scene_from_state(&scene, &pending_state, 0);
+        render_build(&scene, RENDER_INLINE_LAYERS, &list);
+        soft_render_list(&frame, &list);
+        double done = start + elapsed_ms(t0);
+        if (refresh_ms > 0.0) done = ceil(done / refresh_ms) * refresh_ms;
+        for (size_t i = shown_upto; i < pending_upto; i++) {
+            tags[i].t[LAT_DISPLAY] = done;
+            latency_log_add(&probe, &tags[i]);
+        }
+        shown_upto = pending_upto;
+        render_free = done;
+        frames_drawn++;
+    }
+}
+
+static void publish(double at) {
+    drain_render(at);
+    for (size_t i = published_upto; i < tags.size(); i++) tags[i].t[LAT_PUBLISH] = at;
+    published_upto = tags.size();
+    pending_state = game;
+    pending_publish = at;
+    pending_upto = tags.size();
+    pending_valid = 1;
+    frames_published++;
+}
+
+int main(int argc, char** argv) {
+    static const int mix[16] = {
+        INPUT_LEFT, INPUT_LEFT, INPUT_RIGHT, INPUT_RIGHT, INPUT_LEFT, INPUT_RIGHT,
+        INPUT_ROTATE, INPUT_ROTATE, INPUT_ROTATE, INPUT_SOFT_DROP, INPUT_SOFT_DROP,
+        INPUT_SOFT_DROP, INPUT_HARD_DROP, INPUT_HARD_DROP, INPUT_HOLD, INPUT_LEFT
+    };
+    int inputs = 2000, key_ms = 25, level = 1, refresh_hz = 60;
+    uint32_t seed = 1;
+    const char* out_path = "-";
+
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        const char* v = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!strcmp(a, "--help")) { usage(); return 0; }
+        if (!v) { usage(); return 1; }
+        if (!strcmp(a, "--inputs")) inputs = atoi(v);
+        else if (!strcmp(a, "--key-ms")) key_ms = atoi(v);
+        else if (!strcmp(a, "--level")) level = atoi(v);
+        else if (!strcmp(a, "--refresh-hz")) refresh_hz = atoi(v);
+        else if (!strcmp(a, "--seed")) seed = (uint32_t)strtoul(v, NULL, 10);
+        else if (!strcmp(a, "--out")) out_path = v;
+        else { usage(); return 1; }
+        i++;
+    }
+    if (key_ms < 1) key_ms = 1;
+    refresh_ms = refresh_hz > 0 ? 1000.0 / refresh_hz : 0.0;
+    if (!soft_frame_init(&frame, RENDER_WINDOW_WIDTH, RENDER_WINDOW_HEIGHT)) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    latency_log_init(&probe);
+
+    uint32_t game_seed = seed, key_rng = seed * 2654435761u + 1;
+    state_init(&game, game_seed);
+    if (level > 1) {
+        game.level = level;
+        game.speed_ms = speed_for_level(level);
+    }
+    int restarts = 0, sent = 0;
+    double next_key = (double)(rng_next(&key_rng) % (uint32_t)(key_ms * 2));
+    double next_fall = game.speed_ms, sim_free = 0.0;
+    WallTime run_start = std::chrono::steady_clock::now();
+
+    /* The simulation wakes for the next key or gravity step, or as soon
+       as it is free if that moment has already passed */
+    while (sent < inputs) {
+        double wake = next_key < next_fall ? next_key : next_fall;
+        if (wake < sim_free) wake = sim_free;
+        WallTime t0 = std::chrono::steady_clock::now();
+        int changed = 0;
+        while (sent < inputs && next_key <= wake) {
+            if (state_input(&game, mix[rng_next(&key_rng) & 15])) {
+                LatencyTag tag;
+                tag.t[LAT_ARRIVE] = next_key;
+                tag.t[LAT_APPLY] = wake + elapsed_ms(t0);
+                tags.push_back(tag);
+                changed = 1;
+            }
+            sent++;
+            next_key += (double)(rng_next(&key_rng) % (uint32_t)(key_ms * 2));
+        }
+        if (wake >= next_fall) {
+            state_tick(&game);
+            changed = 1;
+            next_fall += game.speed_ms;
+            if (next_fall <= wake) next_fall = wake + game.speed_ms;
+        }
+        if (game.game_over) {
+            state_init(&game, ++game_seed);
+            restarts++;
+            changed = 1;
+        }
+        sim_free = wake + elapsed_ms(t0);
+        if (changed) publish(sim_free);
+    }
+    drain_render(INFINITY);
+
+    printf("%d keys, %zu changed the game, %llu frames published, %llu drawn, %d restarts\n",
+           sent, tags.size(), (unsigned long long)frames_published, (unsigned long long)frames_drawn, restarts);
+    printf("%.1f s of game time in %.2f s\n", render_free / 1000.0, elapsed_ms(run_start) / 1000.0);
+    int ok = latency_write_report(&probe, out_path, "tetris_latency_probe");
+    if (!ok) fprintf(stderr, "cannot write %s\n", out_path);
+    latency_log_free(&probe);
+    soft_frame_free(&frame);
+    return ok ? 0 : 1;
+}
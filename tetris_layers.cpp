@@ -0,0 +1,72 @@
+#include "tetris_layers.h"
+#include <string.h>
+
+const char* const layer_names[RLAYER_COUNT] = { "title", "board frame", "panel" };
+
+static uint64_t hash_int(uint64_t h, int64_t v) {
+    for (int i = 0; i < 8; i++) {
+        h ^= (uint64_t)(v >> (i * 8)) & 0xff;
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+static uint64_t hash_float(uint64_t h, float f) {
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    return hash_int(h, bits);
+}
+
+void layers_reset(LayerCache* lc) {
+    memset(lc, 0, sizeof(*lc));
+}
+
+void layers_device_lost(LayerCache* lc) {
+    for (int i = 0; i < RLAYER_COUNT; i++) lc->valid[i] = 0;
+    lc->device_losses++;
+}
+
+/* FNV-1a over whatever the layer's commands are built from */
+uint64_t layers_key(const RenderScene* s, int layer) {
+    uint64_t h = 0xcbf29ce484222325ull;
+    h = hash_int(h, layer);
+    switch (layer) {
+    case RLAYER_TITLE:
+        h = hash_int(h, s->window_width);
+        h = hash_float(h, s->logo_width);
+        h = hash_float(h, s->logo_height);
+        break;
+    case RLAYER_BOARD_FRAME:
+        h = hash_int(h, s->board_left);
+        h = hash_int(h, s->board_top);
+        h = hash_int(h, s->cell_size);
+        h = hash_int(h, s->cell_gap);
+        break;
+    default:
+        h = hash_int(h, s->side_left);
+        h = hash_int(h, s->board_top);
+        break;
+    }
+    return h;
+}
+
+/* Returns a bit mask of layers the backend must rebuild before this frame */
+int layers_begin_frame(LayerCache* lc, const RenderScene* scene) {
+    int stale = 0;
+    lc->frames++;
+    for (int i = 0; i < RLAYER_COUNT; i++) {
+        uint64_t key = layers_key(scene, i);
+        if (!lc->valid[i] || lc->key[i] != key) {
+            lc->valid[i] = 0;
+            lc->key[i] = key;
+            lc->bounds[i] = render_layer_bounds(scene, i);
+            stale |= 1 << i;
+        }
+    }
+    return stale;
+}
+
+void layers_mark_built(LayerCache* lc, int layer) {
+    lc->valid[layer] = 1;
+    lc->rebuilds[layer]++;
+}
@@ -0,0 +1,28 @@
+#ifndef TETRIS_LAYERS_H
+#define TETRIS_LAYERS_H
+
+/* Bookkeeping for the cached static layers of render_build. Each layer is
+   keyed by the scene inputs it depends on (window size, layout, logo), so
+   it is rebuilt only when one of those changes or the device is lost.
+   Portable; the Direct2D side owns the actual bitmaps. */
+
+#include "tetris_render.h"
+
+typedef struct {
+    uint64_t key[RLAYER_COUNT];
+    int valid[RLAYER_COUNT];
+    RenderRect bounds[RLAYER_COUNT];
+    uint64_t rebuilds[RLAYER_COUNT];
+    uint64_t frames;
+    uint64_t device_losses;
+} LayerCache;
+
+void layers_reset(LayerCache* lc);
+void layers_device_lost(LayerCache* lc);
+uint64_t layers_key(const RenderScene* scene, int layer);
+int layers_begin_frame(LayerCache* lc, const RenderScene* scene);
+void layers_mark_built(LayerCache* lc, int layer);
+
+extern const char* const layer_names[RLAYER_COUNT];
+
+#endif /* TETRIS_LAYERS_H */
@@ -0,0 +1,91 @@
+// Layer cache check - drives the layer bookkeeping headlessly over 300
+// frames with one window resize and one device loss, as the Direct2D
+// backend would, and checks which layers were rebuilt and that a layered
+// frame carries the same commands as the inline one
+// Build: g++ -O2 -std=c++17 tetris_layers_check.cpp tetris_layers.cpp tetris_render.cpp tetris_core.cpp -o tetris_layers_check
+//        cl /O2 /std:c++17 /EHsc tetris_layers_check.cpp tetris_layers.cpp tetris_render.cpp tetris_core.cpp
+// Usage: tetris_layers_check                    (exit status 1 on any failure)
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tetris_layers.h"
+
+#define FRAMES 300
+#define RESIZE_FRAME 100
+#define DEVICE_LOST_FRAME 200
+
+static RenderList frame_list, layer_list;
+static int failures = 0;
+
+static void check(int ok, const char* what) {
+    if (!ok) {
+        printf("FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+/* Resize only moves the title bar; a lost device takes every layer */
+static void check_rebuilds(const GameState* s) {
+    RenderScene scene;
+    render_scene_from_state(&scene, s, 0);
+    LayerCache lc;
+    layers_reset(&lc);
+    int stale_frames[RLAYER_COUNT] = {0};
+    for (int f = 0; f < FRAMES; f++) {
+        scene.animation_frame = f;
+        if (f == RESIZE_FRAME) scene.window_width = RENDER_WINDOW_WIDTH + 120;
+        if (f == DEVICE_LOST_FRAME) layers_device_lost(&lc);
+        int stale = layers_begin_frame(&lc, &scene);
+        for (int i = 0; i < RLAYER_COUNT; i++) {
+            if (!(stale & 1 << i)) continue;
+            render_build_layer(&scene, i, &layer_list);
+            layers_mark_built(&lc, i);
+            stale_frames[i]++;
+        }
+    }
+    static const uint64_t want[RLAYER_COUNT] = { 3, 2, 2 };
+    for (int i = 0; i < RLAYER_COUNT; i++) {
+        char what[128];
+        snprintf(what, sizeof(what), "%s layer rebuilt %llu times, want %llu", layer_names[i],
+                 (unsigned long long)lc.rebuilds[i], (unsigned long long)want[i]);
+        check(lc.rebuilds[i] == want[i] && stale_frames[i] == (int)want[i], what);
+        printf("%s: %llu rebuilds over %d frames\n", layer_names[i], (unsigned long long)lc.rebuilds[i], FRAMES);
+    }
+    check(lc.frames == FRAMES && lc.device_losses == 1, "frame and device loss counters");
+    RenderRect title = render_layer_bounds(&scene, RLAYER_TITLE);
+    check(!memcmp(&lc.bounds[RLAYER_TITLE], &title, sizeof(title)), "title bounds follow the resize");
+}
+
+/* Each RCMD_LAYER stands for exactly the commands the layer builds */
+static void check_layered_matches_inline(const GameState* s) {
+    RenderScene scene;
+    render_scene_from_state(&scene, s, 0);
+    render_build(&scene, RENDER_INLINE_LAYERS, &frame_list);
+    int inline_count = frame_list.count;
+    render_build(&scene, 0, &frame_list);
+    int layered = frame_list.count, layer_cmds = 0, blits = 0;
+    for (int i = 0; i < frame_list.count; i++)
+        if (frame_list.cmd[i].op == RCMD_LAYER) blits++;
+    for (int i = 0; i < RLAYER_COUNT; i++) {
+        render_build_layer(&scene, i, &layer_list);
+        layer_cmds += layer_list.count;
+    }
+    printf("frame: %d commands layered, %d inline\n", layered, inline_count);
+    check(blits == RLAYER_COUNT, "a layered frame blits every layer once");
+    check(layered - blits + layer_cmds == inline_count, "layered commands plus layer contents match the inline frame");
+    check(layered < inline_count, "a layered frame is shorter than the inline one");
+}
+
+int main(int argc, char** argv) {
+    (void)argv;
+    if (argc > 1) {
+        printf("Usage: tetris_layers_check\n");
+        return 0;
+    }
+    GameState s;
+    state_init(&s, 1);
+    check_rebuilds(&s);
+    check_layered_matches_inline(&s);
+    printf("%s\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
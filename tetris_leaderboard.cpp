@@ -0,0 +1,463 @@
+#include "tetris_leaderboard.h"
+#include <stdio.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <direct.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#define LB_LOG_MAGIC 0x3252424cu  /* "LBR2" */
+#define LB_LOG_MAGIC_V1 0x3152424cu
+#define LB_SNAP_VERSION 2
+#define LB_PATH_MAX 512
+
+static_assert(sizeof(ScoreRecord) == 56, "ScoreRecord is an on-disk format");
+
+/* Version 1 logs and snapshots held the score in 32 bits; they are read
+   and converted, and the next compaction rewrites them */
+typedef struct {
+    char player[LB_NAME_MAX];
+    int32_t score;
+    int32_t lines;
+    int32_t level;
+    uint32_t duration_ms;
+    uint32_t seed;
+    uint32_t reserved;
+    int64_t finished;
+} ScoreRecordV1;
+
+static_assert(sizeof(ScoreRecordV1) == sizeof(ScoreRecord), "version 1 records convert in place");
+
+static void record_from_v1(ScoreRecord* r) {
+    ScoreRecordV1 v;
+    memcpy(&v, r, sizeof(v));
+    memset(r, 0, sizeof(*r));
+    memcpy(r->player, v.player, LB_NAME_MAX);
+    r->score = v.score;
+    r->lines = v.lines;
+    r->level = v.level;
+    r->duration_ms = v.duration_ms;
+    r->seed = v.seed;
+    r->finished = v.finished;
+}
+
+typedef struct {
+    uint32_t magic;
+    uint32_t crc;                 /* over seq and record */
+    uint64_t seq;
+    ScoreRecord record;
+} LbLogRecord;
+
+/* Then top_count and best_count records, then a crc32 of all before it */
+typedef struct {
+    char magic[8];                /* "TETRISLB" */
+    uint32_t version;
+    uint32_t top_count;
+    uint32_t best_count;
+    uint32_t reserved;
+    uint64_t last_seq;            /* log records up to here are included */
+} LbSnapHeader;
+
+struct alignas(64) LbShard {
+    std::mutex lock;
+    int fd;
+    uint64_t seq;
+    ScoreRecord top[LB_TOP];      /* best first */
+    int top_count;
+    std::unordered_map<std::string, ScoreRecord> best;
+    std::chrono::steady_clock::time_point synced;
+    int dirty;                    /* written since the last fsync */
+};
+
+struct Leaderboard {
+    char dir[LB_PATH_MAX - 16];   /* room for /N.snap.tmp */
+    int sync_ms;
+    LbShard shard[LB_SHARDS];
+    std::atomic<uint64_t> top_version;
+    std::atomic<uint64_t> inserts, syncs;
+    LbStats loaded;
+    /* Merged top, rebuilt by the query that finds it stale */
+    std::mutex merged_lock;
+    uint64_t merged_version;
+    ScoreRecord merged[LB_TOP];
+    int merged_count;
+    ScoreRecord scratch[LB_SHARDS][LB_TOP];
+    int scratch_count[LB_SHARDS];
+};
+
+#ifdef _WIN32
+static int file_open(const char* path, int append) {
+    return _open(path, append ? _O_WRONLY | _O_CREAT | _O_APPEND | _O_BINARY : _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY,
+                 _S_IREAD | _S_IWRITE);
+}
+static int file_write(int fd, const void* p, size_t n) { return _write(fd, p, (unsigned)n) == (int)n; }
+static int file_sync(int fd) { return _commit(fd) == 0; }
+static int file_truncate(int fd, long long size) { return _chsize_s(fd, size) == 0; }
+static void file_close(int fd) { _close(fd); }
+static int make_dir(const char* path) { return _mkdir(path) == 0 || errno == EEXIST; }
+static int replace_file(const char* from, const char* to) {
+    return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+}
+#else
+static int file_open(const char* path, int append) {
+    return open(path, append ? O_WRONLY | O_CREAT | O_APPEND : O_WRONLY | O_CREAT | O_TRUNC, 0644);
+}
+static int file_write(int fd, const void* p, size_t n) {
+    const char* c = (const char*)p;
+    while (n) {
+        ssize_t w = write(fd, c, n);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) return 0;
+        c += w;
+        n -= (size_t)w;
+    }
+    return 1;
+}
+static int file_sync(int fd) { return fsync(fd) == 0; }
+static int file_truncate(int fd, long long size) { return ftruncate(fd, (off_t)size) == 0; }
+static void file_close(int fd) { close(fd); }
+static int make_dir(const char* path) { return mkdir(path, 0755) == 0 || errno == EEXIST; }
+/* rename() replaces atomically; the directory entry is synced so the
+   new name survives a power cut */
+static int replace_file(const char* from, const char* to) {
+    if (rename(from, to) != 0) return 0;
+    char dir[LB_PATH_MAX];
+    snprintf(dir, sizeof(dir), "%s", to);
+    char* slash = strrchr(dir, '/');
+    if (slash) *slash = 0;
+    int fd = open(slash ? dir : ".", O_RDONLY);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+    return 1;
+}
+#endif
+
+static uint32_t crc32(uint32_t crc, const void* data, size_t n) {
+    static uint32_t table[256];
+    static std::once_flag built;
+    std::call_once(built, [] {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[i] = c;
+        }
+    });
+    const uint8_t* p = (const uint8_t*)data;
+    crc = ~crc;
+    while (n--) crc = table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+static size_t name_len(const ScoreRecord* r) {
+    size_t n = 0;
+    while (n < LB_NAME_MAX && r->player[n]) n++;
+    return n;
+}
+
+static int shard_of(const char* player, size_t n) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < n; i++) h = (h ^ (uint8_t)player[i]) * 16777619u;
+    return (int)(h % LB_SHARDS);
+}
+
+/* Higher score first, then the earlier game, then by name */
+static int better(const ScoreRecord* a, const ScoreRecord* b) {
+    if (a->score != b->score) return a->score > b->score;
+    if (a->finished != b->finished) return a->finished < b->finished;
+    return strncmp(a->player, b->player, LB_NAME_MAX) < 0;
+}
+
+static void shard_path(const Leaderboard* lb, int shard, const char* ext, char* out) {
+    snprintf(out, LB_PATH_MAX, "%s/%d.%s", lb->dir, shard, ext);
+}
+
+/* Index only; returns 1 if the shard's top changed */
+static int shard_add(LbShard* sh, const ScoreRecord* r) {
+    std::string name(r->player, name_len(r));
+    auto it = sh->best.find(name);
+    if (it == sh->best.end()) sh->best.emplace(name, *r);
+    else if (better(r, &it->second)) it->second = *r;
+
+    if (sh->top_count == LB_TOP && !better(r, &sh->top[LB_TOP - 1])) return 0;
+    int i = sh->top_count < LB_TOP ? sh->top_count++ : LB_TOP - 1;
+    for (; i > 0 && better(r, &sh->top[i - 1]); i--) sh->top[i] = sh->top[i - 1];
+    sh->top[i] = *r;
+    return 1;
+}
+
+/* Snapshot, if any and intact; returns the sequence it covers */
+static uint64_t load_snapshot(Leaderboard* lb, int s) {
+    char path[LB_PATH_MAX];
+    shard_path(lb, s, "snap", path);
+    FILE* f = fopen(path, "rb");
+    if (!f) return 0;
+    LbSnapHeader h;
+    uint64_t seq = 0;
+    ScoreRecord* recs = NULL;
+    uint32_t stored = 0;
+    int ok = fread(&h, sizeof(h), 1, f) == 1 && !memcmp(h.magic, "TETRISLB", 8) &&
+             (h.version == LB_SNAP_VERSION || h.version == 1) && h.top_count <= LB_TOP && h.best_count <= 100000000u;
+    size_t count = ok ? (size_t)h.top_count + h.best_count : 0;
+    if (ok && count) {
+        recs = (ScoreRecord*)malloc(count * sizeof(ScoreRecord));
+        ok = recs && fread(recs, sizeof(ScoreRecord), count, f) == count;
+    }
+    ok = ok && fread(&stored, sizeof(stored), 1, f) == 1;
+    if (ok) {
+        uint32_t crc = crc32(0, &h, sizeof(h));
+        if (count) crc = crc32(crc, recs, count * sizeof(ScoreRecord));
+        ok = crc == stored;
+    }
+    if (ok) {
+        LbShard* sh = &lb->shard[s];
+        if (h.version == 1)
+            for (size_t i = 0; i < count; i++) record_from_v1(&recs[i]);
+        memcpy(sh->top, recs, h.top_count * sizeof(ScoreRecord));
+        sh->top_count = (int)h.top_count;
+        for (size_t i = h.top_count; i < count; i++)
+            sh->best.emplace(std::string(recs[i].player, name_len(&recs[i])), recs[i]);
+        seq = h.last_seq;
+        lb->loaded.snapshot_records += count;
+    } else {
+        lb->loaded.bad_snapshots++;
+    }
+    free(recs);
+    fclose(f);
+    return seq;
+}
+
+/* Replays records newer than the snapshot and cuts off a bad tail */
+static int load_log(Leaderboard* lb, int s, uint64_t after) {
+    char path[LB_PATH_MAX];
+    shard_path(lb, s, "log", path);
+    LbShard* sh = &lb->shard[s];
+    sh->seq = after;
+    long long good = 0, size = 0;
+    FILE* f = fopen(path, "rb");
+    if (f) {
+        LbLogRecord rec;
+        while (fread(&rec, sizeof(rec), 1, f) == 1) {
+            if ((rec.magic != LB_LOG_MAGIC && rec.magic != LB_LOG_MAGIC_V1) ||
+                rec.crc != crc32(0, &rec.seq, sizeof(rec) - offsetof(LbLogRecord, seq)))
+                break;
+            if (rec.magic == LB_LOG_MAGIC_V1) record_from_v1(&rec.record);
+            good += (long long)sizeof(rec);
+            if (rec.seq <= after) continue;
+            shard_add(sh, &rec.record);
+            sh->seq = rec.seq;
+            lb->loaded.log_records++;
+        }
+        fseek(f, 0, SEEK_END);
+        size = ftell(f);
+        fclose(f);
+    }
+    sh->fd = file_open(path, 1);
+    if (sh->fd < 0) return 0;
+    if (size > good) {
+        lb->loaded.torn_bytes += (uint64_t)(size - good);
+        if (!file_truncate(sh->fd, good)) return 0;
+    }
+    return 1;
+}
+
+Leaderboard* lb_open(const char* dir, int sync_ms) {
+    if (strlen(dir) >= LB_PATH_MAX - 16 || !make_dir(dir)) return NULL;
+    Leaderboard* lb = new Leaderboard();
+    snprintf(lb->dir, sizeof(lb->dir), "%s", dir);
+    lb->sync_ms = sync_ms;
+    lb->top_version.store(1);
+    lb->inserts.store(0);
+    lb->syncs.store(0);
+    memset(&lb->loaded, 0, sizeof(lb->loaded));
+    lb->merged_version = 0;
+    lb->merged_count = 0;
+    int ok = 1;
+    for (int s = 0; s < LB_SHARDS; s++) {
+        LbShard* sh = &lb->shard[s];
+        sh->fd = -1;
+        sh->top_count = 0;
+        sh->dirty = 0;
+        sh->synced = std::chrono::steady_clock::now();
+        if (ok) ok = load_log(lb, s, load_snapshot(lb, s));
+    }
+    if (!ok) {
+        for (int s = 0; s < LB_SHARDS; s++)
+            if (lb->shard[s].fd >= 0) file_close(lb->shard[s].fd);
+        delete lb;
+        return NULL;
+    }
+    return lb;
+}
+
+void lb_close(Leaderboard* lb) {
+    if (!lb) return;
+    lb_sync(lb);
+    for (int s = 0; s < LB_SHARDS; s++) file_close(lb->shard[s].fd);
+    delete lb;
+}
+
+void lb_record_game(ScoreRecord* r, const char* player, const GameState* s, uint32_t seed,
+                    uint32_t duration_ms) {
+    memset(r, 0, sizeof(*r));
+    memcpy(r->player, player, strnlen(player, LB_NAME_MAX));
+    r->score = s->score;
+    r->lines = s->lines_total;
+    r->level = s->level;
+    r->duration_ms = duration_ms;
+    r->seed = seed;
+    r->finished = (int64_t)time(NULL);
+}
+
+int lb_insert(Leaderboard* lb, const ScoreRecord* r) {
+    LbLogRecord rec;
+    rec.magic = LB_LOG_MAGIC;
+    rec.record = *r;
+    /* Bytes past the name's NUL are zeroed so equal names hash equal */
+    size_t n = name_len(&rec.record);
+    memset(rec.record.player + n, 0, LB_NAME_MAX - n);
+    if (!rec.record.finished) rec.record.finished = (int64_t)time(NULL);
+    LbShard* sh = &lb->shard[shard_of(rec.record.player, n)];
+
+    std::lock_guard<std::mutex> lock(sh->lock);
+    rec.seq = sh->seq + 1;
+    rec.crc = crc32(0, &rec.seq, sizeof(rec) - offsetof(LbLogRecord, seq));
+    if (!file_write(sh->fd, &rec, sizeof(rec))) return 0;
+    sh->seq = rec.seq;
+    if (shard_add(sh, &rec.record)) lb->top_version.fetch_add(1, std::memory_order_release);
+    lb->inserts.fetch_add(1, std::memory_order_relaxed);
+    sh->dirty = 1;
+    if (lb->sync_ms >= 0) {
+        auto now = std::chrono::steady_clock::now();
+        if (now - sh->synced >= std::chrono::milliseconds(lb->sync_ms)) {
+            file_sync(sh->fd);
+            sh->synced = now;
+            sh->dirty = 0;
+            lb->syncs.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    return 1;
+}
+
+int lb_top(Leaderboard* lb, ScoreRecord* out, int n) {
+    if (n > LB_TOP) n = LB_TOP;
+    std::lock_guard<std::mutex> lock(lb->merged_lock);
+    uint64_t version = lb->top_version.load(std::memory_order_acquire);
+    if (version != lb->merged_version) {
+        /* A shard that changes after version was read bumps it again, so
+           the next query rebuilds */
+        int pos[LB_SHARDS];
+        for (int s = 0; s < LB_SHARDS; s++) {
+            LbShard* sh = &lb->shard[s];
+            std::lock_guard<std::mutex> shard_lock(sh->lock);
+            memcpy(lb->scratch[s], sh->top, (size_t)sh->top_count * sizeof(ScoreRecord));
+            lb->scratch_count[s] = sh->top_count;
+            pos[s] = 0;
+        }
+        lb->merged_count = 0;
+        while (lb->merged_count < LB_TOP) {
+            int pick = -1;
+            for (int s = 0; s < LB_SHARDS; s++)
+                if (pos[s] < lb->scratch_count[s] &&
+                    (pick < 0 || better(&lb->scratch[s][pos[s]], &lb->scratch[pick][pos[pick]])))
+                    pick = s;
+            if (pick < 0) break;
+            lb->merged[lb->merged_count++] = lb->scratch[pick][pos[pick]++];
+        }
+        lb->merged_version = version;
+    }
+    if (n > lb->merged_count) n = lb->merged_count;
+    memcpy(out, lb->merged, (size_t)(n > 0 ? n : 0) * sizeof(ScoreRecord));
+    return n > 0 ? n : 0;
+}
+
+int lb_player_best(Leaderboard* lb, const char* player, ScoreRecord* out) {
+    size_t n = strnlen(player, LB_NAME_MAX);
+    LbShard* sh = &lb->shard[shard_of(player, n)];
+    std::string name(player, n);
+    std::lock_guard<std::mutex> lock(sh->lock);
+    auto it = sh->best.find(name);
+    if (it == sh->best.end()) return 0;
+    *out = it->second;
+    return 1;
+}
+
+int lb_sync(Leaderboard* lb) {
+    int ok = 1;
+    for (int s = 0; s < LB_SHARDS; s++) {
+        LbShard* sh = &lb->shard[s];
+        std::lock_guard<std::mutex> lock(sh->lock);
+        if (!sh->dirty) continue;
+        ok &= file_sync(sh->fd);
+        sh->synced = std::chrono::steady_clock::now();
+        sh->dirty = 0;
+        lb->syncs.fetch_add(1, std::memory_order_relaxed);
+    }
+    return ok;
+}
+
+/* Per shard: snapshot to a temporary file, sync, rename over the old
+   one, then empty the log. Inserts to other shards carry on meanwhile. */
+int lb_compact(Leaderboard* lb) {
+    int ok = 1;
+    for (int s = 0; s < LB_SHARDS && ok; s++) {
+        LbShard* sh = &lb->shard[s];
+        char tmp[LB_PATH_MAX], path[LB_PATH_MAX];
+        shard_path(lb, s, "snap.tmp", tmp);
+        shard_path(lb, s, "snap", path);
+        std::lock_guard<std::mutex> lock(sh->lock);
+        LbSnapHeader h;
+        memset(&h, 0, sizeof(h));
+        memcpy(h.magic, "TETRISLB", 8);
+        h.version = LB_SNAP_VERSION;
+        h.top_count = (uint32_t)sh->top_count;
+        h.best_count = (uint32_t)sh->best.size();
+        h.last_seq = sh->seq;
+        int fd = file_open(tmp, 0);
+        if (fd < 0) return 0;
+        uint32_t crc = crc32(0, &h, sizeof(h));
+        ok = file_write(fd, &h, sizeof(h));
+        if (ok && sh->top_count) {
+            crc = crc32(crc, sh->top, (size_t)sh->top_count * sizeof(ScoreRecord));
+            ok = file_write(fd, sh->top, (size_t)sh->top_count * sizeof(ScoreRecord));
+        }
+        for (auto it = sh->best.begin(); ok && it != sh->best.end(); ++it) {
+            crc = crc32(crc, &it->second, sizeof(ScoreRecord));
+            ok = file_write(fd, &it->second, sizeof(ScoreRecord));
+        }
+        ok = ok && file_write(fd, &crc, sizeof(crc)) && file_sync(fd);
+        file_close(fd);
+        ok = ok && replace_file(tmp, path);
+        /* Appends after this land at the new end */
+        if (ok) ok = file_truncate(sh->fd, 0) && file_sync(sh->fd);
+        sh->dirty = 0;
+    }
+    return ok;
+}
+
+void lb_stats(Leaderboard* lb, LbStats* out) {
+    *out = lb->loaded;
+    out->inserts = lb->inserts.load();
+    out->syncs = lb->syncs.load();
+    out->players = 0;
+    for (int s = 0; s < LB_SHARDS; s++) {
+        std::lock_guard<std::mutex> lock(lb->shard[s].lock);
+        out->players += lb->shard[s].best.size();
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef TETRIS_LEADERBOARD_H
+#define TETRIS_LEADERBOARD_H
+
+/* High scores that outlive the process. Finished games are appended to a
+   log as fixed-size checksummed records and indexed in memory: the best
+   LB_TOP games of each shard and every player's best game. Players are
+   spread over LB_SHARDS shards by name, each with its own lock, log and
+   index, so inserts from different threads rarely meet. A top query
+   merges the shards once and serves the merged list until some shard's
+   top changes.
+
+   On disk, DIR/N.log per shard. A torn or corrupt tail record, left by a
+   crash mid-write, is cut off when the log is loaded. lb_compact writes
+   each shard's index to DIR/N.snap and empties its log, so startup reads
+   one snapshot and what was appended since. Records carry a per-shard
+   sequence number, so a crash between those two steps replays nothing
+   twice.
+
+   A record has reached the OS when lb_insert returns. Each shard fsyncs
+   at most every sync_ms (0: every insert, negative: only in lb_sync).
+   Portable. */
+
+#include <stdint.h>
+#include "tetris_core.h"
+
+#define LB_SHARDS 16
+#define LB_TOP 128                /* games kept per shard; the most a query returns */
+#define LB_NAME_MAX 24
+
+/* Little-endian with no padding, as written to disk */
+typedef struct {
+    char player[LB_NAME_MAX];     /* NUL-padded */
+    int64_t score;
+    int32_t lines;
+    int32_t level;
+    uint32_t duration_ms;
+    uint32_t seed;
+    int64_t finished;             /* unix seconds */
+} ScoreRecord;
+
+typedef struct Leaderboard Leaderboard;
+
+typedef struct {
+    uint64_t inserts;
+    uint64_t snapshot_records;    /* read at open */
+    uint64_t log_records;         /* replayed at open */
+    uint64_t torn_bytes;          /* cut off log tails */
+    uint64_t bad_snapshots;       /* ignored at open */
+    uint64_t syncs;
+    uint64_t players;
+} LbStats;
+
+/* Creates dir if needed; NULL if it cannot be used */
+Leaderboard* lb_open(const char* dir, int sync_ms);
+/* Syncs, then frees */
+void lb_close(Leaderboard* lb);
+
+void lb_record_game(ScoreRecord* r, const char* player, const GameState* s, uint32_t seed,
+                    uint32_t duration_ms);
+/* Stamps finished if it is 0; returns 0 if the log could not be written */
+int lb_insert(Leaderboard* lb, const ScoreRecord* r);
+/* Best first; returns how many were written, at most n and LB_TOP */
+int lb_top(Leaderboard* lb, ScoreRecord* out, int n);
+int lb_player_best(Leaderboard* lb, const char* player, ScoreRecord* out);
+
+int lb_sync(Leaderboard* lb);
+int lb_compact(Leaderboard* lb);
+void lb_stats(Leaderboard* lb, LbStats* out);
+
+#endif /* TETRIS_LEADERBOARD_H */
@@ -0,0 +1,301 @@
+// Load generator for tetris_server - many simulated clients on a few
+// epoll threads, each sending seeded random inputs and timing the state
+// that acknowledges them
+// Build: g++ -O2 -std=c++17 -pthread tetris_loadgen.cpp tetris_net.cpp tetris_wheel.cpp tetris_core.cpp -o tetris_loadgen
+//        Linux only (epoll, timerfd)
+// Usage: tetris_loadgen --connect unix:/tmp/tetris.sock --games 10000 --seconds 10
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "tetris_net.h"
+#include "tetris_wheel.h"
+
+/* Clients keep the send times of their last few inputs; a state whose
+   ack covers an input gives that input's round trip. Inputs go out on a
+   per-thread timer wheel with 1 ms ticks. */
+
+#define SENT_RING 16              /* power of two */
+#define RTT_BUCKETS 100000        /* 1 us each */
+#define EVENTS_PER_WAIT 512
+#define TIMER_ID 0xffffffffu
+
+typedef struct {
+    int fd;
+    int started;                  /* sent its first NET_HELLO */
+    uint32_t rng, seed;
+    uint32_t seq, acked;
+    uint64_t sent_us[SENT_RING];
+    int in_len;
+    uint8_t in[NET_MESSAGE_MAX * 4];
+} Client;
+
+typedef struct {
+    int epfd, tfd;
+    Client* clients;
+    WheelNode* nodes;
+    int count;
+    TimerWheel wheel;
+    uint64_t timer_tick;
+    uint64_t rtt[RTT_BUCKETS];
+    uint64_t rtt_max_us;
+    uint64_t inputs, states, restarts, lost;
+} Thread;
+
+static std::atomic<int> stopping(0);
+static struct timespec clock_base;
+static int key_ms = 250;
+static int start_level = 1;
+static int ramp_ms = 1000;
+
+static uint64_t now_us(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)(t.tv_sec - clock_base.tv_sec) * 1000000 + (t.tv_nsec - clock_base.tv_nsec) / 1000;
+}
+
+static void usage(void) {
+    printf("Usage: tetris_loadgen [options]\n"
+           "  --connect ADDR   unix:/path or host:port (default unix:/tmp/tetris.sock)\n"
+           "  --games N        concurrent clients (default 1000)\n"
+           "  --threads N      client threads (default 2)\n"
+           "  --key-ms N       mean gap between one client's inputs (default 250)\n"
+           "  --level N        starting level of every game (default 1)\n"
+           "  --ramp-ms N      spread the game starts over N ms (default 1000)\n"
+           "  --seconds N      run time once everyone is connected (default 10)\n");
+}
+
+static int send_all(Client* c, const uint8_t* p, size_t n) {
+    while (n > 0) {
+        ssize_t sent = send(c->fd, p, n, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent <= 0) return 0;   /* a full socket counts as lost input */
+        p += sent;
+        n -= (size_t)sent;
+    }
+    return 1;
+}
+
+static void send_hello(Client* c) {
+    uint8_t msg[16];
+    send_all(c, msg, net_put_hello(msg, c->seed++, start_level));
+}
+
+static void on_input_due(int id, uint64_t due, void* ctx) {
+    static const int mix[16] = {
+        INPUT_LEFT, INPUT_LEFT, INPUT_RIGHT, INPUT_RIGHT, INPUT_LEFT, INPUT_RIGHT,
+        INPUT_ROTATE, INPUT_ROTATE, INPUT_ROTATE, INPUT_SOFT_DROP, INPUT_SOFT_DROP,
+        INPUT_SOFT_DROP, INPUT_HARD_DROP, INPUT_HARD_DROP, INPUT_HOLD, INPUT_LEFT
+    };
+    Thread* t = (Thread*)ctx;
+    Client* c = &t->clients[id];
+    if (c->fd < 0) return;
+    if (!c->started) {
+        send_hello(c);
+        c->started = 1;
+    } else {
+        uint8_t msg[16];
+        c->seq++;
+        c->sent_us[c->seq & (SENT_RING - 1)] = now_us();
+        if (send_all(c, msg, net_put_input(msg, c->seq, mix[rng_next(&c->rng) & 15]))) t->inputs++;
+        else t->lost++;
+    }
+    wheel_add(&t->wheel, id, due + 1 + rng_next(&c->rng) % (uint32_t)(key_ms * 2));
+}
+
+static void on_state(Thread* t, Client* c, const uint8_t* p, size_t n) {
+    GameState s;
+    uint32_t tick, ack;
+    if (!net_get_state(p, n, &s, &tick, &ack)) return;
+    t->states++;
+    uint64_t now = now_us();
+    /* Inputs older than the ring are no longer timed */
+    if (ack - c->acked > SENT_RING) c->acked = ack - SENT_RING;
+    for (; c->acked != ack && (int32_t)(ack - c->acked) > 0; c->acked++) {
+        uint64_t us = now - c->sent_us[(c->acked + 1) & (SENT_RING - 1)];
+        if (us > t->rtt_max_us) t->rtt_max_us = us;
+        t->rtt[us < RTT_BUCKETS ? us : RTT_BUCKETS - 1]++;
+    }
+    if (s.game_over) {
+        t->restarts++;
+        send_hello(c);
+    }
+}
+
+static void on_readable(Thread* t, int id) {
+    Client* c = &t->clients[id];
+    for (;;) {
+        ssize_t n = recv(c->fd, c->in + c->in_len, sizeof(c->in) - c->in_len, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+        if (n <= 0) {
+            close(c->fd);
+            c->fd = -1;
+            return;
+        }
+        c->in_len += (int)n;
+        int used = 0;
+        for (;;) {
+            int type;
+            const uint8_t* payload;
+            size_t len;
+            int size = net_frame(c->in + used, c->in_len - used, &type, &payload, &len);
+            if (size <= 0) break;
+            if (type == NET_STATE) on_state(t, c, payload, len);
+            used += size;
+        }
+        memmove(c->in, c->in + used, c->in_len - used);
+        c->in_len -= used;
+    }
+}
+
+static void arm_timer(Thread* t) {
+    uint64_t next = wheel_next(&t->wheel, WHEEL_SLOTS);
+    if (next == t->timer_tick) return;
+    t->timer_tick = next;
+    struct itimerspec its;
+    memset(&its, 0, sizeof(its));
+    if (next != UINT64_MAX) {
+        uint64_t ns = (uint64_t)clock_base.tv_nsec + next * 1000000;
+        its.it_value.tv_sec = clock_base.tv_sec + (time_t)(ns / 1000000000);
+        its.it_value.tv_nsec = (long)(ns % 1000000000);
+    }
+    timerfd_settime(t->tfd, TFD_TIMER_ABSTIME, &its, NULL);
+}
+
+static void thread_main(Thread* t) {
+    struct epoll_event events[EVENTS_PER_WAIT];
+    while (!stopping.load(std::memory_order_relaxed)) {
+        int n = epoll_wait(t->epfd, events, EVENTS_PER_WAIT, 100);
+        for (int i = 0; i < n; i++) {
+            uint32_t id = events[i].data.u32;
+            if (id == TIMER_ID) {
+                uint64_t expirations;
+                if (read(t->tfd, &expirations, sizeof(expirations)) < 0) { /* spurious */ }
+                t->timer_tick = UINT64_MAX;
+            } else if (t->clients[id].fd >= 0) {
+                on_readable(t, (int)id);
+            }
+        }
+        wheel_advance(&t->wheel, now_us() / 1000, on_input_due, t);
+        arm_timer(t);
+    }
+}
+
+/* Connects this thread's share of the clients; each says hello at a
+   random point of the ramp, so gravity deadlines do not all line up */
+static int thread_init(Thread* t, const char* addr, int first, int count) {
+    t->count = count;
+    t->clients = (Client*)calloc((size_t)count, sizeof(Client));
+    t->nodes = (WheelNode*)calloc((size_t)count, sizeof(WheelNode));
+    t->epfd = epoll_create1(EPOLL_CLOEXEC);
+    t->tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (!t->clients || !t->nodes || t->epfd < 0 || t->tfd < 0) return 0;
+    t->timer_tick = UINT64_MAX;
+    wheel_init(&t->wheel, t->nodes, count, now_us() / 1000);
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.u32 = TIMER_ID;
+    epoll_ctl(t->epfd, EPOLL_CTL_ADD, t->tfd, &ev);
+    for (int i = 0; i < count; i++) {
+        Client* c = &t->clients[i];
+        c->fd = net_connect(addr);
+        if (c->fd < 0) {
+            fprintf(stderr, "connect %s: %s\n", addr, strerror(errno));
+            return 0;
+        }
+        c->seed = (uint32_t)(first + i) * 7919u + 1;
+        c->rng = c->seed * 2654435761u + 1;
+        ev.data.u32 = (uint32_t)i;
+        epoll_ctl(t->epfd, EPOLL_CTL_ADD, c->fd, &ev);
+        wheel_add(&t->wheel, i, now_us() / 1000 + rng_next(&c->rng) % (uint32_t)ramp_ms);
+    }
+    return 1;
+}
+
+static double percentile(const uint64_t* hist, uint64_t total, double pct) {
+    uint64_t rank = (uint64_t)(total * pct / 100.0), seen = 0;
+    for (int b = 0; b < RTT_BUCKETS; b++) {
+        seen += hist[b];
+        if (seen > rank) return b / 1000.0;
+    }
+    return RTT_BUCKETS / 1000.0;
+}
+
+int main(int argc, char** argv) {
+    const char* addr = "unix:/tmp/tetris.sock";
+    int games = 1000, threads = 2, seconds = 10;
+
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        const char* v = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!strcmp(a, "--help")) { usage(); return 0; }
+        if (!v) { usage(); return 1; }
+        if (!strcmp(a, "--connect")) addr = v;
+        else if (!strcmp(a, "--games")) games = atoi(v);
+        else if (!strcmp(a, "--threads")) threads = atoi(v);
+        else if (!strcmp(a, "--key-ms")) key_ms = atoi(v);
+        else if (!strcmp(a, "--level")) start_level = atoi(v);
+        else if (!strcmp(a, "--ramp-ms")) ramp_ms = atoi(v);
+        else if (!strcmp(a, "--seconds")) seconds = atoi(v);
+        else { usage(); return 1; }
+        i++;
+    }
+    if (threads < 1) threads = 1;
+    if (games < threads) games = threads;
+    if (key_ms < 1) key_ms = 1;
+    if (ramp_ms < 1) ramp_ms = 1;
+
+    clock_gettime(CLOCK_MONOTONIC, &clock_base);
+    long fd_limit = net_raise_fd_limit();
+    if (fd_limit > 0 && fd_limit < games + 64)
+        fprintf(stderr, "warning: open file limit %ld is below %d games\n", fd_limit, games);
+
+    std::vector<Thread*> pool(threads);
+    for (int i = 0; i < threads; i++) {
+        int first = games * i / threads, last = games * (i + 1) / threads;
+        pool[i] = (Thread*)calloc(1, sizeof(Thread));
+        if (!pool[i] || !thread_init(pool[i], addr, first, last - first)) return 1;
+    }
+    printf("%d clients connected to %s\n", games, addr);
+    fflush(stdout);
+
+    std::vector<std::thread> running;
+    uint64_t start = now_us();
+    for (Thread* t : pool) running.emplace_back(thread_main, t);
+    usleep((useconds_t)seconds * 1000000);
+    stopping.store(1);
+    for (std::thread& t : running) t.join();
+    double elapsed = (now_us() - start) / 1e6;
+
+    static uint64_t merged[RTT_BUCKETS];
+    uint64_t inputs = 0, states = 0, restarts = 0, lost = 0, samples = 0, max_us = 0;
+    for (Thread* t : pool) {
+        inputs += t->inputs;
+        states += t->states;
+        restarts += t->restarts;
+        lost += t->lost;
+        if (t->rtt_max_us > max_us) max_us = t->rtt_max_us;
+        for (int b = 0; b < RTT_BUCKETS; b++) {
+            merged[b] += t->rtt[b];
+            samples += t->rtt[b];
+        }
+        for (int i = 0; i < t->count; i++)
+            if (t->clients[i].fd >= 0) close(t->clients[i].fd);
+    }
+    printf("%.1f s: %llu inputs (%.0f/s, %llu not sent), %llu states (%.0f/s), %llu games restarted\n",
+           elapsed, (unsigned long long)inputs, inputs / elapsed, (unsigned long long)lost,
+           (unsigned long long)states, states / elapsed, (unsigned long long)restarts);
+    if (samples)
+        printf("input round trip ms: p50 %.3f p99 %.3f p999 %.3f max %.3f\n", percentile(merged, samples, 50),
+               percentile(merged, samples, 99), percentile(merged, samples, 99.9), max_us / 1000.0);
+    return 0;
+}
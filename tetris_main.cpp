@@ -1,30 +1,37 @@
 #include "tetris.h"
-#include <time.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <windowsx.h>
 
 #define GET_X_LPARAM(lp) ((int)(short)LOWORD(lp))
 #define GET_Y_LPARAM(lp) ((int)(short)HIWORD(lp))
 
-void reset_timer(HWND hwnd) {
-    KillTimer(hwnd, 1);
-    SetTimer(hwnd, 1, speed_ms, NULL);
+/* Runs on the hint worker thread */
+static void hint_ready(void* ctx) {
+    (void)ctx;
+    render_thread_wake(RENDER_WAKE_FRAME);
 }
 
+/* The window thread is the input thread: keys go straight to the
+   simulation, drawing happens on the render thread */
+static int spectating = 0;
+static const char* latency_path = NULL;   /* --latency FILE */
+static int metrics_port = 0;              /* --metrics PORT */
+
 static LRESULT CALLBACK window_proc(HWND hwnd, UINT msg, WPARAM wparam, LPARAM lparam) {
     switch (msg) {
-    case WM_CREATE:
-        create_d2d_resources(hwnd);
-        reset_timer(hwnd);
+    case WM_CREATE: {
+        BotWeights wt;
+        if (!bot_load_weights("tuned_weights.txt", &wt)) wt = bot_default_weights;
+        TRACE_THREAD("input");
+        hint_start(&wt, hint_ready, NULL);
+        render_thread_start(hwnd);
+        game_start(latency_path);
         return 0;
+    }
     case WM_SIZE:
-        if (render_target) {
-            RECT rc;
-            GetClientRect(hwnd, &rc);
-            D2D1_SIZE_U size = D2D1::SizeU(rc.right - rc.left, rc.bottom - rc.top);
-            render_target->Resize(size);
-        }
-        InvalidateRect(hwnd, NULL, FALSE);
+        render_thread_wake(RENDER_WAKE_RESIZE);
         return 0;
     case WM_LBUTTONDOWN: {
         /* Allow dragging from custom titlebar */
@@ -40,7 +47,7 @@ static LRESULT CALLBACK window_proc(HWND hwnd, UINT msg, WPARAM wparam, LPARAM l
 
         /* Check if close button (X) is clicked - top right corner */
         if (y >= 10 && y <= 35 && x >= close_btn_left && x <= close_btn_right) {
-            PostQuitMessage(0);
+            DestroyWindow(hwnd);
             return 0;
         }
 
@@ -50,95 +57,51 @@ static LRESULT CALLBACK window_proc(HWND hwnd, UINT msg, WPARAM wparam, LPARAM l
         }
         return 0;
     }
-    case WM_TIMER:
-        if (wparam == 1 && !game_over) {
-            game_tick(hwnd);
-            animation_frame++;
-        }
-        return 0;
     case WM_KEYDOWN:
-        switch (wparam) {
-        case VK_LEFT:
-            if (fits_piece(cur_piece, cur_x - 1, cur_y, cur_rot)) cur_x--;
-            break;
-        case VK_RIGHT:
-            if (fits_piece(cur_piece, cur_x + 1, cur_y, cur_rot)) cur_x++;
-            break;
-        case VK_UP: {
-            int nr = (cur_rot + 1) % 4;
-            const int kicks[8][2] = {
-                {0,0}, {-1,0}, {1,0}, {-2,0}, {2,0}, {0,-1}, {-1,-1}, {1,-1}
-            };
-            for (int ki = 0; ki < 8; ki++) {
-                int kx = kicks[ki][0];
-                int ky = kicks[ki][1];
-                if (fits_piece(cur_piece, cur_x + kx, cur_y + ky, nr)) {
-                    cur_x += kx;
-                    cur_y += ky;
-                    cur_rot = nr;
-                    break;
-                }
-            }
-            break;
-        }
-        case VK_DOWN:
-            if (fits_piece(cur_piece, cur_x, cur_y + 1, cur_rot)) {
-                cur_y++;
-                score += 1;
-            }
-            break;
-        case VK_SPACE: {
-            int drop = 0;
-            while (fits_piece(cur_piece, cur_x, cur_y + 1, cur_rot)) {
-                cur_y++;
-                drop++;
-            }
-            score += drop * 2;
-            lock_piece();
-            {
-                int cleared = clear_lines();
-                if (cleared > 0) {
-                    const int line_scores[5] = {0, 100, 300, 500, 800};
-                    score += line_scores[cleared] * level;
-                    lines_total += cleared;
-                    level = lines_total / 10 + 1;
-                    update_speed();
-                    reset_timer(hwnd);
-                }
-            }
-            spawn_piece();
-            break;
+        /* The player's game is paused under the spectator grid */
+        if (wparam == 'V' || wparam == 'v') {
+            spectating = !spectating;
+            sim_post(spectating ? SIM_PAUSE : SIM_RESUME);
+            render_thread_wake(RENDER_WAKE_SPECTATE);
+            return 0;
         }
+        if (spectating && wparam != 'Q' && wparam != 'q') return 0;
+        switch (wparam) {
+        case VK_LEFT: sim_post(INPUT_LEFT); break;
+        case VK_RIGHT: sim_post(INPUT_RIGHT); break;
+        case VK_UP: sim_post(INPUT_ROTATE); break;
+        case VK_DOWN: sim_post(INPUT_SOFT_DROP); break;
+        case VK_SPACE: sim_post(INPUT_HARD_DROP); break;
         case 'C':
         case 'c':
-            if (!hold_used) {
-                if (hold_piece < 0) {
-                    hold_piece = cur_piece;
-                    spawn_piece();
-                } else {
-                    int temp = hold_piece;
-                    hold_piece = cur_piece;
-                    set_current_piece(temp);
-                }
-                hold_used = 1;
-            }
+            sim_post(INPUT_HOLD);
+            break;
+        case 'T':
+        case 't':
+            game_dump_trace();
             break;
         case 'Q':
         case 'q':
-            PostQuitMessage(0);
+            DestroyWindow(hwnd);
             break;
         default:
             break;
         }
-        InvalidateRect(hwnd, NULL, FALSE);
         return 0;
-    case WM_PAINT:
-        on_paint(hwnd);
-        ValidateRect(hwnd, NULL);
+    case WM_PAINT: {
+        PAINTSTRUCT ps;
+        BeginPaint(hwnd, &ps);
+        EndPaint(hwnd, &ps);
+        render_thread_wake(RENDER_WAKE_FULL);
         return 0;
+    }
+    /* Every way out ends here, so the worker threads are joined before
+       WinMain returns */
     case WM_DESTROY:
-        KillTimer(hwnd, 1);
-        discard_d2d_resources();
+        game_stop();
+        hint_stop();
+        render_thread_stop();
+        game_report();
         PostQuitMessage(0);
         return 0;
     }
@@ -147,14 +110,19 @@ static LRESULT CALLBACK window_proc(HWND hwnd, UINT msg, WPARAM wparam, LPARAM l
 
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine, int nCmdShow) {
     (void)hPrevInstance;
-    (void)lpCmdLine;
 
-    srand((unsigned)time(NULL));
-    next_piece = -1;
-    level = 1;
-    lines_total = 0;
-    update_speed();
-    spawn_piece();
+    /* --latency FILE: input-to-display percentiles written on exit */
+    static char probe_path[MAX_PATH];
+    const char* arg = lpCmdLine ? strstr(lpCmdLine, "--latency ") : NULL;
+    if (arg && sscanf(arg + 10, " %259[^\r\n]", probe_path) == 1) {
+        char* next = strstr(probe_path, " --");
+        if (next) *next = 0;
+        latency_path = probe_path;
+    }
+    /* --metrics PORT: live counters at http://127.0.0.1:PORT/metrics */
+    arg = lpCmdLine ? strstr(lpCmdLine, "--metrics ") : NULL;
+    if (arg) metrics_port = atoi(arg + 10);
+    if (metrics_port > 0) metrics_serve_start(metrics_port);
 
     const wchar_t CLASS_NAME[] = L"TetrisWindowClass";
     WNDCLASS wc = {};
@@ -169,7 +137,7 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
         CLASS_NAME,
         L"",
         WS_POPUP | WS_VISIBLE | WS_MINIMIZEBOX,
-        CW_USEDEFAULT, CW_USEDEFAULT, 650, 1050,
+        CW_USEDEFAULT, CW_USEDEFAULT, RENDER_WINDOW_WIDTH, RENDER_WINDOW_HEIGHT,
         NULL,
         NULL,
         hInstance,
@@ -190,6 +158,10 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
         TranslateMessage(&msg);
         DispatchMessage(&msg);
     }
+    /* WM_QUIT from anywhere else still goes through WM_DESTROY, so the
+       hint, render and simulation threads never outlive WinMain */
+    if (IsWindow(hwnd)) DestroyWindow(hwnd);
 
+    metrics_serve_stop();
     return (int)msg.wParam;
 }
\ No newline at end of file
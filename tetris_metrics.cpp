@@ -0,0 +1,347 @@
+#include "tetris_metrics.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32")
+typedef SOCKET MetricsSocket;
+#define metrics_close closesocket
+#define metrics_poll WSAPoll
+#else
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+typedef int MetricsSocket;
+#define INVALID_SOCKET (-1)
+#define metrics_close close
+#define metrics_poll poll
+#endif
+
+#define SUM_SCALE 1000000.0   /* histogram sums kept in millionths */
+#define CLIENT_TIMEOUT_MS 2000 /* a scrape that takes longer is dropped */
+
+enum { KIND_COUNTER, KIND_GAUGE, KIND_HISTOGRAM };
+
+typedef struct {
+    char name[64];
+    char labels[64];
+    const char* help;
+    int kind;
+    int slot;                 /* first slot */
+    int bound_count;
+    double bounds[METRICS_MAX_BUCKETS];
+} MetricsSeries;
+
+struct alignas(64) MetricsShard {
+    std::atomic<uint64_t> v[METRICS_MAX_SLOTS];
+};
+
+static MetricsShard shards[METRICS_SHARDS];
+static MetricsSeries series[METRICS_MAX_SERIES];
+static int series_count = 0;
+static int slots_used = 0;
+static std::mutex registry_mutex;
+static std::atomic<unsigned> next_shard(0);
+static thread_local int shard_index = -1;
+
+/* Threads take shards round robin, so up to METRICS_SHARDS threads never
+   share a cache line */
+static MetricsShard* my_shard(void) {
+    if (shard_index < 0) shard_index = (int)(next_shard.fetch_add(1) % METRICS_SHARDS);
+    return &shards[shard_index];
+}
+
+static int add_series(const char* name, const char* labels, const char* help, int kind,
+                      const double* bounds, int bound_count) {
+    if (bound_count > METRICS_MAX_BUCKETS) bound_count = METRICS_MAX_BUCKETS;
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    for (int i = 0; i < series_count; i++)
+        if (!strcmp(series[i].name, name) && !strcmp(series[i].labels, labels)) return i;
+    int slots = kind == KIND_HISTOGRAM ? bound_count + 2 : 1;
+    if (series_count == METRICS_MAX_SERIES || slots_used + slots > METRICS_MAX_SLOTS) return -1;
+    MetricsSeries* s = &series[series_count];
+    snprintf(s->name, sizeof(s->name), "%s", name);
+    snprintf(s->labels, sizeof(s->labels), "%s", labels);
+    s->help = help;
+    s->kind = kind;
+    s->slot = slots_used;
+    s->bound_count = kind == KIND_HISTOGRAM ? bound_count : 0;
+    for (int i = 0; i < s->bound_count; i++) s->bounds[i] = bounds[i];
+    slots_used += slots;
+    return series_count++;
+}
+
+int metrics_counter(const char* name, const char* labels, const char* help) {
+    return add_series(name, labels, help, KIND_COUNTER, NULL, 0);
+}
+
+int metrics_gauge(const char* name, const char* labels, const char* help) {
+    return add_series(name, labels, help, KIND_GAUGE, NULL, 0);
+}
+
+int metrics_histogram(const char* name, const char* labels, const char* help,
+                      const double* bounds, int bound_count) {
+    return add_series(name, labels, help, KIND_HISTOGRAM, bounds, bound_count);
+}
+
+void metrics_add(int id, uint64_t n) {
+    if (id < 0) return;
+    my_shard()->v[series[id].slot].fetch_add(n, std::memory_order_relaxed);
+}
+
+/* Gauges are set from anywhere, so they live in shard 0 only */
+void metrics_gauge_add(int id, int64_t delta) {
+    if (id < 0) return;
+    shards[0].v[series[id].slot].fetch_add((uint64_t)delta, std::memory_order_relaxed);
+}
+
+void metrics_gauge_set(int id, int64_t value) {
+    if (id < 0) return;
+    shards[0].v[series[id].slot].store((uint64_t)value, std::memory_order_relaxed);
+}
+
+void metrics_observe(int id, double v) {
+    if (id < 0) return;
+    const MetricsSeries* s = &series[id];
+    int b = 0;
+    while (b < s->bound_count && v > s->bounds[b]) b++;
+    MetricsShard* shard = my_shard();
+    shard->v[s->slot + b].fetch_add(1, std::memory_order_relaxed);
+    if (v > 0.0) shard->v[s->slot + s->bound_count + 1].fetch_add((uint64_t)(v * SUM_SCALE), std::memory_order_relaxed);
+}
+
+void metrics_note_alloc(const char* kind, size_t bytes) {
+    char labels[64];
+    snprintf(labels, sizeof(labels), "kind=\"%s\"", kind);
+    metrics_add(metrics_counter("tetris_allocations_total", labels, "Heap allocations by the engine"), 1);
+    metrics_add(metrics_counter("tetris_allocated_bytes_total", labels, "Bytes allocated by the engine"), bytes);
+}
+
+typedef struct {
+    int pieces, level, speed;
+    int clears[5];
+} GameSeries;
+
+static GameSeries register_game_series(void) {
+    static const double level_bounds[] = { 1, 2, 4, 6, 8, 10, 12, 15, 20, 25, 30 };
+    static const double speed_bounds[] = { 50, 100, 150, 200, 300, 400, 500, 700, 1000 };
+    GameSeries g;
+    g.pieces = metrics_counter("tetris_pieces_total", "", "Pieces locked");
+    g.level = metrics_histogram("tetris_level", "", "Level at each lock", level_bounds, 11);
+    g.speed = metrics_histogram("tetris_speed_ms", "", "Gravity period at each lock", speed_bounds, 9);
+    g.clears[0] = -1;
+    for (int i = 1; i <= 4; i++) {
+        char labels[16];
+        snprintf(labels, sizeof(labels), "lines=\"%d\"", i);
+        g.clears[i] = metrics_counter("tetris_line_clears_total", labels, "Line clears by rows cleared");
+    }
+    return g;
+}
+
+void metrics_game_step(const GameState* s, int placed, int lines) {
+    static const GameSeries ids = register_game_series();
+    if (s->pieces_placed == placed) return;
+    metrics_add(ids.pieces, (uint64_t)(s->pieces_placed - placed));
+    metrics_observe(ids.level, s->level);
+    metrics_observe(ids.speed, s->speed_ms);
+    int cleared = s->lines_total - lines;
+    if (cleared >= 1 && cleared <= 4) metrics_add(ids.clears[cleared], 1);
+}
+
+static uint64_t slot_total(int slot) {
+    uint64_t sum = 0;
+    for (int i = 0; i < METRICS_SHARDS; i++) sum += shards[i].v[slot].load(std::memory_order_relaxed);
+    return sum;
+}
+
+static void append(std::string* out, const char* fmt, ...) {
+    char line[256];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(line, sizeof(line), fmt, ap);
+    va_end(ap);
+    if (n > 0) out->append(line, n < (int)sizeof(line) ? n : (int)sizeof(line) - 1);
+}
+
+/* Label set with one more pair appended */
+static std::string with_label(const char* labels, const char* extra) {
+    std::string s = labels;
+    if (*labels && *extra) s += ",";
+    s += extra;
+    return s.empty() ? s : "{" + s + "}";
+}
+
+static void render_series(std::string* out, const MetricsSeries* s) {
+    if (s->kind == KIND_COUNTER) {
+        append(out, "%s%s %llu\n", s->name, with_label(s->labels, "").c_str(),
+               (unsigned long long)slot_total(s->slot));
+    } else if (s->kind == KIND_GAUGE) {
+        append(out, "%s%s %lld\n", s->name, with_label(s->labels, "").c_str(),
+               (long long)shards[0].v[s->slot].load(std::memory_order_relaxed));
+    } else {
+        uint64_t cumulative = 0;
+        char le[48];
+        for (int b = 0; b <= s->bound_count; b++) {
+            cumulative += slot_total(s->slot + b);
+            if (b < s->bound_count) snprintf(le, sizeof(le), "le=\"%g\"", s->bounds[b]);
+            else snprintf(le, sizeof(le), "le=\"+Inf\"");
+            append(out, "%s_bucket%s %llu\n", s->name, with_label(s->labels, le).c_str(),
+                   (unsigned long long)cumulative);
+        }
+        append(out, "%s_sum%s %.6f\n", s->name, with_label(s->labels, "").c_str(),
+               slot_total(s->slot + s->bound_count + 1) / SUM_SCALE);
+        append(out, "%s_count%s %llu\n", s->name, with_label(s->labels, "").c_str(),
+               (unsigned long long)cumulative);
+    }
+}
+
+/* Series sharing a name go out together under one HELP/TYPE header, in
+   the order the names were first registered */
+size_t metrics_render(char* buf, size_t cap) {
+    static const char* const type_names[] = { "counter", "gauge", "histogram" };
+    std::string out;
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    for (int i = 0; i < series_count; i++) {
+        const MetricsSeries* s = &series[i];
+        int first = 1;
+        for (int j = 0; j < i && first; j++)
+            if (!strcmp(series[j].name, s->name)) first = 0;
+        if (!first) continue;
+        append(&out, "# HELP %s %s\n", s->name, s->help ? s->help : "");
+        append(&out, "# TYPE %s %s\n", s->name, type_names[s->kind]);
+        for (int j = i; j < series_count; j++)
+            if (!strcmp(series[j].name, s->name)) render_series(&out, &series[j]);
+    }
+    size_t n = out.size() < cap ? out.size() : (cap ? cap - 1 : 0);
+    if (cap) {
+        memcpy(buf, out.data(), n);
+        buf[n] = 0;
+    }
+    return n;
+}
+
+static std::thread serve_thread;
+static std::atomic<int> serve_stopping(0);
+static MetricsSocket listen_socket = INVALID_SOCKET;
+
+static void send_all(MetricsSocket c, const char* p, size_t n) {
+    while (n > 0) {
+        int sent = (int)send(c, p, (int)n, 0);
+        if (sent <= 0) return;
+        p += sent;
+        n -= (size_t)sent;
+    }
+}
+
+/* Waits for the request in short polls, so neither an idle client nor
+   one that trickles bytes can hold up stopping or the next scrape */
+static int wait_readable(MetricsSocket c, std::chrono::steady_clock::time_point deadline) {
+    while (!serve_stopping.load()) {
+        long long left = std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now()).count();
+        if (left <= 0) return 0;
+        struct pollfd p;
+        p.fd = c;
+        p.events = POLLIN;
+        p.revents = 0;
+        int r = metrics_poll(&p, 1, left < 100 ? (int)left : 100);
+        if (r > 0) return 1;
+        if (r < 0) return 0;
+    }
+    return 0;
+}
+
+/* One request per connection, answered and closed */
+static void serve_client(MetricsSocket c) {
+    static char body[1 << 18];
+    char req[2048];
+    int got = 0;
+    /* A client that stops reading the answer is cut off by the send timeout */
+#ifdef _WIN32
+    DWORD send_timeout = CLIENT_TIMEOUT_MS;
+#else
+    struct timeval send_timeout = { CLIENT_TIMEOUT_MS / 1000, (CLIENT_TIMEOUT_MS % 1000) * 1000 };
+#endif
+    setsockopt(c, SOL_SOCKET, SO_SNDTIMEO, (const char*)&send_timeout, sizeof(send_timeout));
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(CLIENT_TIMEOUT_MS);
+    while (got < (int)sizeof(req) - 1) {
+        if (!wait_readable(c, deadline)) break;
+        int n = (int)recv(c, req + got, (int)sizeof(req) - 1 - got, 0);
+        if (n <= 0) break;
+        got += n;
+        req[got] = 0;
+        if (strstr(req, "\r\n\r\n")) break;
+    }
+    req[got] = 0;
+    char head[160];
+    if (!strncmp(req, "GET /metrics ", 13) || !strncmp(req, "GET / ", 6)) {
+        size_t n = metrics_render(body, sizeof(body));
+        int h = snprintf(head, sizeof(head),
+                         "HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                         "Content-Length: %zu\r\nConnection: close\r\n\r\n", n);
+        send_all(c, head, (size_t)h);
+        send_all(c, body, n);
+    } else {
+        static const char not_found[] = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+        send_all(c, not_found, sizeof(not_found) - 1);
+    }
+    metrics_close(c);
+}
+
+static void serve_main(void) {
+    while (!serve_stopping.load()) {
+        struct pollfd p;
+        p.fd = listen_socket;
+        p.events = POLLIN;
+        p.revents = 0;
+        if (metrics_poll(&p, 1, 100) <= 0) continue;
+        MetricsSocket c = accept(listen_socket, NULL, NULL);
+        if (c != INVALID_SOCKET) serve_client(c);
+    }
+}
+
+int metrics_serve_start(int port) {
+    if (listen_socket != INVALID_SOCKET) return 1;
+#ifdef _WIN32
+    WSADATA wsa;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) return 0;
+#endif
+    MetricsSocket s = socket(AF_INET, SOCK_STREAM, 0);
+    if (s == INVALID_SOCKET) return 0;
+    int on = 1;
+    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, (const char*)&on, sizeof(on));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((unsigned short)port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(s, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(s, 16) != 0) {
+        metrics_close(s);
+        return 0;
+    }
+    listen_socket = s;
+    serve_stopping.store(0);
+    serve_thread = std::thread(serve_main);
+    return 1;
+}
+
+void metrics_serve_stop(void) {
+    if (listen_socket == INVALID_SOCKET) return;
+    serve_stopping.store(1);
+    serve_thread.join();
+    metrics_close(listen_socket);
+    listen_socket = INVALID_SOCKET;
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
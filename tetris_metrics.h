@@ -0,0 +1,50 @@
+#ifndef TETRIS_METRICS_H
+#define TETRIS_METRICS_H
+
+/* Live counters in the Prometheus text format, optionally served over
+   HTTP on localhost. Every thread adds into its own shard of relaxed
+   atomics (one cache line apart from the others), so instrumenting a hot
+   loop costs an uncontended add; shards are summed only on scrape.
+
+   Register once and keep the id, e.g.
+       static const int ticks = metrics_counter("tetris_ticks_total", "", "Gravity steps");
+       metrics_add(ticks, 1);
+   Registering the same name and labels again returns the same id. */
+
+#include <stddef.h>
+#include <stdint.h>
+#include "tetris_core.h"
+
+#define METRICS_SHARDS 16
+#define METRICS_MAX_SERIES 128
+#define METRICS_MAX_SLOTS 1024     /* counter values plus histogram buckets */
+#define METRICS_MAX_BUCKETS 16
+
+/* labels: "" or Prometheus label pairs without braces, e.g. "lines=\"4\"".
+   Return -1 when the registry is full; updates to -1 are ignored. */
+int metrics_counter(const char* name, const char* labels, const char* help);
+int metrics_gauge(const char* name, const char* labels, const char* help);
+int metrics_histogram(const char* name, const char* labels, const char* help,
+                      const double* bounds, int bound_count);
+
+void metrics_add(int id, uint64_t n);
+void metrics_gauge_add(int id, int64_t delta);
+void metrics_gauge_set(int id, int64_t value);
+void metrics_observe(int id, double v);
+
+/* Count an allocation of `bytes` under tetris_allocations_total{kind} */
+void metrics_note_alloc(const char* kind, size_t bytes);
+
+/* Counts the pieces and line clears of one game step, with the level and
+   gravity period at each lock; placed and lines are the counts from
+   before the step */
+void metrics_game_step(const GameState* s, int placed, int lines);
+
+/* Text exposition of every series; returns the length, truncated to cap-1 */
+size_t metrics_render(char* buf, size_t cap);
+
+/* GET /metrics on 127.0.0.1:port from a background thread */
+int metrics_serve_start(int port);
+void metrics_serve_stop(void);
+
+#endif /* TETRIS_METRICS_H */
@@ -0,0 +1,320 @@
+#include "tetris_net.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+static_assert(WIDTH * 3 <= 32, "a board row must pack into a u32");
+
+static uint8_t* put8(uint8_t* p, uint32_t v) {
+    *p++ = (uint8_t)v;
+    return p;
+}
+
+static uint8_t* put16(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    return p + 2;
+}
+
+static uint8_t* put32(uint8_t* p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = (uint8_t)(v >> (8 * i));
+    return p + 4;
+}
+
+static uint8_t* put64(uint8_t* p, uint64_t v) {
+    for (int i = 0; i < 8; i++) p[i] = (uint8_t)(v >> (8 * i));
+    return p + 8;
+}
+
+static uint32_t get16(const uint8_t* p) {
+    return p[0] | (uint32_t)p[1] << 8;
+}
+
+static uint32_t get32(const uint8_t* p) {
+    return p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint64_t get64(const uint8_t* p) {
+    return get32(p) | (uint64_t)get32(p + 4) << 32;
+}
+
+static uint32_t pack_row(const int* row) {
+    uint32_t v = 0;
+    for (int x = 0; x < WIDTH; x++) v |= (uint32_t)(row[x] & 7) << (3 * x);
+    return v;
+}
+
+static void unpack_row(int* row, uint32_t v) {
+    for (int x = 0; x < WIDTH; x++) row[x] = (v >> (3 * x)) & 7;
+}
+
+/* Piece pose, preview and counters: NET_HUD bytes shared by NET_STATE and
+   NET_DELTA */
+static uint8_t* put_hud(uint8_t* p, const GameState* s) {
+    p = put8(p, (uint32_t)s->cur_piece);
+    p = put8(p, (uint32_t)s->cur_rot);
+    p = put8(p, (uint32_t)(int8_t)s->cur_x);
+    p = put8(p, (uint32_t)(int8_t)s->cur_y);
+    p = put8(p, (uint32_t)s->next_piece);
+    p = put8(p, s->hold_piece < 0 ? 0xff : (uint32_t)s->hold_piece);
+    p = put8(p, (s->game_over ? NET_STATE_GAME_OVER : 0) | (s->hold_used ? NET_STATE_HOLD_USED : 0));
+    p = put8(p, (uint32_t)s->level);
+    p = put16(p, (uint32_t)s->lines_total);
+    return put64(p, (uint64_t)s->score);
+}
+
+static int get_hud(const uint8_t* p, GameState* s) {
+    s->cur_piece = p[0];
+    s->cur_rot = p[1];
+    s->cur_x = (int8_t)p[2];
+    s->cur_y = (int8_t)p[3];
+    s->next_piece = p[4];
+    s->hold_piece = p[5] == 0xff ? -1 : p[5];
+    s->game_over = (p[6] & NET_STATE_GAME_OVER) != 0;
+    s->hold_used = (p[6] & NET_STATE_HOLD_USED) != 0;
+    s->level = p[7];
+    s->speed_ms = speed_for_level(s->level);
+    s->lines_total = (int)get16(p + 8);
+    s->score = (int64_t)get64(p + 10);
+    return s->cur_piece <= 6 && s->cur_rot <= 3 && s->next_piece <= 6 && s->hold_piece <= 6;
+}
+
+/* Fills in the length once the payload is written */
+static size_t finish(uint8_t* out, uint8_t* end) {
+    size_t n = (size_t)(end - out);
+    put16(out, (uint32_t)(n - 2));
+    return n;
+}
+
+size_t net_put_hello(uint8_t* out, uint32_t seed, int level) {
+    uint8_t* p = put8(out + 2, NET_HELLO);
+    p = put32(p, seed);
+    p = put8(p, (uint32_t)level);
+    return finish(out, p);
+}
+
+size_t net_put_input(uint8_t* out, uint32_t seq, int input) {
+    uint8_t* p = put8(out + 2, NET_INPUT);
+    p = put32(p, seq);
+    p = put8(p, (uint32_t)input);
+    return finish(out, p);
+}
+
+size_t net_put_bye(uint8_t* out) {
+    return finish(out, put8(out + 2, NET_BYE));
+}
+
+size_t net_put_state(uint8_t* out, const GameState* s, uint32_t tick, uint32_t ack) {
+    int first = 0;
+    while (first < HEIGHT) {
+        int empty = 1;
+        for (int x = 0; x < WIDTH && empty; x++) empty = !s->board[first][x];
+        if (!empty) break;
+        first++;
+    }
+    uint8_t* p = put8(out + 2, NET_STATE);
+    p = put32(p, tick);
+    p = put32(p, ack);
+    p = put_hud(p, s);
+    p = put8(p, (uint32_t)first);
+    for (int y = first; y < HEIGHT; y++) p = put32(p, pack_row(s->board[y]));
+    return finish(out, p);
+}
+
+size_t net_put_delta(uint8_t* out, const GameState* prev, const GameState* s, uint32_t tick) {
+    uint8_t* p = put8(out + 2, NET_DELTA);
+    p = put32(p, tick);
+    p = put_hud(p, s);
+    uint8_t* count = p++;
+    int rows = 0;
+    for (int y = 0; y < HEIGHT; y++) {
+        uint32_t row = pack_row(s->board[y]);
+        if (row == pack_row(prev->board[y])) continue;
+        p = put8(p, (uint32_t)y);
+        p = put32(p, row);
+        rows++;
+    }
+    *count = (uint8_t)rows;
+    return finish(out, p);
+}
+
+size_t net_put_inputs(uint8_t* out, uint32_t first, uint32_t ack, const uint8_t* inputs, int count) {
+    if (count > NET_INPUTS_MAX) count = NET_INPUTS_MAX;
+    uint8_t* p = put8(out + 2, NET_INPUTS);
+    p = put32(p, first);
+    p = put32(p, ack);
+    p = put8(p, (uint32_t)count);
+    memcpy(p, inputs, (size_t)count);
+    return finish(out, p + count);
+}
+
+int net_frame(const uint8_t* buf, size_t n, int* type, const uint8_t** payload, size_t* payload_len) {
+    if (n < 2) return 0;
+    size_t len = get16(buf);
+    if (len < 1 || len + 2 > NET_MESSAGE_MAX) return -1;
+    if (n < len + 2) return 0;
+    *type = buf[2];
+    *payload = buf + 3;
+    *payload_len = len - 1;
+    return (int)(len + 2);
+}
+
+int net_get_hello(const uint8_t* p, size_t n, uint32_t* seed, int* level) {
+    if (n != 5) return 0;
+    *seed = get32(p);
+    *level = p[4];
+    return 1;
+}
+
+int net_get_input(const uint8_t* p, size_t n, uint32_t* seq, int* input) {
+    if (n != 5 || p[4] >= INPUT_COUNT) return 0;
+    *seq = get32(p);
+    *input = p[4];
+    return 1;
+}
+
+int net_get_inputs(const uint8_t* p, size_t n, uint32_t* first, uint32_t* ack, const uint8_t** inputs,
+                   int* count) {
+    if (n < 9 || p[8] > NET_INPUTS_MAX || n != 9 + (size_t)p[8]) return 0;
+    *first = get32(p);
+    *ack = get32(p + 4);
+    *count = p[8];
+    *inputs = p + 9;
+    return 1;
+}
+
+int net_get_state(const uint8_t* p, size_t n, GameState* s, uint32_t* tick, uint32_t* ack) {
+    if (n < NET_STATE_FIXED) return 0;
+    int first = p[NET_STATE_FIXED - 1];
+    if (first > HEIGHT || n != NET_STATE_FIXED + (size_t)(HEIGHT - first) * 4) return 0;
+    memset(s, 0, sizeof(*s));
+    *tick = get32(p);
+    *ack = get32(p + 4);
+    if (!get_hud(p + 8, s)) return 0;
+    const uint8_t* rows = p + NET_STATE_FIXED;
+    for (int y = first; y < HEIGHT; y++, rows += 4) unpack_row(s->board[y], get32(rows));
+    return 1;
+}
+
+int net_get_delta(const uint8_t* p, size_t n, GameState* s, uint32_t* tick) {
+    if (n < NET_DELTA_FIXED || n != NET_DELTA_FIXED + (size_t)p[NET_DELTA_FIXED - 1] * 5) return 0;
+    const uint8_t* rows = p + NET_DELTA_FIXED;
+    for (int k = 0; k < p[NET_DELTA_FIXED - 1]; k++)
+        if (rows[k * 5] >= HEIGHT) return 0;
+    GameState hud = *s;
+    if (!get_hud(p + 4, &hud)) return 0;
+    *tick = get32(p);
+    *s = hud;
+    for (int k = 0; k < p[NET_DELTA_FIXED - 1]; k++, rows += 5) unpack_row(s->board[rows[0]], get32(rows + 1));
+    return 1;
+}
+
+int net_set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+/* Resolves addr into a socket address; returns the family or -1 */
+static int parse_addr(const char* addr, struct sockaddr_storage* out, socklen_t* len) {
+    memset(out, 0, sizeof(*out));
+    if (!strncmp(addr, "unix:", 5)) {
+        struct sockaddr_un* un = (struct sockaddr_un*)out;
+        if (strlen(addr + 5) >= sizeof(un->sun_path)) return -1;
+        un->sun_family = AF_UNIX;
+        strcpy(un->sun_path, addr + 5);
+        *len = sizeof(*un);
+        return AF_UNIX;
+    }
+    if (!strncmp(addr, "tcp:", 4)) addr += 4;
+    const char* colon = strrchr(addr, ':');
+    if (!colon) return -1;
+    char host[256];
+    snprintf(host, sizeof(host), "%.*s", (int)(colon - addr), addr);
+    struct addrinfo hints, *res = NULL;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host[0] ? host : NULL, colon + 1, &hints, &res) != 0 || !res) return -1;
+    memcpy(out, res->ai_addr, res->ai_addrlen);
+    *len = res->ai_addrlen;
+    int family = res->ai_family;
+    freeaddrinfo(res);
+    return family;
+}
+
+int net_listen(const char* addr) {
+    struct sockaddr_storage sa;
+    socklen_t len;
+    int family = parse_addr(addr, &sa, &len);
+    if (family < 0) return -1;
+    int fd = socket(family, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    if (family == AF_UNIX) {
+        unlink(((struct sockaddr_un*)&sa)->sun_path);
+    } else {
+        int on = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    }
+    if (bind(fd, (struct sockaddr*)&sa, len) != 0 || listen(fd, SOMAXCONN) != 0 || !net_set_nonblocking(fd)) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/* Connects blocking, so a full accept backlog waits rather than fails */
+int net_connect(const char* addr) {
+    struct sockaddr_storage sa;
+    socklen_t len;
+    int family = parse_addr(addr, &sa, &len);
+    if (family < 0) return -1;
+    int fd = socket(family, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    int rc;
+    do rc = connect(fd, (struct sockaddr*)&sa, len);
+    while (rc != 0 && errno == EINTR);
+    if (rc != 0 || !net_set_nonblocking(fd)) {
+        close(fd);
+        return -1;
+    }
+    if (family != AF_UNIX) {
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    }
+    return fd;
+}
+
+int net_udp(const char* local, const char* peer) {
+    struct sockaddr_storage la, pa;
+    socklen_t llen, plen;
+    int family = parse_addr(local, &la, &llen);
+    if (family < 0 || family == AF_UNIX || parse_addr(peer, &pa, &plen) != family) return -1;
+    int fd = socket(family, SOCK_DGRAM, 0);
+    if (fd < 0) return -1;
+    if (bind(fd, (struct sockaddr*)&la, llen) != 0 || connect(fd, (struct sockaddr*)&pa, plen) != 0 ||
+        !net_set_nonblocking(fd)) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+long net_raise_fd_limit(void) {
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) != 0) return -1;
+    if (rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+        getrlimit(RLIMIT_NOFILE, &rl);
+    }
+    return (long)rl.rlim_cur;
+}
@@ -0,0 +1,84 @@
+#ifndef TETRIS_NET_H
+#define TETRIS_NET_H
+
+/* Wire protocol between the game server and its clients, plus socket
+   helpers. Every message is a frame: a little-endian uint16 length of
+   what follows, a type byte, then the payload.
+
+   Client to server:
+     NET_HELLO   u32 seed, u8 level              start or restart the game
+     NET_INPUT   u32 seq, u8 input               seq counts up per input
+     NET_BYE
+   Server to client:
+     NET_STATE   u32 tick, u32 ack, u8 piece, u8 rot, i8 x, i8 y,
+                 u8 next, u8 hold (0xff none), u8 flags, u8 level,
+                 u16 lines, i64 score, u8 first_row,
+                 then a u32 per row from first_row down, 3 bits per cell
+   Server to spectators:
+     NET_STATE   as above with ack 0, as a keyframe
+     NET_DELTA   u32 tick, then NET_STATE's fields from piece to score,
+                 u8 count, then count times u8 row, u32 cells: the rows
+                 that differ from the previous tick's message
+
+   Peer to peer, one frame per UDP datagram:
+     NET_INPUTS  u32 first, u32 ack, u8 count,
+                 then count input masks for frames first, first+1, ...
+   A peer resends every input the other side has not acked, so losing a
+   datagram costs nothing once a later one arrives; ack is the number of
+   frames the sender holds the receiver's inputs for.
+
+   ack is the seq of the last input the connection sent, applied or not,
+   so a client can time its inputs; rows above the stack are not sent. States are snapshots: a
+   newer one replaces any the client has not read yet. */
+
+#include <stddef.h>
+#include <stdint.h>
+#include "tetris_core.h"
+
+enum { NET_HELLO = 1, NET_INPUT, NET_BYE, NET_STATE, NET_INPUTS, NET_DELTA };
+
+#define NET_STATE_GAME_OVER 1
+#define NET_STATE_HOLD_USED 2
+
+#define NET_FRAME_HEADER 3
+#define NET_STATE_FIXED 27
+#define NET_STATE_MAX (NET_FRAME_HEADER + NET_STATE_FIXED + HEIGHT * 4)
+#define NET_DELTA_FIXED 23
+#define NET_DELTA_MAX (NET_FRAME_HEADER + NET_DELTA_FIXED + HEIGHT * 5)
+#define NET_INPUTS_MAX 64
+#define NET_MESSAGE_MAX NET_DELTA_MAX
+
+/* Encoders write one whole frame and return its size */
+size_t net_put_hello(uint8_t* out, uint32_t seed, int level);
+size_t net_put_input(uint8_t* out, uint32_t seq, int input);
+size_t net_put_bye(uint8_t* out);
+size_t net_put_state(uint8_t* out, const GameState* s, uint32_t tick, uint32_t ack);
+size_t net_put_delta(uint8_t* out, const GameState* prev, const GameState* s, uint32_t tick);
+size_t net_put_inputs(uint8_t* out, uint32_t first, uint32_t ack, const uint8_t* inputs, int count);
+
+/* Splits the next frame off buf. Returns its total size, 0 if more bytes
+   are needed, or -1 if the stream is corrupt. */
+int net_frame(const uint8_t* buf, size_t n, int* type, const uint8_t** payload, size_t* payload_len);
+
+/* Payload decoders; return 0 on a malformed payload. net_get_state fills
+   everything a client can draw; the rng is not sent. */
+int net_get_hello(const uint8_t* p, size_t n, uint32_t* seed, int* level);
+int net_get_input(const uint8_t* p, size_t n, uint32_t* seq, int* input);
+int net_get_state(const uint8_t* p, size_t n, GameState* s, uint32_t* tick, uint32_t* ack);
+/* Applies a delta to the state built from the messages before it */
+int net_get_delta(const uint8_t* p, size_t n, GameState* s, uint32_t* tick);
+/* inputs points into the payload */
+int net_get_inputs(const uint8_t* p, size_t n, uint32_t* first, uint32_t* ack, const uint8_t** inputs,
+                   int* count);
+
+/* Addresses are "unix:/path" or "[tcp:]host:port". Sockets come back
+   non-blocking, -1 on failure. POSIX only. */
+int net_listen(const char* addr);
+int net_connect(const char* addr);
+/* A UDP socket bound to local and connected to peer, both host:port */
+int net_udp(const char* local, const char* peer);
+int net_set_nonblocking(int fd);
+/* Raises the open file limit to the hard limit; returns the new limit */
+long net_raise_fd_limit(void);
+
+#endif /* TETRIS_NET_H */
@@ -0,0 +1,503 @@
+#include "tetris_pc.h"
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#define PC_MAX_SHAPES 40
+#define PC_TT_BITS 16
+
+struct PcDatabase {
+    void* base;
+    size_t size;
+    void* handle;
+    const PcDbHeader* header;
+    const uint64_t* bits;
+};
+
+/* Every distinct (rot, x) of each piece, pushed up against row 0 */
+typedef struct {
+    int n[7];
+    uint64_t bits[7][PC_MAX_SHAPES];
+    int rot[7][PC_MAX_SHAPES];
+    int x[7][PC_MAX_SHAPES];
+} PcShapes;
+
+static void build_shapes(PcShapes* sh) {
+    for (int piece = 0; piece < 7; piece++) {
+        sh->n[piece] = 0;
+        for (int rot = 0; rot < 4; rot++) {
+            uint16_t m = get_mask(piece, rot);
+            int top = 3;
+            for (int i = 0; i < 16; i++)
+                if (((m >> i) & 1u) && i / 4 < top) top = i / 4;
+            for (int px = -3; px < WIDTH; px++) {
+                uint64_t bits = 0;
+                int inside = 1;
+                for (int i = 0; i < 16; i++) {
+                    if (!((m >> i) & 1u)) continue;
+                    int x = i % 4 + px;
+                    if (x < 0 || x >= WIDTH) { inside = 0; break; }
+                    bits |= 1ull << ((i / 4 - top) * WIDTH + x);
+                }
+                if (!inside) continue;
+                int dup = 0;
+                for (int k = 0; k < sh->n[piece]; k++)
+                    if (sh->bits[piece][k] == bits) { dup = 1; break; }
+                if (dup) continue;
+                int k = sh->n[piece]++;
+                sh->bits[piece][k] = bits;
+                sh->rot[piece][k] = rot;
+                sh->x[piece][k] = px;
+            }
+        }
+    }
+}
+
+static int popcount64(uint64_t v) {
+    int n = 0;
+    while (v) { v &= v - 1; n++; }
+    return n;
+}
+
+/* ---- Pattern database ---- */
+
+/* A shape as column heights: for each column it covers, the lowest and
+   highest cell counted up from the bottom of the piece */
+typedef struct {
+    int cols;
+    int col[4], low[4], high[4];
+} PcProfileShape;
+
+typedef struct {
+    int height;
+    uint64_t pow[WIDTH + 1];
+    int n[7];
+    PcProfileShape shape[7][PC_MAX_SHAPES];
+    std::atomic<uint8_t>* memo;   /* 0 unknown, 1 dead, 2 fillable */
+} PcDbBuild;
+
+static void profile_shapes(PcDbBuild* b, const PcShapes* sh) {
+    for (int piece = 0; piece < 7; piece++) {
+        b->n[piece] = sh->n[piece];
+        for (int k = 0; k < sh->n[piece]; k++) {
+            PcProfileShape* ps = &b->shape[piece][k];
+            uint64_t bits = sh->bits[piece][k];
+            int rows = 0;
+            for (int y = 0; y < 4; y++)
+                if ((bits >> (y * WIDTH)) & ((1ull << WIDTH) - 1)) rows = y + 1;
+            ps->cols = 0;
+            for (int x = 0; x < WIDTH; x++) {
+                int low = -1, high = -1;
+                for (int y = 0; y < rows; y++) {
+                    if (!((bits >> (y * WIDTH + x)) & 1)) continue;
+                    int up = rows - 1 - y;
+                    if (low < 0 || up < low) low = up;
+                    if (up > high) high = up;
+                }
+                if (low < 0) continue;
+                ps->col[ps->cols] = x;
+                ps->low[ps->cols] = low;
+                ps->high[ps->cols] = high;
+                ps->cols++;
+            }
+        }
+    }
+}
+
+static int profile_fillable(PcDbBuild* b, uint64_t idx, const int* h) {
+    uint8_t known = b->memo[idx].load(std::memory_order_relaxed);
+    if (known) return known == 2;
+
+    int empty = 0;
+    for (int x = 0; x < WIDTH; x++) empty += b->height - h[x];
+    int ok = empty == 0;
+    for (int piece = 0; piece < 7 && !ok && empty % 4 == 0; piece++) {
+        for (int k = 0; k < b->n[piece] && !ok; k++) {
+            const PcProfileShape* ps = &b->shape[piece][k];
+            int base = h[ps->col[0]] - ps->low[0];
+            int flush = 1;
+            for (int c = 0; c < ps->cols && flush; c++)
+                flush = h[ps->col[c]] - ps->low[c] == base && base + ps->high[c] < b->height;
+            if (!flush) continue;
+            int next[WIDTH];
+            memcpy(next, h, sizeof(next));
+            uint64_t nidx = idx;
+            for (int c = 0; c < ps->cols; c++) {
+                int x = ps->col[c];
+                next[x] = base + ps->high[c] + 1;
+                nidx += (uint64_t)(next[x] - h[x]) * b->pow[x];
+            }
+            ok = profile_fillable(b, nidx, next);
+        }
+    }
+    b->memo[idx].store(ok ? 2 : 1, std::memory_order_relaxed);
+    return ok;
+}
+
+int pc_db_build(const char* path, int height, int threads) {
+    if (height < 1 || height > PC_MAX_HEIGHT || WIDTH * height > 64) return 0;
+    if (threads < 1) threads = 1;
+
+    PcShapes sh;
+    build_shapes(&sh);
+    PcDbBuild* b = new PcDbBuild;
+    b->height = height;
+    b->pow[0] = 1;
+    for (int x = 1; x <= WIDTH; x++) b->pow[x] = b->pow[x - 1] * (uint64_t)(height + 1);
+    profile_shapes(b, &sh);
+    uint64_t profiles = b->pow[WIDTH];
+    b->memo = new std::atomic<uint8_t>[profiles];
+    for (uint64_t i = 0; i < profiles; i++) b->memo[i].store(0, std::memory_order_relaxed);
+
+    /* Workers share the memo; two of them solving the same profile agree */
+    std::vector<std::thread> pool;
+    for (int t = 0; t < threads; t++) {
+        pool.emplace_back([b, profiles, t, threads]() {
+            int h[WIDTH];
+            for (uint64_t idx = (uint64_t)t; idx < profiles; idx += (uint64_t)threads) {
+                uint64_t v = idx;
+                for (int x = 0; x < WIDTH; x++) {
+                    h[x] = (int)(v % (uint64_t)(b->height + 1));
+                    v /= (uint64_t)(b->height + 1);
+                }
+                profile_fillable(b, idx, h);
+            }
+        });
+    }
+    for (size_t t = 0; t < pool.size(); t++) pool[t].join();
+
+    PcDbHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, "TETRISPC", 8);
+    hdr.version = 1;
+    hdr.width = WIDTH;
+    hdr.height = (uint32_t)height;
+    hdr.profiles = profiles;
+    hdr.bits_offset = 64;
+    hdr.file_size = hdr.bits_offset + (profiles + 63) / 64 * sizeof(uint64_t);
+
+    size_t size = (size_t)hdr.file_size;
+    void* handle = NULL;
+    char* base = (char*)tb_map_file(path, &size, 1, &handle);
+    if (!base) {
+        delete[] b->memo;
+        delete b;
+        return 0;
+    }
+    uint64_t* bits = (uint64_t*)(base + hdr.bits_offset);
+    memset(bits, 0, (size_t)(hdr.file_size - hdr.bits_offset));
+    for (uint64_t i = 0; i < profiles; i++) {
+        if (b->memo[i].load(std::memory_order_relaxed) == 2) {
+            bits[i >> 6] |= 1ull << (i & 63);
+            hdr.fillable++;
+        }
+    }
+    memcpy(base, &hdr, sizeof(hdr));
+    tb_unmap_file(base, size, handle);
+    delete[] b->memo;
+    delete b;
+    return 1;
+}
+
+PcDatabase* pc_db_open(const char* path) {
+    size_t size = 0;
+    void* handle = NULL;
+    void* base = tb_map_file(path, &size, 0, &handle);
+    if (!base) return NULL;
+    const PcDbHeader* h = (const PcDbHeader*)base;
+    if (size < sizeof(PcDbHeader) || memcmp(h->magic, "TETRISPC", 8) != 0 ||
+        h->version != 1 || h->file_size != size) {
+        tb_unmap_file(base, size, handle);
+        return NULL;
+    }
+    PcDatabase* db = (PcDatabase*)malloc(sizeof(PcDatabase));
+    if (!db) {
+        tb_unmap_file(base, size, handle);
+        return NULL;
+    }
+    db->base = base;
+    db->size = size;
+    db->handle = handle;
+    db->header = h;
+    db->bits = (const uint64_t*)((const char*)base + h->bits_offset);
+    return db;
+}
+
+void pc_db_close(PcDatabase* db) {
+    if (!db) return;
+    tb_unmap_file(db->base, db->size, db->handle);
+    free(db);
+}
+
+const PcDbHeader* pc_db_header(const PcDatabase* db) {
+    return db->header;
+}
+
+static uint64_t profile_index(uint64_t board, int height) {
+    uint64_t idx = 0, pow = 1;
+    for (int x = 0; x < WIDTH; x++) {
+        int h = 0;
+        for (int y = 0; y < height; y++) h += (int)((board >> (y * WIDTH + x)) & 1);
+        idx += (uint64_t)h * pow;
+        pow *= (uint64_t)(height + 1);
+    }
+    return idx;
+}
+
+int pc_db_fillable(const PcDatabase* db, uint64_t board) {
+    uint64_t idx = profile_index(board, (int)db->header->height);
+    return (int)((db->bits[idx >> 6] >> (idx & 63)) & 1);
+}
+
+/* ---- Solver ---- */
+
+/* Failed (board, queue position, hold) states; lossy but exact on hit */
+typedef struct {
+    uint64_t board;
+    int32_t qi;
+    int32_t hold;
+} PcTtEntry;
+
+typedef struct {
+    const PcProblem* p;
+    const PcShapes* shapes;
+    const PcDatabase* db;
+    uint64_t full, bottom_row;
+    uint64_t col_mask[WIDTH];
+    PcTtEntry* tt;
+    PcStep path[PC_MAX_PIECES + 1];
+    uint64_t nodes, db_prunes;
+    std::atomic<int>* best_task;
+    int task;
+    int stopped;
+} PcSearch;
+
+static uint64_t tt_index(uint64_t board, int qi, int hold) {
+    uint64_t k = board ^ ((uint64_t)(qi * 8 + hold + 1) * 0x9E3779B97F4A7C15ull);
+    k ^= k >> 29;
+    k *= 0xbf58476d1ce4e5b9ull;
+    k ^= k >> 32;
+    return k & ((1u << PC_TT_BITS) - 1);
+}
+
+/* Hard drop; 0 if the piece does not fit or would leave a hole under it */
+static uint64_t drop_flush(const PcSearch* s, uint64_t board, uint64_t bits) {
+    if ((bits & ~s->full) || (bits & board)) return 0;
+    while (!(bits & s->bottom_row) && !((bits << WIDTH) & board)) bits <<= WIDTH;
+    if ((bits << WIDTH) & s->full & ~(board | bits)) return 0;
+    return bits;
+}
+
+/* Cheap necessary conditions: enough pieces left, every region between
+   full columns a multiple of four cells, and the pattern database */
+static int can_finish(PcSearch* s, uint64_t board, int qi, int hold, int placed) {
+    const PcProblem* p = s->p;
+    int empty = popcount64(s->full & ~board);
+    if (empty > 4 * (p->max_pieces - placed)) return 0;
+    if (empty > 4 * (p->queue_len - qi + (hold >= 0))) return 0;
+
+    int segment = 0;
+    for (int x = 0; x < WIDTH; x++) {
+        int gap = p->height - popcount64(board & s->col_mask[x]);
+        if (gap == 0) {
+            if (segment % 4) return 0;
+            segment = 0;
+        }
+        segment += gap;
+    }
+    if (segment % 4) return 0;
+
+    if (s->db && !pc_db_fillable(s->db, board)) {
+        s->db_prunes++;
+        return 0;
+    }
+    return 1;
+}
+
+static int search(PcSearch* s, uint64_t board, int qi, int hold, int placed);
+
+static int try_piece(PcSearch* s, uint64_t board, int piece, int use_hold,
+                     int next_qi, int next_hold, int placed) {
+    const PcShapes* sh = s->shapes;
+    for (int k = 0; k < sh->n[piece]; k++) {
+        uint64_t bits = drop_flush(s, board, sh->bits[piece][k]);
+        if (!bits) continue;
+        PcStep* st = &s->path[placed];
+        st->piece = piece;
+        st->rot = sh->rot[piece][k];
+        st->x = sh->x[piece][k];
+        st->use_hold = use_hold;
+        if (search(s, board | bits, next_qi, next_hold, placed + 1)) return 1;
+        if (s->stopped) return 0;
+    }
+    return 0;
+}
+
+/* Depth-first search; returns 1 with s->path filled up to the clear */
+static int search(PcSearch* s, uint64_t board, int qi, int hold, int placed) {
+    const PcProblem* p = s->p;
+    if (board == s->full) {
+        s->path[placed].piece = -1;
+        return 1;
+    }
+    if ((++s->nodes & 1023) == 0 && s->best_task->load(std::memory_order_relaxed) < s->task) {
+        s->stopped = 1;
+        return 0;
+    }
+    if (qi >= p->queue_len || placed >= p->max_pieces) return 0;
+    PcTtEntry* e = &s->tt[tt_index(board, qi, hold)];
+    if (e->board == board && e->qi == qi && e->hold == hold) return 0;
+    if (!can_finish(s, board, qi, hold, placed)) return 0;
+
+    int cur = p->queue[qi];
+    int hold_ok = !(placed == 0 && p->hold_locked);
+    if (try_piece(s, board, cur, 0, qi + 1, hold, placed)) return 1;
+    if (!s->stopped && hold_ok) {
+        if (hold >= 0 && hold != cur) {
+            if (try_piece(s, board, hold, 1, qi + 1, cur, placed)) return 1;
+        } else if (hold < 0 && qi + 1 < p->queue_len) {
+            if (try_piece(s, board, p->queue[qi + 1], 1, qi + 2, cur, placed)) return 1;
+        }
+    }
+    if (!s->stopped) {
+        e->board = board;
+        e->qi = qi;
+        e->hold = hold;
+    }
+    return 0;
+}
+
+/* A first placement, searched as one unit of parallel work */
+typedef struct {
+    uint64_t board;
+    int qi, hold;
+    PcStep step;
+} PcTask;
+
+static int add_root_tasks(PcSearch* s, std::vector<PcTask>* tasks, int piece, int use_hold,
+                          int qi, int hold) {
+    const PcShapes* sh = s->shapes;
+    for (int k = 0; k < sh->n[piece]; k++) {
+        uint64_t bits = drop_flush(s, s->p->board, sh->bits[piece][k]);
+        if (!bits) continue;
+        PcTask t;
+        t.board = s->p->board | bits;
+        t.qi = qi;
+        t.hold = hold;
+        t.step.piece = piece;
+        t.step.rot = sh->rot[piece][k];
+        t.step.x = sh->x[piece][k];
+        t.step.use_hold = use_hold;
+        tasks->push_back(t);
+    }
+    return (int)tasks->size();
+}
+
+static int hole_free(const PcSearch* s, uint64_t board) {
+    return !((board << WIDTH) & s->full & ~board);
+}
+
+int pc_solve(const PcProblem* p, const PcDatabase* db, PcResult* result) {
+    auto t0 = std::chrono::steady_clock::now();
+    memset(result, 0, sizeof(*result));
+    if (p->height < 1 || p->height > PC_MAX_HEIGHT || WIDTH * p->height > 64) return -1;
+    if (p->queue_len < 1 || p->queue_len > PC_MAX_PIECES) return -1;
+
+    static PcShapes shapes;
+    static std::once_flag shapes_once;
+    std::call_once(shapes_once, [] { build_shapes(&shapes); });
+
+    std::atomic<int> best_task(0x7fffffff);
+    PcSearch base;
+    memset(&base, 0, sizeof(base));
+    base.p = p;
+    base.shapes = &shapes;
+    if (db && db->header->width == WIDTH && (int)db->header->height == p->height) base.db = db;
+    base.full = WIDTH * p->height == 64 ? ~0ull : (1ull << (WIDTH * p->height)) - 1;
+    base.bottom_row = ((1ull << WIDTH) - 1) << ((p->height - 1) * WIDTH);
+    for (int x = 0; x < WIDTH; x++)
+        for (int y = 0; y < p->height; y++) base.col_mask[x] |= 1ull << (y * WIDTH + x);
+    base.best_task = &best_task;
+    if ((p->board & ~base.full) || !hole_free(&base, p->board)) return -1;
+
+    if (p->board == base.full) {
+        result->found = 1;
+    } else if (popcount64(base.full & ~p->board) % 4 == 0 && p->max_pieces > 0 &&
+               can_finish(&base, p->board, 0, p->hold, 0)) {
+        std::vector<PcTask> tasks;
+        int cur = p->queue[0];
+        add_root_tasks(&base, &tasks, cur, 0, 1, p->hold);
+        if (!p->hold_locked) {
+            if (p->hold >= 0 && p->hold != cur)
+                add_root_tasks(&base, &tasks, p->hold, 1, 1, cur);
+            else if (p->hold < 0 && p->queue_len > 1)
+                add_root_tasks(&base, &tasks, p->queue[1], 1, 2, cur);
+        }
+
+        std::atomic<int> next_task(0);
+        std::atomic<uint64_t> nodes(0), db_prunes(0);
+        std::mutex result_mutex;
+        int threads = p->threads < 1 ? 1 : p->threads;
+        if (threads > (int)tasks.size()) threads = (int)tasks.size();
+
+        /* Lowest-numbered solving task wins, so the answer does not depend
+           on the thread count; tasks after a known solution stop early */
+        auto worker = [&]() {
+            PcSearch s = base;
+            std::vector<PcTtEntry> tt((size_t)1 << PC_TT_BITS);
+            for (size_t i = 0; i < tt.size(); i++) tt[i].qi = -1;
+            s.tt = tt.data();
+            for (;;) {
+                int t = next_task.fetch_add(1);
+                if (t >= (int)tasks.size() || t > best_task.load()) break;
+                s.task = t;
+                s.stopped = 0;
+                s.path[0] = tasks[t].step;
+                if (!search(&s, tasks[t].board, tasks[t].qi, tasks[t].hold, 1)) continue;
+                std::lock_guard<std::mutex> lock(result_mutex);
+                if (t < best_task.load()) {
+                    best_task.store(t);
+                    int n = 0;
+                    while (n < p->max_pieces && s.path[n].piece >= 0) n++;
+                    result->found = 1;
+                    result->steps = n;
+                    memcpy(result->step, s.path, n * sizeof(PcStep));
+                }
+            }
+            nodes.fetch_add(s.nodes);
+            db_prunes.fetch_add(s.db_prunes);
+        };
+        std::vector<std::thread> pool;
+        for (int t = 1; t < threads; t++) pool.emplace_back(worker);
+        if (threads > 0) worker();
+        for (size_t t = 0; t < pool.size(); t++) pool[t].join();
+        result->nodes = nodes.load();
+        result->db_prunes = db_prunes.load();
+    }
+    result->ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    return result->found;
+}
+
+int pc_problem_from_state(PcProblem* p, const GameState* s, int height, int max_pieces) {
+    if (height < 1 || height > PC_MAX_HEIGHT || WIDTH * height > 64) return 0;
+    for (int y = 0; y < HEIGHT - height; y++)
+        for (int x = 0; x < WIDTH; x++)
+            if (s->board[y][x]) return 0;
+    memset(p, 0, sizeof(*p));
+    p->height = height;
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < WIDTH; x++)
+            if (s->board[HEIGHT - height + y][x]) p->board |= 1ull << (y * WIDTH + x);
+    p->queue[0] = s->cur_piece;
+    p->queue_len = 1;
+    if (s->next_piece >= 0) p->queue[p->queue_len++] = s->next_piece;
+    p->hold = s->hold_piece;
+    p->hold_locked = s->hold_used;
+    p->max_pieces = max_pieces > PC_MAX_PIECES ? PC_MAX_PIECES : max_pieces;
+    p->threads = (int)std::thread::hardware_concurrency();
+    return 1;
+}
@@ -0,0 +1,72 @@
+#ifndef TETRIS_PC_H
+#define TETRIS_PC_H
+
+#include "tetris_tablebase.h"
+
+/* Perfect-clear solver. Works on the bottom `height` rows of the board as
+   a bitboard in the tablebase layout (bit y * WIDTH + x, row 0 at the top
+   of the region), so WIDTH * height must fit in 64 bits.
+
+   Only hole-free placements are searched: every piece is hard dropped and
+   must rest flush on the stack. On such boards a cleared row changes no
+   later drop, so full rows are simply left in place and the board is
+   perfectly cleared once the region is full. */
+
+#define PC_MAX_PIECES 16
+#define PC_MAX_HEIGHT 6
+
+typedef struct {
+    int piece;
+    int rot, x;     /* rotate, shift, then hard drop */
+    int use_hold;   /* piece came out of (or went through) hold */
+} PcStep;
+
+typedef struct {
+    int height;             /* rows to clear, 1..PC_MAX_HEIGHT */
+    uint64_t board;         /* filled cells of the region */
+    int queue[PC_MAX_PIECES];
+    int queue_len;          /* current piece first, then the preview */
+    int hold;               /* -1 when empty */
+    int hold_locked;        /* hold already used for the current piece */
+    int max_pieces;         /* placements allowed */
+    int threads;
+} PcProblem;
+
+typedef struct {
+    int found;
+    int steps;
+    PcStep step[PC_MAX_PIECES];
+    uint64_t nodes;
+    uint64_t db_prunes;
+    double ms;
+} PcResult;
+
+/* Header of a pattern file; a bitset over column-height profiles follows
+   at bits_offset. Profile index = sum of h[x] * (height + 1)^x, and a set
+   bit means some piece sequence fills the profile with no holes. */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t width, height;
+    uint32_t reserved;
+    uint64_t profiles;
+    uint64_t fillable;
+    uint64_t bits_offset;
+    uint64_t file_size;
+} PcDbHeader;
+
+typedef struct PcDatabase PcDatabase;
+
+/* Pattern database */
+int pc_db_build(const char* path, int height, int threads);
+PcDatabase* pc_db_open(const char* path);
+void pc_db_close(PcDatabase* db);
+const PcDbHeader* pc_db_header(const PcDatabase* db);
+int pc_db_fillable(const PcDatabase* db, uint64_t board);
+
+/* Solver; returns -1 if the problem is outside the model (holes, bad
+   height), otherwise result->found */
+int pc_problem_from_state(PcProblem* p, const GameState* s, int height, int max_pieces);
+int pc_solve(const PcProblem* p, const PcDatabase* db, PcResult* result);
+
+#endif /* TETRIS_PC_H */
@@ -0,0 +1,172 @@
+// Perfect-clear solver check - solves queues whose answer is known, with
+// and without a freshly built pattern database, and plays every solution
+// back through the game rules until the board is empty
+// Build: g++ -O2 -std=c++17 -pthread tetris_pc_check.cpp tetris_pc.cpp tetris_tablebase.cpp tetris_core.cpp -o tetris_pc_check
+//        cl /O2 /std:c++17 /EHsc tetris_pc_check.cpp tetris_pc.cpp tetris_tablebase.cpp tetris_core.cpp
+// Usage: tetris_pc_check                        (exit status 1 on any failure)
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include "tetris_pc.h"
+
+typedef struct {
+    const char* queue;
+    const char* board;      /* region rows top to bottom, NULL when empty */
+    int height;
+    char hold;              /* 0 when empty */
+    int hold_locked;
+    int found;
+    const char* why;
+} PcCase;
+
+static const PcCase cases[] = {
+    { "OOOOO", NULL, 2, 0, 0, 1, "five O pieces tile two rows" },
+    { "OOOOOOOOOO", NULL, 4, 0, 0, 1, "ten O pieces tile four rows" },
+    { "IIIIIIIIII", NULL, 4, 0, 0, 1, "ten upright I pieces fill four rows" },
+    { "O", "########..,########..", 2, 0, 0, 1, "one O fills the gap" },
+    { "SOOOOO", NULL, 2, 0, 0, 1, "S goes into the empty hold" },
+    { "SOOOO", NULL, 2, 'O', 0, 1, "S swaps with the held O" },
+    { "TIOLJSZTIOLJS", NULL, 4, 0, 0, 1, "a two-bag opener" },
+    { "IOTSZJLIOTSZJ", NULL, 4, 0, 0, 1, "a two-bag opener" },
+    { "IIIII", NULL, 2, 0, 0, 0, "flat I pieces cannot fill a row of ten" },
+    { "SSSSS", NULL, 2, 0, 0, 0, "every S leaves a hole on two rows" },
+    { "SOOOOO", NULL, 2, 0, 1, 0, "S cannot be held a second time" },
+    { "IOTSZJLIOT", NULL, 4, 0, 0, 0, "ten pieces of one and a half bags" },
+};
+
+static const char piece_letters[] = "IOTSZJL";
+static int failures = 0;
+
+static void check(int ok, const char* what) {
+    if (!ok) {
+        printf("FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+static int piece_from_letter(char c) {
+    const char* p = strchr(piece_letters, c);
+    return c && p ? (int)(p - piece_letters) : -1;
+}
+
+static void make_problem(const PcCase* c, PcProblem* p) {
+    memset(p, 0, sizeof(*p));
+    p->height = c->height;
+    for (const char* q = c->queue; *q; q++) p->queue[p->queue_len++] = piece_from_letter(*q);
+    for (int i = 0; c->board && c->board[i]; i++) {
+        int y = i / (WIDTH + 1), x = i % (WIDTH + 1);
+        if (x < WIDTH && c->board[i] != '.') p->board |= 1ull << (y * WIDTH + x);
+    }
+    p->hold = c->hold ? piece_from_letter(c->hold) : -1;
+    p->hold_locked = c->hold_locked;
+    int empty = WIDTH * p->height;
+    for (uint64_t b = p->board; b; b &= b - 1) empty--;
+    p->max_pieces = empty / 4;
+    p->threads = (int)std::thread::hardware_concurrency();
+}
+
+static int queue_at(const PcProblem* p, int i) {
+    return i < p->queue_len ? p->queue[i] : -1;
+}
+
+/* Plays the solution from the problem's position with the game's own hold,
+   drop and line clears: every step must be the piece the queue and hold
+   give at that point, fit where the solver put it, and the board must end
+   empty with exactly the region's rows cleared */
+static int replay(const PcProblem* p, const PcResult* r) {
+    GameState s;
+    state_init(&s, 1);
+    memset(s.board, 0, sizeof(s.board));
+    for (int y = 0; y < p->height; y++)
+        for (int x = 0; x < WIDTH; x++)
+            if (p->board >> (y * WIDTH + x) & 1) s.board[HEIGHT - p->height + y][x] = 1;
+    int qi = 0;
+    s.next_piece = queue_at(p, 1);
+    state_set_piece(&s, p->queue[0]);
+    s.hold_piece = p->hold;
+    s.hold_used = p->hold_locked;
+
+    if (r->steps > p->max_pieces) return 0;
+    for (int i = 0; i < r->steps; i++) {
+        const PcStep* st = &r->step[i];
+        if (st->use_hold) {
+            int was_empty = s.hold_piece < 0;
+            if (!state_hold(&s)) return 0;
+            if (was_empty) {
+                qi++;
+                s.next_piece = queue_at(p, qi + 1);
+            }
+        }
+        if (qi >= p->queue_len || s.cur_piece != st->piece) return 0;
+        s.cur_rot = st->rot;
+        s.cur_x = st->x;
+        s.cur_y = 0;
+        if (!board_fits(s.board, s.cur_piece, s.cur_x, s.cur_y, s.cur_rot)) return 0;
+        state_hard_drop(&s);
+        qi++;
+        s.next_piece = queue_at(p, qi + 1);
+        if (s.game_over) return 0;
+    }
+    for (int y = 0; y < HEIGHT; y++)
+        for (int x = 0; x < WIDTH; x++)
+            if (s.board[y][x]) return 0;
+    return s.lines_total == p->height;
+}
+
+static void check_case(const PcCase* c, const PcDatabase* db, uint64_t* db_prunes) {
+    PcProblem p;
+    make_problem(c, &p);
+    PcResult r;
+    int found = pc_solve(&p, db, &r);
+    char what[160];
+    snprintf(what, sizeof(what), "%s on %d rows%s: %s", c->queue, c->height, db ? " with database" : "", c->why);
+    check(found == c->found, what);
+    if (found == 1) {
+        snprintf(what, sizeof(what), "%s on %d rows%s: the solution replays to an empty board", c->queue,
+                 c->height, db ? " with database" : "");
+        check(replay(&p, &r), what);
+    }
+    if (db_prunes) *db_prunes += r.db_prunes;
+    printf("%-14s %d rows%s: %s, %d steps, %llu nodes, %.3f ms\n", c->queue, c->height, db ? " +db" : "    ",
+           found == 1 ? "clear" : found == 0 ? "none " : "error", r.steps, (unsigned long long)r.nodes, r.ms);
+}
+
+/* Builds the pattern database for a height, checks a few profiles and runs
+   that height's cases through it */
+static void check_database(int height) {
+    char path[64];
+    snprintf(path, sizeof(path), "tetris_pc_check_%d.bin", height);
+    char what[128];
+    snprintf(what, sizeof(what), "pattern database for %d rows builds", height);
+    check(pc_db_build(path, height, (int)std::thread::hardware_concurrency()), what);
+    PcDatabase* db = pc_db_open(path);
+    snprintf(what, sizeof(what), "pattern database for %d rows opens", height);
+    check(db != NULL, what);
+    if (!db) return;
+    const PcDbHeader* h = pc_db_header(db);
+    check(h->width == WIDTH && (int)h->height == height && h->fillable > 0 && h->fillable < h->profiles,
+          "database header matches the build");
+    check(pc_db_fillable(db, 0), "the empty region is fillable");
+    check(!pc_db_fillable(db, 1ull << ((height - 1) * WIDTH)), "a region missing one cell of four is not");
+
+    uint64_t db_prunes = 0;
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+        if (cases[i].height == height) check_case(&cases[i], db, &db_prunes);
+    if (height == 4) check(db_prunes > 0, "the database prunes the unsolvable four-row queue");
+    pc_db_close(db);
+    remove(path);
+}
+
+int main(int argc, char** argv) {
+    (void)argv;
+    if (argc > 1) {
+        printf("Usage: tetris_pc_check\n");
+        return 0;
+    }
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) check_case(&cases[i], NULL, NULL);
+    check_database(2);
+    check_database(4);
+    printf("%s\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,151 @@
+// Perfect-clear solver - finds placements that empty the bottom rows
+// within a piece budget, or proves there are none
+// Build: g++ -O2 -std=c++17 -pthread tetris_pc_solve.cpp tetris_pc.cpp tetris_tablebase.cpp tetris_core.cpp -o tetris_pc_solve
+//        cl /O2 /std:c++17 /EHsc tetris_pc_solve.cpp tetris_pc.cpp tetris_tablebase.cpp tetris_core.cpp
+// Usage: tetris_pc_solve --build-db pc_4.bin --height 4
+//        tetris_pc_solve --queue IOTSZJLIOT --db pc_4.bin
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <thread>
+#include "tetris_pc.h"
+
+static const char piece_letters[] = "IOTSZJL";
+
+static int piece_from_letter(char c) {
+    const char* p = strchr(piece_letters, c);
+    return c && p ? (int)(p - piece_letters) : -1;
+}
+
+/* Rows from the top of the region down, '.' empty, anything else filled */
+static int parse_board(const char* text, int height, uint64_t* board) {
+    *board = 0;
+    int y = 0, x = 0;
+    for (const char* c = text; ; c++) {
+        if (*c == ',' || *c == '/' || *c == 0) {
+            if (x != WIDTH) return 0;
+            y++;
+            x = 0;
+            if (!*c) break;
+            continue;
+        }
+        if (y >= height || x >= WIDTH) return 0;
+        if (*c != '.') *board |= 1ull << (y * WIDTH + x);
+        x++;
+    }
+    return y == height;
+}
+
+static void usage(void) {
+    printf("Usage: tetris_pc_solve [options]\n"
+           "  --queue PIECES   current piece then preview, letters of IOTSZJL\n"
+           "  --hold P         held piece (default none)\n"
+           "  --hold-used      hold already used for the current piece\n"
+           "  --board ROWS     region rows top to bottom, e.g. ..........,##....####\n"
+           "  --height N       rows to clear, 1..%d (default 4)\n"
+           "  --pieces N       placement budget (default: enough for the region)\n"
+           "  --threads N      worker threads (default: all cores)\n"
+           "  --db FILE        pattern database to prune with\n"
+           "  --build-db FILE  write the pattern database for --height and exit\n",
+           PC_MAX_HEIGHT);
+}
+
+int main(int argc, char** argv) {
+    PcProblem p;
+    memset(&p, 0, sizeof(p));
+    p.height = 4;
+    p.hold = -1;
+    p.max_pieces = 0;
+    p.threads = (int)std::thread::hardware_concurrency();
+    const char* queue = NULL;
+    const char* board = NULL;
+    const char* db_path = NULL;
+    const char* build_path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        const char* v = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!strcmp(a, "--help")) { usage(); return 0; }
+        if (!strcmp(a, "--hold-used")) { p.hold_locked = 1; continue; }
+        if (!v) { usage(); return 1; }
+        if (!strcmp(a, "--queue")) queue = v;
+        else if (!strcmp(a, "--hold")) p.hold = piece_from_letter(v[0]);
+        else if (!strcmp(a, "--board")) board = v;
+        else if (!strcmp(a, "--height")) p.height = atoi(v);
+        else if (!strcmp(a, "--pieces")) p.max_pieces = atoi(v);
+        else if (!strcmp(a, "--threads")) p.threads = atoi(v);
+        else if (!strcmp(a, "--db")) db_path = v;
+        else if (!strcmp(a, "--build-db")) build_path = v;
+        else { usage(); return 1; }
+        i++;
+    }
+    if (p.height < 1 || p.height > PC_MAX_HEIGHT || WIDTH * p.height > 64) {
+        fprintf(stderr, "height must be 1..%d\n", PC_MAX_HEIGHT);
+        return 1;
+    }
+
+    if (build_path) {
+        auto t0 = std::chrono::steady_clock::now();
+        if (!pc_db_build(build_path, p.height, p.threads)) {
+            fprintf(stderr, "cannot write %s\n", build_path);
+            return 1;
+        }
+        double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        PcDatabase* db = pc_db_open(build_path);
+        if (!db) {
+            fprintf(stderr, "cannot read back %s\n", build_path);
+            return 1;
+        }
+        const PcDbHeader* h = pc_db_header(db);
+        printf("%llu of %llu profiles fillable, %llu bytes, %.2fs\n",
+               (unsigned long long)h->fillable, (unsigned long long)h->profiles,
+               (unsigned long long)h->file_size, s);
+        pc_db_close(db);
+        return 0;
+    }
+
+    if (!queue) { usage(); return 1; }
+    for (const char* c = queue; *c && p.queue_len < PC_MAX_PIECES; c++) {
+        int piece = piece_from_letter(*c);
+        if (piece < 0) {
+            fprintf(stderr, "unknown piece '%c'\n", *c);
+            return 1;
+        }
+        p.queue[p.queue_len++] = piece;
+    }
+    if (board && !parse_board(board, p.height, &p.board)) {
+        fprintf(stderr, "board needs %d rows of %d cells\n", p.height, WIDTH);
+        return 1;
+    }
+    if (p.max_pieces <= 0) {
+        int empty = WIDTH * p.height;
+        for (uint64_t b = p.board; b; b &= b - 1) empty--;
+        p.max_pieces = empty / 4;
+    }
+    if (p.max_pieces > PC_MAX_PIECES) p.max_pieces = PC_MAX_PIECES;
+
+    PcDatabase* db = NULL;
+    if (db_path && !(db = pc_db_open(db_path))) {
+        fprintf(stderr, "cannot open %s\n", db_path);
+        return 1;
+    }
+
+    PcResult r;
+    int found = pc_solve(&p, db, &r);
+    pc_db_close(db);
+    if (found < 0) {
+        fprintf(stderr, "board has holes or does not fit the region\n");
+        return 1;
+    }
+    printf("%s in %.3f ms, %llu nodes, %llu pruned by database\n",
+           found ? "perfect clear" : "no perfect clear", r.ms,
+           (unsigned long long)r.nodes, (unsigned long long)r.db_prunes);
+
+    for (int i = 0; i < r.steps; i++) {
+        const PcStep* st = &r.step[i];
+        printf("%2d. %c rot %d x %d%s\n", i + 1, piece_letters[st->piece], st->rot, st->x,
+               st->use_hold ? " (hold)" : "");
+    }
+    return found ? 0 : 2;
+}
@@ -0,0 +1,432 @@
+#include "tetris_render.h"
+#include "tetris_trace.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+const RenderRgba render_palette[RCOL_COUNT] = {
+    { 0.0f, 0.0f, 0.0f, 0.0f },      /* none */
+    { 0.2f, 0.8f, 0.9f, 1.0f },      /* I */
+    { 1.0f, 0.85f, 0.2f, 1.0f },     /* O */
+    { 0.8f, 0.3f, 0.9f, 1.0f },      /* T */
+    { 0.3f, 0.9f, 0.5f, 1.0f },      /* S */
+    { 1.0f, 0.3f, 0.3f, 1.0f },      /* Z */
+    { 0.3f, 0.6f, 1.0f, 1.0f },      /* J */
+    { 1.0f, 0.6f, 0.2f, 1.0f },      /* L */
+    { 0.7f, 0.7f, 0.7f, 1.0f },      /* border */
+    { 0.12f, 0.12f, 0.12f, 1.0f },   /* bg */
+    { 0.85f, 0.85f, 0.85f, 1.0f },   /* label */
+    { 0.5f, 0.85f, 0.6f, 1.0f },     /* label score */
+    { 0.5f, 0.8f, 1.0f, 1.0f },      /* label level */
+    { 0.7f, 0.6f, 1.0f, 1.0f },      /* label lines */
+    { 0.8f, 0.9f, 1.0f, 1.0f },      /* value */
+    { 1.0f, 1.0f, 1.0f, 0.55f },     /* hint */
+    { 1.0f, 1.0f, 1.0f, 0.3f },      /* cell highlight */
+    { 0.0f, 0.0f, 0.0f, 0.4f },      /* cell shadow */
+    { 0.2f, 0.2f, 0.2f, 0.6f },      /* cell border */
+    { 0.02f, 0.08f, 0.12f, 1.0f },   /* titlebar */
+    { 0.2f, 0.8f, 0.9f, 0.8f },      /* titlebar accent */
+    { 0.15f, 0.15f, 0.2f, 1.0f },    /* close button */
+    { 0.8f, 0.3f, 0.3f, 0.7f },      /* close button border */
+    { 0.0f, 0.0f, 0.0f, 0.2f },      /* board inner shadow */
+    { 1.0f, 1.0f, 1.0f, 0.08f },     /* board highlight */
+    { 1.0f, 1.0f, 1.0f, 0.12f },     /* panel top highlight */
+    { 1.0f, 1.0f, 1.0f, 0.10f },     /* panel left highlight */
+    { 0.0f, 0.0f, 0.0f, 0.3f },      /* panel bottom shadow */
+    { 0.0f, 0.0f, 0.0f, 0.25f },     /* panel right shadow */
+    { 0.35f, 0.35f, 0.35f, 1.0f },   /* panel border */
+    { 0.16f, 0.17f, 0.20f, 1.0f },   /* spectator board */
+    { 0.30f, 0.12f, 0.12f, 1.0f },   /* spectator board, game over */
+    { 0.0f, 0.0f, 0.0f, 0.0f },      /* dynamic */
+};
+
+static RenderRect rect(float l, float t, float r, float b) {
+    RenderRect x = { l, t, r, b };
+    return x;
+}
+
+static RenderRgba rgba(float r, float g, float b, float a) {
+    RenderRgba c = { r, g, b, a };
+    return c;
+}
+
+static RenderCmd* push(RenderList* list, int op, int color) {
+    if (list->count >= RENDER_MAX_CMDS) {
+        list->overflow++;
+        return NULL;
+    }
+    RenderCmd* c = &list->cmd[list->count++];
+    memset(c, 0, sizeof(*c));
+    c->op = (uint8_t)op;
+    c->color = (uint8_t)color;
+    c->width = 1.0f;
+    return c;
+}
+
+void render_list_reset(RenderList* list) {
+    list->count = 0;
+    list->text_used = 0;
+    list->overflow = 0;
+}
+
+void render_fill(RenderList* list, RenderRect r, int color) {
+    RenderCmd* c = push(list, RCMD_FILL_RECT, color);
+    if (c) c->rect = r;
+}
+
+void render_stroke(RenderList* list, RenderRect r, int color, float width) {
+    RenderCmd* c = push(list, RCMD_STROKE_RECT, color);
+    if (!c) return;
+    c->rect = r;
+    c->width = width;
+}
+
+void render_line(RenderList* list, float x0, float y0, float x1, float y1, int color, float width) {
+    RenderCmd* c = push(list, RCMD_LINE, color);
+    if (!c) return;
+    c->rect = rect(x0, y0, x1, y1);
+    c->width = width;
+}
+
+void render_fill_rgba(RenderList* list, RenderRect r, RenderRgba color) {
+    RenderCmd* c = push(list, RCMD_FILL_RECT, RCOL_DYNAMIC);
+    if (!c) return;
+    c->rect = r;
+    c->rgba = color;
+}
+
+void render_gradient(RenderList* list, RenderRect r, RenderRgba top, RenderRgba bottom) {
+    RenderCmd* c = push(list, RCMD_GRADIENT, RCOL_DYNAMIC);
+    if (!c) return;
+    c->rect = r;
+    c->rgba = top;
+    c->rgba2 = bottom;
+}
+
+void render_text(RenderList* list, RenderRect r, int font, int color, const char* text) {
+    int len = (int)strlen(text);
+    if (list->text_used + len > RENDER_TEXT_BYTES) {
+        list->overflow++;
+        return;
+    }
+    RenderCmd* c = push(list, RCMD_TEXT, color);
+    if (!c) return;
+    c->rect = r;
+    c->style = (uint8_t)font;
+    c->text_offset = (uint16_t)list->text_used;
+    c->text_len = (uint16_t)len;
+    memcpy(list->text + list->text_used, text, len);
+    list->text_used += len;
+}
+
+void render_bitmap(RenderList* list, RenderRect r, int bitmap) {
+    RenderCmd* c = push(list, RCMD_BITMAP, RCOL_NONE);
+    if (!c) return;
+    c->rect = r;
+    c->style = (uint8_t)bitmap;
+}
+
+/* Beveled cell: fill, highlight on the top and left, shadow on the bottom
+   and right, thin border */
+static void build_cell(RenderList* list, const RenderScene* s, int bx, int by, int color) {
+    float cs = (float)s->cell_size;
+    float x = (float)(s->board_left + bx * (s->cell_size + s->cell_gap));
+    float y = (float)(s->board_top + by * (s->cell_size + s->cell_gap));
+    RenderRect r = rect(x, y, x + cs, y + cs);
+
+    render_fill(list, r, color);
+    render_fill(list, rect(x + 1, y + 1, x + cs - 1, y + 5), RCOL_CELL_HIGHLIGHT);
+    render_fill(list, rect(x + 1, y + 1, x + 5, y + cs - 1), RCOL_CELL_HIGHLIGHT);
+    render_fill(list, rect(x + 1, y + cs - 5, x + cs - 1, y + cs - 1), RCOL_CELL_SHADOW);
+    render_fill(list, rect(x + cs - 5, y + 1, x + cs - 1, y + cs - 1), RCOL_CELL_SHADOW);
+    render_stroke(list, r, RCOL_CELL_BORDER, 0.8f);
+}
+
+static void build_preview(RenderList* list, const RenderScene* s, float ox, float oy, int piece) {
+    float small = s->cell_size / 1.5f;
+    uint16_t m = get_mask(piece, 0);
+    for (int b = 0; b < 16; b++) {
+        if (!((m >> b) & 1u)) continue;
+        float px = ox + (b % 4) * (small + 2.0f);
+        float py = oy + (b / 4) * (small + 2.0f);
+        RenderRect r = rect(px, py, px + small, py + small);
+        render_fill(list, r, pieces[piece].color);
+        render_stroke(list, r, RCOL_BORDER, 1.0f);
+    }
+}
+
+static void build_title(const RenderScene* s, RenderList* list) {
+    float ww = (float)s->window_width;
+
+    /* Title bar with a cyan accent line and the close button */
+    render_fill(list, rect(0, 0, ww, 50), RCOL_TITLEBAR);
+    render_fill(list, rect(0, 48, ww, 50), RCOL_TITLEBAR_ACCENT);
+    float close_right = ww - 15;
+    float close_left = close_right - 25;
+    RenderRect close_btn = rect(close_left, 10, close_right, 35);
+    render_fill(list, close_btn, RCOL_CLOSE_BG);
+    render_stroke(list, close_btn, RCOL_CLOSE_BORDER, 1.5f);
+    render_line(list, close_left + 5, 15, close_right - 5, 30, RCOL_CLOSE_BORDER, 2.0f);
+    render_line(list, close_right - 5, 15, close_left + 5, 30, RCOL_CLOSE_BORDER, 2.0f);
+
+    /* Logo, or text if the image did not load */
+    if (s->logo_width > 0.0f && s->logo_height > 0.0f) {
+        float logo_height = 35.0f;
+        float logo_width = (logo_height / s->logo_height) * s->logo_width;
+        render_bitmap(list, rect(10.0f, 7.0f, 10.0f + logo_width, 7.0f + logo_height), RBMP_LOGO);
+    } else {
+        render_text(list, rect(10.0f, 12.0f, 150.0f, 40.0f), RFONT_HUD, RCOL_LABEL, "TETRIS");
+    }
+}
+
+static RenderRect board_frame_rect(const RenderScene* s) {
+    int board_width = WIDTH * (s->cell_size + s->cell_gap) + s->cell_gap;
+    int board_height = HEIGHT * (s->cell_size + s->cell_gap) + s->cell_gap;
+    return rect((float)s->board_left - 4, (float)s->board_top - 4,
+                (float)(s->board_left + board_width + 4),
+                (float)(s->board_top + board_height + 4));
+}
+
+/* Bevel drawn over the gradient */
+static void build_board_frame(const RenderScene* s, RenderList* list) {
+    RenderRect bg = board_frame_rect(s);
+    render_fill(list, rect(bg.left, bg.top, bg.right, bg.top + 8.0f), RCOL_BOARD_SHADE);
+    render_line(list, bg.left, bg.top + 1, bg.right, bg.top + 1, RCOL_BOARD_HIGHLIGHT, 1.5f);
+    render_line(list, bg.left, bg.bottom - 1, bg.right, bg.bottom - 1, RCOL_CELL_SHADOW, 1.5f);
+}
+
+/* Bevel and labels drawn over the pulsing panel background */
+static void build_panel_frame(const RenderScene* s, RenderList* list) {
+    float sx = (float)s->side_left;
+    float sy = (float)s->board_top;
+    float hy = sy + 110;
+    render_fill(list, rect(sx - 10, sy - 4, sx + 170, sy + 1), RCOL_PANEL_HIGHLIGHT);
+    render_fill(list, rect(sx - 10, sy - 4, sx - 6, sy + 360), RCOL_PANEL_LEFT_HIGHLIGHT);
+    render_fill(list, rect(sx - 10, sy + 356, sx + 170, sy + 360), RCOL_PANEL_SHADOW);
+    render_fill(list, rect(sx + 166, sy - 4, sx + 170, sy + 360), RCOL_PANEL_RIGHT_SHADOW);
+    render_stroke(list, rect(sx - 10, sy - 4, sx + 170, sy + 360), RCOL_PANEL_BORDER, 1.5f);
+
+    render_text(list, rect(sx, sy - 28, sx + 200, sy), RFONT_HUD, RCOL_BORDER, "Next:");
+    render_text(list, rect(sx, hy - 28, sx + 200, hy), RFONT_HUD, RCOL_BORDER, "Hold:");
+    render_text(list, rect(sx, hy + 50, sx + 300, hy + 65), RFONT_HUD, RCOL_LABEL_SCORE, "Score:");
+    render_text(list, rect(sx, hy + 70, sx + 300, hy + 85), RFONT_HUD, RCOL_LABEL_LEVEL, "Level:");
+    render_text(list, rect(sx, hy + 90, sx + 300, hy + 105), RFONT_HUD, RCOL_LABEL_LINES, "Lines:");
+}
+
+RenderRect render_layer_bounds(const RenderScene* s, int layer) {
+    float sx = (float)s->side_left;
+    float sy = (float)s->board_top;
+    switch (layer) {
+    case RLAYER_TITLE:
+        return rect(0, 0, (float)s->window_width, 50);
+    case RLAYER_BOARD_FRAME:
+        return board_frame_rect(s);
+    default:
+        /* Panel plus the "Next:" caption above it; 1 px for the border stroke */
+        return rect(sx - 11, sy - 28, sx + 171, sy + 361);
+    }
+}
+
+void render_build_layer(const RenderScene* scene, int layer, RenderList* list) {
+    render_list_reset(list);
+    switch (layer) {
+    case RLAYER_TITLE: build_title(scene, list); break;
+    case RLAYER_BOARD_FRAME: build_board_frame(scene, list); break;
+    case RLAYER_PANEL: build_panel_frame(scene, list); break;
+    }
+}
+
+static void build_layer(const RenderScene* s, int layer, int flags, RenderList* list) {
+    if (flags & RENDER_INLINE_LAYERS) {
+        if (layer == RLAYER_TITLE) build_title(s, list);
+        else if (layer == RLAYER_BOARD_FRAME) build_board_frame(s, list);
+        else build_panel_frame(s, list);
+        return;
+    }
+    RenderCmd* c = push(list, RCMD_LAYER, RCOL_NONE);
+    if (!c) return;
+    c->rect = render_layer_bounds(s, layer);
+    c->style = (uint8_t)layer;
+}
+
+static void build_board(const RenderScene* s, int flags, RenderList* list) {
+    /* Darker at the top, lighter at the bottom, pulsing slowly */
+    float pulse = 0.04f * sinf((s->animation_frame % 60) * 3.14159f / 30.0f) * 0.5f;
+    render_gradient(list, board_frame_rect(s), rgba(0.10f + pulse, 0.12f + pulse, 0.15f + pulse, 1.0f),
+                    rgba(0.22f + pulse, 0.24f + pulse, 0.28f + pulse, 1.0f));
+    build_layer(s, RLAYER_BOARD_FRAME, flags, list);
+
+    for (int y = 0; y < HEIGHT; y++)
+        for (int x = 0; x < WIDTH; x++)
+            if (s->board[y][x]) build_cell(list, s, x, y, s->board[y][x]);
+
+    uint16_t m = get_mask(s->cur_piece, s->cur_rot);
+    for (int b = 0; b < 16; b++) {
+        if (!((m >> b) & 1u)) continue;
+        int ax = b % 4 + s->cur_x;
+        int ay = b / 4 + s->cur_y;
+        if (ay >= 0 && ay < HEIGHT && ax >= 0 && ax < WIDTH)
+            build_cell(list, s, ax, ay, pieces[s->cur_piece].color);
+    }
+
+    /* Placement hint published by the background search */
+    if (s->have_hint) {
+        uint16_t hm = get_mask(s->hint_piece, s->hint_rot);
+        for (int b = 0; b < 16; b++) {
+            if (!((hm >> b) & 1u)) continue;
+            float x = (float)(s->board_left + (b % 4 + s->hint_x) * (s->cell_size + s->cell_gap));
+            float y = (float)(s->board_top + (b / 4 + s->hint_y) * (s->cell_size + s->cell_gap));
+            render_stroke(list, rect(x + 2, y + 2, x + s->cell_size - 2, y + s->cell_size - 2), RCOL_HINT, 2.0f);
+        }
+    }
+}
+
+static void build_panel(const RenderScene* s, int flags, RenderList* list) {
+    float sx = (float)s->side_left;
+    float sy = (float)s->board_top;
+    float hy = sy + 110;
+
+    float hue_shift = (s->animation_frame % 120) / 120.0f;
+    float brightness = 0.3f + 0.1f * sinf(hue_shift * 3.14159f * 2.0f);
+    render_fill_rgba(list, rect(sx - 10, sy - 4, sx + 170, sy + 360),
+                     rgba(0.13f + brightness * 0.05f, 0.13f + brightness * 0.05f,
+                          0.16f + brightness * 0.05f, 1.0f));
+    build_layer(s, RLAYER_PANEL, flags, list);
+
+    if (s->next_piece >= 0) build_preview(list, s, sx, sy, s->next_piece);
+    if (s->hold_piece >= 0) build_preview(list, s, sx, hy, s->hold_piece);
+
+    char hud[64];
+    snprintf(hud, sizeof(hud), "%lld", (long long)s->score);
+    render_text(list, rect(sx + 60, hy + 50, sx + 260, hy + 80), RFONT_HUD, RCOL_LABEL_SCORE, hud);
+    snprintf(hud, sizeof(hud), "%d", s->level);
+    render_text(list, rect(sx + 60, hy + 70, sx + 260, hy + 100), RFONT_HUD, RCOL_LABEL_LEVEL, hud);
+    snprintf(hud, sizeof(hud), "%d", s->lines_total);
+    render_text(list, rect(sx + 60, hy + 90, sx + 260, hy + 120), RFONT_HUD, RCOL_LABEL_LINES, hud);
+
+    if (s->have_hint) {
+        snprintf(hud, sizeof(hud), "Hint: depth %d%s", s->hint_depth, s->hint_hold ? ", hold" : "");
+        render_text(list, rect(sx, hy + 120, sx + 300, hy + 145), RFONT_HUD, RCOL_LABEL, hud);
+        snprintf(hud, sizeof(hud), "%.1f ms", s->hint_latency_ms);
+        render_text(list, rect(sx, hy + 140, sx + 300, hy + 165), RFONT_HUD, RCOL_LABEL, hud);
+    }
+}
+
+/* Scene for a headless game at the default layout, without logo or hint */
+void render_scene_from_state(RenderScene* scene, const GameState* s, int animation_frame) {
+    memset(scene, 0, sizeof(*scene));
+    scene->board = s->board;
+    scene->cur_piece = s->cur_piece;
+    scene->cur_rot = s->cur_rot;
+    scene->cur_x = s->cur_x;
+    scene->cur_y = s->cur_y;
+    scene->next_piece = s->next_piece;
+    scene->hold_piece = s->hold_piece;
+    scene->score = s->score;
+    scene->level = s->level;
+    scene->lines_total = s->lines_total;
+    scene->animation_frame = animation_frame;
+    scene->window_width = RENDER_WINDOW_WIDTH;
+    scene->cell_size = RENDER_CELL_SIZE;
+    scene->cell_gap = RENDER_CELL_GAP;
+    scene->board_left = RENDER_BOARD_LEFT;
+    scene->board_top = RENDER_BOARD_TOP;
+    scene->side_left = RENDER_SIDE_LEFT;
+}
+
+/* Without RENDER_INLINE_LAYERS the static parts appear as RCMD_LAYER
+   commands; render_build_layer produces their content */
+void render_build(const RenderScene* scene, int flags, RenderList* list) {
+    TRACE_SCOPE("render_build");
+    render_list_reset(list);
+    RenderCmd* c = push(list, RCMD_CLEAR, RCOL_DYNAMIC);
+    if (c) c->rgba = rgba(0.08f, 0.08f, 0.08f, 1.0f);
+    build_layer(scene, RLAYER_TITLE, flags, list);
+    build_board(scene, flags, list);
+    build_panel(scene, flags, list);
+}
+
+/* Conservative: false only if nothing the command draws can land in clip */
+int render_cmd_visible(const RenderCmd* cmd, const RenderRect* clip) {
+    RenderRect r = cmd->rect;
+    float pad = cmd->width;
+    switch (cmd->op) {
+    case RCMD_CLEAR:
+        return 1;
+    case RCMD_LINE:
+        r = rect(fminf(r.left, r.right), fminf(r.top, r.bottom), fmaxf(r.left, r.right), fmaxf(r.top, r.bottom));
+        break;
+    case RCMD_STROKE_RECT:
+        break;
+    case RCMD_TEXT:
+        pad = 24.0f;   /* glyphs may run past a short layout box */
+        break;
+    default:
+        pad = 0.0f;
+        break;
+    }
+    return r.left - pad < clip->right && clip->left < r.right + pad &&
+           r.top - pad < clip->bottom && clip->top < r.bottom + pad;
+}
+
+void render_cache_reset(RenderCache* c) {
+    memset(c, 0, sizeof(*c));
+}
+
+void render_cache_begin_frame(RenderCache* c) {
+    c->frames++;
+    c->frame_creations = 0;
+}
+
+void render_cache_note_creation(RenderCache* c) {
+    c->creations++;
+    c->frame_creations++;
+}
+
+/* Returns 1 if key already owns *slot. Otherwise assigns a slot (free
+   first, then round robin) that the caller must fill and returns 0. */
+int render_cache_acquire(RenderCache* c, uint64_t key, int* slot) {
+    for (int i = 0; i < c->used; i++) {
+        if (c->key[i] == key) {
+            c->hits++;
+            *slot = i;
+            return 1;
+        }
+    }
+    int s;
+    if (c->used < RENDER_CACHE_SLOTS) {
+        s = c->used++;
+    } else {
+        s = c->next_victim;
+        c->next_victim = (c->next_victim + 1) % RENDER_CACHE_SLOTS;
+        c->evictions++;
+    }
+    c->key[s] = key;
+    render_cache_note_creation(c);
+    *slot = s;
+    return 0;
+}
+
+static uint64_t quantize(float v) {
+    return (uint64_t)(v <= 0.0f ? 0 : v >= 1.0f ? 255 : (int)(v * 255.0f + 0.5f));
+}
+
+/* Both gradient colors at 8 bits per channel */
+uint64_t render_gradient_key(const RenderCmd* cmd) {
+    const RenderRgba* a = &cmd->rgba;
+    const RenderRgba* b = &cmd->rgba2;
+    return quantize(a->r) | quantize(a->g) << 8 | quantize(a->b) << 16 | quantize(a->a) << 24 |
+           quantize(b->r) << 32 | quantize(b->g) << 40 | quantize(b->b) << 48 | quantize(b->a) << 56;
+}
+
+/* Acquires every cached resource the list needs, as a backend would while
+   replaying it; returns how many had to be created */
+int render_list_prepare(const RenderList* list, RenderCache* c) {
+    int created = 0;
+    for (int i = 0; i < list->count; i++) {
+        int slot;
+        if (list->cmd[i].op == RCMD_GRADIENT && !render_cache_acquire(c, render_gradient_key(&list->cmd[i]), &slot))
+            created++;
+    }
+    return created;
+}
@@ -0,0 +1,162 @@
+#ifndef TETRIS_RENDER_H
+#define TETRIS_RENDER_H
+
+/* Platform-neutral frame description. render_build turns a scene into a
+   list of drawing commands that refer to colors, fonts and bitmaps by id;
+   a backend (Direct2D in tetris_graphics.cpp) replays the list with
+   resources it created up front. Nothing in here may include windows.h. */
+
+#include <stdint.h>
+#include "tetris_core.h"
+
+#define RENDER_MAX_CMDS 4096
+#define RENDER_TEXT_BYTES 4096
+#define RENDER_CACHE_SLOTS 64
+
+/* Default layout, shared by the window and the headless renderers */
+#define RENDER_CELL_SIZE 28
+#define RENDER_CELL_GAP 2
+#define RENDER_BOARD_LEFT 24
+#define RENDER_BOARD_TOP 72
+#define RENDER_SIDE_LEFT (WIDTH * (RENDER_CELL_SIZE + RENDER_CELL_GAP) + 72)
+#define RENDER_WINDOW_WIDTH 650
+#define RENDER_WINDOW_HEIGHT 1050
+
+typedef struct {
+    float r, g, b, a;
+} RenderRgba;
+
+typedef struct {
+    float left, top, right, bottom;
+} RenderRect;
+
+/* Fixed colors; a backend creates one brush per id before the first frame.
+   Ids 1..7 are the piece colors of pieces[].color. */
+enum {
+    RCOL_NONE = 0,
+    RCOL_PIECE_LAST = 7,
+    RCOL_BORDER,
+    RCOL_BG,
+    RCOL_LABEL,
+    RCOL_LABEL_SCORE,
+    RCOL_LABEL_LEVEL,
+    RCOL_LABEL_LINES,
+    RCOL_VALUE,
+    RCOL_HINT,
+    RCOL_CELL_HIGHLIGHT,
+    RCOL_CELL_SHADOW,
+    RCOL_CELL_BORDER,
+    RCOL_TITLEBAR,
+    RCOL_TITLEBAR_ACCENT,
+    RCOL_CLOSE_BG,
+    RCOL_CLOSE_BORDER,
+    RCOL_BOARD_SHADE,
+    RCOL_BOARD_HIGHLIGHT,
+    RCOL_PANEL_HIGHLIGHT,
+    RCOL_PANEL_LEFT_HIGHLIGHT,
+    RCOL_PANEL_SHADOW,
+    RCOL_PANEL_RIGHT_SHADOW,
+    RCOL_PANEL_BORDER,
+    RCOL_MINI_BOARD,
+    RCOL_MINI_BOARD_OVER,
+    RCOL_DYNAMIC,       /* color carried by the command itself */
+    RCOL_COUNT
+};
+
+enum { RFONT_HUD = 0, RFONT_COUNT };
+enum { RBMP_LOGO = 0, RBMP_COUNT };
+
+/* Parts of the frame that only change with the window size or the logo;
+   a backend may render each once into a bitmap and blit it */
+enum { RLAYER_TITLE = 0, RLAYER_BOARD_FRAME, RLAYER_PANEL, RLAYER_COUNT };
+
+/* render_build flags */
+#define RENDER_INLINE_LAYERS 1   /* emit layer content instead of RCMD_LAYER */
+
+enum {
+    RCMD_CLEAR,
+    RCMD_FILL_RECT,
+    RCMD_STROKE_RECT,
+    RCMD_LINE,          /* rect holds x0, y0, x1, y1 */
+    RCMD_GRADIENT,      /* vertical, rgba at the top to rgba2 at the bottom */
+    RCMD_TEXT,
+    RCMD_BITMAP,
+    RCMD_LAYER          /* style is the RLAYER_* to blit at rect */
+};
+
+typedef struct {
+    uint8_t op;
+    uint8_t color;      /* RCOL_* */
+    uint8_t style;      /* RFONT_*, RBMP_* or RLAYER_* */
+    float width;        /* stroke width */
+    RenderRect rect;
+    RenderRgba rgba, rgba2;
+    uint16_t text_offset, text_len;
+} RenderCmd;
+
+typedef struct {
+    RenderCmd cmd[RENDER_MAX_CMDS];
+    int count;
+    char text[RENDER_TEXT_BYTES];
+    int text_used;
+    int overflow;       /* commands or text dropped because the list was full */
+} RenderList;
+
+/* Everything render_build reads; the game fills it from its globals */
+typedef struct {
+    const int (*board)[WIDTH];
+    int cur_piece, cur_rot, cur_x, cur_y;
+    int next_piece, hold_piece;
+    int64_t score;
+    int level, lines_total;
+    int animation_frame;
+    int window_width;
+    int cell_size, cell_gap;
+    int board_left, board_top, side_left;
+    float logo_width, logo_height;   /* 0 when the logo is not loaded */
+    int have_hint;
+    int hint_piece, hint_rot, hint_x, hint_y;
+    int hint_depth, hint_hold;
+    float hint_latency_ms;
+} RenderScene;
+
+/* Backend resources that depend on command data (gradients) live in a
+   fixed set of slots keyed by value. The counters let a caller check that
+   a steady-state frame creates nothing. */
+typedef struct {
+    uint64_t key[RENDER_CACHE_SLOTS];
+    int used;
+    int next_victim;
+    uint64_t frames;
+    uint64_t creations;        /* since the cache was reset */
+    uint64_t frame_creations;  /* during the current frame */
+    uint64_t hits;
+    uint64_t evictions;
+} RenderCache;
+
+extern const RenderRgba render_palette[RCOL_COUNT];
+
+/* Command list */
+void render_list_reset(RenderList* list);
+void render_fill(RenderList* list, RenderRect r, int color);
+void render_stroke(RenderList* list, RenderRect r, int color, float width);
+void render_line(RenderList* list, float x0, float y0, float x1, float y1, int color, float width);
+void render_fill_rgba(RenderList* list, RenderRect r, RenderRgba c);
+void render_gradient(RenderList* list, RenderRect r, RenderRgba top, RenderRgba bottom);
+void render_text(RenderList* list, RenderRect r, int font, int color, const char* text);
+void render_bitmap(RenderList* list, RenderRect r, int bitmap);
+void render_scene_from_state(RenderScene* scene, const GameState* s, int animation_frame);
+void render_build(const RenderScene* scene, int flags, RenderList* list);
+void render_build_layer(const RenderScene* scene, int layer, RenderList* list);
+RenderRect render_layer_bounds(const RenderScene* scene, int layer);
+int render_cmd_visible(const RenderCmd* cmd, const RenderRect* clip);
+
+/* Resource cache */
+void render_cache_reset(RenderCache* c);
+void render_cache_begin_frame(RenderCache* c);
+void render_cache_note_creation(RenderCache* c);
+int render_cache_acquire(RenderCache* c, uint64_t key, int* slot);
+uint64_t render_gradient_key(const RenderCmd* cmd);
+int render_list_prepare(const RenderList* list, RenderCache* c);
+
+#endif /* TETRIS_RENDER_H */
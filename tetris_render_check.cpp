@@ -0,0 +1,209 @@
+// Headless render check - draws a seeded bot game with the software
+// backend and compares each frame against golden images
+// Build: g++ -O2 -std=c++17 tetris_render_check.cpp tetris_soft.cpp tetris_glyphs.cpp tetris_render.cpp tetris_font.cpp tetris_bot.cpp tetris_eval_cache.cpp tetris_core.cpp -o tetris_render_check
+//        cl /O2 /std:c++17 /EHsc tetris_render_check.cpp tetris_soft.cpp tetris_glyphs.cpp tetris_render.cpp tetris_font.cpp tetris_bot.cpp tetris_eval_cache.cpp tetris_core.cpp
+// Usage: tetris_render_check --write golden     (record frames as PPM)
+//        tetris_render_check --compare golden   (fails on any difference)
+//        tetris_render_check --self-test golden (makes the goldens, then checks a second run)
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include "tetris_soft.h"
+#include "tetris_bot.h"
+
+#ifdef _WIN32
+#include <direct.h>
+#include <errno.h>
+static int make_dir(const char* path) { return _mkdir(path) == 0 || errno == EEXIST; }
+#else
+#include <errno.h>
+#include <sys/stat.h>
+static int make_dir(const char* path) { return mkdir(path, 0755) == 0 || errno == EEXIST; }
+#endif
+
+static RenderList list;
+
+static void usage(void) {
+    printf("Usage: tetris_render_check [options]\n"
+           "  --frames N       frames to draw, one per placed piece (default 100)\n"
+           "  --seed N         game seed (default 1)\n"
+           "  --write DIR      save each frame as DIR/frame_NNNN.ppm\n"
+           "  --compare DIR    compare each frame with DIR/frame_NNNN.ppm\n"
+           "  --self-test DIR  write goldens to DIR, then redraw into fresh buffers and compare\n"
+           "  --tolerance N    largest channel difference still counted as equal (default 0)\n");
+}
+
+static int write_ppm(const char* path, const SoftFrame* f) {
+    FILE* fp = fopen(path, "wb");
+    if (!fp) return 0;
+    fprintf(fp, "P6\n%d %d\n255\n", f->width, f->height);
+    std::vector<unsigned char> row((size_t)f->width * 3);
+    for (int y = 0; y < f->height; y++) {
+        const uint32_t* p = f->pixels + (size_t)y * f->stride;
+        for (int x = 0; x < f->width; x++) {
+            row[x * 3 + 0] = (unsigned char)(p[x] >> 16);
+            row[x * 3 + 1] = (unsigned char)(p[x] >> 8);
+            row[x * 3 + 2] = (unsigned char)p[x];
+        }
+        fwrite(row.data(), 1, row.size(), fp);
+    }
+    return fclose(fp) == 0;
+}
+
+/* Returns the number of differing pixels, or -1 if the file is missing or
+   has another size */
+static long compare_ppm(const char* path, const SoftFrame* f, int tolerance, int* max_delta) {
+    FILE* fp = fopen(path, "rb");
+    if (!fp) return -1;
+    int w, h, maxval;
+    if (fscanf(fp, "P6 %d %d %d", &w, &h, &maxval) != 3 || w != f->width || h != f->height ||
+        maxval != 255 || fgetc(fp) == EOF) {
+        fclose(fp);
+        return -1;
+    }
+    std::vector<unsigned char> row((size_t)w * 3);
+    long diff = 0;
+    *max_delta = 0;
+    for (int y = 0; y < h; y++) {
+        if (fread(row.data(), 1, row.size(), fp) != row.size()) {
+            fclose(fp);
+            return -1;
+        }
+        const uint32_t* p = f->pixels + (size_t)y * f->stride;
+        for (int x = 0; x < w; x++) {
+            int d = 0;
+            for (int c = 0; c < 3; c++) {
+                int v = (int)((p[x] >> (16 - 8 * c)) & 255) - row[x * 3 + c];
+                if (v < 0) v = -v;
+                if (v > d) d = v;
+            }
+            if (d > *max_delta) *max_delta = d;
+            if (d > tolerance) diff++;
+        }
+    }
+    fclose(fp);
+    return diff;
+}
+
+/* One pass over the seeded game. With fresh_buffers every frame is drawn
+   into a newly made buffer, so nothing can carry over from the last one.
+   Returns the frames that differ from or are missing in compare_dir, or
+   -1 if a frame cannot be drawn or written. */
+static int run(int frames, uint32_t seed, const char* write_dir, const char* compare_dir, int tolerance,
+               int fresh_buffers) {
+    SoftFrame frame;
+    if (!soft_frame_init(&frame, RENDER_WINDOW_WIDTH, RENDER_WINDOW_HEIGHT)) {
+        fprintf(stderr, "out of memory\n");
+        return -1;
+    }
+    EvalCache* cache = eval_cache_create(16u << 20);
+    GameState s;
+    state_init(&s, seed);
+
+    std::vector<double> ms;
+    int failed = 0, missing = 0;
+    for (int n = 0; n < frames; n++) {
+        RenderScene scene;
+        render_scene_from_state(&scene, &s, n);
+        if (fresh_buffers && n > 0) {
+            soft_frame_free(&frame);
+            if (!soft_frame_init(&frame, RENDER_WINDOW_WIDTH, RENDER_WINDOW_HEIGHT)) {
+                fprintf(stderr, "out of memory\n");
+                eval_cache_destroy(cache);
+                return -1;
+            }
+        }
+
+        auto t0 = std::chrono::steady_clock::now();
+        render_build(&scene, RENDER_INLINE_LAYERS, &list);
+        soft_render_list(&frame, &list);
+        ms.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count());
+
+        char path[1024];
+        const char* dir = write_dir ? write_dir : compare_dir;
+        if (dir) snprintf(path, sizeof(path), "%s/frame_%04d.ppm", dir, n);
+        if (write_dir && !write_ppm(path, &frame)) {
+            fprintf(stderr, "cannot write %s\n", path);
+            eval_cache_destroy(cache);
+            soft_frame_free(&frame);
+            return -1;
+        }
+        if (compare_dir) {
+            int max_delta;
+            long diff = compare_ppm(path, &frame, tolerance, &max_delta);
+            if (diff < 0) {
+                missing++;
+            } else if (diff > 0) {
+                printf("frame %d: %ld pixels differ, max delta %d\n", n, diff, max_delta);
+                failed++;
+            }
+        }
+
+        /* Next frame: one more piece placed, or a fresh game */
+        BotMove mv;
+        if (s.game_over || !bot_search(&s, &bot_default_weights, 1, cache, &mv))
+            state_init(&s, seed + n + 1);
+        else
+            bot_apply(&s, &mv);
+    }
+
+    std::vector<double> sorted = ms;
+    std::sort(sorted.begin(), sorted.end());
+    double sum = 0;
+    for (double v : ms) sum += v;
+    printf("%d frames, %d commands in the last; render ms min %.3f avg %.3f p50 %.3f p99 %.3f max %.3f\n",
+           frames, list.count, sorted.front(), sum / frames, sorted[frames / 2],
+           sorted[(size_t)(frames - 1) * 99 / 100], sorted.back());
+    printf("text: %llu layouts built for %llu strings drawn\n", (unsigned long long)frame.layouts->builds,
+           (unsigned long long)frame.layouts->lookups);
+    if (compare_dir)
+        printf("%d of %d frames differ, %d missing\n", failed, frames, missing);
+
+    eval_cache_destroy(cache);
+    soft_frame_free(&frame);
+    return failed + missing;
+}
+
+int main(int argc, char** argv) {
+    int frames = 100;
+    uint32_t seed = 1;
+    int tolerance = 0;
+    const char* write_dir = NULL;
+    const char* compare_dir = NULL;
+    const char* self_test_dir = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        const char* v = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!strcmp(a, "--help")) { usage(); return 0; }
+        if (!v) { usage(); return 1; }
+        if (!strcmp(a, "--frames")) frames = atoi(v);
+        else if (!strcmp(a, "--seed")) seed = (uint32_t)strtoul(v, NULL, 10);
+        else if (!strcmp(a, "--write")) write_dir = v;
+        else if (!strcmp(a, "--compare")) compare_dir = v;
+        else if (!strcmp(a, "--self-test")) self_test_dir = v;
+        else if (!strcmp(a, "--tolerance")) tolerance = atoi(v);
+        else { usage(); return 1; }
+        i++;
+    }
+    if (frames < 1) frames = 1;
+
+    /* Goldens made here from one pass, then a second pass from scratch
+       compared against them */
+    if (self_test_dir) {
+        if (!make_dir(self_test_dir)) {
+            fprintf(stderr, "cannot create %s\n", self_test_dir);
+            return 1;
+        }
+        if (run(frames, seed, self_test_dir, NULL, 0, 0) < 0) return 1;
+        int bad = run(frames, seed, NULL, self_test_dir, tolerance, 1);
+        printf("%s\n", bad ? "FAILED" : "OK");
+        return bad ? 2 : 0;
+    }
+
+    int bad = run(frames, seed, write_dir, compare_dir, tolerance, 0);
+    return bad < 0 ? 1 : bad ? 2 : 0;
+}
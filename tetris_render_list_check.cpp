@@ -0,0 +1,94 @@
+// Render list cache check - builds the same scene frame after frame and
+// walks each list through the resource cache as a backend would: only the
+// first frame may create anything, and an animated board creates nothing
+// once its pulse has cycled
+// Build: g++ -O2 -std=c++17 tetris_render_list_check.cpp tetris_render.cpp tetris_core.cpp -o tetris_render_list_check
+//        cl /O2 /std:c++17 /EHsc tetris_render_list_check.cpp tetris_render.cpp tetris_core.cpp
+// Usage: tetris_render_list_check               (exit status 1 on any failure)
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tetris_render.h"
+
+#define IDENTICAL_FRAMES 300
+#define PULSE_FRAMES 60
+
+static RenderList list;
+static int failures = 0;
+
+static void check(int ok, const char* what) {
+    if (!ok) {
+        printf("FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+/* Builds and prepares one frame; returns the creations it caused */
+static int frame(const RenderScene* scene, int flags, RenderCache* c) {
+    render_cache_begin_frame(c);
+    render_build(scene, flags, &list);
+    int created = render_list_prepare(&list, c);
+    if (c->frame_creations != (uint64_t)created) return -1;
+    return created;
+}
+
+static void check_identical_frames(const GameState* s, int flags, const char* name) {
+    RenderScene scene;
+    render_scene_from_state(&scene, s, 0);
+    RenderCache c;
+    render_cache_reset(&c);
+    int first = frame(&scene, flags, &c);
+    int later = 0;
+    for (int i = 1; i < IDENTICAL_FRAMES; i++) {
+        int n = frame(&scene, flags, &c);
+        if (n != 0) later++;
+    }
+    char what[128];
+    snprintf(what, sizeof(what), "%s: the first frame creates what the list needs (%d)", name, first);
+    check(first >= 0 && (uint64_t)first == c.creations, what);
+    snprintf(what, sizeof(what), "%s: %d identical frames after the first create nothing (%d did)", name,
+             IDENTICAL_FRAMES - 1, later);
+    check(!later && !list.overflow, what);
+    printf("%s: %llu creations, %llu hits over %llu frames\n", name, (unsigned long long)c.creations,
+           (unsigned long long)c.hits, (unsigned long long)c.frames);
+}
+
+/* The board pulse repeats every PULSE_FRAMES; a second cycle must be served
+   entirely from the cache */
+static void check_pulse_cycle(const GameState* s) {
+    RenderScene scene;
+    render_scene_from_state(&scene, s, 0);
+    RenderCache c;
+    render_cache_reset(&c);
+    for (int f = 0; f < PULSE_FRAMES; f++) {
+        scene.animation_frame = f;
+        frame(&scene, RENDER_INLINE_LAYERS, &c);
+    }
+    uint64_t after_first = c.creations;
+    int later = 0;
+    for (int f = PULSE_FRAMES; f < 10 * PULSE_FRAMES; f++) {
+        scene.animation_frame = f;
+        if (frame(&scene, RENDER_INLINE_LAYERS, &c) != 0) later++;
+    }
+    char what[128];
+    snprintf(what, sizeof(what), "animated: frames after the first pulse cycle create nothing (%d did)", later);
+    check(!later, what);
+    check(after_first <= RENDER_CACHE_SLOTS && !c.evictions, "animated: one pulse cycle fits the cache");
+    printf("animated: %llu creations in the first cycle, %llu hits over %llu frames\n",
+           (unsigned long long)after_first, (unsigned long long)c.hits, (unsigned long long)c.frames);
+}
+
+int main(int argc, char** argv) {
+    (void)argv;
+    if (argc > 1) {
+        printf("Usage: tetris_render_list_check\n");
+        return 0;
+    }
+    GameState s;
+    state_init(&s, 1);
+    check_identical_frames(&s, 0, "layered");
+    check_identical_frames(&s, RENDER_INLINE_LAYERS, "inline");
+    check_pulse_cycle(&s);
+    printf("%s\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
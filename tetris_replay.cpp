@@ -0,0 +1,97 @@
+#include "tetris_replay.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char replay_magic[8] = { 'T', 'E', 'T', 'R', 'I', 'S', 'R', 'P' };
+
+void replay_begin(Replay* r, uint32_t seed) {
+    memset(r, 0, sizeof(*r));
+    memcpy(r->header.magic, replay_magic, sizeof(replay_magic));
+    r->header.version = REPLAY_VERSION;
+    r->header.seed = seed;
+}
+
+void replay_free(Replay* r) {
+    free(r->move);
+    r->move = NULL;
+    r->capacity = 0;
+    r->header.moves = 0;
+}
+
+int replay_add(Replay* r, uint32_t t_ms, int use_hold, int rot, int x, int y) {
+    if (r->header.moves == r->capacity) {
+        uint32_t cap = r->capacity ? r->capacity * 2 : 256;
+        ReplayMove* grown = (ReplayMove*)realloc(r->move, cap * sizeof(ReplayMove));
+        if (!grown) return 0;
+        r->move = grown;
+        r->capacity = cap;
+    }
+    ReplayMove* mv = &r->move[r->header.moves++];
+    mv->t_ms = t_ms;
+    mv->flags = use_hold ? REPLAY_HOLD : 0;
+    mv->rot = (uint8_t)rot;
+    mv->x = (int8_t)x;
+    mv->y = (int8_t)y;
+    return 1;
+}
+
+void replay_finish(Replay* r, const GameState* s, uint32_t duration_ms) {
+    r->header.duration_ms = duration_ms;
+    r->header.final_score = s->score;
+}
+
+int replay_save(const Replay* r, const char* path) {
+    FILE* f = fopen(path, "wb");
+    if (!f) return 0;
+    int ok = fwrite(&r->header, sizeof(r->header), 1, f) == 1 &&
+             fwrite(r->move, sizeof(ReplayMove), r->header.moves, f) == r->header.moves;
+    return fclose(f) == 0 && ok;
+}
+
+int replay_header_valid(const ReplayHeader* h, size_t file_size) {
+    return file_size >= sizeof(ReplayHeader) && !memcmp(h->magic, replay_magic, sizeof(replay_magic)) &&
+           (h->version == REPLAY_VERSION || h->version == 1) &&
+           (file_size - sizeof(ReplayHeader)) / sizeof(ReplayMove) >= h->moves;
+}
+
+int replay_load(Replay* r, const char* path) {
+    memset(r, 0, sizeof(*r));
+    FILE* f = fopen(path, "rb");
+    if (!f) return 0;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    int ok = size > 0 && fread(&r->header, sizeof(r->header), 1, f) == 1 &&
+             replay_header_valid(&r->header, (size_t)size);
+    if (ok && r->header.moves) {
+        r->move = (ReplayMove*)malloc(r->header.moves * sizeof(ReplayMove));
+        r->capacity = r->header.moves;
+        ok = r->move && fread(r->move, sizeof(ReplayMove), r->header.moves, f) == r->header.moves;
+    }
+    fclose(f);
+    if (!ok) replay_free(r);
+    return ok;
+}
+
+/* A move whose position is the hard-drop landing scores like a hard drop;
+   anything else (a tuck or a slide) is placed where it was locked */
+int replay_apply(GameState* s, const ReplayMove* mv) {
+    if (s->game_over) return -1;
+    if ((mv->flags & REPLAY_HOLD) && state_hold(s) && s->game_over) return -1;
+    int rot = mv->rot & 3;
+    if (!board_fits(s->board, s->cur_piece, mv->x, mv->y, rot) ||
+        board_fits(s->board, s->cur_piece, mv->x, mv->y + 1, rot))
+        return -1;
+
+    int drop = mv->y >= 0;
+    for (int y = 0; y <= mv->y && drop; y++)
+        drop = board_fits(s->board, s->cur_piece, mv->x, y, rot);
+    s->cur_rot = rot;
+    s->cur_x = mv->x;
+    s->cur_y = mv->y;
+    /* The path check found where a hard drop from the top stops, so it
+       is scored without searching for the landing again */
+    if (drop) s->score += mv->y * 2;
+    return state_lock_piece(s);
+}
@@ -0,0 +1,53 @@
+#ifndef TETRIS_REPLAY_H
+#define TETRIS_REPLAY_H
+
+#include <stddef.h>
+#include "tetris_core.h"
+
+/* Recorded games. A replay is the seed of a GameState plus one record per
+   placed piece, so playing the records back through replay_apply rebuilds
+   every state of the game exactly.
+
+   File layout: ReplayHeader, then header.moves ReplayMove records, all
+   little-endian with no padding, so a file can be mapped and read in
+   place. Version 1 held a 32-bit final score followed by a reserved zero
+   word, which reads as the same 64-bit score, so it is still accepted. */
+
+#define REPLAY_VERSION 2
+#define REPLAY_HOLD 1       /* ReplayMove.flags: hold before placing */
+
+typedef struct {
+    char magic[8];          /* "TETRISRP" */
+    uint32_t version;
+    uint32_t seed;
+    uint32_t moves;
+    uint32_t duration_ms;
+    int64_t final_score;
+} ReplayHeader;
+
+typedef struct {
+    uint32_t t_ms;          /* lock time since the game started */
+    uint8_t flags;
+    uint8_t rot;
+    int8_t x, y;            /* final position of the piece */
+} ReplayMove;
+
+typedef struct {
+    ReplayHeader header;
+    ReplayMove* move;
+    uint32_t capacity;
+} Replay;
+
+void replay_begin(Replay* r, uint32_t seed);
+void replay_free(Replay* r);
+int replay_add(Replay* r, uint32_t t_ms, int use_hold, int rot, int x, int y);
+void replay_finish(Replay* r, const GameState* s, uint32_t duration_ms);
+int replay_save(const Replay* r, const char* path);
+int replay_load(Replay* r, const char* path);
+int replay_header_valid(const ReplayHeader* h, size_t file_size);
+
+/* Playback: state_init with the header seed, then one call per move.
+   Returns the lines cleared, or -1 if the move does not fit. */
+int replay_apply(GameState* s, const ReplayMove* mv);
+
+#endif /* TETRIS_REPLAY_H */
@@ -0,0 +1,361 @@
+// Replay corpus analytics - maps every replay file, re-simulates the games
+// on a pool of threads and writes per-game metrics as a columnar file,
+// with placement heatmaps, the line clear distribution and stack heights
+// Build: g++ -O2 -std=c++17 -pthread tetris_replay_stats.cpp tetris_replay.cpp tetris_tablebase.cpp tetris_versus.cpp tetris_bot.cpp tetris_eval_cache.cpp tetris_core.cpp -o tetris_replay_stats
+//        cl /O2 /std:c++17 /EHsc tetris_replay_stats.cpp tetris_replay.cpp tetris_tablebase.cpp tetris_versus.cpp tetris_bot.cpp tetris_eval_cache.cpp tetris_core.cpp
+// Usage: tetris_replay_stats --out stats.tan games/*.rep
+//        tetris_replay_stats --list corpus.txt --threads 8 --out stats.tan
+//        tetris_replay_stats --generate 2000 --dir games   (bot games to try it on)
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include "tetris_replay.h"
+#include "tetris_tablebase.h"
+#include "tetris_versus.h"
+#include "tetris_bot.h"
+
+/* Output, little-endian with no padding:
+     AnHeader
+     AnColumn[columns], then each column's games values of 4 bytes
+                                     (COL_I64: 8)
+     uint32 heat[7][HEIGHT][WIDTH]   cells covered by locked pieces, by piece
+     uint32 clears[5]                locks by lines cleared
+     uint64 height_start[games + 1], uint8 height[height_samples]
+                                     stack height after every lock of game i
+                                     at height_start[i] .. height_start[i + 1] */
+typedef struct {
+    char magic[8];                /* "TETRISAN" */
+    uint32_t version;
+    uint32_t games;
+    uint32_t columns;
+    uint32_t reserved;
+    uint64_t height_samples;
+} AnHeader;
+
+enum { COL_U32, COL_I32, COL_F32, COL_I64 };
+
+typedef struct {
+    char name[16];
+    uint32_t type;
+    uint32_t reserved;
+} AnColumn;
+
+#define CLAIM_FILES 16            /* files a worker takes at a time */
+
+typedef struct {
+    uint32_t seed, moves, duration_ms;
+    int64_t score;
+    uint32_t lines, clears[5], attack, holds, max_height;
+    float pps, lpm, apm, mean_height;
+    uint32_t ok;                  /* read, every move fit and the score matches */
+} GameStats;
+
+typedef struct {
+    uint64_t heat[7][HEIGHT][WIDTH];
+    uint64_t clears[5];
+    uint64_t moves, bytes;
+} WorkerTotals;
+
+static std::vector<std::string> files;
+static std::vector<GameStats> stats;
+static std::vector<std::vector<uint8_t> > heights;
+static std::atomic<size_t> next_file(0);
+
+static void usage(void) {
+    printf("Usage: tetris_replay_stats [options] [FILE.rep ...]\n"
+           "  --list FILE      read replay paths from FILE, one per line\n"
+           "  --out FILE       columnar results (default replay_stats.tan)\n"
+           "  --threads N      (default: all cores)\n"
+           "  --generate N     record N bot games into --dir instead\n"
+           "  --dir DIR        existing directory for --generate (default .)\n"
+           "  --pieces N       longest generated game (default 400)\n");
+}
+
+static int stack_height(const int b[HEIGHT][WIDTH]) {
+    for (int y = 0; y < HEIGHT; y++)
+        for (int x = 0; x < WIDTH; x++)
+            if (b[y][x]) return HEIGHT - y;
+    return 0;
+}
+
+/* The replay is read in place from the mapping */
+static void analyse(size_t index, WorkerTotals* t) {
+    GameStats* gs = &stats[index];
+    std::vector<uint8_t>& hs = heights[index];
+    memset(gs, 0, sizeof(*gs));
+    size_t size = 0;
+    void* handle = NULL;
+    void* base = tb_map_file(files[index].c_str(), &size, 0, &handle);
+    if (!base) return;
+    const ReplayHeader* h = (const ReplayHeader*)base;
+    if (!replay_header_valid(h, size)) {
+        tb_unmap_file(base, size, handle);
+        return;
+    }
+    const ReplayMove* mv = (const ReplayMove*)(h + 1);
+    t->bytes += size;
+    gs->seed = h->seed;
+    gs->moves = h->moves;
+    gs->duration_ms = h->duration_ms;
+
+    GameState s;
+    state_init(&s, h->seed);
+    hs.reserve(h->moves);
+    int ok = 1, combo = 0, last_tetris = 0;
+    uint64_t height_sum = 0;
+    for (uint32_t m = 0; m < h->moves; m++) {
+        /* The piece that lands, as replay_apply's hold will leave it */
+        int piece = s.cur_piece;
+        if ((mv[m].flags & REPLAY_HOLD) && !s.hold_used) {
+            piece = s.hold_piece >= 0 ? s.hold_piece : s.next_piece;
+            gs->holds++;
+        }
+        int cleared = replay_apply(&s, &mv[m]);
+        if (cleared < 0) {
+            ok = 0;
+            break;
+        }
+        uint16_t mask = get_mask(piece, mv[m].rot);
+        for (int i = 0; i < 16; i++)
+            if (mask >> i & 1) t->heat[piece][mv[m].y + i / 4][mv[m].x + i % 4]++;
+        gs->clears[cleared > 4 ? 4 : cleared]++;
+        gs->attack += (uint32_t)versus_attack(&attack_table_default, s.board, cleared, &combo, &last_tetris);
+        int height = stack_height(s.board);
+        hs.push_back((uint8_t)height);
+        height_sum += (uint64_t)height;
+        if ((uint32_t)height > gs->max_height) gs->max_height = (uint32_t)height;
+    }
+    gs->score = s.score;
+    gs->lines = (uint32_t)s.lines_total;
+    gs->ok = ok && s.score == h->final_score;
+    uint32_t ms = h->duration_ms ? h->duration_ms : h->moves ? mv[h->moves - 1].t_ms : 0;
+    if (ms) {
+        gs->pps = (float)(hs.size() * 1000.0 / ms);
+        gs->lpm = (float)(gs->lines * 60000.0 / ms);
+        gs->apm = (float)(gs->attack * 60000.0 / ms);
+    }
+    if (!hs.empty()) gs->mean_height = (float)((double)height_sum / hs.size());
+    for (int c = 0; c < 5; c++) t->clears[c] += gs->clears[c];
+    t->moves += hs.size();
+    tb_unmap_file(base, size, handle);
+}
+
+static void worker(WorkerTotals* t) {
+    for (;;) {
+        size_t first = next_file.fetch_add(CLAIM_FILES);
+        if (first >= files.size()) return;
+        size_t last = first + CLAIM_FILES < files.size() ? first + CLAIM_FILES : files.size();
+        for (size_t i = first; i < last; i++) analyse(i, t);
+    }
+}
+
+typedef struct {
+    const char* name;
+    uint32_t type;
+    size_t offset;
+} ColumnDef;
+
+static const ColumnDef column_defs[] = {
+    { "seed", COL_U32, offsetof(GameStats, seed) },
+    { "moves", COL_U32, offsetof(GameStats, moves) },
+    { "duration_ms", COL_U32, offsetof(GameStats, duration_ms) },
+    { "score", COL_I64, offsetof(GameStats, score) },
+    { "lines", COL_U32, offsetof(GameStats, lines) },
+    { "singles", COL_U32, offsetof(GameStats, clears[1]) },
+    { "doubles", COL_U32, offsetof(GameStats, clears[2]) },
+    { "triples", COL_U32, offsetof(GameStats, clears[3]) },
+    { "tetrises", COL_U32, offsetof(GameStats, clears[4]) },
+    { "attack", COL_U32, offsetof(GameStats, attack) },
+    { "holds", COL_U32, offsetof(GameStats, holds) },
+    { "max_height", COL_U32, offsetof(GameStats, max_height) },
+    { "pps", COL_F32, offsetof(GameStats, pps) },
+    { "lpm", COL_F32, offsetof(GameStats, lpm) },
+    { "apm", COL_F32, offsetof(GameStats, apm) },
+    { "mean_height", COL_F32, offsetof(GameStats, mean_height) },
+    { "ok", COL_U32, offsetof(GameStats, ok) },
+};
+#define COLUMNS (sizeof(column_defs) / sizeof(column_defs[0]))
+
+static int write_results(const char* path, const WorkerTotals* total) {
+    FILE* f = fopen(path, "wb");
+    if (!f) return 0;
+    uint32_t games = (uint32_t)stats.size();
+    AnHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, "TETRISAN", 8);
+    h.version = 2;
+    h.games = games;
+    h.columns = (uint32_t)COLUMNS;
+    h.height_samples = 0;
+    for (const auto& hs : heights) h.height_samples += hs.size();
+    int ok = fwrite(&h, sizeof(h), 1, f) == 1;
+    for (size_t c = 0; c < COLUMNS && ok; c++) {
+        AnColumn col;
+        memset(&col, 0, sizeof(col));
+        snprintf(col.name, sizeof(col.name), "%s", column_defs[c].name);
+        col.type = column_defs[c].type;
+        ok = fwrite(&col, sizeof(col), 1, f) == 1;
+    }
+    std::vector<uint8_t> column((size_t)games * 8);
+    for (size_t c = 0; c < COLUMNS && ok; c++) {
+        size_t width = column_defs[c].type == COL_I64 ? 8 : 4;
+        for (uint32_t g = 0; g < games; g++)
+            memcpy(&column[g * width], (const char*)&stats[g] + column_defs[c].offset, width);
+        ok = fwrite(column.data(), width, games, f) == games;
+    }
+    for (int p = 0; p < 7 && ok; p++)
+        for (int y = 0; y < HEIGHT && ok; y++) {
+            uint32_t row[WIDTH];
+            for (int x = 0; x < WIDTH; x++)
+                row[x] = total->heat[p][y][x] > 0xffffffffu ? 0xffffffffu : (uint32_t)total->heat[p][y][x];
+            ok = fwrite(row, sizeof(row), 1, f) == 1;
+        }
+    uint32_t clears[5];
+    for (int c = 0; c < 5; c++) clears[c] = (uint32_t)total->clears[c];
+    ok = ok && fwrite(clears, sizeof(clears), 1, f) == 1;
+    uint64_t start = 0;
+    for (uint32_t g = 0; g <= games && ok; g++) {
+        ok = fwrite(&start, sizeof(start), 1, f) == 1;
+        if (g < games) start += heights[g].size();
+    }
+    for (uint32_t g = 0; g < games && ok; g++)
+        ok = heights[g].empty() || fwrite(heights[g].data(), 1, heights[g].size(), f) == heights[g].size();
+    return fclose(f) == 0 && ok;
+}
+
+/* Bot games at a per-game pace between 1 and 3 pieces per second */
+static int generate(int count, const char* dir, int pieces, int threads) {
+    std::atomic<int> next(0), failed(0);
+    std::vector<std::thread> pool;
+    for (int t = 0; t < threads; t++)
+        pool.emplace_back([&] {
+            EvalCache* cache = eval_cache_create(16u << 20);
+            for (int i; (i = next++) < count;) {
+                uint32_t seed = 0x9e3779b9u * (uint32_t)(i + 1);
+                double pps = 1.0 + (seed >> 8) % 2000 / 1000.0;
+                GameState s;
+                state_init(&s, seed);
+                Replay r;
+                replay_begin(&r, seed);
+                while (!s.game_over && s.pieces_placed < pieces) {
+                    BotMove mv;
+                    if (!bot_search(&s, &bot_default_weights, 1, cache, &mv)) break;
+                    uint32_t at = (uint32_t)((s.pieces_placed + 1) * 1000.0 / pps);
+                    if (!replay_add(&r, at, mv.use_hold, mv.place.rot, mv.place.x, mv.place.y)) break;
+                    bot_apply(&s, &mv);
+                }
+                uint32_t end = r.header.moves ? r.move[r.header.moves - 1].t_ms : 0;
+                replay_finish(&r, &s, end + 500);
+                char path[1024];
+                snprintf(path, sizeof(path), "%s/game%06d.rep", dir, i);
+                if (!replay_save(&r, path)) failed++;
+                replay_free(&r);
+            }
+            eval_cache_destroy(cache);
+        });
+    for (auto& t : pool) t.join();
+    if (failed) fprintf(stderr, "%d replays could not be written to %s\n", failed.load(), dir);
+    else printf("recorded %d games in %s\n", count, dir);
+    return failed ? 1 : 0;
+}
+
+static int read_list(const char* path) {
+    FILE* f = fopen(path, "r");
+    if (!f) return 0;
+    char line[4096];
+    while (fgets(line, sizeof(line), f)) {
+        size_t n = strcspn(line, "\r\n");
+        line[n] = 0;
+        if (n) files.push_back(line);
+    }
+    fclose(f);
+    return 1;
+}
+
+int main(int argc, char** argv) {
+    const char* out_path = "replay_stats.tan";
+    const char* dir = ".";
+    int threads = (int)std::thread::hardware_concurrency();
+    int generate_count = 0, pieces = 400;
+
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        const char* v = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!strcmp(a, "--help")) { usage(); return 0; }
+        if (a[0] != '-') { files.push_back(a); continue; }
+        if (!v) { usage(); return 1; }
+        if (!strcmp(a, "--list")) {
+            if (!read_list(v)) {
+                fprintf(stderr, "cannot read %s\n", v);
+                return 1;
+            }
+        } else if (!strcmp(a, "--out")) out_path = v;
+        else if (!strcmp(a, "--threads")) threads = atoi(v);
+        else if (!strcmp(a, "--generate")) generate_count = atoi(v);
+        else if (!strcmp(a, "--dir")) dir = v;
+        else if (!strcmp(a, "--pieces")) pieces = atoi(v);
+        else { usage(); return 1; }
+        i++;
+    }
+    if (threads < 1) threads = 1;
+    if (generate_count > 0) return generate(generate_count, dir, pieces, threads);
+    if (files.empty()) {
+        usage();
+        return 1;
+    }
+
+    stats.resize(files.size());
+    heights.resize(files.size());
+    std::vector<WorkerTotals> totals(threads);
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<std::thread> pool;
+    for (int t = 0; t < threads; t++) {
+        memset(&totals[t], 0, sizeof(WorkerTotals));
+        pool.emplace_back(worker, &totals[t]);
+    }
+    for (auto& t : pool) t.join();
+    double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    WorkerTotals total;
+    memset(&total, 0, sizeof(total));
+    for (const WorkerTotals& t : totals) {
+        for (int p = 0; p < 7; p++)
+            for (int y = 0; y < HEIGHT; y++)
+                for (int x = 0; x < WIDTH; x++) total.heat[p][y][x] += t.heat[p][y][x];
+        for (int c = 0; c < 5; c++) total.clears[c] += t.clears[c];
+        total.moves += t.moves;
+        total.bytes += t.bytes;
+    }
+    size_t good = 0;
+    double pps = 0, lpm = 0, apm = 0;
+    for (const GameStats& g : stats) {
+        if (!g.ok) continue;
+        good++;
+        pps += g.pps;
+        lpm += g.lpm;
+        apm += g.apm;
+    }
+    printf("%zu games (%zu unreadable or not matching their score), %llu moves, %.1f MB on %d threads\n",
+           files.size(), files.size() - good, (unsigned long long)total.moves, total.bytes / 1e6, threads);
+    printf("%.3f s: %.0f games/s, %.0f moves/s\n", s, files.size() / s, total.moves / s);
+    if (good)
+        printf("per game mean: %.2f pieces/s, %.1f lines/min, %.1f attack/min\n", pps / good, lpm / good, apm / good);
+    uint64_t locks = 0;
+    for (int c = 0; c < 5; c++) locks += total.clears[c];
+    if (locks)
+        printf("locks clearing 0-4 lines: %.1f%% %.1f%% %.1f%% %.1f%% %.1f%%\n", 100.0 * total.clears[0] / locks,
+               100.0 * total.clears[1] / locks, 100.0 * total.clears[2] / locks, 100.0 * total.clears[3] / locks,
+               100.0 * total.clears[4] / locks);
+    if (!write_results(out_path, &total)) {
+        fprintf(stderr, "cannot write %s\n", out_path);
+        return 1;
+    }
+    printf("wrote %s\n", out_path);
+    return good == files.size() ? 0 : 1;
+}
@@ -0,0 +1,70 @@
+#include "tetris_rollback.h"
+#include <string.h>
+
+void rollback_init(RollbackSession* r, const VersusConfig* cfg, int players, uint32_t seed, int local) {
+    memset(r, 0, sizeof(*r));
+    versus_init(&r->match, cfg, players, seed);
+    r->local = local;
+}
+
+int rollback_add_input(RollbackSession* r, int player, uint32_t frame, unsigned input) {
+    if (frame < r->known[player]) return 1;
+    if (frame > r->known[player] || frame >= r->frame + ROLLBACK_INPUTS / 2) return 0;
+    r->input[frame % ROLLBACK_INPUTS][player] = (uint8_t)input;
+    r->known[player] = frame + 1;
+    /* Frames already run used the prediction */
+    if (frame < r->frame && r->used[frame % ROLLBACK_WINDOW][player] != (uint8_t)input &&
+        frame < r->replay_from)
+        r->replay_from = frame;
+    return 1;
+}
+
+int rollback_ready(const RollbackSession* r) {
+    for (int i = 0; i < r->match.players; i++)
+        if ((int32_t)(r->frame - r->known[i]) >= ROLLBACK_WINDOW) return 0;
+    return 1;
+}
+
+/* Saves, then runs frame with real inputs where known and nothing where not */
+static void run_frame(RollbackSession* r, uint32_t frame) {
+    unsigned in[VERSUS_MAX_PLAYERS];
+    uint8_t* used = r->used[frame % ROLLBACK_WINDOW];
+    versus_copy(&r->saved[frame % ROLLBACK_WINDOW], &r->match);
+    for (int i = 0; i < r->match.players; i++) {
+        in[i] = frame < r->known[i] ? r->input[frame % ROLLBACK_INPUTS][i] : 0;
+        used[i] = (uint8_t)in[i];
+    }
+    versus_step(&r->match, in);
+}
+
+int rollback_resolve(RollbackSession* r) {
+    if (r->replay_from >= r->frame) return 0;
+    int depth = (int)(r->frame - r->replay_from);
+    versus_copy(&r->match, &r->saved[r->replay_from % ROLLBACK_WINDOW]);
+    for (uint32_t f = r->replay_from; f < r->frame; f++) run_frame(r, f);
+    r->rollbacks++;
+    r->resimulated += (uint32_t)depth;
+    if ((uint32_t)depth > r->max_depth) r->max_depth = (uint32_t)depth;
+    r->replay_from = r->frame;
+    return depth;
+}
+
+int rollback_advance(RollbackSession* r) {
+    if (!rollback_ready(r) || r->known[r->local] <= r->frame) return 0;
+    rollback_resolve(r);
+    run_frame(r, r->frame);
+    r->frame++;
+    r->replay_from = r->frame;
+    return 1;
+}
+
+uint32_t rollback_confirmed(const RollbackSession* r) {
+    uint32_t confirmed = r->frame;
+    for (int i = 0; i < r->match.players; i++)
+        if (r->known[i] < confirmed) confirmed = r->known[i];
+    return confirmed;
+}
+
+unsigned rollback_input(const RollbackSession* r, int player, uint32_t frame) {
+    return r->input[frame % ROLLBACK_INPUTS][player];
+}
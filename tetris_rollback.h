@@ -0,0 +1,53 @@
+#ifndef TETRIS_ROLLBACK_H
+#define TETRIS_ROLLBACK_H
+
+/* Rollback for online versus. Every peer runs the whole match; remote
+   players whose input for a frame has not arrived are predicted to press
+   nothing, which is right for most frames of a tap-driven game. When a
+   real input turns out different, the match is restored to the state
+   saved before that frame and stepped forward again with what is now
+   known. Saving is versus_copy into a ring slot, so a frame costs one
+   copy of the boards in play and never allocates.
+
+   Remote inputs arrive in frame order per player (the transport resends
+   until acked), so "known" is just a count per player. A peer may run at
+   most ROLLBACK_WINDOW frames past the oldest input it is missing.
+   Portable. */
+
+#include <stdint.h>
+#include "tetris_versus.h"
+
+#define ROLLBACK_WINDOW 16
+#define ROLLBACK_INPUTS (ROLLBACK_WINDOW * 4)   /* input ring, past and future */
+
+typedef struct {
+    VersusMatch match;            /* state at the start of frame */
+    uint32_t frame;               /* keeps counting after the match is over */
+    int local;
+    uint32_t known[VERSUS_MAX_PLAYERS];         /* inputs held for frames below this */
+    uint8_t input[ROLLBACK_INPUTS][VERSUS_MAX_PLAYERS];
+    uint8_t used[ROLLBACK_WINDOW][VERSUS_MAX_PLAYERS];  /* what each frame ran with */
+    VersusMatch saved[ROLLBACK_WINDOW];         /* state at the start of each frame */
+    uint32_t replay_from;         /* earliest mispredicted frame, or frame */
+    /* Counters */
+    uint32_t rollbacks, resimulated, max_depth, stalls;
+} RollbackSession;
+
+/* The session is large; callers keep it in static or heap storage */
+void rollback_init(RollbackSession* r, const VersusConfig* cfg, int players, uint32_t seed, int local);
+/* Inputs a player pressed on a frame; frames the session already holds
+   are ignored. Returns 0 for a gap or a frame too far ahead. */
+int rollback_add_input(RollbackSession* r, int player, uint32_t frame, unsigned input);
+/* Whether frame can run without predicting past the window */
+int rollback_ready(const RollbackSession* r);
+/* Replays from the earliest misprediction, if any; returns frames redone */
+int rollback_resolve(RollbackSession* r);
+/* Resolves, then steps one frame. The local input for frame must already
+   be added. Returns 0 when not ready. */
+int rollback_advance(RollbackSession* r);
+/* Frames below this ran with real inputs for everyone */
+uint32_t rollback_confirmed(const RollbackSession* r);
+/* The input recorded for a player's frame, for resending */
+unsigned rollback_input(const RollbackSession* r, int player, uint32_t frame);
+
+#endif /* TETRIS_ROLLBACK_H */
@@ -0,0 +1,316 @@
+// Rollback test - two bot peers play versus over loopback UDP through an
+// impairment shim (loss, latency, jitter) and must finish with identical
+// matches; --bench instead times rollbacks of a fixed depth offline
+// Build: g++ -O2 -std=c++17 -pthread tetris_rollback_bench.cpp tetris_rollback.cpp tetris_versus.cpp tetris_net.cpp tetris_bot.cpp tetris_eval_cache.cpp tetris_core.cpp -o tetris_rollback_bench
+//        POSIX only (UDP sockets, poll)
+// Usage: tetris_rollback_bench --frames 1200 --loss 5 --latency 40 --jitter 20
+//        tetris_rollback_bench --bench 20000 --depth 10
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "tetris_bot.h"
+#include "tetris_net.h"
+#include "tetris_rollback.h"
+
+#define PEERS 2
+
+/* A datagram held back by the shim */
+typedef struct {
+    uint64_t due_us;
+    uint32_t order;               /* keeps equal due times in send order */
+    size_t len;
+    uint8_t data[NET_MESSAGE_MAX];
+} Delayed;
+
+/* Impairs one direction: drops, then delays by latency plus uniform jitter,
+   which also reorders */
+typedef struct {
+    std::vector<Delayed> queue;   /* min-heap on due_us */
+    uint32_t rng, order;
+    uint64_t sent, dropped;
+} Shim;
+
+typedef struct {
+    int index;
+    int fd;
+    Shim shim;
+    RollbackSession* session;
+    std::vector<double> resolve_us;   /* per rollback */
+    std::vector<int> resolve_depth;
+    uint32_t stall_frames;
+    uint64_t stall_us;
+    int done;
+} Peer;
+
+static struct timespec clock_base;
+static uint32_t frames = 1200;
+static int loss_pct = 0;
+static int latency_ms = 30;
+static int jitter_ms = 10;
+static uint32_t seed = 1;
+static VersusConfig config;
+static std::atomic<int> finished(0);
+
+static uint64_t now_us(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)(t.tv_sec - clock_base.tv_sec) * 1000000 + (t.tv_nsec - clock_base.tv_nsec) / 1000;
+}
+
+static void usage(void) {
+    printf("Usage: tetris_rollback_bench [options]\n"
+           "  --frames N      frames to play over UDP (default 1200)\n"
+           "  --loss PCT      datagrams dropped each way (default 0)\n"
+           "  --latency MS    one-way delay (default 30)\n"
+           "  --jitter MS     extra random delay up to this (default 10)\n"
+           "  --port N        first of two loopback ports (default 7301)\n"
+           "  --seed N        match seed (default 1)\n"
+           "  --bench N       instead time N frames offline, the remote --depth frames late\n"
+           "  --depth N       rollback depth for --bench (default 10, below %d)\n", ROLLBACK_WINDOW);
+}
+
+static bool later(const Delayed& a, const Delayed& b) {
+    return a.due_us != b.due_us ? a.due_us > b.due_us : a.order > b.order;
+}
+
+static void shim_send(Shim* sh, uint64_t now, const uint8_t* data, size_t len) {
+    sh->sent++;
+    if ((int)(rng_next(&sh->rng) % 100) < loss_pct) {
+        sh->dropped++;
+        return;
+    }
+    Delayed d;
+    d.due_us = now + (uint64_t)latency_ms * 1000;
+    if (jitter_ms > 0) d.due_us += rng_next(&sh->rng) % ((uint32_t)jitter_ms * 1000 + 1);
+    d.order = sh->order++;
+    d.len = len;
+    memcpy(d.data, data, len);
+    sh->queue.push_back(d);
+    std::push_heap(sh->queue.begin(), sh->queue.end(), later);
+}
+
+/* Sends what is due; returns when the next datagram is, or 0 */
+static uint64_t shim_flush(Shim* sh, int fd, uint64_t now) {
+    while (!sh->queue.empty() && sh->queue.front().due_us <= now) {
+        const Delayed& d = sh->queue.front();
+        send(fd, d.data, d.len, 0);
+        std::pop_heap(sh->queue.begin(), sh->queue.end(), later);
+        sh->queue.pop_back();
+    }
+    return sh->queue.empty() ? 0 : sh->queue.front().due_us;
+}
+
+static void receive(Peer* p, uint32_t* peer_ack) {
+    uint8_t buf[NET_MESSAGE_MAX];
+    ssize_t n;
+    while ((n = recv(p->fd, buf, sizeof(buf), 0)) > 0) {
+        int type, count;
+        const uint8_t *payload, *inputs;
+        size_t len;
+        uint32_t first, ack;
+        if (net_frame(buf, (size_t)n, &type, &payload, &len) != n || type != NET_INPUTS ||
+            !net_get_inputs(payload, len, &first, &ack, &inputs, &count))
+            continue;
+        for (int k = 0; k < count; k++) rollback_add_input(p->session, 1 - p->index, first + k, inputs[k]);
+        if (ack > *peer_ack) *peer_ack = ack;
+    }
+}
+
+/* Everything the peer has not acked, oldest first */
+static void send_inputs(Peer* p, uint32_t peer_ack, uint64_t now) {
+    RollbackSession* r = p->session;
+    uint8_t inputs[NET_INPUTS_MAX], out[NET_MESSAGE_MAX];
+    uint32_t first = peer_ack, end = r->known[p->index];
+    int count = 0;
+    for (uint32_t f = first; f < end && count < NET_INPUTS_MAX; f++)
+        inputs[count++] = (uint8_t)rollback_input(r, p->index, f);
+    size_t len = net_put_inputs(out, first, r->known[1 - p->index], inputs, count);
+    shim_send(&p->shim, now, out, len);
+}
+
+static void run_peer(Peer* p) {
+    RollbackSession* r = p->session;
+    BotPilot pilot;
+    memset(&pilot, 0, sizeof(pilot));
+    uint32_t peer_ack = 0;
+    uint64_t frame_us = (uint64_t)config.frame_ms * 1000;
+    uint64_t next_frame = now_us(), next_send = next_frame, stalled_since = 0;
+
+    while (finished.load() < PEERS) {
+        uint64_t now = now_us();
+        receive(p, &peer_ack);
+        if (r->frame < frames && now >= next_frame) {
+            if (r->known[p->index] == r->frame) {
+                int in = bot_pilot_input(&pilot, &r->match.p[p->index].game, &bot_default_weights);
+                rollback_add_input(r, p->index, r->frame, in < 0 ? 0 : VERSUS_INPUT(in));
+            }
+            if (rollback_ready(r)) {
+                uint64_t t0 = now_us();
+                int depth = rollback_resolve(r);
+                if (depth) {
+                    p->resolve_us.push_back((double)(now_us() - t0));
+                    p->resolve_depth.push_back(depth);
+                }
+                rollback_advance(r);
+                next_frame += frame_us;
+                if (stalled_since) {
+                    /* Resume the pace rather than racing to catch up */
+                    p->stall_us += now - stalled_since;
+                    stalled_since = 0;
+                    next_frame = now + frame_us;
+                }
+                next_send = now;
+            } else if (!stalled_since) {
+                /* Too far ahead of the peer: wait for its inputs */
+                stalled_since = now;
+                p->stall_frames++;
+            }
+        }
+        if (r->frame >= frames && !p->done) {
+            rollback_resolve(r);
+            if (rollback_confirmed(r) >= frames && peer_ack >= frames) {
+                p->done = 1;
+                finished++;
+            }
+        }
+        if (now >= next_send) {
+            send_inputs(p, peer_ack, now);
+            next_send = now + frame_us;
+        }
+        uint64_t wake = next_send;
+        if (r->frame < frames && !stalled_since) wake = std::min(wake, next_frame);
+        uint64_t due = shim_flush(&p->shim, p->fd, now);
+        if (due && due < wake) wake = due;
+        struct pollfd pfd = { p->fd, POLLIN, 0 };
+        now = now_us();
+        poll(&pfd, 1, wake > now ? (int)((wake - now + 999) / 1000) : 0);
+    }
+}
+
+static double pct(std::vector<double> v, double q) {
+    if (v.empty()) return 0.0;
+    std::sort(v.begin(), v.end());
+    return v[std::min(v.size() - 1, (size_t)(v.size() * q / 100.0))];
+}
+
+/* A truth match with both bots, fed to a session that hears the remote
+   depth frames late, so nearly every remote press is a depth rollback */
+static int bench(uint32_t count, int depth) {
+    static RollbackSession session;
+    static VersusMatch truth;
+    BotPilot pilot[PEERS];
+    std::vector<unsigned> remote;
+    std::vector<double> times;
+    memset(pilot, 0, sizeof(pilot));
+    rollback_init(&session, &config, PEERS, seed, 0);
+    versus_init(&truth, &config, PEERS, seed);
+
+    for (uint32_t f = 0; f < count; f++) {
+        unsigned in[PEERS];
+        for (int i = 0; i < PEERS; i++) {
+            int k = bot_pilot_input(&pilot[i], &truth.p[i].game, &bot_default_weights);
+            in[i] = k < 0 ? 0 : VERSUS_INPUT(k);
+        }
+        versus_step(&truth, in);
+        remote.push_back(in[1]);
+        rollback_add_input(&session, 0, f, in[0]);
+        if (f >= (uint32_t)depth) rollback_add_input(&session, 1, f - depth, remote[f - depth]);
+        uint64_t t0 = now_us();
+        int d = rollback_resolve(&session);
+        if (d == depth) times.push_back((double)(now_us() - t0));
+        rollback_advance(&session);
+    }
+    for (uint32_t f = count >= (uint32_t)depth ? count - depth : 0; f < count; f++)
+        rollback_add_input(&session, 1, f, remote[f]);
+    rollback_resolve(&session);
+
+    int same = versus_hash(&session.match) == versus_hash(&truth);
+    printf("%u frames, remote %d frames late: %u rollbacks, %u frames resimulated\n", count, depth,
+           session.rollbacks, session.resimulated);
+    printf("depth %d rollback us: p50 %.1f p99 %.1f max %.1f (%zu samples)\n", depth, pct(times, 50),
+           pct(times, 99), pct(times, 100), times.size());
+    printf("match after the last rollback %s the match without prediction\n", same ? "equals" : "DIFFERS FROM");
+    return same ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    int port = 7301, bench_frames = 0, depth = 10;
+    clock_gettime(CLOCK_MONOTONIC, &clock_base);
+    versus_config_default(&config);
+
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        const char* v = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!strcmp(a, "--help")) { usage(); return 0; }
+        if (!v) { usage(); return 1; }
+        if (!strcmp(a, "--frames")) frames = (uint32_t)strtoul(v, NULL, 10);
+        else if (!strcmp(a, "--loss")) loss_pct = atoi(v);
+        else if (!strcmp(a, "--latency")) latency_ms = atoi(v);
+        else if (!strcmp(a, "--jitter")) jitter_ms = atoi(v);
+        else if (!strcmp(a, "--port")) port = atoi(v);
+        else if (!strcmp(a, "--seed")) seed = (uint32_t)strtoul(v, NULL, 10);
+        else if (!strcmp(a, "--bench")) bench_frames = atoi(v);
+        else if (!strcmp(a, "--depth")) depth = atoi(v);
+        else { usage(); return 1; }
+        i++;
+    }
+    if (bench_frames > 0) {
+        if (depth < 1 || depth >= ROLLBACK_WINDOW) { usage(); return 1; }
+        return bench((uint32_t)bench_frames, depth);
+    }
+    if (loss_pct >= 100) { usage(); return 1; }
+
+    static Peer peers[PEERS];
+    static RollbackSession sessions[PEERS];
+    char addr[PEERS][32];
+    for (int i = 0; i < PEERS; i++) snprintf(addr[i], sizeof(addr[i]), "127.0.0.1:%d", port + i);
+    for (int i = 0; i < PEERS; i++) {
+        Peer* p = &peers[i];
+        p->index = i;
+        p->fd = net_udp(addr[i], addr[1 - i]);
+        if (p->fd < 0) {
+            fprintf(stderr, "cannot open UDP %s\n", addr[i]);
+            return 1;
+        }
+        p->shim.rng = seed * 2654435761u + (uint32_t)i + 1;
+        p->session = &sessions[i];
+        rollback_init(p->session, &config, PEERS, seed, i);
+    }
+    printf("%u frames over loopback, %d%% loss, %d ms latency, %d ms jitter\n", frames, loss_pct, latency_ms,
+           jitter_ms);
+    uint64_t start = now_us();
+    std::thread other(run_peer, &peers[1]);
+    run_peer(&peers[0]);
+    other.join();
+    double elapsed = (now_us() - start) / 1e6;
+
+    for (int i = 0; i < PEERS; i++) {
+        Peer* p = &peers[i];
+        RollbackSession* r = p->session;
+        double per_frame = 0.0;
+        for (size_t k = 0; k < p->resolve_us.size(); k++) per_frame += p->resolve_us[k] / p->resolve_depth[k];
+        printf("peer %d: %u rollbacks, %u frames resimulated, max depth %u, %u stalls for %.1f ms, "
+               "%llu of %llu datagrams dropped\n",
+               i + 1, r->rollbacks, r->resimulated, r->max_depth, p->stall_frames, p->stall_us / 1000.0,
+               (unsigned long long)p->shim.dropped, (unsigned long long)p->shim.sent);
+        printf("        rollback us: p50 %.1f p99 %.1f max %.1f, %.2f us per resimulated frame\n",
+               pct(p->resolve_us, 50), pct(p->resolve_us, 99), pct(p->resolve_us, 100),
+               p->resolve_us.empty() ? 0.0 : per_frame / p->resolve_us.size());
+        close(p->fd);
+    }
+    const VersusMatch* m = &sessions[0].match;
+    int same = versus_hash(m) == versus_hash(&sessions[1].match);
+    printf("%.1f s; match %s", elapsed, m->over ? "over, " : "running, ");
+    if (m->over && m->winner >= 0) printf("peer %d won, ", m->winner + 1);
+    else if (m->over) printf("draw, ");
+    printf("peers %s\n", same ? "agree" : "DESYNCED");
+    return same ? 0 : 1;
+}
@@ -0,0 +1,579 @@
+// Headless game server - thousands of concurrent games over TCP or Unix
+// sockets, one per connection, on a few epoll worker threads
+// Build: g++ -O2 -std=c++17 -pthread tetris_server.cpp tetris_net.cpp tetris_wheel.cpp tetris_metrics.cpp tetris_leaderboard.cpp tetris_core.cpp -o tetris_server
+//        Linux only (epoll, timerfd)
+// Usage: tetris_server --listen unix:/tmp/tetris.sock --workers 2
+//        tetris_server --listen 127.0.0.1:7000 --games 20000 --metrics 9100
+//        tetris_server --scores tetris_scores   (record finished games)
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "tetris_leaderboard.h"
+#include "tetris_metrics.h"
+#include "tetris_net.h"
+#include "tetris_wheel.h"
+
+/* Every worker owns a slab of games, an epoll set and a timer wheel, and
+   all of them wait on the one listening socket (EPOLLEXCLUSIVE wakes just
+   one). Whoever accepts hands the socket to the worker with the fewest
+   games, and from then on the game lives entirely on that worker, so
+   nothing else is shared between workers but the metrics shards. That is
+   why the wheel is per worker rather than one shared wheel: a game's
+   timer is only ever armed, cancelled and fired by its own worker, so no
+   wheel operation needs a lock.
+
+   Each loop: read input and apply it at once, fire the gravity timers
+   that are due, then send one state per changed game. A state that does
+   not fit the socket stays pending and newer states wait behind it, so a
+   slow client costs one message of memory. */
+
+#define TICK_US 250               /* timer wheel resolution */
+#define LATENCY_BUCKETS 100000    /* 1 us each */
+#define EVENTS_PER_WAIT 512
+#define LISTEN_ID 0xffffffffu
+#define TIMER_ID 0xfffffffeu
+#define HANDOFF_ID 0xfffffffdu
+
+typedef struct {
+    GameState state;
+    int fd;                       /* -1 when the slot is free */
+    int started;                  /* got its NET_HELLO */
+    uint32_t tick, ack;
+    uint32_t seed;
+    uint64_t started_us;
+    uint64_t due_us;              /* next gravity step */
+    uint64_t tick_due_us;         /* oldest unsent step, 0 if none */
+    int changed, listed;          /* state unsent / on the dirty list */
+    int32_t next_dirty;
+    int in_len, out_off, out_len;
+    uint8_t in[64];
+    uint8_t out[NET_STATE_MAX];
+} Game;
+
+struct Worker {
+    int epfd, tfd, efd;
+    std::atomic<int> load;        /* games open or handed over */
+    std::mutex handoff_mutex;
+    std::vector<int> handoff;     /* sockets accepted for us elsewhere */
+    Game* games;
+    WheelNode* nodes;
+    int32_t* free_slots;
+    int free_count, capacity;
+    TimerWheel wheel;
+    int32_t dirty_head;
+    uint64_t timer_tick;          /* wheel tick the timerfd is set for */
+    uint64_t latency[LATENCY_BUCKETS];
+    uint64_t latency_max_us;
+    uint64_t ticks, inputs, sent, accepted, rejected;
+};
+
+static std::atomic<int> stopping(0);
+static int listen_fd = -1;
+static Leaderboard* scores = NULL;
+static std::vector<Worker*> pool;
+static struct timespec clock_base;
+
+static uint64_t now_us(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)(t.tv_sec - clock_base.tv_sec) * 1000000 + (t.tv_nsec - clock_base.tv_nsec) / 1000;
+}
+
+static void on_signal(int sig) {
+    (void)sig;
+    stopping.store(1);
+}
+
+static void usage(void) {
+    printf("Usage: tetris_server [options]\n"
+           "  --listen ADDR    unix:/path or host:port (default unix:/tmp/tetris.sock)\n"
+           "  --workers N      worker threads (default 2)\n"
+           "  --games N        game slots per worker (default 8000)\n"
+           "  --seconds N      stop after N seconds (default: run until interrupted)\n"
+           "  --metrics PORT   serve live counters on http://127.0.0.1:PORT/metrics\n"
+           "  --scores DIR     record finished games on the leaderboard in DIR\n");
+}
+
+typedef struct {
+    int games, connections, rejected, inputs, bytes_sent, ticks, latency;
+} ServerSeries;
+
+static ServerSeries register_server_series(void) {
+    static const double latency_bounds[] = { 50, 100, 250, 500, 750, 1000, 2000, 5000, 10000 };
+    ServerSeries m;
+    m.games = metrics_gauge("tetris_active_games", "", "Games being simulated");
+    m.connections = metrics_counter("tetris_server_connections_total", "", "Connections accepted");
+    m.rejected = metrics_counter("tetris_server_rejected_total", "", "Connections refused for want of a slot");
+    m.inputs = metrics_counter("tetris_server_inputs_total", "", "Inputs received");
+    m.bytes_sent = metrics_counter("tetris_server_bytes_sent_total", "", "State bytes written to clients");
+    m.ticks = metrics_counter("tetris_ticks_total", "", "Gravity steps");
+    m.latency = metrics_histogram("tetris_server_tick_latency_us", "",
+                                  "Gravity deadline to its state being written", latency_bounds, 9);
+    return m;
+}
+
+static const ServerSeries& series(void) {
+    static const ServerSeries m = register_server_series();
+    return m;
+}
+
+static void mark_changed(Worker* w, int id) {
+    Game* g = &w->games[id];
+    g->changed = 1;
+    if (g->listed || g->out_off < g->out_len) return;
+    g->listed = 1;
+    g->next_dirty = w->dirty_head;
+    w->dirty_head = id;
+}
+
+static void close_game(Worker* w, int id) {
+    Game* g = &w->games[id];
+    if (g->fd < 0) return;
+    wheel_cancel(&w->wheel, id);
+    close(g->fd);
+    g->fd = -1;
+    if (g->started) metrics_gauge_add(series().games, -1);
+    g->started = 0;
+    w->free_slots[w->free_count++] = id;   /* a listed slot is skipped by flush */
+    w->load.fetch_sub(1, std::memory_order_relaxed);
+}
+
+static void note_latency(Worker* w, uint64_t us) {
+    if (us > w->latency_max_us) w->latency_max_us = us;
+    w->latency[us < LATENCY_BUCKETS ? us : LATENCY_BUCKETS - 1]++;
+    metrics_observe(series().latency, (double)us);
+}
+
+/* Writes what is pending; returns 0 if the connection is gone */
+static int write_pending(Worker* w, int id) {
+    Game* g = &w->games[id];
+    while (g->out_off < g->out_len) {
+        ssize_t n = send(g->fd, g->out + g->out_off, g->out_len - g->out_off, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        if (n <= 0) return 0;
+        g->out_off += (int)n;
+        metrics_add(series().bytes_sent, (uint64_t)n);
+    }
+    if (g->out_off < g->out_len) return 1;
+    w->sent++;
+    if (g->tick_due_us) {
+        note_latency(w, now_us() - g->tick_due_us);
+        g->tick_due_us = 0;
+    }
+    return 1;
+}
+
+static void watch(Worker* w, int id, uint32_t events) {
+    struct epoll_event ev;
+    ev.events = events;
+    ev.data.u32 = (uint32_t)id;
+    epoll_ctl(w->epfd, EPOLL_CTL_MOD, w->games[id].fd, &ev);
+}
+
+/* One state per changed game, written straight away */
+static void flush_dirty(Worker* w) {
+    while (w->dirty_head >= 0) {
+        int id = w->dirty_head;
+        Game* g = &w->games[id];
+        w->dirty_head = g->next_dirty;
+        g->listed = 0;
+        if (g->fd < 0 || !g->changed || g->out_off < g->out_len) continue;
+        g->out_len = (int)net_put_state(g->out, &g->state, g->tick, g->ack);
+        g->out_off = 0;
+        g->changed = 0;
+        if (!write_pending(w, id)) close_game(w, id);
+        else if (g->out_off < g->out_len) watch(w, id, EPOLLIN | EPOLLOUT);
+    }
+}
+
+static void on_writable(Worker* w, int id) {
+    Game* g = &w->games[id];
+    if (!write_pending(w, id)) {
+        close_game(w, id);
+        return;
+    }
+    if (g->out_off < g->out_len) return;
+    watch(w, id, EPOLLIN);
+    if (g->changed) mark_changed(w, id);
+}
+
+/* The protocol has no player names, so games are filed under their seed */
+static void record_game(const Game* g) {
+    if (!scores) return;
+    char player[LB_NAME_MAX];
+    snprintf(player, sizeof(player), "seed-%u", g->seed);
+    ScoreRecord r;
+    lb_record_game(&r, player, &g->state, g->seed, (uint32_t)((now_us() - g->started_us) / 1000));
+    lb_insert(scores, &r);
+}
+
+/* Call after anything that can end the game, with game_over as it was
+   before: a game that has just ended stops its gravity, until the client
+   says hello again, and is recorded exactly once */
+static void check_game_over(Worker* w, int id, int was_over) {
+    Game* g = &w->games[id];
+    if (was_over || !g->state.game_over) return;
+    wheel_cancel(&w->wheel, id);
+    record_game(g);
+}
+
+static void schedule(Worker* w, int id) {
+    Game* g = &w->games[id];
+    wheel_add(&w->wheel, id, (g->due_us + TICK_US - 1) / TICK_US);
+}
+
+static void on_timer(int id, uint64_t due, void* ctx) {
+    (void)due;
+    Worker* w = (Worker*)ctx;
+    Game* g = &w->games[id];
+    uint64_t now = now_us();
+    if (now < g->due_us) {            /* the wheel fired early for a slot */
+        schedule(w, id);
+        return;
+    }
+    int was_over = g->state.game_over;
+    if (was_over) return;             /* its timer was cancelled as it ended */
+    int placed = g->state.pieces_placed, lines = g->state.lines_total;
+    state_tick(&g->state);
+    metrics_game_step(&g->state, placed, lines);
+    metrics_add(series().ticks, 1);
+    w->ticks++;
+    g->tick++;
+    if (!g->tick_due_us) g->tick_due_us = g->due_us;
+    mark_changed(w, id);
+    if (g->state.game_over) {
+        check_game_over(w, id, was_over);
+        return;
+    }
+    g->due_us += (uint64_t)g->state.speed_ms * 1000;
+    if (g->due_us <= now) g->due_us = now + (uint64_t)g->state.speed_ms * 1000;   /* no burst */
+    schedule(w, id);
+}
+
+static void on_message(Worker* w, int id, int type, const uint8_t* p, size_t n) {
+    Game* g = &w->games[id];
+    if (type == NET_HELLO) {
+        uint32_t seed;
+        int level;
+        if (!net_get_hello(p, n, &seed, &level)) return;
+        state_init(&g->state, seed);
+        g->seed = seed;
+        g->started_us = now_us();
+        if (level > 1) {
+            g->state.level = level;
+            g->state.speed_ms = speed_for_level(level);
+        }
+        if (!g->started) metrics_gauge_add(series().games, 1);
+        g->started = 1;
+        g->tick = 0;                   /* ack carries on across restarts */
+        g->tick_due_us = 0;
+        g->due_us = now_us() + (uint64_t)g->state.speed_ms * 1000;
+        schedule(w, id);
+        mark_changed(w, id);
+    } else if (type == NET_INPUT) {
+        uint32_t seq;
+        int input;
+        if (!g->started || !net_get_input(p, n, &seq, &input)) return;
+        w->inputs++;
+        metrics_add(series().inputs, 1);
+        int placed = g->state.pieces_placed, lines = g->state.lines_total;
+        int was_over = g->state.game_over;
+        if (!was_over && state_input(&g->state, input)) {
+            metrics_game_step(&g->state, placed, lines);
+            check_game_over(w, id, was_over);
+        }
+        g->ack = seq;
+        mark_changed(w, id);
+    } else if (type == NET_BYE) {
+        close_game(w, id);
+    }
+}
+
+static void on_readable(Worker* w, int id) {
+    Game* g = &w->games[id];
+    for (;;) {
+        ssize_t n = recv(g->fd, g->in + g->in_len, sizeof(g->in) - g->in_len, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+        if (n <= 0) {
+            close_game(w, id);
+            return;
+        }
+        g->in_len += (int)n;
+        int used = 0;
+        for (;;) {
+            int type;
+            const uint8_t* payload;
+            size_t len;
+            int size = net_frame(g->in + used, g->in_len - used, &type, &payload, &len);
+            if (size < 0) {
+                close_game(w, id);
+                return;
+            }
+            if (size == 0) break;
+            on_message(w, id, type, payload, len);
+            if (g->fd < 0) return;
+            used += size;
+        }
+        memmove(g->in, g->in + used, g->in_len - used);
+        g->in_len -= used;
+    }
+}
+
+static void adopt_game(Worker* w, int fd) {
+    if (!w->free_count) {
+        w->rejected++;
+        w->load.fetch_sub(1, std::memory_order_relaxed);
+        metrics_add(series().rejected, 1);
+        close(fd);
+        return;
+    }
+    int id = w->free_slots[--w->free_count];
+    Game* g = &w->games[id];
+    g->fd = fd;
+    g->started = 0;
+    g->ack = 0;
+    g->changed = 0;                /* listed stays as it is */
+    g->in_len = g->out_off = g->out_len = 0;
+    g->tick_due_us = 0;
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.u32 = (uint32_t)id;
+    if (epoll_ctl(w->epfd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+        g->fd = -1;
+        w->free_slots[w->free_count++] = id;
+        w->load.fetch_sub(1, std::memory_order_relaxed);
+        close(fd);
+        return;
+    }
+    w->accepted++;
+}
+
+/* Whichever worker wakes accepts; the least loaded one gets the game */
+static void accept_games(Worker* w) {
+    for (;;) {
+        int fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) return;
+        metrics_add(series().connections, 1);
+        Worker* to = w;
+        for (Worker* o : pool)
+            if (o->load.load(std::memory_order_relaxed) < to->load.load(std::memory_order_relaxed)) to = o;
+        to->load.fetch_add(1, std::memory_order_relaxed);
+        if (to == w) {
+            adopt_game(w, fd);
+            continue;
+        }
+        {
+            std::lock_guard<std::mutex> lock(to->handoff_mutex);
+            to->handoff.push_back(fd);
+        }
+        uint64_t one = 1;
+        if (write(to->efd, &one, sizeof(one)) < 0) { /* counter full: already signalled */ }
+    }
+}
+
+static void adopt_handoffs(Worker* w) {
+    uint64_t count;
+    if (read(w->efd, &count, sizeof(count)) < 0) return;
+    std::vector<int> fds;
+    {
+        std::lock_guard<std::mutex> lock(w->handoff_mutex);
+        fds.swap(w->handoff);
+    }
+    for (int fd : fds) adopt_game(w, fd);
+}
+
+/* Points the timerfd at the next wheel slot with a timer in it */
+static void arm_timer(Worker* w) {
+    uint64_t next = wheel_next(&w->wheel, WHEEL_SLOTS);
+    if (next == w->timer_tick) return;
+    w->timer_tick = next;
+    struct itimerspec its;
+    memset(&its, 0, sizeof(its));
+    if (next != UINT64_MAX) {
+        uint64_t ns = (uint64_t)clock_base.tv_nsec + next * TICK_US * 1000;
+        its.it_value.tv_sec = clock_base.tv_sec + (time_t)(ns / 1000000000);
+        its.it_value.tv_nsec = (long)(ns % 1000000000);
+    }
+    timerfd_settime(w->tfd, TFD_TIMER_ABSTIME, &its, NULL);
+}
+
+static int worker_init(Worker* w, int capacity) {
+    w->capacity = capacity;
+    w->games = (Game*)calloc((size_t)capacity, sizeof(Game));
+    w->nodes = (WheelNode*)calloc((size_t)capacity, sizeof(WheelNode));
+    w->free_slots = (int32_t*)malloc((size_t)capacity * sizeof(int32_t));
+    if (!w->games || !w->nodes || !w->free_slots) return 0;
+    metrics_note_alloc("game_slab", (size_t)capacity * (sizeof(Game) + sizeof(WheelNode) + sizeof(int32_t)));
+    for (int i = 0; i < capacity; i++) {
+        w->games[i].fd = -1;
+        w->free_slots[i] = capacity - 1 - i;
+    }
+    w->free_count = capacity;
+    w->dirty_head = -1;
+    w->timer_tick = UINT64_MAX;
+    wheel_init(&w->wheel, w->nodes, capacity, now_us() / TICK_US);
+
+    w->epfd = epoll_create1(EPOLL_CLOEXEC);
+    w->tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    w->efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (w->epfd < 0 || w->tfd < 0 || w->efd < 0) return 0;
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLEXCLUSIVE;
+    ev.data.u32 = LISTEN_ID;
+    if (epoll_ctl(w->epfd, EPOLL_CTL_ADD, listen_fd, &ev) != 0) return 0;
+    ev.events = EPOLLIN;
+    ev.data.u32 = HANDOFF_ID;
+    if (epoll_ctl(w->epfd, EPOLL_CTL_ADD, w->efd, &ev) != 0) return 0;
+    ev.data.u32 = TIMER_ID;
+    return epoll_ctl(w->epfd, EPOLL_CTL_ADD, w->tfd, &ev) == 0;
+}
+
+static void worker_main(Worker* w) {
+    struct epoll_event events[EVENTS_PER_WAIT];
+    while (!stopping.load(std::memory_order_relaxed)) {
+        int n = epoll_wait(w->epfd, events, EVENTS_PER_WAIT, 100);
+        for (int i = 0; i < n; i++) {
+            uint32_t id = events[i].data.u32;
+            if (id == LISTEN_ID) {
+                accept_games(w);
+            } else if (id == HANDOFF_ID) {
+                adopt_handoffs(w);
+            } else if (id == TIMER_ID) {
+                uint64_t expirations;
+                if (read(w->tfd, &expirations, sizeof(expirations)) < 0) { /* spurious */ }
+                w->timer_tick = UINT64_MAX;
+            } else {
+                Game* g = &w->games[id];
+                if (events[i].events & EPOLLOUT && g->fd >= 0 && g->out_off < g->out_len) on_writable(w, (int)id);
+                if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR) && g->fd >= 0)
+                    on_readable(w, (int)id);
+            }
+        }
+        wheel_advance(&w->wheel, now_us() / TICK_US, on_timer, w);
+        flush_dirty(w);
+        arm_timer(w);
+    }
+    for (int i = 0; i < w->capacity; i++) close_game(w, i);
+}
+
+static double percentile(const uint64_t* hist, uint64_t total, double pct) {
+    uint64_t rank = (uint64_t)(total * pct / 100.0), seen = 0;
+    for (int b = 0; b < LATENCY_BUCKETS; b++) {
+        seen += hist[b];
+        if (seen > rank) return b / 1000.0;
+    }
+    return LATENCY_BUCKETS / 1000.0;
+}
+
+int main(int argc, char** argv) {
+    const char* addr = "unix:/tmp/tetris.sock";
+    int workers = 2, games = 8000, seconds = 0, metrics_port = 0;
+    const char* scores_dir = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        const char* v = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!strcmp(a, "--help")) { usage(); return 0; }
+        if (!v) { usage(); return 1; }
+        if (!strcmp(a, "--listen")) addr = v;
+        else if (!strcmp(a, "--workers")) workers = atoi(v);
+        else if (!strcmp(a, "--games")) games = atoi(v);
+        else if (!strcmp(a, "--seconds")) seconds = atoi(v);
+        else if (!strcmp(a, "--metrics")) metrics_port = atoi(v);
+        else if (!strcmp(a, "--scores")) scores_dir = v;
+        else { usage(); return 1; }
+        i++;
+    }
+    if (workers < 1) workers = 1;
+    if (games < 1) games = 1;
+
+    clock_gettime(CLOCK_MONOTONIC, &clock_base);
+    long fd_limit = net_raise_fd_limit();
+    if (fd_limit > 0 && fd_limit < (long)workers * games + 64)
+        fprintf(stderr, "warning: open file limit %ld is below %d games\n", fd_limit, workers * games);
+    listen_fd = net_listen(addr);
+    if (listen_fd < 0) {
+        fprintf(stderr, "cannot listen on %s\n", addr);
+        return 1;
+    }
+    if (metrics_port > 0 && !metrics_serve_start(metrics_port)) {
+        fprintf(stderr, "cannot listen on port %d\n", metrics_port);
+        return 1;
+    }
+    /* Workers insert concurrently; each log shard is synced at most every 100 ms */
+    if (scores_dir && !(scores = lb_open(scores_dir, 100))) {
+        fprintf(stderr, "cannot open leaderboard %s\n", scores_dir);
+        return 1;
+    }
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    signal(SIGPIPE, SIG_IGN);
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < workers; i++) pool.push_back(new Worker());
+    for (int i = 0; i < workers; i++) {
+        if (!worker_init(pool[i], games)) {
+            fprintf(stderr, "cannot set up worker %d\n", i);
+            return 1;
+        }
+    }
+    printf("listening on %s, %d workers x %d games\n", addr, workers, games);
+    fflush(stdout);
+    uint64_t start = now_us();
+    for (int i = 0; i < workers; i++) threads.emplace_back(worker_main, pool[i]);
+    while (!stopping.load() && (!seconds || now_us() - start < (uint64_t)seconds * 1000000))
+        usleep(50000);
+    stopping.store(1);
+    for (std::thread& t : threads) t.join();
+    double elapsed = (now_us() - start) / 1e6;
+    metrics_serve_stop();
+    close(listen_fd);
+    if (!strncmp(addr, "unix:", 5)) unlink(addr + 5);
+
+    static uint64_t merged[LATENCY_BUCKETS];
+    uint64_t ticks = 0, inputs = 0, sent = 0, accepted = 0, rejected = 0, samples = 0, max_us = 0;
+    for (Worker* w : pool) {
+        ticks += w->ticks;
+        inputs += w->inputs;
+        sent += w->sent;
+        accepted += w->accepted;
+        rejected += w->rejected;
+        if (w->latency_max_us > max_us) max_us = w->latency_max_us;
+        for (int b = 0; b < LATENCY_BUCKETS; b++) {
+            merged[b] += w->latency[b];
+            samples += w->latency[b];
+        }
+    }
+    printf("%llu connections (%llu refused), %.1f s\n", (unsigned long long)accepted,
+           (unsigned long long)rejected, elapsed);
+    printf("%llu ticks (%.0f/s), %llu inputs (%.0f/s), %llu states sent (%.0f/s)\n",
+           (unsigned long long)ticks, ticks / elapsed, (unsigned long long)inputs, inputs / elapsed,
+           (unsigned long long)sent, sent / elapsed);
+    if (samples)
+        printf("tick latency ms: p50 %.3f p99 %.3f p999 %.3f max %.3f\n", percentile(merged, samples, 50),
+               percentile(merged, samples, 99), percentile(merged, samples, 99.9), max_us / 1000.0);
+    if (scores) {
+        LbStats st;
+        ScoreRecord top;
+        lb_stats(scores, &st);
+        if (lb_top(scores, &top, 1))
+            printf("%llu games recorded, best %lld by %.*s\n", (unsigned long long)st.inserts, (long long)top.score,
+                   LB_NAME_MAX, top.player);
+        lb_close(scores);
+    }
+    return 0;
+}
@@ -0,0 +1,182 @@
+#include "tetris_shm.h"
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <atomic>
+
+#define SHM_MAGIC 0x42485354u     /* "TSHB" */
+#define SHM_STATE_WORDS ((sizeof(ShmState) + 3) / 4)
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "the region is shared between processes");
+
+/* The snapshot is copied as relaxed atomic words between the seqlock
+   loads, which keeps overlapping copies well defined */
+typedef struct {
+    uint32_t magic;
+    uint32_t size;
+    alignas(64) std::atomic<uint32_t> seq;      /* odd while a publish is under way */
+    std::atomic<uint32_t> words[SHM_STATE_WORDS];
+    alignas(64) std::atomic<uint32_t> cmd_tail; /* bot */
+    alignas(64) std::atomic<uint32_t> cmd_head; /* engine */
+    ShmCommand cmds[SHM_COMMANDS];
+} ShmRegion;
+
+struct ShmBot {
+    ShmRegion* r;
+    char name[64];
+    int owner;
+    uint32_t tick;
+    uint64_t retries;
+};
+
+static ShmBot* map_region(const char* name, int create) {
+    if (strlen(name) >= sizeof(((ShmBot*)0)->name)) return NULL;
+    int fd = shm_open(name, create ? O_CREAT | O_RDWR | O_TRUNC : O_RDWR, 0600);
+    if (fd < 0) return NULL;
+    if (create && ftruncate(fd, sizeof(ShmRegion)) != 0) {
+        close(fd);
+        shm_unlink(name);
+        return NULL;
+    }
+    void* p = mmap(NULL, sizeof(ShmRegion), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    ShmBot* b = (ShmBot*)calloc(1, sizeof(ShmBot));
+    if (p == MAP_FAILED || !b) {
+        if (p != MAP_FAILED) munmap(p, sizeof(ShmRegion));
+        if (create) shm_unlink(name);
+        free(b);
+        return NULL;
+    }
+    b->r = (ShmRegion*)p;
+    strcpy(b->name, name);
+    b->owner = create;
+    return b;
+}
+
+ShmBot* shm_bot_create(const char* name) {
+    ShmBot* b = map_region(name, 1);
+    if (!b) return NULL;
+    /* A fresh mapping is zeroed, which is the empty ring and version 0 */
+    b->r->size = sizeof(ShmRegion);
+    std::atomic_thread_fence(std::memory_order_release);
+    b->r->magic = SHM_MAGIC;
+    return b;
+}
+
+ShmBot* shm_bot_attach(const char* name) {
+    ShmBot* b = map_region(name, 0);
+    if (b && (b->r->magic != SHM_MAGIC || b->r->size != sizeof(ShmRegion))) {
+        shm_bot_close(b);
+        return NULL;
+    }
+    return b;
+}
+
+void shm_bot_close(ShmBot* b) {
+    if (!b) return;
+    munmap(b->r, sizeof(ShmRegion));
+    if (b->owner) shm_unlink(b->name);
+    free(b);
+}
+
+void shm_bot_publish(ShmBot* b, const GameState* s, uint32_t ack) {
+    uint32_t words[SHM_STATE_WORDS];
+    ShmState st;
+    memset(&st, 0, sizeof(st));
+    st.tick = ++b->tick;
+    st.ack = ack;
+    st.score = s->score;
+    st.lines = s->lines_total;
+    st.level = s->level;
+    st.speed_ms = s->speed_ms;
+    st.pieces_placed = s->pieces_placed;
+    st.piece = (int8_t)s->cur_piece;
+    st.rot = (int8_t)s->cur_rot;
+    st.x = (int8_t)s->cur_x;
+    st.y = (int8_t)s->cur_y;
+    st.next = (int8_t)s->next_piece;
+    st.hold = (int8_t)s->hold_piece;
+    st.hold_used = (int8_t)s->hold_used;
+    st.game_over = (int8_t)s->game_over;
+    for (int y = 0; y < HEIGHT; y++)
+        for (int x = 0; x < WIDTH; x++) st.board[y][x] = (uint8_t)s->board[y][x];
+    memset(words, 0, sizeof(words));
+    memcpy(words, &st, sizeof(st));
+
+    ShmRegion* r = b->r;
+    uint32_t seq = r->seq.load(std::memory_order_relaxed);
+    r->seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < SHM_STATE_WORDS; i++) r->words[i].store(words[i], std::memory_order_relaxed);
+    r->seq.store(seq + 2, std::memory_order_release);
+}
+
+uint32_t shm_bot_read(ShmBot* b, ShmState* out) {
+    uint32_t words[SHM_STATE_WORDS];
+    ShmRegion* r = b->r;
+    for (;;) {
+        uint32_t seq = r->seq.load(std::memory_order_acquire);
+        if (!(seq & 1)) {
+            for (size_t i = 0; i < SHM_STATE_WORDS; i++) words[i] = r->words[i].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (r->seq.load(std::memory_order_relaxed) == seq) {
+                memcpy(out, words, sizeof(*out));
+                return seq;
+            }
+        }
+        b->retries++;
+    }
+}
+
+uint32_t shm_bot_version(const ShmBot* b) {
+    return b->r->seq.load(std::memory_order_acquire);
+}
+
+uint64_t shm_bot_retries(const ShmBot* b) {
+    return b->retries;
+}
+
+int shm_bot_send(ShmBot* b, const ShmCommand* c) {
+    ShmRegion* r = b->r;
+    uint32_t tail = r->cmd_tail.load(std::memory_order_relaxed);
+    if (tail - r->cmd_head.load(std::memory_order_acquire) == SHM_COMMANDS) return 0;
+    r->cmds[tail % SHM_COMMANDS] = *c;
+    r->cmd_tail.store(tail + 1, std::memory_order_release);
+    return 1;
+}
+
+int shm_bot_next_command(ShmBot* b, ShmCommand* out) {
+    ShmRegion* r = b->r;
+    uint32_t head = r->cmd_head.load(std::memory_order_relaxed);
+    if (head == r->cmd_tail.load(std::memory_order_acquire)) return 0;
+    *out = r->cmds[head % SHM_COMMANDS];
+    r->cmd_head.store(head + 1, std::memory_order_release);
+    return 1;
+}
+
+/* The other process is not trusted: everything is checked against the
+   board before it is applied */
+int shm_bot_apply(GameState* s, const ShmCommand* c) {
+    switch (c->kind) {
+    case SHM_CMD_INPUT:
+        return !s->game_over && c->input < INPUT_COUNT && state_input(s, c->input);
+    case SHM_CMD_PLACE: {
+        /* Tried on a copy so a rejected move leaves nothing half done */
+        GameState t = *s;
+        if (t.game_over || c->rot > 3) return 0;
+        if (c->use_hold && (t.hold_used || !state_hold(&t) || t.game_over)) return 0;
+        if (!board_fits(t.board, t.cur_piece, c->x, t.cur_y, c->rot)) return 0;
+        t.cur_rot = c->rot;
+        t.cur_x = c->x;
+        state_hard_drop(&t);
+        *s = t;
+        return 1;
+    }
+    case SHM_CMD_RESTART:
+        state_init(s, c->seed);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,67 @@
+#ifndef TETRIS_SHM_H
+#define TETRIS_SHM_H
+
+/* Bots in other processes, over POSIX shared memory. The engine publishes
+   a snapshot of its game under a seqlock: the writer never waits, and a
+   reader retries the copy if a publish overlapped it. Moves come back
+   through a single-producer ring of commands in the same region. Neither
+   side makes a system call per move, so a round trip is a few cache line
+   transfers; both sides poll, spinning and then yielding.
+
+   The snapshot carries the one-piece preview the game has; the rest of
+   the sequence stays in the engine's rng. POSIX only. */
+
+#include <stdint.h>
+#include "tetris_core.h"
+
+#define SHM_COMMANDS 64           /* power of two */
+
+enum {
+    SHM_CMD_INPUT = 1,            /* one INPUT_* */
+    SHM_CMD_PLACE,                /* hold if asked, then drop at rot, x */
+    SHM_CMD_RESTART               /* new game from seed */
+};
+
+typedef struct {
+    uint32_t seq;                 /* echoed as ack once handled */
+    uint8_t kind;
+    uint8_t input;
+    uint8_t use_hold;
+    uint8_t rot;
+    int8_t x;
+    uint32_t seed;
+} ShmCommand;
+
+/* What a bot reads */
+typedef struct {
+    uint32_t tick;                /* publishes so far */
+    uint32_t ack;                 /* seq of the last command handled */
+    int64_t score;                /* long bot games pass 2^31 */
+    int32_t lines, level, speed_ms, pieces_placed;
+    int8_t piece, rot, x, y, next, hold, hold_used, game_over;
+    uint8_t board[HEIGHT][WIDTH];
+} ShmState;
+
+typedef struct ShmBot ShmBot;
+
+/* Engine side: creates name (e.g. "/tetris-bot") and unlinks it on close */
+ShmBot* shm_bot_create(const char* name);
+void shm_bot_publish(ShmBot* b, const GameState* s, uint32_t ack);
+/* Takes the oldest waiting command; 0 if none */
+int shm_bot_next_command(ShmBot* b, ShmCommand* out);
+/* Applies a move from outside; 0 if it is not legal here */
+int shm_bot_apply(GameState* s, const ShmCommand* c);
+
+/* Bot side */
+ShmBot* shm_bot_attach(const char* name);
+/* A consistent snapshot; returns its version, which changes on publish */
+uint32_t shm_bot_read(ShmBot* b, ShmState* out);
+uint32_t shm_bot_version(const ShmBot* b);
+/* 0 if the ring is full */
+int shm_bot_send(ShmBot* b, const ShmCommand* c);
+/* Snapshot copies that had to be retried */
+uint64_t shm_bot_retries(const ShmBot* b);
+
+void shm_bot_close(ShmBot* b);
+
+#endif /* TETRIS_SHM_H */
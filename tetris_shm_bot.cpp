@@ -0,0 +1,223 @@
+// Shared-memory bot link - an engine process publishing its game and a bot
+// process placing pieces through the command ring, timing every move from
+// send to the snapshot that acknowledges it
+// Build: g++ -O2 -std=c++17 tetris_shm_bot.cpp tetris_shm.cpp tetris_bot.cpp tetris_eval_cache.cpp tetris_core.cpp -o tetris_shm_bot
+//        POSIX only (shm_open, fork); older glibc needs -lrt
+// Usage: tetris_shm_bot --moves 20000             (forks the engine, then plays)
+//        tetris_shm_bot --host /tetris-bot        (engine only, until killed)
+//        tetris_shm_bot --client /tetris-bot      (bot only)
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <signal.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <algorithm>
+#include <vector>
+#include "tetris_bot.h"
+#include "tetris_shm.h"
+
+static volatile sig_atomic_t stop = 0;
+static uint32_t seed = 1;
+static int gravity = 1;
+static int spins = 2000;          /* empty polls before yielding the CPU */
+
+static uint64_t now_ns(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000000u + (uint64_t)t.tv_nsec;
+}
+
+static void on_signal(int sig) {
+    (void)sig;
+    stop = 1;
+}
+
+static void usage(void) {
+    printf("Usage: tetris_shm_bot [options]\n"
+           "  --moves N        pieces the bot places (default 20000)\n"
+           "  --host NAME      run only the engine on shared memory NAME\n"
+           "  --client NAME    run only the bot against an engine on NAME\n"
+           "  --no-gravity     the engine publishes only in answer to moves\n"
+           "  --seed N         (default 1)\n");
+}
+
+static int run_host(const char* name) {
+    ShmBot* b = shm_bot_create(name);
+    if (!b) {
+        fprintf(stderr, "cannot create shared memory %s\n", name);
+        return 1;
+    }
+    GameState g;
+    state_init(&g, seed);
+    uint32_t ack = 0;
+    uint64_t applied = 0, rejected = 0, publishes = 1;
+    shm_bot_publish(b, &g, ack);
+    uint64_t due = now_ns() + (uint64_t)g.speed_ms * 1000000u;
+    int idle = 0;
+    while (!stop) {
+        int changed = 0;
+        ShmCommand c;
+        while (shm_bot_next_command(b, &c)) {
+            if (shm_bot_apply(&g, &c)) applied++;
+            else rejected++;
+            ack = c.seq;
+            changed = 1;
+        }
+        /* Reading the clock costs more than a poll, so not on every one */
+        if (gravity && !g.game_over && (changed || idle % 64 == 0) && now_ns() >= due) {
+            state_tick(&g);
+            due = now_ns() + (uint64_t)g.speed_ms * 1000000u;
+            changed = 1;
+        }
+        if (changed) {
+            shm_bot_publish(b, &g, ack);
+            publishes++;
+            idle = 0;
+        } else if (++idle >= spins) {
+            sched_yield();
+            idle = 0;
+        }
+    }
+    printf("engine: %llu commands applied, %llu rejected, %llu snapshots published\n",
+           (unsigned long long)applied, (unsigned long long)rejected, (unsigned long long)publishes);
+    shm_bot_close(b);
+    return 0;
+}
+
+/* Spins on the version, then yields, until a snapshot acks seq */
+static void wait_ack(ShmBot* b, uint32_t seq, ShmState* st) {
+    uint32_t seen = 0;
+    int idle = 0;
+    for (;;) {
+        uint32_t v = shm_bot_version(b);
+        if (v != seen && !(v & 1)) {
+            seen = shm_bot_read(b, st);
+            if (st->ack == seq) return;
+        } else if (++idle >= spins) {
+            sched_yield();
+            idle = 0;
+        }
+    }
+}
+
+static void to_game(const ShmState* st, GameState* g) {
+    memset(g, 0, sizeof(*g));
+    for (int y = 0; y < HEIGHT; y++)
+        for (int x = 0; x < WIDTH; x++) g->board[y][x] = st->board[y][x];
+    g->cur_piece = st->piece;
+    g->cur_rot = st->rot;
+    g->cur_x = st->x;
+    g->cur_y = st->y;
+    g->next_piece = st->next;
+    g->hold_piece = st->hold;
+    g->hold_used = st->hold_used;
+    g->game_over = st->game_over;
+    g->level = st->level;
+    g->speed_ms = st->speed_ms;
+    g->score = st->score;
+    g->lines_total = st->lines;
+    g->pieces_placed = st->pieces_placed;
+}
+
+static int run_client(const char* name, int moves) {
+    ShmBot* b = NULL;
+    for (int tries = 0; !b && tries < 200; tries++) {
+        b = shm_bot_attach(name);
+        if (!b) usleep(10000);
+    }
+    if (!b) {
+        fprintf(stderr, "no engine on %s\n", name);
+        return 1;
+    }
+    ShmState st;
+    while (!shm_bot_version(b)) sched_yield();
+    shm_bot_read(b, &st);
+
+    std::vector<double> rtt;
+    rtt.reserve((size_t)moves);
+    uint32_t seq = 0;
+    int games = 1, rejected = 0;
+    uint64_t think_ns = 0, best_score = 0;
+    for (int m = 0; m < moves; m++) {
+        ShmCommand c;
+        memset(&c, 0, sizeof(c));
+        c.seq = ++seq;
+        GameState g;
+        to_game(&st, &g);
+        BotMove mv;
+        uint64_t t0 = now_ns();
+        if (g.game_over || !bot_choose(&g, &bot_default_weights, &mv)) {
+            if ((uint64_t)g.score > best_score) best_score = (uint64_t)g.score;
+            c.kind = SHM_CMD_RESTART;
+            c.seed = seed + (uint32_t)games++;
+        } else {
+            c.kind = SHM_CMD_PLACE;
+            c.use_hold = (uint8_t)mv.use_hold;
+            c.rot = (uint8_t)mv.place.rot;
+            c.x = (int8_t)mv.place.x;
+        }
+        uint64_t t1 = now_ns();
+        think_ns += t1 - t0;
+        while (!shm_bot_send(b, &c)) sched_yield();
+        wait_ack(b, seq, &st);
+        rtt.push_back((now_ns() - t1) / 1000.0);
+        if (c.kind == SHM_CMD_PLACE && st.pieces_placed == g.pieces_placed && !st.game_over) rejected++;
+    }
+    if ((uint64_t)st.score > best_score) best_score = (uint64_t)st.score;
+
+    std::sort(rtt.begin(), rtt.end());
+    size_t n = rtt.size();
+    printf("bot: %d moves over %d games, best score %llu, %d moves rejected\n", moves, games,
+           (unsigned long long)best_score, rejected);
+    if (n)
+        printf("round trip us: p50 %.2f p99 %.2f p999 %.2f max %.2f (bot thinking %.2f us per move)\n",
+               rtt[n / 2], rtt[std::min(n - 1, n * 99 / 100)], rtt[std::min(n - 1, n * 999 / 1000)], rtt[n - 1],
+               think_ns / 1000.0 / n);
+    printf("snapshot copies retried: %llu\n", (unsigned long long)shm_bot_retries(b));
+    shm_bot_close(b);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    const char* host = NULL;
+    const char* client = NULL;
+    int moves = 20000;
+
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        const char* v = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!strcmp(a, "--help")) { usage(); return 0; }
+        if (!strcmp(a, "--no-gravity")) { gravity = 0; continue; }
+        if (!v) { usage(); return 1; }
+        if (!strcmp(a, "--moves")) moves = atoi(v);
+        else if (!strcmp(a, "--host")) host = v;
+        else if (!strcmp(a, "--client")) client = v;
+        else if (!strcmp(a, "--seed")) seed = (uint32_t)strtoul(v, NULL, 10);
+        else { usage(); return 1; }
+        i++;
+    }
+    /* With one CPU the other side cannot run while this one spins */
+    if (sysconf(_SC_NPROCESSORS_ONLN) < 2) spins = 1;
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    if (host) return run_host(host);
+    if (client) return run_client(client, moves);
+
+    char name[64];
+    snprintf(name, sizeof(name), "/tetris-bot-%d", (int)getpid());
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        return 1;
+    }
+    if (pid == 0) return run_host(name);
+    int rc = run_client(name, moves);
+    kill(pid, SIGTERM);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return rc || !WIFEXITED(status) || WEXITSTATUS(status);
+}
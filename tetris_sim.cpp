@@ -0,0 +1,296 @@
+#include "tetris_sim.h"
+#include "tetris_trace.h"
+#include "tetris_metrics.h"
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#define SIM_FRESH 4
+#define SIM_ARRIVALS (SIM_INPUT_SLOTS * 4)
+
+typedef struct {
+    uint8_t input;
+    double t_ms;
+} SimInput;
+
+const char* const sim_stage_names[SIM_STAGE_COUNT] = {
+    "input queue", "input to publish", "input to display", "gravity lateness", "render"
+};
+
+static std::thread sim_thread;
+static std::mutex wake_mutex;
+static std::condition_variable wake_cv;
+static int stopping = 0;
+static int running = 0;
+static SimConfig config;
+static SimStats stats;
+
+/* Input ring: the input thread owns ring_tail, the simulation thread
+   owns ring_head */
+static SimInput ring[SIM_INPUT_SLOTS];
+static std::atomic<uint32_t> ring_head(0);
+static std::atomic<uint32_t> ring_tail(0);
+
+/* Simulation thread only */
+static GameState game;
+static int animation_frame = 0;
+static int paused = 0;
+static uint32_t publish_seq = 0;
+static uint32_t input_seq = 0, published_input_seq = 0;
+
+/* Times of each applied input by input_seq, written by the simulation
+   thread before the frame that holds it is published, so the render
+   thread can time every input it draws. A slot is reused only
+   SIM_ARRIVALS inputs later. */
+typedef struct {
+    std::atomic<double> arrive, apply, publish;
+} SimTag;
+
+static SimTag tags[SIM_ARRIVALS];
+
+/* Frames: triple buffer as in tetris_hint.cpp */
+static SimFrame frames[3];
+static std::atomic<int> frame_middle(1);
+static int write_index = 0;
+static int read_index = 2;
+static uint32_t last_read_seq = 0;
+static uint32_t last_shown_input = 0;
+
+double sim_now_ms(void) {
+    using namespace std::chrono;
+    return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+}
+
+static std::chrono::steady_clock::time_point time_point_ms(double ms) {
+    using namespace std::chrono;
+    return steady_clock::time_point(duration_cast<steady_clock::duration>(duration<double, std::milli>(ms)));
+}
+
+void sim_series_add(SimSeries* s, double v) {
+    s->sample[s->count % SIM_SERIES_SAMPLES] = v;
+    s->count++;
+    s->sum += v;
+    s->sum_sq += v * v;
+    if (v > s->max) s->max = v;
+}
+
+void sim_series_summary(const SimSeries* s, SimSummary* out) {
+    static double sorted[SIM_SERIES_SAMPLES];
+    memset(out, 0, sizeof(*out));
+    if (!s->count) return;
+    int n = s->count < SIM_SERIES_SAMPLES ? (int)s->count : SIM_SERIES_SAMPLES;
+    memcpy(sorted, s->sample, n * sizeof(double));
+    std::sort(sorted, sorted + n);
+    out->count = s->count;
+    out->mean = s->sum / s->count;
+    out->p50 = sorted[(n - 1) * 50 / 100];
+    out->p99 = sorted[(n - 1) * 99 / 100];
+    out->max = s->max;
+    double var = s->sum_sq / s->count - out->mean * out->mean;
+    out->jitter = var > 0.0 ? sqrt(var) : 0.0;
+}
+
+int sim_post(int input) {
+    uint32_t tail = ring_tail.load(std::memory_order_relaxed);
+    if (tail - ring_head.load(std::memory_order_acquire) >= SIM_INPUT_SLOTS) {
+        stats.inputs_dropped++;
+        return 0;
+    }
+    SimInput* in = &ring[tail & (SIM_INPUT_SLOTS - 1)];
+    in->input = (uint8_t)input;
+    in->t_ms = sim_now_ms();
+    ring_tail.store(tail + 1, std::memory_order_release);
+    /* The lock only orders the wakeup against the sleeper's check */
+    { std::lock_guard<std::mutex> lock(wake_mutex); }
+    wake_cv.notify_one();
+    return 1;
+}
+
+static int pop_input(SimInput* out) {
+    uint32_t head = ring_head.load(std::memory_order_relaxed);
+    if (head == ring_tail.load(std::memory_order_acquire)) return 0;
+    *out = ring[head & (SIM_INPUT_SLOTS - 1)];
+    ring_head.store(head + 1, std::memory_order_release);
+    return 1;
+}
+
+static void publish(void) {
+    double now = sim_now_ms();
+    SimFrame* f = &frames[write_index];
+    f->state = game;
+    f->seq = ++publish_seq;
+    f->animation_frame = animation_frame;
+    f->paused = paused;
+    f->input_seq = input_seq;
+    f->publish_ms = now;
+
+    uint32_t first = published_input_seq + 1;
+    if (input_seq - published_input_seq > SIM_ARRIVALS) first = input_seq - SIM_ARRIVALS + 1;
+    for (uint32_t i = first; i - 1 != input_seq; i++) {
+        SimTag* t = &tags[i % SIM_ARRIVALS];
+        t->publish.store(now, std::memory_order_relaxed);
+        sim_series_add(&stats.stage[SIM_STAGE_PUBLISH], now - t->arrive.load(std::memory_order_relaxed));
+    }
+    published_input_seq = input_seq;
+
+    write_index = frame_middle.exchange(write_index | SIM_FRESH, std::memory_order_acq_rel) & 3;
+    stats.frames_published++;
+    if (config.on_frame) config.on_frame(config.ctx);
+}
+
+int sim_acquire(const SimFrame** out) {
+    if (frame_middle.load(std::memory_order_relaxed) & SIM_FRESH)
+        read_index = frame_middle.exchange(read_index, std::memory_order_acq_rel) & 3;
+    const SimFrame* f = &frames[read_index];
+    int fresh = f->seq != last_read_seq;
+    last_read_seq = f->seq;
+    *out = f;
+    return fresh;
+}
+
+/* Render thread, after the frame reached the screen. Display latency is
+   timed from the oldest input this frame shows for the first time; the
+   probe gets every one of them. */
+void sim_frame_shown(const SimFrame* f, double render_start_ms) {
+    double now = sim_now_ms();
+    static const double frame_bounds[] = { 1, 2, 4, 8, 16, 33, 50, 100, 250 };
+    static const int frame_ms = metrics_histogram("tetris_frame_ms", "", "Render time per shown frame", frame_bounds, 9);
+    sim_series_add(&stats.stage[SIM_STAGE_RENDER], now - render_start_ms);
+    metrics_observe(frame_ms, now - render_start_ms);
+    stats.frames_shown++;
+    if (f->input_seq == last_shown_input) return;
+    uint32_t first = last_shown_input + 1;
+    if (f->input_seq - last_shown_input > SIM_ARRIVALS / 2) first = f->input_seq - SIM_ARRIVALS / 2 + 1;
+    sim_series_add(&stats.stage[SIM_STAGE_DISPLAY],
+                   now - tags[first % SIM_ARRIVALS].arrive.load(std::memory_order_relaxed));
+    for (uint32_t i = first; config.probe && i - 1 != f->input_seq; i++) {
+        const SimTag* t = &tags[i % SIM_ARRIVALS];
+        LatencyTag tag;
+        tag.t[LAT_ARRIVE] = t->arrive.load(std::memory_order_relaxed);
+        tag.t[LAT_APPLY] = t->apply.load(std::memory_order_relaxed);
+        tag.t[LAT_PUBLISH] = t->publish.load(std::memory_order_relaxed);
+        tag.t[LAT_DISPLAY] = now;
+        latency_log_add(config.probe, &tag);
+    }
+    last_shown_input = f->input_seq;
+}
+
+static int input_ready(void) {
+    return ring_tail.load(std::memory_order_acquire) != ring_head.load(std::memory_order_relaxed);
+}
+
+/* Applies every queued input, then gravity if its deadline passed, and
+   publishes once if anything changed */
+static void sim_main(void) {
+    TRACE_THREAD("simulation");
+    static const int ticks_counter = metrics_counter("tetris_ticks_total", "", "Gravity steps");
+    double next_fall = sim_now_ms() + game.speed_ms;
+    if (config.on_spawn) config.on_spawn(&game, config.ctx);
+    publish();
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(wake_mutex);
+            auto ready = [] { return stopping || input_ready(); };
+            if (paused || game.game_over) wake_cv.wait(lock, ready);
+            else wake_cv.wait_until(lock, time_point_ms(next_fall), ready);
+            if (stopping) return;
+        }
+        TRACE_SCOPE("sim_step");
+        stats.wakeups++;
+        int changed = 0, spawned = 0;
+        SimInput in;
+        while (pop_input(&in)) {
+            double now = sim_now_ms();
+            stats.inputs++;
+            sim_series_add(&stats.stage[SIM_STAGE_QUEUE], now - in.t_ms);
+            if (in.input == SIM_PAUSE || in.input == SIM_RESUME) {
+                paused = in.input == SIM_PAUSE;
+                next_fall = now + game.speed_ms;
+                changed = 1;
+                continue;
+            }
+            if (paused) continue;
+            int placed = game.pieces_placed, held = game.hold_used, lines = game.lines_total;
+            if (!state_input(&game, in.input)) continue;
+            metrics_game_step(&game, placed, lines);
+            input_seq++;
+            tags[input_seq % SIM_ARRIVALS].arrive.store(in.t_ms, std::memory_order_relaxed);
+            tags[input_seq % SIM_ARRIVALS].apply.store(sim_now_ms(), std::memory_order_relaxed);
+            spawned |= game.pieces_placed != placed || game.hold_used != held;
+            changed = 1;
+        }
+
+        double now = sim_now_ms();
+        if (!paused && !game.game_over && now >= next_fall) {
+            int placed = game.pieces_placed, lines = game.lines_total;
+            sim_series_add(&stats.stage[SIM_STAGE_GRAVITY], now - next_fall);
+            TRACE_SCOPE("gravity_tick");
+            state_tick(&game);
+            metrics_add(ticks_counter, 1);
+            metrics_game_step(&game, placed, lines);
+            animation_frame++;
+            spawned |= game.pieces_placed != placed;
+            changed = 1;
+            next_fall += game.speed_ms;
+            if (next_fall <= now) next_fall = now + game.speed_ms;   /* fell behind; no burst */
+        }
+
+        if (spawned && !game.game_over && config.on_spawn) config.on_spawn(&game, config.ctx);
+        if (changed) publish();
+    }
+}
+
+int sim_start(const SimConfig* cfg) {
+    if (running) return 0;
+    config = *cfg;
+    memset(&stats, 0, sizeof(stats));
+    state_init(&game, cfg->seed);
+    if (cfg->start_level > 1) {
+        game.level = cfg->start_level;
+        game.speed_ms = speed_for_level(game.level);
+    }
+    animation_frame = 0;
+    paused = 0;
+    publish_seq = input_seq = published_input_seq = 0;
+    ring_head.store(0);
+    ring_tail.store(0);
+    last_read_seq = last_shown_input = 0;
+    /* Readers see the opening position even before the first publish */
+    for (int i = 0; i < 3; i++) {
+        memset(&frames[i], 0, sizeof(frames[i]));
+        frames[i].state = game;
+    }
+    frame_middle.store(1);
+    write_index = 0;
+    read_index = 2;
+    stopping = 0;
+    running = 1;
+    metrics_gauge_add(metrics_gauge("tetris_active_games", "", "Games being simulated"), 1);
+    sim_thread = std::thread(sim_main);
+    return 1;
+}
+
+void sim_stop(void) {
+    if (!running) return;
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex);
+        stopping = 1;
+    }
+    wake_cv.notify_one();
+    sim_thread.join();
+    running = 0;
+    metrics_gauge_add(metrics_gauge("tetris_active_games", "", "Games being simulated"), -1);
+}
+
+const SimStats* sim_stats(void) {
+    return &stats;
+}
+
+const GameState* sim_final_state(void) {
+    return &game;
+}
@@ -0,0 +1,96 @@
+#ifndef TETRIS_SIM_H
+#define TETRIS_SIM_H
+
+/* Game simulation on its own thread. The input thread feeds it through a
+   single-producer ring, gravity runs on the thread's own deadline, and
+   every change is published as a complete frame through a triple buffer,
+   so input, simulation and rendering never wait on each other. Portable;
+   the window and the benchmark tool drive the same code. */
+
+#include "tetris_core.h"
+#include "tetris_latency.h"
+
+#define SIM_INPUT_SLOTS 64        /* power of two */
+#define SIM_SERIES_SAMPLES 4096   /* recent samples kept per stage */
+
+/* Commands accepted besides INPUT_* */
+enum { SIM_PAUSE = INPUT_COUNT, SIM_RESUME };
+
+/* Immutable snapshot handed to the render thread */
+typedef struct {
+    GameState state;
+    uint32_t seq;             /* bumped by every publish */
+    int animation_frame;      /* gravity steps so far */
+    int paused;
+    uint32_t input_seq;       /* inputs applied so far */
+    double publish_ms;
+} SimFrame;
+
+/* Called on the simulation thread whenever a new piece becomes current */
+typedef void (*SimSpawnFn)(const GameState* s, void* ctx);
+/* Called on the simulation thread after each publish */
+typedef void (*SimNotifyFn)(void* ctx);
+
+typedef struct {
+    uint32_t seed;
+    int start_level;          /* 0 or 1 for a normal game */
+    SimSpawnFn on_spawn;
+    SimNotifyFn on_frame;
+    void* ctx;
+    LatencyLog* probe;        /* gets a tag per input once it is drawn; owned
+                                 by the render thread while running */
+} SimConfig;
+
+/* Per-stage timings. Each stage is written by one thread only. */
+enum {
+    SIM_STAGE_QUEUE = 0,      /* key arrival to applied */
+    SIM_STAGE_PUBLISH,        /* key arrival to frame published */
+    SIM_STAGE_DISPLAY,        /* key arrival to frame drawn */
+    SIM_STAGE_GRAVITY,        /* gravity step lateness */
+    SIM_STAGE_RENDER,         /* time spent drawing a frame */
+    SIM_STAGE_COUNT
+};
+
+typedef struct {
+    double sample[SIM_SERIES_SAMPLES];
+    uint64_t count;
+    double sum, sum_sq, max;
+} SimSeries;
+
+typedef struct {
+    uint64_t count;
+    double mean, p50, p99, max;
+    double jitter;            /* standard deviation */
+} SimSummary;
+
+typedef struct {
+    SimSeries stage[SIM_STAGE_COUNT];
+    uint64_t inputs, inputs_dropped;
+    uint64_t frames_published, frames_shown;
+    uint64_t wakeups;
+} SimStats;
+
+extern const char* const sim_stage_names[SIM_STAGE_COUNT];
+
+double sim_now_ms(void);
+
+/* Simulation thread */
+int sim_start(const SimConfig* cfg);
+void sim_stop(void);
+
+/* Input thread; returns 0 if the ring is full and the input was dropped */
+int sim_post(int input);
+
+/* Render thread. *out stays valid until the next call; returns 1 if the
+   frame is newer than the one handed out last time. */
+int sim_acquire(const SimFrame** out);
+void sim_frame_shown(const SimFrame* f, double render_start_ms);
+
+/* Stats; only consistent once sim_stop has returned */
+const SimStats* sim_stats(void);
+/* The game as the simulation left it; same rule as sim_stats */
+const GameState* sim_final_state(void);
+void sim_series_add(SimSeries* s, double v);
+void sim_series_summary(const SimSeries* s, SimSummary* out);
+
+#endif /* TETRIS_SIM_H */
@@ -0,0 +1,165 @@
+// Threaded game loop benchmark - an input thread, the simulation thread
+// and a software render thread, with per-stage latency and jitter
+// Build: g++ -O2 -std=c++17 -pthread tetris_sim_bench.cpp tetris_sim.cpp tetris_metrics.cpp tetris_latency.cpp tetris_soft.cpp tetris_glyphs.cpp tetris_render.cpp tetris_font.cpp tetris_core.cpp -o tetris_sim_bench
+//        cl /O2 /std:c++17 /EHsc tetris_sim_bench.cpp tetris_sim.cpp tetris_metrics.cpp tetris_latency.cpp tetris_soft.cpp tetris_glyphs.cpp tetris_render.cpp tetris_font.cpp tetris_core.cpp
+// Usage: tetris_sim_bench --seconds 5 --key-ms 20 --paint-ms 30
+//        add -DTETRIS_TRACE tetris_trace.cpp to the build for --trace
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "tetris_metrics.h"
+#include "tetris_sim.h"
+#include "tetris_soft.h"
+#include "tetris_trace.h"
+
+static std::mutex frame_mutex;
+static std::condition_variable frame_cv;
+static int frame_ready = 0;
+static std::atomic<int> done(0);
+static RenderList list;
+
+static void usage(void) {
+    printf("Usage: tetris_sim_bench [options]\n"
+           "  --seconds N      run time (default 5)\n"
+           "  --key-ms N       mean gap between key presses (default 20)\n"
+           "  --paint-ms N     extra time every frame spends drawing (default 0)\n"
+           "  --level N        starting level, sets gravity speed (default 20)\n"
+           "  --seed N         game seed (default 1)\n"
+           "  --latency FILE   write per-input latency percentiles\n"
+           "  --metrics PORT   serve live counters on http://127.0.0.1:PORT/metrics\n"
+           "  --trace FILE     write a Chrome trace and print per-site timings\n");
+}
+
+static void frame_published(void* ctx) {
+    (void)ctx;
+    {
+        std::lock_guard<std::mutex> lock(frame_mutex);
+        frame_ready = 1;
+    }
+    frame_cv.notify_one();
+}
+
+/* Random moves, mostly shifts and rotations, at jittered intervals */
+static void input_main(int key_ms, uint32_t seed) {
+    static const int mix[16] = {
+        INPUT_LEFT, INPUT_LEFT, INPUT_RIGHT, INPUT_RIGHT, INPUT_LEFT, INPUT_RIGHT,
+        INPUT_ROTATE, INPUT_ROTATE, INPUT_ROTATE, INPUT_SOFT_DROP, INPUT_SOFT_DROP,
+        INPUT_SOFT_DROP, INPUT_HARD_DROP, INPUT_HARD_DROP, INPUT_HOLD, INPUT_LEFT
+    };
+    TRACE_THREAD("input");
+    uint32_t rng = seed * 2654435761u + 1;
+    while (!done.load()) {
+        sim_post(mix[rng_next(&rng) & 15]);
+        int gap = key_ms > 0 ? (int)(rng_next(&rng) % (uint32_t)(key_ms * 2)) : 0;
+        std::this_thread::sleep_for(std::chrono::milliseconds(gap));
+    }
+}
+
+/* Draws the newest frame whenever one is published; paint_ms stands in
+   for a slow backend */
+static void render_main(int paint_ms) {
+    TRACE_THREAD("render");
+    SoftFrame frame;
+    if (!soft_frame_init(&frame, RENDER_WINDOW_WIDTH, RENDER_WINDOW_HEIGHT)) return;
+    while (!done.load()) {
+        {
+            std::unique_lock<std::mutex> lock(frame_mutex);
+            frame_cv.wait_for(lock, std::chrono::milliseconds(50), [] { return frame_ready; });
+            frame_ready = 0;
+        }
+        const SimFrame* f;
+        if (!sim_acquire(&f)) continue;
+        TRACE_SCOPE("render_frame");
+        double t0 = sim_now_ms();
+        RenderScene scene;
+        render_scene_from_state(&scene, &f->state, f->animation_frame);
+        render_build(&scene, RENDER_INLINE_LAYERS, &list);
+        soft_render_list(&frame, &list);
+        if (paint_ms > 0) std::this_thread::sleep_for(std::chrono::milliseconds(paint_ms));
+        sim_frame_shown(f, t0);
+    }
+    soft_frame_free(&frame);
+}
+
+int main(int argc, char** argv) {
+    int seconds = 5, key_ms = 20, paint_ms = 0, metrics_port = 0;
+    const char* trace_path = NULL;
+    const char* latency_path = NULL;
+    LatencyLog probe;
+    latency_log_init(&probe);
+    SimConfig cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.seed = 1;
+    cfg.start_level = 20;
+    cfg.on_frame = frame_published;
+
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        const char* v = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!strcmp(a, "--help")) { usage(); return 0; }
+        if (!v) { usage(); return 1; }
+        if (!strcmp(a, "--seconds")) seconds = atoi(v);
+        else if (!strcmp(a, "--key-ms")) key_ms = atoi(v);
+        else if (!strcmp(a, "--paint-ms")) paint_ms = atoi(v);
+        else if (!strcmp(a, "--level")) cfg.start_level = atoi(v);
+        else if (!strcmp(a, "--seed")) cfg.seed = (uint32_t)strtoul(v, NULL, 10);
+        else if (!strcmp(a, "--trace")) trace_path = v;
+        else if (!strcmp(a, "--latency")) latency_path = v;
+        else if (!strcmp(a, "--metrics")) metrics_port = atoi(v);
+        else { usage(); return 1; }
+        i++;
+    }
+
+    if (latency_path) cfg.probe = &probe;
+    if (metrics_port > 0 && !metrics_serve_start(metrics_port)) {
+        fprintf(stderr, "cannot listen on port %d\n", metrics_port);
+        return 1;
+    }
+    sim_start(&cfg);
+    std::thread render(render_main, paint_ms);
+    std::thread input(input_main, key_ms, cfg.seed);
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    done.store(1);
+    input.join();
+    frame_published(NULL);
+    render.join();
+    sim_stop();
+    metrics_serve_stop();
+
+    const SimStats* st = sim_stats();
+    printf("%llu inputs (%llu dropped), %llu sim wakeups, %llu frames published, %llu drawn\n",
+           (unsigned long long)st->inputs, (unsigned long long)st->inputs_dropped,
+           (unsigned long long)st->wakeups, (unsigned long long)st->frames_published,
+           (unsigned long long)st->frames_shown);
+    printf("%-18s %8s %9s %9s %9s %9s %9s\n", "stage", "count", "mean ms", "p50", "p99", "max", "jitter");
+    for (int i = 0; i < SIM_STAGE_COUNT; i++) {
+        SimSummary s;
+        sim_series_summary(&st->stage[i], &s);
+        printf("%-18s %8llu %9.3f %9.3f %9.3f %9.3f %9.3f\n", sim_stage_names[i], (unsigned long long)s.count,
+               s.mean, s.p50, s.p99, s.max, s.jitter);
+    }
+
+    if (latency_path && !latency_write_report(&probe, latency_path, "tetris_sim_bench")) {
+        fprintf(stderr, "cannot write %s\n", latency_path);
+        return 1;
+    }
+    latency_log_free(&probe);
+    if (trace_path) {
+#ifdef TETRIS_TRACE
+        if (!trace_write_chrome(trace_path)) {
+            fprintf(stderr, "cannot write %s\n", trace_path);
+            return 1;
+        }
+        printf("\n");
+        trace_write_histograms(stdout);
+#else
+        fprintf(stderr, "tracing is compiled out; rebuild with -DTETRIS_TRACE tetris_trace.cpp\n");
+#endif
+    }
+    return 0;
+}
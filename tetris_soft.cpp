@@ -0,0 +1,275 @@
+#include "tetris_soft.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SOFT_SSE2 1
+#endif
+
+/* Glyph pixel size; narrower than tall so captions fit the widths the
+   layout leaves for the window font */
+#define TEXT_SCALE_X 1.5f
+#define TEXT_SCALE_Y 2.0f
+
+/* Shared by every frame buffer; built once, read-only afterwards */
+const GlyphAtlas* soft_glyph_atlas(void) {
+    static GlyphAtlas atlas;
+    static int built = glyph_atlas_build_builtin(&atlas, TEXT_SCALE_X, TEXT_SCALE_Y);
+    return built ? &atlas : NULL;
+}
+
+int soft_frame_init(SoftFrame* f, int width, int height) {
+    f->width = width;
+    f->height = height;
+    f->stride = width;
+    f->pixels = (uint32_t*)malloc((size_t)width * height * sizeof(uint32_t));
+    f->layouts = (TextLayoutCache*)malloc(sizeof(TextLayoutCache));
+    if (f->layouts) text_cache_reset(f->layouts);
+    return f->pixels && f->layouts && soft_glyph_atlas();
+}
+
+void soft_frame_free(SoftFrame* f) {
+    free(f->pixels);
+    free(f->layouts);
+    f->pixels = NULL;
+    f->layouts = NULL;
+}
+
+static uint32_t channel(float v) {
+    return v <= 0.0f ? 0u : v >= 1.0f ? 255u : (uint32_t)(v * 255.0f + 0.5f);
+}
+
+uint32_t soft_premultiply(RenderRgba c) {
+    float a = c.a < 0.0f ? 0.0f : c.a > 1.0f ? 1.0f : c.a;
+    return channel(a) << 24 | channel(c.r * a) << 16 | channel(c.g * a) << 8 | channel(c.b * a);
+}
+
+/* x * s / 255, rounded */
+static uint32_t mul255(uint32_t x, uint32_t s) {
+    uint32_t t = x * s + 128;
+    return (t + (t >> 8)) >> 8;
+}
+
+/* Color scaled by a coverage of 0..255 */
+static uint32_t scale_color(uint32_t c, uint32_t cov) {
+    return mul255(c >> 24, cov) << 24 | mul255((c >> 16) & 255, cov) << 16 |
+           mul255((c >> 8) & 255, cov) << 8 | mul255(c & 255, cov);
+}
+
+/* Source over: dst = src + dst * (1 - src alpha) */
+static uint32_t blend(uint32_t dst, uint32_t src) {
+    uint32_t inv = 255 - (src >> 24);
+    return src + (mul255(dst >> 24, inv) << 24 | mul255((dst >> 16) & 255, inv) << 16 |
+                  mul255((dst >> 8) & 255, inv) << 8 | mul255(dst & 255, inv));
+}
+
+void soft_fill_span(uint32_t* dst, int n, uint32_t color) {
+    uint32_t alpha = color >> 24;
+    if (alpha == 0) return;
+    int i = 0;
+#ifdef SOFT_SSE2
+    if (alpha == 255) {
+        __m128i c4 = _mm_set1_epi32((int)color);
+        for (; i + 4 <= n; i += 4) _mm_storeu_si128((__m128i*)(dst + i), c4);
+    } else {
+        __m128i zero = _mm_setzero_si128();
+        __m128i src = _mm_set1_epi32((int)color);
+        __m128i inv = _mm_set1_epi16((short)(255 - alpha));
+        __m128i round = _mm_set1_epi16(128);
+        for (; i + 4 <= n; i += 4) {
+            __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+            __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), inv), round);
+            __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), inv), round);
+            lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+            hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+            _mm_storeu_si128((__m128i*)(dst + i), _mm_add_epi8(_mm_packus_epi16(lo, hi), src));
+        }
+    }
+#endif
+    if (alpha == 255) {
+        for (; i < n; i++) dst[i] = color;
+    } else {
+        for (; i < n; i++) dst[i] = blend(dst[i], color);
+    }
+}
+
+/* Coverage of pixel i by [a, b), 0..1 */
+static float coverage(int i, float a, float b) {
+    float lo = a > (float)i ? a : (float)i;
+    float hi = b < (float)(i + 1) ? b : (float)(i + 1);
+    return hi > lo ? hi - lo : 0.0f;
+}
+
+/* Rectangle with fractional edges: edge pixels blend by coverage, the
+   inside goes through the span filler */
+void soft_fill_rect(SoftFrame* f, RenderRect r, uint32_t color) {
+    float l = r.left < 0 ? 0 : r.left;
+    float t = r.top < 0 ? 0 : r.top;
+    float rr = r.right > f->width ? (float)f->width : r.right;
+    float b = r.bottom > f->height ? (float)f->height : r.bottom;
+    if (rr <= l || b <= t) return;
+
+    int x0 = (int)floorf(l), x1 = (int)ceilf(rr);
+    int y0 = (int)floorf(t), y1 = (int)ceilf(b);
+    int ix0 = (int)ceilf(l), ix1 = (int)floorf(rr);   /* fully covered columns */
+    for (int y = y0; y < y1; y++) {
+        uint32_t* row = f->pixels + (size_t)y * f->stride;
+        float cy = coverage(y, t, b);
+        if (cy >= 1.0f && ix1 > ix0) {
+            soft_fill_span(row + ix0, ix1 - ix0, color);
+            for (int x = x0; x < ix0; x++)
+                row[x] = blend(row[x], scale_color(color, channel(coverage(x, l, rr))));
+            for (int x = ix1 > ix0 ? ix1 : x0; x < x1; x++)
+                row[x] = blend(row[x], scale_color(color, channel(coverage(x, l, rr))));
+        } else {
+            for (int x = x0; x < x1; x++)
+                row[x] = blend(row[x], scale_color(color, channel(coverage(x, l, rr) * cy)));
+        }
+    }
+}
+
+/* Many rectangles in one color; whole-pixel ones go straight to the span
+   filler */
+void soft_fill_rects(SoftFrame* f, const RenderRect* r, int n, uint32_t color) {
+    for (int i = 0; i < n; i++) {
+        int l = (int)r[i].left, t = (int)r[i].top, rr = (int)r[i].right, b = (int)r[i].bottom;
+        if (l != r[i].left || t != r[i].top || rr != r[i].right || b != r[i].bottom ||
+            l < 0 || t < 0 || rr > f->width || b > f->height) {
+            soft_fill_rect(f, r[i], color);
+            continue;
+        }
+        for (int y = t; y < b; y++) soft_fill_span(f->pixels + (size_t)y * f->stride + l, rr - l, color);
+    }
+}
+
+static RenderRect rect(float l, float t, float r, float b) {
+    RenderRect x = { l, t, r, b };
+    return x;
+}
+
+/* Outline centered on the rectangle edges, as Direct2D strokes it */
+static void stroke_rect(SoftFrame* f, RenderRect r, float w, uint32_t color) {
+    float h = w * 0.5f;
+    soft_fill_rect(f, rect(r.left - h, r.top - h, r.right + h, r.top + h), color);
+    soft_fill_rect(f, rect(r.left - h, r.bottom - h, r.right + h, r.bottom + h), color);
+    soft_fill_rect(f, rect(r.left - h, r.top + h, r.left + h, r.bottom - h), color);
+    soft_fill_rect(f, rect(r.right - h, r.top + h, r.right + h, r.bottom - h), color);
+}
+
+/* Axis-aligned lines are thin rectangles; others use distance to the
+   segment for coverage */
+static void draw_line(SoftFrame* f, RenderRect seg, float w, uint32_t color) {
+    float x0 = seg.left, y0 = seg.top, x1 = seg.right, y1 = seg.bottom;
+    float h = w * 0.5f;
+    if (y0 == y1) {
+        soft_fill_rect(f, rect(fminf(x0, x1), y0 - h, fmaxf(x0, x1), y0 + h), color);
+        return;
+    }
+    if (x0 == x1) {
+        soft_fill_rect(f, rect(x0 - h, fminf(y0, y1), x0 + h, fmaxf(y0, y1)), color);
+        return;
+    }
+    float dx = x1 - x0, dy = y1 - y0;
+    float len2 = dx * dx + dy * dy;
+    int bx0 = (int)floorf(fminf(x0, x1) - h), bx1 = (int)ceilf(fmaxf(x0, x1) + h);
+    int by0 = (int)floorf(fminf(y0, y1) - h), by1 = (int)ceilf(fmaxf(y0, y1) + h);
+    if (bx0 < 0) bx0 = 0;
+    if (by0 < 0) by0 = 0;
+    if (bx1 > f->width) bx1 = f->width;
+    if (by1 > f->height) by1 = f->height;
+    for (int y = by0; y < by1; y++) {
+        for (int x = bx0; x < bx1; x++) {
+            float px = x + 0.5f - x0, py = y + 0.5f - y0;
+            float k = (px * dx + py * dy) / len2;
+            if (k < 0.0f || k > 1.0f) continue;   /* flat caps */
+            float ex = px - k * dx, ey = py - k * dy;
+            float cov = h + 0.5f - sqrtf(ex * ex + ey * ey);
+            if (cov <= 0.0f) continue;
+            uint32_t* p = f->pixels + (size_t)y * f->stride + x;
+            *p = blend(*p, scale_color(color, channel(cov)));
+        }
+    }
+}
+
+static void gradient(SoftFrame* f, const RenderCmd* c) {
+    float h = c->rect.bottom - c->rect.top;
+    if (h <= 0.0f) return;
+    int y0 = (int)floorf(c->rect.top), y1 = (int)ceilf(c->rect.bottom);
+    for (int y = y0; y < y1; y++) {
+        float t = (y + 0.5f - c->rect.top) / h;
+        t = t < 0.0f ? 0.0f : t > 1.0f ? 1.0f : t;
+        RenderRgba k = {
+            c->rgba.r + (c->rgba2.r - c->rgba.r) * t,
+            c->rgba.g + (c->rgba2.g - c->rgba.g) * t,
+            c->rgba.b + (c->rgba2.b - c->rgba.b) * t,
+            c->rgba.a + (c->rgba2.a - c->rgba.a) * t
+        };
+        float top = y > c->rect.top ? (float)y : c->rect.top;
+        float bottom = y + 1 < c->rect.bottom ? (float)(y + 1) : c->rect.bottom;
+        soft_fill_rect(f, rect(c->rect.left, top, c->rect.right, bottom), soft_premultiply(k));
+    }
+}
+
+/* Each glyph is its atlas cell used as coverage for the color */
+void soft_draw_text(SoftFrame* f, float x, float y, const char* text, int len, uint32_t color) {
+    const GlyphAtlas* a = soft_glyph_atlas();
+    const TextLayout* t = text_layout(f->layouts, a, text, len);
+    int ox = (int)floorf(x + 0.5f);
+    int oy = (int)floorf(y + a->top + 0.5f);
+    for (int i = 0; i < t->len; i++) {
+        const GlyphInfo* g = &a->glyph[t->g[i].glyph];
+        int gx = ox + t->g[i].x;
+        for (int cy = 0; cy < a->cell_height; cy++) {
+            int py = oy + cy;
+            if (py < 0 || py >= f->height) continue;
+            const uint8_t* cov = a->alpha + (size_t)(g->y + cy) * a->width + g->x;
+            uint32_t* row = f->pixels + (size_t)py * f->stride;
+            for (int cx = 0; cx < a->cell_width; cx++) {
+                int px = gx + cx;
+                if (!cov[cx] || px < 0 || px >= f->width) continue;
+                row[px] = blend(row[px], cov[cx] == 255 ? color : scale_color(color, cov[cx]));
+            }
+        }
+    }
+}
+
+static uint32_t command_color(const RenderCmd* c) {
+    return soft_premultiply(c->color == RCOL_DYNAMIC ? c->rgba : render_palette[c->color]);
+}
+
+void soft_render_list(SoftFrame* f, const RenderList* list) {
+    for (int i = 0; i < list->count; i++) {
+        const RenderCmd* c = &list->cmd[i];
+        switch (c->op) {
+        case RCMD_CLEAR: {
+            uint32_t color = soft_premultiply(c->rgba);
+            for (int y = 0; y < f->height; y++) {
+                uint32_t* row = f->pixels + (size_t)y * f->stride;
+                for (int x = 0; x < f->width; x++) row[x] = color;
+            }
+            break;
+        }
+        case RCMD_FILL_RECT:
+            soft_fill_rect(f, c->rect, command_color(c));
+            break;
+        case RCMD_STROKE_RECT:
+            stroke_rect(f, c->rect, c->width, command_color(c));
+            break;
+        case RCMD_LINE:
+            draw_line(f, c->rect, c->width, command_color(c));
+            break;
+        case RCMD_GRADIENT:
+            gradient(f, c);
+            break;
+        case RCMD_TEXT:
+            soft_draw_text(f, c->rect.left, c->rect.top, list->text + c->text_offset, c->text_len,
+                           command_color(c));
+            break;
+        default:
+            /* bitmaps and cached layers have no software source */
+            break;
+        }
+    }
+}
@@ -0,0 +1,31 @@
+#ifndef TETRIS_SOFT_H
+#define TETRIS_SOFT_H
+
+/* Software backend for render lists: premultiplied BGRA (0xAARRGGBB in a
+   uint32_t) with antialiased rectangle edges and source-over blending.
+   Text is blitted from an atlas of the built-in 5x7 font, scaled up, with
+   layouts cached per frame buffer. Layers are not
+   cached here; build the list with RENDER_INLINE_LAYERS. */
+
+#include "tetris_render.h"
+#include "tetris_glyphs.h"
+
+typedef struct {
+    int width, height;
+    int stride;           /* pixels per row */
+    uint32_t* pixels;
+    TextLayoutCache* layouts;
+} SoftFrame;
+
+int soft_frame_init(SoftFrame* f, int width, int height);
+void soft_frame_free(SoftFrame* f);
+
+uint32_t soft_premultiply(RenderRgba c);
+void soft_fill_span(uint32_t* dst, int n, uint32_t color);
+void soft_fill_rect(SoftFrame* f, RenderRect r, uint32_t color);
+void soft_fill_rects(SoftFrame* f, const RenderRect* r, int n, uint32_t color);
+void soft_draw_text(SoftFrame* f, float x, float y, const char* text, int len, uint32_t color);
+const GlyphAtlas* soft_glyph_atlas(void);
+void soft_render_list(SoftFrame* f, const RenderList* list);
+
+#endif /* TETRIS_SOFT_H */
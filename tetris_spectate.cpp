@@ -0,0 +1,110 @@
+#include "tetris_spectate.h"
+#include <stdlib.h>
+#include <string.h>
+
+const int spectate_bucket_color[SPECTATE_BUCKETS] = {
+    RCOL_MINI_BOARD, RCOL_MINI_BOARD_OVER, 1, 2, 3, 4, 5, 6, 7
+};
+
+/* Picks the grid shape that gives the largest whole-pixel cells; cells
+   keep a one-pixel gap once they are big enough to afford it */
+int spectate_layout(SpectateLayout* l, int boards, int visible_rows, int left, int top, int width, int height) {
+    memset(l, 0, sizeof(*l));
+    if (boards < 1 || boards > SPECTATE_MAX_BOARDS || visible_rows < 1 || visible_rows > HEIGHT) return 0;
+    l->boards = boards;
+    l->visible_rows = visible_rows;
+    l->spacing = 4;
+    for (int cols = 1; cols <= boards; cols++) {
+        int rows = (boards + cols - 1) / cols;
+        int pw = (width - l->spacing * (cols + 1)) / (cols * WIDTH);
+        int ph = (height - l->spacing * (rows + 1)) / (rows * visible_rows);
+        int p = pw < ph ? pw : ph;
+        if (p > l->pitch) {
+            l->pitch = p;
+            l->columns = cols;
+            l->rows = rows;
+        }
+    }
+    if (l->pitch < 1) return 0;
+    l->gap = l->pitch >= 4 ? 1 : 0;
+    /* Center the grid */
+    int used_w = l->columns * WIDTH * l->pitch + l->spacing * (l->columns + 1);
+    int used_h = l->rows * visible_rows * l->pitch + l->spacing * (l->rows + 1);
+    l->left = left + (width - used_w) / 2 + l->spacing;
+    l->top = top + (height - used_h) / 2 + l->spacing;
+    return 1;
+}
+
+RenderRect spectate_board_rect(const SpectateLayout* l, int board) {
+    float x = (float)(l->left + board % l->columns * (WIDTH * l->pitch + l->spacing));
+    float y = (float)(l->top + board / l->columns * (l->visible_rows * l->pitch + l->spacing));
+    RenderRect r = { x, y, x + WIDTH * l->pitch, y + l->visible_rows * l->pitch };
+    return r;
+}
+
+int spectate_batch_init(SpectateBatch* b, int boards, int visible_rows) {
+    memset(b, 0, sizeof(*b));
+    /* A background per board, every cell, and the four of each falling piece */
+    b->capacity = boards * (1 + WIDTH * visible_rows + 4);
+    b->rect = (RenderRect*)malloc((size_t)b->capacity * sizeof(RenderRect));
+    return b->rect != NULL;
+}
+
+void spectate_batch_free(SpectateBatch* b) {
+    free(b->rect);
+    b->rect = NULL;
+    b->capacity = 0;
+}
+
+static void cell_rect(const SpectateLayout* l, const RenderRect* board, int x, int row, RenderRect* out) {
+    out->left = board->left + x * l->pitch;
+    out->top = board->top + row * l->pitch;
+    out->right = out->left + l->pitch - l->gap;
+    out->bottom = out->top + l->pitch - l->gap;
+}
+
+/* Two passes: count each bucket, then write every rectangle straight into
+   its bucket, so no sort and no per-cell branching on the backend */
+void spectate_build(const SpectateLayout* l, const GameState* games, int count, SpectateBatch* b) {
+    if (count > l->boards) count = l->boards;
+    int first = HEIGHT - l->visible_rows;
+    memset(b->count, 0, sizeof(b->count));
+    for (int i = 0; i < count; i++) {
+        const GameState* g = &games[i];
+        b->count[g->game_over ? SPECTATE_BOARD_OVER : SPECTATE_BOARD]++;
+        for (int y = first; y < HEIGHT; y++)
+            for (int x = 0; x < WIDTH; x++)
+                if (g->board[y][x]) b->count[SPECTATE_CELLS + g->board[y][x] - 1]++;
+        if (!g->game_over) {
+            uint16_t m = get_mask(g->cur_piece, g->cur_rot);
+            for (int k = 0; k < 16; k++)
+                if ((m >> k) & 1u && g->cur_y + k / 4 >= first)
+                    b->count[SPECTATE_CELLS + pieces[g->cur_piece].color - 1]++;
+        }
+    }
+    int at = 0;
+    for (int i = 0; i < SPECTATE_BUCKETS; i++) {
+        b->start[i] = at;
+        at += b->count[i];
+    }
+    b->total = at;
+
+    int fill[SPECTATE_BUCKETS];
+    memcpy(fill, b->start, sizeof(fill));
+    for (int i = 0; i < count; i++) {
+        const GameState* g = &games[i];
+        RenderRect board = spectate_board_rect(l, i);
+        b->rect[fill[g->game_over ? SPECTATE_BOARD_OVER : SPECTATE_BOARD]++] = board;
+        for (int y = first; y < HEIGHT; y++)
+            for (int x = 0; x < WIDTH; x++)
+                if (g->board[y][x])
+                    cell_rect(l, &board, x, y - first, &b->rect[fill[SPECTATE_CELLS + g->board[y][x] - 1]++]);
+        if (!g->game_over) {
+            uint16_t m = get_mask(g->cur_piece, g->cur_rot);
+            int bucket = SPECTATE_CELLS + pieces[g->cur_piece].color - 1;
+            for (int k = 0; k < 16; k++)
+                if ((m >> k) & 1u && g->cur_y + k / 4 >= first)
+                    cell_rect(l, &board, g->cur_x + k % 4, g->cur_y + k / 4 - first, &b->rect[fill[bucket]++]);
+        }
+    }
+}
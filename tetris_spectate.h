@@ -0,0 +1,46 @@
+#ifndef TETRIS_SPECTATE_H
+#define TETRIS_SPECTATE_H
+
+/* Tournament view: up to SPECTATE_MAX_BOARDS games as mini-boards in a
+   grid. Every visible cell of every board becomes one rectangle, bucketed
+   by color, so a backend draws the whole view with one brush (or one fill
+   loop) per color instead of per cell. */
+
+#include "tetris_render.h"
+
+#define SPECTATE_MAX_BOARDS 100
+
+/* Buckets in drawing order: backgrounds first, then the piece colors */
+enum {
+    SPECTATE_BOARD = 0,
+    SPECTATE_BOARD_OVER,
+    SPECTATE_CELLS,         /* + color - 1 for piece colors 1..7 */
+    SPECTATE_BUCKETS = SPECTATE_CELLS + RCOL_PIECE_LAST
+};
+
+typedef struct {
+    int boards;
+    int columns, rows;      /* grid of boards */
+    int visible_rows;       /* bottom rows of each board that are shown */
+    int pitch, gap;         /* cell step and the gap inside it, whole pixels */
+    int spacing;            /* between boards */
+    int left, top;
+} SpectateLayout;
+
+typedef struct {
+    RenderRect* rect;       /* bucket i is rect[start[i]] .. rect[start[i] + count[i] - 1] */
+    int capacity;
+    int start[SPECTATE_BUCKETS];
+    int count[SPECTATE_BUCKETS];
+    int total;
+} SpectateBatch;
+
+extern const int spectate_bucket_color[SPECTATE_BUCKETS];
+
+int spectate_layout(SpectateLayout* l, int boards, int visible_rows, int left, int top, int width, int height);
+RenderRect spectate_board_rect(const SpectateLayout* l, int board);
+int spectate_batch_init(SpectateBatch* b, int boards, int visible_rows);
+void spectate_batch_free(SpectateBatch* b);
+void spectate_build(const SpectateLayout* l, const GameState* games, int count, SpectateBatch* b);
+
+#endif /* TETRIS_SPECTATE_H */
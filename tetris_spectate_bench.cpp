@@ -0,0 +1,141 @@
+// Spectator view benchmark - steps many bot games and draws them all as
+// mini-boards with the software backend, for growing board counts
+// Build: g++ -O2 -std=c++17 tetris_spectate_bench.cpp tetris_spectate.cpp tetris_soft.cpp tetris_glyphs.cpp tetris_render.cpp tetris_font.cpp tetris_bot.cpp tetris_eval_cache.cpp tetris_core.cpp -o tetris_spectate_bench
+//        cl /O2 /std:c++17 /EHsc tetris_spectate_bench.cpp tetris_spectate.cpp tetris_soft.cpp tetris_glyphs.cpp tetris_render.cpp tetris_font.cpp tetris_bot.cpp tetris_eval_cache.cpp tetris_core.cpp
+// Usage: tetris_spectate_bench --frames 200 --write view.ppm
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include "tetris_spectate.h"
+#include "tetris_soft.h"
+#include "tetris_bot.h"
+
+#define FRAME_BUDGET_MS 4.0
+
+static void usage(void) {
+    printf("Usage: tetris_spectate_bench [options]\n"
+           "  --frames N       frames per run (default 200)\n"
+           "  --boards N       run only this board count (default 1, 10, 25, 50, 100)\n"
+           "  --rows N         visible rows per board, 20 or 30 (default both)\n"
+           "  --seed N         first game seed (default 1)\n"
+           "  --write FILE     save the last 100-board frame as PPM\n");
+}
+
+static int write_ppm(const char* path, const SoftFrame* f) {
+    FILE* fp = fopen(path, "wb");
+    if (!fp) return 0;
+    fprintf(fp, "P6\n%d %d\n255\n", f->width, f->height);
+    for (int y = 0; y < f->height; y++) {
+        const uint32_t* p = f->pixels + (size_t)y * f->stride;
+        for (int x = 0; x < f->width; x++) {
+            unsigned char rgb[3] = { (unsigned char)(p[x] >> 16), (unsigned char)(p[x] >> 8), (unsigned char)p[x] };
+            fwrite(rgb, 1, 3, fp);
+        }
+    }
+    return fclose(fp) == 0;
+}
+
+static double percentile(std::vector<double> v, int pct) {
+    std::sort(v.begin(), v.end());
+    return v[(v.size() - 1) * pct / 100];
+}
+
+/* One placement per game per frame; finished games restart */
+static void step_games(std::vector<GameState>& games, uint32_t* next_seed) {
+    for (GameState& g : games) {
+        BotMove mv;
+        if (g.game_over || !bot_search(&g, &bot_default_weights, 0, NULL, &mv))
+            state_init(&g, (*next_seed)++);
+        else
+            bot_apply(&g, &mv);
+    }
+}
+
+int main(int argc, char** argv) {
+    int frames = 200, only_boards = 0, only_rows = 0;
+    uint32_t seed = 1;
+    const char* write_path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        const char* v = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!strcmp(a, "--help")) { usage(); return 0; }
+        if (!v) { usage(); return 1; }
+        if (!strcmp(a, "--frames")) frames = atoi(v);
+        else if (!strcmp(a, "--boards")) only_boards = atoi(v);
+        else if (!strcmp(a, "--rows")) only_rows = atoi(v);
+        else if (!strcmp(a, "--seed")) seed = (uint32_t)strtoul(v, NULL, 10);
+        else if (!strcmp(a, "--write")) write_path = v;
+        else { usage(); return 1; }
+        i++;
+    }
+    if (frames < 1) frames = 1;
+
+    SoftFrame frame;
+    if (!soft_frame_init(&frame, RENDER_WINDOW_WIDTH, RENDER_WINDOW_HEIGHT)) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    const int counts[] = { 1, 10, 25, 50, 100 };
+    const int heights[] = { 20, 30 };
+    uint32_t bg = soft_premultiply(render_palette[RCOL_BG]);
+    int over_budget = 0;
+
+    printf("boards rows cell  rects  build_ms  draw_ms  p99_ms  max_ms\n");
+    for (int rows : heights) {
+        if (only_rows && rows != only_rows) continue;
+        for (int boards : counts) {
+            if (only_boards) boards = only_boards;
+            SpectateLayout layout;
+            SpectateBatch batch;
+            if (!spectate_layout(&layout, boards, rows, 0, 50, frame.width, frame.height - 50) ||
+                !spectate_batch_init(&batch, boards, rows)) {
+                fprintf(stderr, "%d boards do not fit\n", boards);
+                return 1;
+            }
+            uint32_t next_seed = seed;
+            std::vector<GameState> games(boards);
+            for (GameState& g : games) state_init(&g, next_seed++);
+            /* Warm up so boards have stacks on them */
+            for (int i = 0; i < 40; i++) step_games(games, &next_seed);
+
+            std::vector<double> build_ms, total_ms;
+            for (int n = 0; n < frames; n++) {
+                step_games(games, &next_seed);
+                auto t0 = std::chrono::steady_clock::now();
+                spectate_build(&layout, games.data(), boards, &batch);
+                auto t1 = std::chrono::steady_clock::now();
+                soft_fill_span(frame.pixels, frame.stride * frame.height, bg);
+                for (int b = 0; b < SPECTATE_BUCKETS; b++)
+                    soft_fill_rects(&frame, batch.rect + batch.start[b], batch.count[b],
+                                    soft_premultiply(render_palette[spectate_bucket_color[b]]));
+                auto t2 = std::chrono::steady_clock::now();
+                build_ms.push_back(std::chrono::duration<double, std::milli>(t1 - t0).count());
+                total_ms.push_back(std::chrono::duration<double, std::milli>(t2 - t0).count());
+            }
+            double build = 0, total = 0, worst = 0;
+            for (int i = 0; i < frames; i++) {
+                build += build_ms[i];
+                total += total_ms[i];
+                if (total_ms[i] > worst) worst = total_ms[i];
+            }
+            double p99 = percentile(total_ms, 99);
+            printf("%6d %4d %4d %6d  %8.3f %8.3f %7.3f %7.3f%s\n", boards, rows, layout.pitch, batch.total,
+                   build / frames, (total - build) / frames, p99, worst,
+                   p99 > FRAME_BUDGET_MS ? "  over budget" : "");
+            if (p99 > FRAME_BUDGET_MS) over_budget = 1;
+
+            if (write_path && boards == SPECTATE_MAX_BOARDS && !write_ppm(write_path, &frame)) {
+                fprintf(stderr, "cannot write %s\n", write_path);
+                return 1;
+            }
+            spectate_batch_free(&batch);
+            if (only_boards) break;
+        }
+    }
+    soft_frame_free(&frame);
+    return over_budget ? 2 : 0;
+}
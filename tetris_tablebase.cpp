@@ -0,0 +1,271 @@
+#include "tetris_tablebase.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+struct Tablebase {
+    void* base;
+    size_t size;
+    void* handle;
+    const TbHeader* header;
+    const uint32_t* disp;
+    const uint64_t* keys;
+    const float* survive;
+    const float* lines;
+};
+
+int tb_geometry(TbGeometry* g, int width, int height) {
+    if (width < 4 || height < 4 || width * height > 64) return 0;
+    g->width = width;
+    g->height = height;
+    g->full_row = (1ull << width) - 1;
+    g->board_mask = width * height == 64 ? ~0ull : (1ull << (width * height)) - 1;
+    return 1;
+}
+
+/* Piece bits at (px, py), or 0 if any cell falls outside the board */
+static uint64_t piece_bits(const TbGeometry* g, int piece, int rot, int px, int py) {
+    uint16_t m = get_mask(piece, rot);
+    uint64_t bits = 0;
+    for (int i = 0; i < 16; i++) {
+        if ((m >> i) & 1u) {
+            int x = i % 4 + px;
+            int y = i / 4 + py;
+            if (x < 0 || x >= g->width || y < 0 || y >= g->height) return 0;
+            bits |= 1ull << (y * g->width + x);
+        }
+    }
+    return bits;
+}
+
+static uint64_t clear_rows(const TbGeometry* g, uint64_t b, int* lines) {
+    int cleared = 0;
+    for (int y = g->height - 1; y >= 0; y--) {
+        uint64_t row = g->full_row << (y * g->width);
+        if ((b & row) == row) {
+            uint64_t low = (1ull << (y * g->width)) - 1;   /* rows 0 .. y-1 */
+            uint64_t above = b & low;
+            uint64_t below = b & ~(row | low);
+            b = (below | (above << g->width)) & g->board_mask;
+            cleared++;
+            y++;
+        }
+    }
+    *lines = cleared;
+    return b;
+}
+
+int tb_placements(const TbGeometry* g, uint64_t board, int piece, TbPlacement* out) {
+    uint64_t bottom_row = g->full_row << ((g->height - 1) * g->width);
+    uint64_t seen[TB_MAX_PLACEMENTS];
+    int n = 0;
+    for (int rot = 0; rot < 4; rot++) {
+        for (int px = -3; px < g->width; px++) {
+            uint64_t bits = piece_bits(g, piece, rot, px, 0);
+            if (!bits || (bits & board)) continue;
+            int py = 0;
+            while (!(bits & bottom_row) && !((bits << g->width) & board)) {
+                bits <<= g->width;
+                py++;
+            }
+            int dup = 0;
+            for (int i = 0; i < n; i++) {
+                if (seen[i] == bits) { dup = 1; break; }
+            }
+            if (dup || n >= TB_MAX_PLACEMENTS) continue;
+            seen[n] = bits;
+            out[n].board = clear_rows(g, board | bits, &out[n].lines);
+            out[n].rot = rot;
+            out[n].x = px;
+            out[n].y = py;
+            n++;
+        }
+    }
+    return n;
+}
+
+static uint64_t mix64(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ull;
+    x ^= x >> 33;
+    return x;
+}
+
+uint64_t tb_bucket(uint64_t key, uint64_t seed, uint64_t buckets) {
+    return mix64(key ^ seed) % buckets;
+}
+
+uint64_t tb_slot(uint64_t key, uint64_t seed, uint32_t disp, uint64_t slots) {
+    return mix64(key + (seed ^ (0x9E3779B97F4A7C15ull * (disp + 1ull)))) % slots;
+}
+
+#ifdef _WIN32
+void* tb_map_file(const char* path, size_t* size, int writable, void** handle) {
+    HANDLE file = CreateFileA(path, writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ,
+                              FILE_SHARE_READ, NULL, writable ? CREATE_ALWAYS : OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return NULL;
+    if (!writable) {
+        LARGE_INTEGER li;
+        GetFileSizeEx(file, &li);
+        *size = (size_t)li.QuadPart;
+    }
+    HANDLE mapping = CreateFileMappingA(file, NULL, writable ? PAGE_READWRITE : PAGE_READONLY,
+                                        (DWORD)((uint64_t)*size >> 32), (DWORD)*size, NULL);
+    CloseHandle(file);
+    if (!mapping) return NULL;
+    void* base = MapViewOfFile(mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, *size);
+    if (!base) {
+        CloseHandle(mapping);
+        return NULL;
+    }
+    *handle = mapping;
+    return base;
+}
+
+void tb_unmap_file(void* base, size_t size, void* handle) {
+    (void)size;
+    if (base) UnmapViewOfFile(base);
+    if (handle) CloseHandle((HANDLE)handle);
+}
+#else
+void* tb_map_file(const char* path, size_t* size, int writable, void** handle) {
+    int fd = writable ? open(path, O_RDWR | O_CREAT | O_TRUNC, 0644) : open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+    if (writable) {
+        if (ftruncate(fd, (off_t)*size) != 0) {
+            close(fd);
+            return NULL;
+        }
+    } else {
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            close(fd);
+            return NULL;
+        }
+        *size = (size_t)st.st_size;
+    }
+    void* base = mmap(NULL, *size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return NULL;
+    *handle = NULL;
+    return base;
+}
+
+void tb_unmap_file(void* base, size_t size, void* handle) {
+    (void)handle;
+    if (base) munmap(base, size);
+}
+#endif
+
+/* An array of count elements at offset lies aligned and wholly inside a
+   file of size bytes */
+static int section_fits(uint64_t offset, uint64_t count, uint64_t elem, uint64_t size) {
+    return offset % elem == 0 && offset >= sizeof(TbHeader) && offset <= size &&
+           count <= (size - offset) / elem;
+}
+
+/* Every array the lookups index must fit the mapping; nothing else in the
+   file is trusted */
+static int header_valid(const TbHeader* h, size_t size) {
+    TbGeometry g;
+    return size >= sizeof(TbHeader) && memcmp(h->magic, "TETRISTB", 8) == 0 &&
+           h->version == TB_VERSION && h->file_size == size && h->width <= 64 && h->height <= 64 &&
+           tb_geometry(&g, (int)h->width, (int)h->height) && h->buckets > 0 && h->slots > 0 &&
+           section_fits(h->disp_offset, h->buckets, sizeof(uint32_t), size) &&
+           section_fits(h->keys_offset, h->slots, sizeof(uint64_t), size) &&
+           section_fits(h->survive_offset, h->slots, sizeof(float), size) &&
+           section_fits(h->lines_offset, h->slots, sizeof(float), size);
+}
+
+Tablebase* tablebase_open(const char* path) {
+    size_t size = 0;
+    void* handle = NULL;
+    void* base = tb_map_file(path, &size, 0, &handle);
+    if (!base) return NULL;
+    const TbHeader* h = (const TbHeader*)base;
+    if (!header_valid(h, size)) {
+        tb_unmap_file(base, size, handle);
+        return NULL;
+    }
+    Tablebase* tb = (Tablebase*)malloc(sizeof(Tablebase));
+    if (!tb) {
+        tb_unmap_file(base, size, handle);
+        return NULL;
+    }
+    const char* p = (const char*)base;
+    tb->base = base;
+    tb->size = size;
+    tb->handle = handle;
+    tb->header = h;
+    tb->disp = (const uint32_t*)(p + h->disp_offset);
+    tb->keys = (const uint64_t*)(p + h->keys_offset);
+    tb->survive = (const float*)(p + h->survive_offset);
+    tb->lines = (const float*)(p + h->lines_offset);
+    return tb;
+}
+
+void tablebase_close(Tablebase* tb) {
+    if (!tb) return;
+    tb_unmap_file(tb->base, tb->size, tb->handle);
+    free(tb);
+}
+
+const TbHeader* tablebase_header(const Tablebase* tb) {
+    return tb->header;
+}
+
+/* Two hashes and one compare, whatever the table size */
+int tablebase_lookup(const Tablebase* tb, uint64_t board, TbEntry* out) {
+    const TbHeader* h = tb->header;
+    uint32_t d = tb->disp[tb_bucket(board, h->seed, h->buckets)];
+    uint64_t slot = tb_slot(board, h->seed, d, h->slots);
+    if (tb->keys[slot] != board) return 0;
+    out->survive = tb->survive[slot];
+    out->expected_lines = tb->lines[slot];
+    return 1;
+}
+
+/* The placement most likely to survive the horizon; among equally safe
+   ones, the most lines now and expected */
+int tablebase_best_placement(const Tablebase* tb, uint64_t board, int piece, TbPlacement* out) {
+    TbGeometry g;
+    if (!tb_geometry(&g, (int)tb->header->width, (int)tb->header->height)) return 0;
+    TbPlacement places[TB_MAX_PLACEMENTS];
+    int n = tb_placements(&g, board, piece, places);
+    int found = 0;
+    float best_survive = 0.0f;
+    double best_lines = 0.0;
+    for (int i = 0; i < n; i++) {
+        TbEntry e;
+        if (!tablebase_lookup(tb, places[i].board, &e)) continue;
+        double lines = places[i].lines + e.expected_lines;
+        if (!found || e.survive > best_survive || (e.survive == best_survive && lines > best_lines)) {
+            best_survive = e.survive;
+            best_lines = lines;
+            *out = places[i];
+            found = 1;
+        }
+    }
+    return found;
+}
+
+uint64_t tablebase_board_bits(const int b[HEIGHT][WIDTH]) {
+    if (WIDTH * HEIGHT > 64) return TB_EMPTY_KEY;
+    uint64_t bits = 0;
+    for (int y = 0; y < HEIGHT; y++)
+        for (int x = 0; x < WIDTH; x++)
+            if (b[y][x]) bits |= 1ull << (y * WIDTH + x);
+    return bits;
+}
@@ -0,0 +1,78 @@
+#ifndef TETRIS_TABLEBASE_H
+#define TETRIS_TABLEBASE_H
+
+#include <stddef.h>
+#include "tetris_core.h"
+
+/* Exact-play tables for narrow boards (width * height <= 64).
+   A board is a bitboard, bit y * width + x, row 0 at the top. Placements
+   follow the bot's model: rotate and shift at the spawn row, then hard
+   drop; a piece with no such placement ends the game.
+
+   Per board the file stores, over the build horizon of uniformly random
+   pieces:
+   - survive: the chance of placing every one of them, playing for that
+   - expected_lines: lines cleared with best play, a dead end counting
+     nothing from there on */
+
+#define TB_MAX_PLACEMENTS 64
+#define TB_VERSION 2
+
+typedef struct {
+    int width, height;
+    uint64_t full_row;    /* bits of row 0 */
+    uint64_t board_mask;  /* all width * height bits */
+} TbGeometry;
+
+typedef struct {
+    uint64_t board;       /* board after lock and line clear */
+    int lines;
+    int rot, x, y;
+} TbPlacement;
+
+typedef struct {
+    float survive;
+    float expected_lines;
+} TbEntry;
+
+/* Header of a tablebase file; the arrays follow it in this order:
+   uint32 disp[buckets], uint64 keys[slots], float survive[slots],
+   float expected_lines[slots] */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t width, height;
+    uint32_t horizon;
+    uint64_t states;
+    uint64_t slots;
+    uint64_t buckets;
+    uint64_t seed;
+    uint64_t disp_offset, keys_offset, survive_offset, lines_offset;
+    uint64_t file_size;
+} TbHeader;
+
+typedef struct Tablebase Tablebase;
+
+#define TB_EMPTY_KEY 0xFFFFFFFFFFFFFFFFull
+
+/* Bitboard rules */
+int tb_geometry(TbGeometry* g, int width, int height);
+int tb_placements(const TbGeometry* g, uint64_t board, int piece, TbPlacement* out);
+
+/* Perfect hash (hash and displace): key -> slot with no collisions */
+uint64_t tb_bucket(uint64_t key, uint64_t seed, uint64_t buckets);
+uint64_t tb_slot(uint64_t key, uint64_t seed, uint32_t disp, uint64_t slots);
+
+/* Memory-mapped files */
+void* tb_map_file(const char* path, size_t* size, int writable, void** handle);
+void tb_unmap_file(void* base, size_t size, void* handle);
+
+/* Play-time access */
+Tablebase* tablebase_open(const char* path);
+void tablebase_close(Tablebase* tb);
+const TbHeader* tablebase_header(const Tablebase* tb);
+int tablebase_lookup(const Tablebase* tb, uint64_t board, TbEntry* out);
+int tablebase_best_placement(const Tablebase* tb, uint64_t board, int piece, TbPlacement* out);
+uint64_t tablebase_board_bits(const int b[HEIGHT][WIDTH]);
+
+#endif /* TETRIS_TABLEBASE_H */
@@ -0,0 +1,443 @@
+// Tablebase builder - enumerates every reachable board of a narrow variant,
+// solves survival and expected lines over a horizon of random pieces on all
+// cores and writes a mapped table
+// Build: g++ -O2 -std=c++17 -pthread tetris_tablebase_build.cpp tetris_tablebase.cpp tetris_core.cpp -o tetris_tablebase_build
+//        cl /O2 /std:c++17 /EHsc tetris_tablebase_build.cpp tetris_tablebase.cpp tetris_core.cpp
+// Usage: tetris_tablebase_build --width 4 --height 6 --horizon 20 --out tb_4x6.bin
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "tetris_tablebase.h"
+
+#define TB_SEED 0x5445545249535442ull
+#define SPILL_BATCH 4096
+
+typedef struct {
+    int width, height;
+    int horizon;
+    int threads;
+    int partitions;
+    size_t mem_bytes;
+    const char* work;
+    const char* out;
+} BuildConfig;
+
+static double now_seconds(void) {
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+static void part_path(char* buf, size_t n, const BuildConfig* cfg, const char* kind, int part) {
+    snprintf(buf, n, "%s/tb_%s_%03d.bin", cfg->work, kind, part);
+}
+
+static int partition_of(uint64_t key, int partitions) {
+    return (int)((key * 0x9E3779B97F4A7C15ull) >> 40) % partitions;
+}
+
+static std::vector<uint64_t> read_keys(const char* path) {
+    std::vector<uint64_t> keys;
+    FILE* f = fopen(path, "rb");
+    if (!f) return keys;
+    fseek(f, 0, SEEK_END);
+    long bytes = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    keys.resize((size_t)bytes / sizeof(uint64_t));
+    if (!keys.empty() && fread(keys.data(), sizeof(uint64_t), keys.size(), f) != keys.size())
+        keys.clear();
+    fclose(f);
+    return keys;
+}
+
+static int write_keys(const char* path, const uint64_t* keys, size_t n, const char* mode) {
+    FILE* f = fopen(path, mode);
+    if (!f) return 0;
+    size_t written = n ? fwrite(keys, sizeof(uint64_t), n, f) : 0;
+    return fclose(f) == 0 && written == n;
+}
+
+/* Candidate boards spill to one file per partition, so no partition
+   ever has to hold more than its own share of the state space */
+typedef struct {
+    std::vector<FILE*> files;
+    std::vector<std::mutex> locks;
+} SpillFiles;
+
+static void expand_frontier(const BuildConfig* cfg, const TbGeometry* g,
+                            const std::vector<uint64_t>& frontier, SpillFiles* spill) {
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        std::vector<std::vector<uint64_t>> out(cfg->partitions);
+        auto flush = [&](int p) {
+            std::lock_guard<std::mutex> lock(spill->locks[p]);
+            fwrite(out[p].data(), sizeof(uint64_t), out[p].size(), spill->files[p]);
+            out[p].clear();
+        };
+        for (;;) {
+            size_t start = next.fetch_add(256);
+            if (start >= frontier.size()) break;
+            size_t end = std::min(frontier.size(), start + 256);
+            for (size_t i = start; i < end; i++) {
+                for (int piece = 0; piece < 7; piece++) {
+                    TbPlacement places[TB_MAX_PLACEMENTS];
+                    int n = tb_placements(g, frontier[i], piece, places);
+                    for (int k = 0; k < n; k++) {
+                        int p = partition_of(places[k].board, cfg->partitions);
+                        out[p].push_back(places[k].board);
+                        if (out[p].size() >= SPILL_BATCH) flush(p);
+                    }
+                }
+            }
+        }
+        for (int p = 0; p < cfg->partitions; p++)
+            if (!out[p].empty()) flush(p);
+    };
+    std::vector<std::thread> pool;
+    for (int t = 1; t < cfg->threads; t++) pool.emplace_back(worker);
+    worker();
+    for (auto& th : pool) th.join();
+}
+
+/* Breadth-first closure from the empty board, one partition in memory at a time */
+static uint64_t enumerate_states(const BuildConfig* cfg, const TbGeometry* g) {
+    char path[1024];
+    for (int p = 0; p < cfg->partitions; p++) {
+        part_path(path, sizeof(path), cfg, "visited", p);
+        write_keys(path, NULL, 0, "wb");
+        part_path(path, sizeof(path), cfg, "frontier", p);
+        write_keys(path, NULL, 0, "wb");
+    }
+    uint64_t empty = 0;
+    part_path(path, sizeof(path), cfg, "frontier", partition_of(empty, cfg->partitions));
+    write_keys(path, &empty, 1, "wb");
+    part_path(path, sizeof(path), cfg, "visited", partition_of(empty, cfg->partitions));
+    write_keys(path, &empty, 1, "wb");
+
+    uint64_t total = 1;
+    for (int level = 0;; level++) {
+        double t0 = now_seconds();
+        SpillFiles spill;
+        spill.files.resize(cfg->partitions);
+        spill.locks = std::vector<std::mutex>(cfg->partitions);
+        for (int p = 0; p < cfg->partitions; p++) {
+            part_path(path, sizeof(path), cfg, "cand", p);
+            spill.files[p] = fopen(path, "wb");
+            if (!spill.files[p]) {
+                fprintf(stderr, "cannot write %s\n", path);
+                exit(1);
+            }
+        }
+        uint64_t expanded = 0;
+        for (int p = 0; p < cfg->partitions; p++) {
+            part_path(path, sizeof(path), cfg, "frontier", p);
+            std::vector<uint64_t> frontier = read_keys(path);
+            expanded += frontier.size();
+            expand_frontier(cfg, g, frontier, &spill);
+        }
+        for (int p = 0; p < cfg->partitions; p++) fclose(spill.files[p]);
+        if (expanded == 0) break;
+
+        uint64_t discovered = 0;
+        for (int p = 0; p < cfg->partitions; p++) {
+            part_path(path, sizeof(path), cfg, "cand", p);
+            std::vector<uint64_t> cand = read_keys(path);
+            std::sort(cand.begin(), cand.end());
+            cand.erase(std::unique(cand.begin(), cand.end()), cand.end());
+
+            part_path(path, sizeof(path), cfg, "visited", p);
+            std::vector<uint64_t> visited = read_keys(path);
+            std::vector<uint64_t> fresh;
+            std::set_difference(cand.begin(), cand.end(), visited.begin(), visited.end(),
+                                std::back_inserter(fresh));
+            std::vector<uint64_t> merged;
+            merged.reserve(visited.size() + fresh.size());
+            std::merge(visited.begin(), visited.end(), fresh.begin(), fresh.end(),
+                       std::back_inserter(merged));
+            write_keys(path, merged.data(), merged.size(), "wb");
+            part_path(path, sizeof(path), cfg, "frontier", p);
+            write_keys(path, fresh.data(), fresh.size(), "wb");
+            discovered += fresh.size();
+        }
+        total += discovered;
+        printf("  level %3d: expanded %10llu, new %10llu, total %10llu  (%.2fs)\n", level,
+               (unsigned long long)expanded, (unsigned long long)discovered,
+               (unsigned long long)total, now_seconds() - t0);
+        fflush(stdout);
+    }
+    for (int p = 0; p < cfg->partitions; p++) {
+        part_path(path, sizeof(path), cfg, "cand", p);
+        remove(path);
+        part_path(path, sizeof(path), cfg, "frontier", p);
+        remove(path);
+    }
+    return total;
+}
+
+static uint64_t align_up(uint64_t v, uint64_t a) {
+    return (v + a - 1) / a * a;
+}
+
+/* Hash and displace: place big buckets first, each with the first
+   displacement that lands all of its keys in free slots */
+static int build_hash(const BuildConfig* cfg, TbHeader* h, uint32_t* disp, uint64_t* keys) {
+    char path[1024];
+    std::vector<uint64_t> bucket_start(h->buckets + 1, 0);
+    for (int p = 0; p < cfg->partitions; p++) {
+        part_path(path, sizeof(path), cfg, "visited", p);
+        for (uint64_t k : read_keys(path)) bucket_start[tb_bucket(k, h->seed, h->buckets) + 1]++;
+    }
+    for (uint64_t b = 0; b < h->buckets; b++) bucket_start[b + 1] += bucket_start[b];
+
+    /* Bucket contents go to a mapped scratch file rather than the heap */
+    part_path(path, sizeof(path), cfg, "buckets", 0);
+    size_t scratch_size = (size_t)(h->states ? h->states : 1) * sizeof(uint64_t);
+    void* scratch_handle = NULL;
+    uint64_t* grouped = (uint64_t*)tb_map_file(path, &scratch_size, 1, &scratch_handle);
+    if (!grouped) return 0;
+    std::vector<uint64_t> fill(bucket_start.begin(), bucket_start.end() - 1);
+    for (int p = 0; p < cfg->partitions; p++) {
+        part_path(path, sizeof(path), cfg, "visited", p);
+        for (uint64_t k : read_keys(path)) grouped[fill[tb_bucket(k, h->seed, h->buckets)]++] = k;
+    }
+
+    std::vector<uint32_t> order(h->buckets);
+    for (uint64_t b = 0; b < h->buckets; b++) order[b] = (uint32_t)b;
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        return bucket_start[a + 1] - bucket_start[a] > bucket_start[b + 1] - bucket_start[b];
+    });
+
+    for (uint64_t s = 0; s < h->slots; s++) keys[s] = TB_EMPTY_KEY;
+    int ok = 1;
+    for (uint64_t i = 0; i < h->buckets && ok; i++) {
+        uint32_t b = order[i];
+        uint64_t first = bucket_start[b], count = bucket_start[b + 1] - first;
+        disp[b] = 0;
+        if (count == 0) continue;
+        uint64_t slots[64];
+        if (count > 64) { ok = 0; break; }
+        for (uint32_t d = 0;; d++) {
+            if (d == 0x00FFFFFFu) { ok = 0; break; }
+            int fits = 1;
+            for (uint64_t j = 0; j < count && fits; j++) {
+                slots[j] = tb_slot(grouped[first + j], h->seed, d, h->slots);
+                if (keys[slots[j]] != TB_EMPTY_KEY) fits = 0;
+                for (uint64_t q = 0; q < j && fits; q++)
+                    if (slots[q] == slots[j]) fits = 0;
+            }
+            if (!fits) continue;
+            for (uint64_t j = 0; j < count; j++) keys[slots[j]] = grouped[first + j];
+            disp[b] = d;
+            break;
+        }
+    }
+    tb_unmap_file(grouped, scratch_size, scratch_handle);
+    part_path(path, sizeof(path), cfg, "buckets", 0);
+    remove(path);
+    return ok;
+}
+
+static uint64_t lookup_slot(const TbHeader* h, const uint32_t* disp, const uint64_t* keys, uint64_t board) {
+    uint64_t s = tb_slot(board, h->seed, disp[tb_bucket(board, h->seed, h->buckets)], h->slots);
+    return keys[s] == board ? s : TB_EMPTY_KEY;
+}
+
+/* Run fn(begin, end) over slot ranges on all threads */
+template <typename Fn>
+static void parallel_slots(const BuildConfig* cfg, uint64_t slots, Fn fn) {
+    std::atomic<uint64_t> next(0);
+    auto worker = [&]() {
+        for (;;) {
+            uint64_t begin = next.fetch_add(4096);
+            if (begin >= slots) break;
+            fn(begin, std::min(slots, begin + 4096));
+        }
+    };
+    std::vector<std::thread> pool;
+    for (int t = 1; t < cfg->threads; t++) pool.emplace_back(worker);
+    worker();
+    for (auto& th : pool) th.join();
+}
+
+/* Backward induction over the horizon, both values at once. With k pieces
+   to go, a board's survival S_k is the mean over pieces of the best
+   S_k-1 among its placements, and its expected lines V_k the mean of the
+   best (lines + V_k-1); a piece with no placement counts 0 for both.
+   S_0 = 1, V_0 = 0. Survival plays for survival, lines for lines. */
+static void solve_horizon(const BuildConfig* cfg, const TbGeometry* g, const TbHeader* h,
+                          const uint32_t* disp, const uint64_t* keys, float* survive, float* lines) {
+    std::vector<float> next_survive(h->slots), next_lines(h->slots);
+    for (uint64_t s = 0; s < h->slots; s++) {
+        survive[s] = keys[s] != TB_EMPTY_KEY ? 1.0f : 0.0f;
+        lines[s] = 0.0f;
+    }
+    for (int k = 1; k <= cfg->horizon; k++) {
+        parallel_slots(cfg, h->slots, [&](uint64_t begin, uint64_t end) {
+            for (uint64_t s = begin; s < end; s++) {
+                if (keys[s] == TB_EMPTY_KEY) {
+                    next_survive[s] = 0.0f;
+                    next_lines[s] = 0.0f;
+                    continue;
+                }
+                double survive_sum = 0.0, lines_sum = 0.0;
+                for (int piece = 0; piece < 7; piece++) {
+                    TbPlacement places[TB_MAX_PLACEMENTS];
+                    int n = tb_placements(g, keys[s], piece, places);
+                    double best_survive = 0.0, best_lines = 0.0;
+                    for (int i = 0; i < n; i++) {
+                        uint64_t t = lookup_slot(h, disp, keys, places[i].board);
+                        double sv = t != TB_EMPTY_KEY ? survive[t] : 0.0f;
+                        double v = places[i].lines + (t != TB_EMPTY_KEY ? lines[t] : 0.0f);
+                        if (sv > best_survive) best_survive = sv;
+                        if (v > best_lines) best_lines = v;
+                    }
+                    survive_sum += best_survive;
+                    lines_sum += best_lines;
+                }
+                next_survive[s] = (float)(survive_sum / 7.0);
+                next_lines[s] = (float)(lines_sum / 7.0);
+            }
+        });
+        memcpy(survive, next_survive.data(), h->slots * sizeof(float));
+        memcpy(lines, next_lines.data(), h->slots * sizeof(float));
+    }
+}
+
+static void usage(void) {
+    printf("Usage: tetris_tablebase_build [options]\n"
+           "  --width N       board width, 4..16 (default 4)\n"
+           "  --height N      board height, width * height <= 64 (default 6)\n"
+           "  --horizon N     pieces of lookahead for survival and lines (default 20)\n"
+           "  --threads N     worker threads (default: all cores)\n"
+           "  --mem-mb N      memory for one partition of states (default 1024)\n"
+           "  --partitions N  override the partition count\n"
+           "  --work DIR      directory for partition files (default .)\n"
+           "  --out FILE      output table (default tablebase.bin)\n");
+}
+
+int main(int argc, char** argv) {
+    BuildConfig cfg;
+    cfg.width = 4;
+    cfg.height = 6;
+    cfg.horizon = 20;
+    cfg.threads = (int)std::thread::hardware_concurrency();
+    cfg.partitions = 0;
+    cfg.mem_bytes = (size_t)1024 << 20;
+    cfg.work = ".";
+    cfg.out = "tablebase.bin";
+
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        const char* v = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!strcmp(a, "--help")) { usage(); return 0; }
+        if (!v) { usage(); return 1; }
+        if (!strcmp(a, "--width")) cfg.width = atoi(v);
+        else if (!strcmp(a, "--height")) cfg.height = atoi(v);
+        else if (!strcmp(a, "--horizon")) cfg.horizon = atoi(v);
+        else if (!strcmp(a, "--threads")) cfg.threads = atoi(v);
+        else if (!strcmp(a, "--mem-mb")) cfg.mem_bytes = (size_t)atoi(v) << 20;
+        else if (!strcmp(a, "--partitions")) cfg.partitions = atoi(v);
+        else if (!strcmp(a, "--work")) cfg.work = v;
+        else if (!strcmp(a, "--out")) cfg.out = v;
+        else { usage(); return 1; }
+        i++;
+    }
+    if (cfg.threads < 1) cfg.threads = 1;
+
+    TbGeometry g;
+    if (!tb_geometry(&g, cfg.width, cfg.height)) {
+        fprintf(stderr, "board must be at least 4x4 with at most 64 cells\n");
+        return 1;
+    }
+
+    /* Worst case is every bit pattern; a partition needs its visited set
+       plus candidates (about three key arrays) in memory at once */
+    if (cfg.partitions <= 0) {
+        double worst = 3.0 * 8.0 * (double)(1ull << (g.width * g.height > 40 ? 40 : g.width * g.height));
+        double parts = worst / (double)(cfg.mem_bytes ? cfg.mem_bytes : 1);
+        cfg.partitions = parts < 1.0 ? 1 : parts > 256.0 ? 256 : (int)parts + 1;
+    }
+    printf("tablebase %dx%d, horizon %d, %d threads, %d partitions\n",
+           cfg.width, cfg.height, cfg.horizon, cfg.threads, cfg.partitions);
+
+    double t0 = now_seconds();
+    uint64_t states = enumerate_states(&cfg, &g);
+    double t1 = now_seconds();
+    printf("enumerated %llu states in %.2fs\n", (unsigned long long)states, t1 - t0);
+
+    TbHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, "TETRISTB", 8);
+    h.version = TB_VERSION;
+    h.width = (uint32_t)cfg.width;
+    h.height = (uint32_t)cfg.height;
+    h.horizon = (uint32_t)cfg.horizon;
+    h.states = states;
+    h.slots = states + states / 8 + 1;
+    h.buckets = states / 4 + 1;
+    h.seed = TB_SEED;
+    h.disp_offset = align_up(sizeof(TbHeader), 64);
+    h.keys_offset = align_up(h.disp_offset + h.buckets * sizeof(uint32_t), 64);
+    h.survive_offset = align_up(h.keys_offset + h.slots * sizeof(uint64_t), 64);
+    h.lines_offset = align_up(h.survive_offset + h.slots * sizeof(float), 64);
+    h.file_size = h.lines_offset + h.slots * sizeof(float);
+
+    size_t size = (size_t)h.file_size;
+    void* handle = NULL;
+    char* base = (char*)tb_map_file(cfg.out, &size, 1, &handle);
+    if (!base) {
+        fprintf(stderr, "cannot map %s\n", cfg.out);
+        return 1;
+    }
+    uint32_t* disp = (uint32_t*)(base + h.disp_offset);
+    uint64_t* keys = (uint64_t*)(base + h.keys_offset);
+    float* survive = (float*)(base + h.survive_offset);
+    float* lines = (float*)(base + h.lines_offset);
+
+    if (!build_hash(&cfg, &h, disp, keys)) {
+        fprintf(stderr, "perfect hash construction failed\n");
+        tb_unmap_file(base, size, handle);
+        return 1;
+    }
+    double t2 = now_seconds();
+    printf("perfect hash over %llu slots in %.2fs\n", (unsigned long long)h.slots, t2 - t1);
+
+    solve_horizon(&cfg, &g, &h, disp, keys, survive, lines);
+    double t4 = now_seconds();
+    uint64_t empty_slot = lookup_slot(&h, disp, keys, 0);
+    uint64_t certain = 0, doomed = 0;
+    for (uint64_t s = 0; s < h.slots; s++) {
+        if (keys[s] == TB_EMPTY_KEY) continue;
+        certain += survive[s] == 1.0f;
+        doomed += survive[s] == 0.0f;
+    }
+    printf("horizon %d solved in %.2fs: empty board survives with p %.4f and clears %.3f lines\n",
+           cfg.horizon, t4 - t2, empty_slot != TB_EMPTY_KEY ? survive[empty_slot] : 0.0f,
+           empty_slot != TB_EMPTY_KEY ? lines[empty_slot] : 0.0f);
+    printf("survival: %llu of %llu boards certain, %llu doomed\n", (unsigned long long)certain,
+           (unsigned long long)states, (unsigned long long)doomed);
+    /* horizon pieces bring 4 * horizon cells: no more lines than that fills */
+    if (empty_slot != TB_EMPTY_KEY && lines[empty_slot] > cfg.horizon * 4.0f / cfg.width + 1e-3f) {
+        fprintf(stderr, "expected lines %.3f exceed the %d that %d pieces can clear\n", lines[empty_slot],
+                cfg.horizon * 4 / cfg.width, cfg.horizon);
+        tb_unmap_file(base, size, handle);
+        return 1;
+    }
+
+    /* Header last, so a crashed build never looks like a valid table */
+    memcpy(base, &h, sizeof(h));
+    tb_unmap_file(base, size, handle);
+
+    char path[1024];
+    for (int p = 0; p < cfg.partitions; p++) {
+        part_path(path, sizeof(path), &cfg, "visited", p);
+        remove(path);
+    }
+    printf("wrote %s (%.1f MB) in %.2fs total\n", cfg.out, h.file_size / 1048576.0, t4 - t0);
+    return 0;
+}
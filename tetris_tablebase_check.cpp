@@ -0,0 +1,279 @@
+// Tablebase check - placements and line clears on known boards, cell
+// counts over random boards, expected lines from the empty board against
+// what the pieces can possibly clear, and a small table made by the
+// builder, read back through tablebase_open and compared state by state
+// with a recursion of its own
+// Build: g++ -O2 -std=c++17 tetris_tablebase_check.cpp tetris_tablebase.cpp tetris_core.cpp -o tetris_tablebase_check
+//        cl /O2 /std:c++17 /EHsc tetris_tablebase_check.cpp tetris_tablebase.cpp tetris_core.cpp
+// Usage: tetris_tablebase_check                 (exit status 1 on any failure;
+//                                                runs ./tetris_tablebase_build)
+//        tetris_tablebase_check --builder PATH
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unordered_map>
+#include <vector>
+#include "tetris_tablebase.h"
+
+#define TABLE_WIDTH 4
+#define TABLE_HEIGHT 5
+#define TABLE_HORIZON 6
+#define TABLE_PATH "tetris_tablebase_check.tb"
+
+#ifdef _WIN32
+static const char* builder = "tetris_tablebase_build.exe";
+#else
+static const char* builder = "./tetris_tablebase_build";
+#endif
+
+static int failures = 0;
+
+static void check(int ok, const char* what) {
+    if (!ok) {
+        printf("FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+/* Rows top first, '#' filled */
+static uint64_t parse_board(const TbGeometry* g, const char* const* rows) {
+    uint64_t b = 0;
+    for (int y = 0; y < g->height; y++)
+        for (int x = 0; x < g->width; x++)
+            if (rows[y][x] == '#') b |= 1ull << (y * g->width + x);
+    return b;
+}
+
+static int cells(uint64_t b) {
+    int n = 0;
+    for (; b; b &= b - 1) n++;
+    return n;
+}
+
+/* A vertical I fills the gap in the second row from the bottom: that row
+   clears, the stack above drops one row and the bottom row is untouched */
+static void check_known_clear(void) {
+    TbGeometry g;
+    tb_geometry(&g, 4, 6);
+    static const char* const before[6] = { "....", "....", "....", "....", "###.", "#..#" };
+    static const char* const after[6] = { "....", "....", "...#", "...#", "...#", "#..#" };
+    uint64_t board = parse_board(&g, before), want = parse_board(&g, after);
+    int found = 0;
+    for (int p = 0; p < 7; p++) {
+        TbPlacement out[TB_MAX_PLACEMENTS];
+        int n = tb_placements(&g, board, p, out);
+        for (int i = 0; i < n; i++)
+            if (out[i].lines == 1 && out[i].board == want) found = 1;
+    }
+    check(found, "vertical I clearing one row over '#..#' leaves the rows below it alone");
+}
+
+/* Every placement adds four cells and each cleared line removes a row */
+static void check_cell_counts(void) {
+    static const int sizes[][2] = { {4, 6}, {4, 8}, {5, 8}, {6, 10}, {8, 8} };
+    uint32_t rng = 12345;
+    for (const auto& sz : sizes) {
+        TbGeometry g;
+        tb_geometry(&g, sz[0], sz[1]);
+        int bad = 0;
+        for (int t = 0; t < 2000; t++) {
+            /* Random rows below a random height, never full */
+            uint64_t b = 0;
+            int top = (int)(rng_next(&rng) % (uint32_t)g.height);
+            for (int y = top + 1; y < g.height; y++) {
+                uint64_t row = rng_next(&rng) & g.full_row;
+                if (row == g.full_row) row &= ~(1ull << (rng_next(&rng) % (uint32_t)g.width));
+                b |= row << (y * g.width);
+            }
+            for (int p = 0; p < 7; p++) {
+                TbPlacement out[TB_MAX_PLACEMENTS];
+                int n = tb_placements(&g, b, p, out);
+                for (int i = 0; i < n; i++) {
+                    if (cells(out[i].board) != cells(b) + 4 - out[i].lines * g.width) bad++;
+                    for (int y = 0; y < g.height; y++)
+                        if ((out[i].board >> (y * g.width) & g.full_row) == g.full_row) bad++;
+                }
+            }
+        }
+        char what[96];
+        snprintf(what, sizeof(what), "%dx%d: placements keep the cell count and leave no full row", g.width,
+                 g.height);
+        check(!bad, what);
+    }
+}
+
+/* Expected lines over k pieces from board b, as the builder defines it */
+static double expected_lines(const TbGeometry* g, uint64_t b, int k, std::unordered_map<uint64_t, double>* memo) {
+    if (!k) return 0;
+    auto it = memo[k].find(b);
+    if (it != memo[k].end()) return it->second;
+    double sum = 0;
+    for (int p = 0; p < 7; p++) {
+        TbPlacement out[TB_MAX_PLACEMENTS];
+        int n = tb_placements(g, b, p, out);
+        double best = 0;
+        for (int i = 0; i < n; i++) {
+            double v = out[i].lines + expected_lines(g, out[i].board, k - 1, memo);
+            if (v > best) best = v;
+        }
+        sum += best;
+    }
+    memo[k][b] = sum / 7;
+    return sum / 7;
+}
+
+/* k pieces bring 4k cells, so at most 4k / width lines */
+static void check_expected_bound(void) {
+    TbGeometry g;
+    tb_geometry(&g, 4, 6);
+    std::unordered_map<uint64_t, double> memo[7];
+    for (int k = 1; k <= 6; k++) {
+        double v = expected_lines(&g, 0, k, memo);
+        char what[96];
+        snprintf(what, sizeof(what), "4x6 expected lines over %d pieces %.3f <= %.3f", k, v, k * 4.0 / g.width);
+        check(v <= k * 4.0 / g.width + 1e-9, what);
+        printf("V_%d(empty) = %.3f\n", k, v);
+    }
+}
+
+/* Every board reachable from empty, breadth first */
+static std::vector<uint64_t> enumerate(const TbGeometry* g) {
+    std::vector<uint64_t> states(1, 0);
+    std::unordered_map<uint64_t, int> seen;
+    seen[0] = 0;
+    for (size_t i = 0; i < states.size(); i++) {
+        for (int p = 0; p < 7; p++) {
+            TbPlacement out[TB_MAX_PLACEMENTS];
+            int n = tb_placements(g, states[i], p, out);
+            for (int k = 0; k < n; k++)
+                if (seen.emplace(out[k].board, (int)states.size()).second) states.push_back(out[k].board);
+        }
+    }
+    return states;
+}
+
+static int close_to(double a, double b) {
+    return fabs(a - b) <= 1e-4 * (1.0 + fabs(b));
+}
+
+/* Builds a table with the builder, then checks every state it should hold
+   against survival and expected lines recomputed here, and that
+   best_placement picks a placement nothing beats */
+static void check_table(void) {
+    char cmd[1024];
+    snprintf(cmd, sizeof(cmd), "%s --width %d --height %d --horizon %d --threads 1 --out %s > %s", builder,
+             TABLE_WIDTH, TABLE_HEIGHT, TABLE_HORIZON, TABLE_PATH,
+#ifdef _WIN32
+             "NUL"
+#else
+             "/dev/null"
+#endif
+    );
+    remove(TABLE_PATH);
+    if (system(cmd) != 0) {
+        printf("FAIL: %s\n", cmd);
+        failures++;
+        return;
+    }
+    Tablebase* tb = tablebase_open(TABLE_PATH);
+    check(tb != NULL, "the built table opens");
+    if (!tb) return;
+
+    TbGeometry g;
+    tb_geometry(&g, TABLE_WIDTH, TABLE_HEIGHT);
+    std::vector<uint64_t> states = enumerate(&g);
+    std::unordered_map<uint64_t, size_t> index;
+    for (size_t i = 0; i < states.size(); i++) index[states[i]] = i;
+    const TbHeader* h = tablebase_header(tb);
+    check(h->states == states.size() && h->horizon == TABLE_HORIZON && h->width == TABLE_WIDTH &&
+          h->height == TABLE_HEIGHT, "the header matches the build and the reachable state count");
+
+    /* S_k and V_k for every state, bottom up */
+    size_t n = states.size();
+    std::vector<double> survive(n, 1.0), lines(n, 0.0), next_survive(n), next_lines(n);
+    for (int k = 1; k <= TABLE_HORIZON; k++) {
+        for (size_t i = 0; i < n; i++) {
+            double ss = 0, ls = 0;
+            for (int p = 0; p < 7; p++) {
+                TbPlacement out[TB_MAX_PLACEMENTS];
+                int m = tb_placements(&g, states[i], p, out);
+                double bs = 0, bl = 0;
+                for (int j = 0; j < m; j++) {
+                    size_t t = index[out[j].board];
+                    if (survive[t] > bs) bs = survive[t];
+                    if (out[j].lines + lines[t] > bl) bl = out[j].lines + lines[t];
+                }
+                ss += bs;
+                ls += bl;
+            }
+            next_survive[i] = ss / 7;
+            next_lines[i] = ls / 7;
+        }
+        survive.swap(next_survive);
+        lines.swap(next_lines);
+    }
+
+    int missing = 0, wrong = 0, bad_pick = 0;
+    for (size_t i = 0; i < n; i++) {
+        TbEntry e;
+        if (!tablebase_lookup(tb, states[i], &e)) {
+            missing++;
+            continue;
+        }
+        if (!close_to(e.survive, survive[i]) || !close_to(e.expected_lines, lines[i])) wrong++;
+        for (int p = 0; p < 7; p++) {
+            TbPlacement out[TB_MAX_PLACEMENTS], pick;
+            int m = tb_placements(&g, states[i], p, out);
+            int found = tablebase_best_placement(tb, states[i], p, &pick);
+            if (found != (m > 0)) {
+                bad_pick++;
+                continue;
+            }
+            if (!found) continue;
+            TbEntry pe;
+            tablebase_lookup(tb, pick.board, &pe);
+            double pick_lines = pick.lines + pe.expected_lines;
+            for (int j = 0; j < m; j++) {
+                TbEntry oe;
+                tablebase_lookup(tb, out[j].board, &oe);
+                if (oe.survive > pe.survive ||
+                    (oe.survive == pe.survive && out[j].lines + oe.expected_lines > pick_lines)) {
+                    bad_pick++;
+                    break;
+                }
+            }
+        }
+    }
+    char what[128];
+    snprintf(what, sizeof(what), "all %zu reachable states are in the table (%d missing)", n, missing);
+    check(!missing, what);
+    snprintf(what, sizeof(what), "table values match the recursion (%d differ)", wrong);
+    check(!wrong, what);
+    snprintf(what, sizeof(what), "best_placement picks an argmax (%d bad picks)", bad_pick);
+    check(!bad_pick, what);
+    TbEntry e;
+    check(!tablebase_lookup(tb, 1, &e), "a board no sequence reaches is not found");
+    size_t empty = index[0];
+    printf("%dx%d horizon %d: %zu states, empty board survives with p %.4f and clears %.3f lines\n", TABLE_WIDTH,
+           TABLE_HEIGHT, TABLE_HORIZON, n, survive[empty], lines[empty]);
+    tablebase_close(tb);
+    remove(TABLE_PATH);
+}
+
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--builder") && i + 1 < argc) {
+            builder = argv[++i];
+        } else {
+            printf("Usage: tetris_tablebase_check [--builder PATH]\n");
+            return 0;
+        }
+    }
+    check_known_clear();
+    check_cell_counts();
+    check_expected_bound();
+    check_table();
+    printf("%s\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
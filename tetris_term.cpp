@@ -0,0 +1,166 @@
+#include "tetris_term.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+/* 256-color indices for TCOL_*; 0 (default) uses the terminal's own */
+static const uint8_t term_palette[TCOL_COUNT] = {
+    0,
+    51, 220, 171, 77, 203, 69, 208,   /* I O T S Z J L */
+    250,                              /* border */
+    238,                              /* empty cell */
+    252                               /* label */
+};
+
+/* Worst case per cell: cursor move, two colors and the character */
+#define TERM_CELL_BYTES 40
+
+int term_init(TermScreen* t, int cols, int rows) {
+    memset(t, 0, sizeof(*t));
+    t->cols = cols;
+    t->rows = rows;
+    t->front = (TermCell*)calloc((size_t)cols * rows, sizeof(TermCell));
+    t->back = (TermCell*)calloc((size_t)cols * rows, sizeof(TermCell));
+    t->out_cap = (size_t)cols * rows * TERM_CELL_BYTES + 64;
+    t->out = (char*)malloc(t->out_cap);
+    t->full = 1;
+    t->cursor_x = t->cursor_y = -1;
+    t->colors = 0xFFFFFFFFu;
+    return t->front && t->back && t->out;
+}
+
+void term_free(TermScreen* t) {
+    free(t->front);
+    free(t->back);
+    free(t->out);
+    t->front = t->back = NULL;
+    t->out = NULL;
+}
+
+void term_clear(TermScreen* t) {
+    TermCell blank = TERM_CELL(' ', TCOL_DEFAULT, TCOL_DEFAULT);
+    for (int i = 0; i < t->cols * t->rows; i++) t->back[i] = blank;
+}
+
+void term_put(TermScreen* t, int x, int y, char ch, int fg, int bg) {
+    if (x < 0 || y < 0 || x >= t->cols || y >= t->rows) return;
+    t->back[y * t->cols + x] = TERM_CELL(ch, fg, bg);
+}
+
+void term_text(TermScreen* t, int x, int y, const char* s, int fg) {
+    for (; *s; s++, x++) term_put(t, x, y, *s, fg, TCOL_DEFAULT);
+}
+
+/* A board cell is two columns wide so it looks square */
+static void put_block(TermScreen* t, int x, int y, int color) {
+    if (color) {
+        term_put(t, x, y, '[', TCOL_DEFAULT, color);
+        term_put(t, x + 1, y, ']', TCOL_DEFAULT, color);
+    } else {
+        term_put(t, x, y, ' ', TCOL_EMPTY, TCOL_DEFAULT);
+        term_put(t, x + 1, y, '.', TCOL_EMPTY, TCOL_DEFAULT);
+    }
+}
+
+static void put_preview(TermScreen* t, int x, int y, int piece) {
+    uint16_t m = piece >= 0 ? get_mask(piece, 0) : 0;
+    for (int b = 0; b < 16; b++) {
+        int on = (m >> b) & 1u;
+        term_put(t, x + b % 4 * 2, y + b / 4, on ? '[' : ' ', TCOL_DEFAULT, on ? pieces[piece].color : 0);
+        term_put(t, x + b % 4 * 2 + 1, y + b / 4, on ? ']' : ' ', TCOL_DEFAULT, on ? pieces[piece].color : 0);
+    }
+}
+
+/* Same arrangement as the Windows console build: counters on top, the
+   board with Next and Hold beside it, then the controls. The falling
+   piece is drawn once over the finished board, not tested per cell. */
+void term_compose(TermScreen* t, const GameState* s) {
+    char line[96];
+    term_clear(t);
+    snprintf(line, sizeof(line), "Score: %lld  Level: %d  Lines: %d", (long long)s->score, s->level, s->lines_total);
+    term_text(t, 0, 0, line, TCOL_LABEL);
+
+    for (int y = 0; y < HEIGHT; y++) {
+        term_put(t, TERM_BOARD_LEFT - 1, 1 + y, '|', TCOL_BORDER, TCOL_DEFAULT);
+        for (int x = 0; x < WIDTH; x++) put_block(t, TERM_BOARD_LEFT + 2 * x, 1 + y, s->board[y][x]);
+        term_put(t, TERM_BOARD_LEFT + 2 * WIDTH, 1 + y, '|', TCOL_BORDER, TCOL_DEFAULT);
+    }
+    if (!s->game_over) {
+        uint16_t m = get_mask(s->cur_piece, s->cur_rot);
+        for (int b = 0; b < 16; b++) {
+            int x = s->cur_x + b % 4, y = s->cur_y + b / 4;
+            if ((m >> b) & 1u && x >= 0 && x < WIDTH && y >= 0 && y < HEIGHT)
+                put_block(t, TERM_BOARD_LEFT + 2 * x, 1 + y, pieces[s->cur_piece].color);
+        }
+    }
+    for (int x = 0; x < 2 * WIDTH + 2; x++) term_put(t, x, HEIGHT + 1, '-', TCOL_BORDER, TCOL_DEFAULT);
+
+    term_text(t, TERM_SIDE_LEFT, 1, "Next:", TCOL_LABEL);
+    put_preview(t, TERM_SIDE_LEFT, 2, s->next_piece);
+    term_text(t, TERM_SIDE_LEFT, 7, "Hold:", TCOL_LABEL);
+    put_preview(t, TERM_SIDE_LEFT, 8, s->hold_piece);
+    if (s->game_over) term_text(t, TERM_SIDE_LEFT, 13, "GAME OVER", TCOL_LABEL);
+
+    term_text(t, 0, HEIGHT + 2, "Left/Right move, Up/W rotate, Down/S soft drop,", TCOL_BORDER);
+    term_text(t, 0, HEIGHT + 3, "Space hard drop, C hold, Q quit", TCOL_BORDER);
+}
+
+static char* put_color(char* p, int code, int color) {
+    if (!color) return p + sprintf(p, "\x1b[%dm", code == 38 ? 39 : 49);
+    return p + sprintf(p, "\x1b[%d;5;%dm", code, term_palette[color]);
+}
+
+/* Builds the escape sequence that turns front into back and makes back
+   the new front; returns its length */
+size_t term_diff(TermScreen* t) {
+    char* p = t->out;
+    int cells = 0;
+    for (int y = 0; y < t->rows; y++) {
+        for (int x = 0; x < t->cols; x++) {
+            TermCell c = t->back[y * t->cols + x];
+            if (!t->full && c == t->front[y * t->cols + x]) continue;
+            if (t->cursor_y != y || t->cursor_x != x) p += sprintf(p, "\x1b[%d;%dH", y + 1, x + 1);
+            int fg = (c >> 8) & 0xFF, bg = (c >> 16) & 0xFF;
+            if ((t->colors & 0xFF) != (uint32_t)fg) p = put_color(p, 38, fg);
+            if (((t->colors >> 8) & 0xFF) != (uint32_t)bg) p = put_color(p, 48, bg);
+            t->colors = (uint32_t)fg | (uint32_t)bg << 8;
+            *p++ = (char)(c & 0xFF);
+            t->cursor_x = x + 1;
+            t->cursor_y = y;
+            cells++;
+        }
+    }
+    TermCell* swap = t->front;
+    t->front = t->back;
+    t->back = swap;
+    t->full = 0;
+
+    size_t n = (size_t)(p - t->out);
+    t->stats.frames++;
+    t->stats.bytes += n;
+    t->stats.cells += cells;
+    t->stats.last_bytes = n;
+    t->stats.last_cells = cells;
+    if (n > t->stats.max_bytes) t->stats.max_bytes = n;
+    return n;
+}
+
+/* One write for the whole frame; only a short write or a signal makes
+   it continue */
+int term_flush(TermScreen* t, int fd) {
+    size_t n = term_diff(t);
+    const char* p = t->out;
+    while (n > 0) {
+        ssize_t w = write(fd, p, n);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            t->full = 1;
+            return 0;
+        }
+        p += w;
+        n -= (size_t)w;
+    }
+    return 1;
+}
@@ -0,0 +1,62 @@
+#ifndef TETRIS_TERM_H
+#define TETRIS_TERM_H
+
+/* ANSI terminal screen. Frames are composed into a back grid of cells and
+   term_flush sends only the cells that differ from what the terminal
+   already shows, with cursor moves and color changes kept to the
+   minimum, as one buffer in one write. Portable apart from the write. */
+
+#include <stddef.h>
+#include "tetris_core.h"
+
+#define TERM_BOARD_LEFT 1
+#define TERM_SIDE_LEFT (TERM_BOARD_LEFT + 2 * WIDTH + 3)
+#define TERM_COLS (TERM_SIDE_LEFT + 16)
+#define TERM_ROWS (HEIGHT + 4)
+
+/* Cell colors; 1..7 are the piece colors of pieces[].color */
+enum {
+    TCOL_DEFAULT = 0,
+    TCOL_PIECE_LAST = 7,
+    TCOL_BORDER,
+    TCOL_EMPTY,
+    TCOL_LABEL,
+    TCOL_COUNT
+};
+
+/* One cell: character, foreground and background color, packed so a
+   whole cell compares in one go */
+typedef uint32_t TermCell;
+#define TERM_CELL(ch, fg, bg) ((uint32_t)(uint8_t)(ch) | (uint32_t)(fg) << 8 | (uint32_t)(bg) << 16)
+
+typedef struct {
+    uint64_t frames;
+    uint64_t bytes;
+    uint64_t cells;             /* cells sent */
+    uint64_t max_bytes;
+    size_t last_bytes;
+    int last_cells;
+} TermStats;
+
+typedef struct {
+    int cols, rows;
+    TermCell* front;            /* what the terminal shows */
+    TermCell* back;             /* frame being composed */
+    char* out;
+    size_t out_cap;
+    int full;                   /* resend every cell on the next flush */
+    int cursor_x, cursor_y;     /* -1 when unknown */
+    uint32_t colors;            /* fg | bg << 8 of the current SGR state */
+    TermStats stats;
+} TermScreen;
+
+int term_init(TermScreen* t, int cols, int rows);
+void term_free(TermScreen* t);
+void term_clear(TermScreen* t);
+void term_put(TermScreen* t, int x, int y, char ch, int fg, int bg);
+void term_text(TermScreen* t, int x, int y, const char* s, int fg);
+void term_compose(TermScreen* t, const GameState* s);
+size_t term_diff(TermScreen* t);
+int term_flush(TermScreen* t, int fd);
+
+#endif /* TETRIS_TERM_H */
@@ -0,0 +1,238 @@
+#include "tetris_trace.h"
+
+#ifdef TETRIS_TRACE
+
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define TRACE_TSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define TRACE_TSC 1
+#endif
+
+typedef struct {
+    int site;
+    uint64_t start, end;
+} TraceEvent;
+
+/* One per recording thread, never freed so a dump still sees threads
+   that have exited. Only the owner writes; counters use relaxed
+   load/store pairs, which cost the same as plain increments. */
+struct TraceThread {
+    int tid;
+    char name[32];
+    std::atomic<uint64_t> head;
+    std::atomic<uint64_t> calls[TRACE_MAX_SITES];
+    std::atomic<uint64_t> total[TRACE_MAX_SITES];    /* ticks inside the scope */
+    std::atomic<std::atomic<uint64_t>*> hist[TRACE_MAX_SITES];
+    TraceThread* next;
+    TraceEvent ring[TRACE_RING_EVENTS];
+};
+
+static std::mutex registry_mutex;
+static const char* site_names[TRACE_MAX_SITES];
+static int site_count = 0;
+static TraceThread* threads = NULL;
+static int thread_count = 0;
+static thread_local TraceThread* self = NULL;
+
+static std::once_flag epoch_once;
+static uint64_t epoch_ticks;
+static std::chrono::steady_clock::time_point epoch_time;
+
+uint64_t trace_now(void) {
+#ifdef TRACE_TSC
+    return __rdtsc();
+#else
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+/* Ticks per microsecond, measured since the first site was registered */
+static double ticks_per_us(void) {
+#ifdef TRACE_TSC
+    double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - epoch_time).count();
+    uint64_t ticks = trace_now() - epoch_ticks;
+    return us > 0.0 && ticks ? ticks / us : 1.0;
+#else
+    return 1000.0;
+#endif
+}
+
+int trace_site(const char* name) {
+    std::call_once(epoch_once, [] {
+        epoch_time = std::chrono::steady_clock::now();
+        epoch_ticks = trace_now();
+    });
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    for (int i = 0; i < site_count; i++)
+        if (!strcmp(site_names[i], name)) return i;
+    if (site_count == TRACE_MAX_SITES) return -1;
+    site_names[site_count] = name;
+    return site_count++;
+}
+
+static TraceThread* this_thread(void) {
+    if (self) return self;
+    TraceThread* t = new TraceThread();
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    t->tid = ++thread_count;
+    snprintf(t->name, sizeof(t->name), "thread %d", t->tid);
+    t->next = threads;
+    threads = t;
+    self = t;
+    return t;
+}
+
+void trace_thread_name(const char* name) {
+    TraceThread* t = this_thread();
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    snprintf(t->name, sizeof(t->name), "%s", name);
+}
+
+static int high_bit(uint64_t v) {
+#ifdef _MSC_VER
+    unsigned long i;
+    _BitScanReverse64(&i, v);
+    return (int)i;
+#else
+    return 63 - __builtin_clzll(v);
+#endif
+}
+
+/* Log-linear buckets: exact below 32, then 16 steps per power of two,
+   so every bucket is within 1/16 of its values */
+static int hist_bucket(uint64_t v) {
+    if (v < 32) return (int)v;
+    int e = high_bit(v);
+    int b = 32 + (e - 5) * 16 + (int)((v >> (e - 4)) & 15);
+    return b < TRACE_HIST_BUCKETS ? b : TRACE_HIST_BUCKETS - 1;
+}
+
+static double bucket_value(int b) {
+    if (b < 32) return b;
+    int e = (b - 32) / 16 + 5, sub = (b - 32) % 16;
+    double width = (double)(1ull << (e - 4));
+    return (16 + sub) * width + width / 2;
+}
+
+static inline void bump(std::atomic<uint64_t>* c, uint64_t by) {
+    c->store(c->load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+}
+
+void trace_record(int site, uint64_t start, uint64_t end) {
+    if (site < 0) return;
+    TraceThread* t = this_thread();
+    uint64_t h = t->head.load(std::memory_order_relaxed);
+    TraceEvent* e = &t->ring[h & (TRACE_RING_EVENTS - 1)];
+    e->site = site;
+    e->start = start;
+    e->end = end;
+    t->head.store(h + 1, std::memory_order_release);
+
+    std::atomic<uint64_t>* hist = t->hist[site].load(std::memory_order_relaxed);
+    if (!hist) {
+        hist = new std::atomic<uint64_t>[TRACE_HIST_BUCKETS]();
+        t->hist[site].store(hist, std::memory_order_release);
+    }
+    bump(&hist[hist_bucket(end - start)], 1);
+    bump(&t->calls[site], 1);
+    bump(&t->total[site], end - start);
+}
+
+void trace_count(int site) {
+    if (site >= 0) bump(&this_thread()->calls[site], 1);
+}
+
+int trace_write_chrome(const char* path) {
+    FILE* fp = fopen(path, "w");
+    if (!fp) return 0;
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    double per_us = ticks_per_us();
+    double now_us = (trace_now() - epoch_ticks) / per_us;
+    std::vector<TraceEvent> copy(TRACE_RING_EVENTS);
+    const char* sep = "";
+
+    fprintf(fp, "{\"traceEvents\":[\n");
+    for (TraceThread* t = threads; t; t = t->next) {
+        fprintf(fp, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                sep, t->tid, t->name);
+        sep = ",\n";
+
+        uint64_t head = t->head.load(std::memory_order_acquire);
+        uint64_t first = head > TRACE_RING_EVENTS ? head - TRACE_RING_EVENTS : 0;
+        for (uint64_t i = first; i < head; i++) copy[i - first] = t->ring[i & (TRACE_RING_EVENTS - 1)];
+        /* Anything the owner lapped while we copied is no longer whole */
+        uint64_t after = t->head.load(std::memory_order_acquire);
+        uint64_t valid = after > TRACE_RING_EVENTS ? after - TRACE_RING_EVENTS : 0;
+        for (uint64_t i = first > valid ? first : valid; i < head; i++) {
+            const TraceEvent* e = &copy[i - first];
+            if (e->start < epoch_ticks) continue;
+            fprintf(fp, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                    site_names[e->site], t->tid, (e->start - epoch_ticks) / per_us, (e->end - e->start) / per_us);
+        }
+
+        /* Call counts as one counter sample at dump time */
+        fprintf(fp, ",\n{\"name\":\"calls\",\"ph\":\"C\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"args\":{", t->tid, now_us);
+        const char* arg_sep = "";
+        for (int s = 0; s < site_count; s++) {
+            uint64_t n = t->calls[s].load(std::memory_order_relaxed);
+            if (!n) continue;
+            fprintf(fp, "%s\"%s\":%llu", arg_sep, site_names[s], (unsigned long long)n);
+            arg_sep = ",";
+        }
+        fprintf(fp, "}}");
+    }
+    fprintf(fp, "\n],\"displayTimeUnit\":\"ns\"}\n");
+    return fclose(fp) == 0;
+}
+
+static double percentile(const uint64_t* buckets, uint64_t n, double pct) {
+    uint64_t rank = (uint64_t)(n * pct / 100.0), seen = 0;
+    for (int b = 0; b < TRACE_HIST_BUCKETS; b++) {
+        seen += buckets[b];
+        if (seen > rank) return bucket_value(b);
+    }
+    return 0.0;
+}
+
+void trace_write_histograms(FILE* out) {
+    static uint64_t merged[TRACE_HIST_BUCKETS];
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    double per_us = ticks_per_us();
+    fprintf(out, "%-24s %10s %10s %9s %9s %9s %9s %9s\n", "site", "calls", "total ms",
+            "p50 us", "p90 us", "p99 us", "p999 us", "max us");
+    for (int s = 0; s < site_count; s++) {
+        uint64_t calls = 0, total = 0, timed = 0;
+        memset(merged, 0, sizeof(merged));
+        for (TraceThread* t = threads; t; t = t->next) {
+            calls += t->calls[s].load(std::memory_order_relaxed);
+            total += t->total[s].load(std::memory_order_relaxed);
+            std::atomic<uint64_t>* hist = t->hist[s].load(std::memory_order_acquire);
+            for (int b = 0; hist && b < TRACE_HIST_BUCKETS; b++) {
+                uint64_t n = hist[b].load(std::memory_order_relaxed);
+                merged[b] += n;
+                timed += n;
+            }
+        }
+        if (!timed) {
+            fprintf(out, "%-24s %10llu\n", site_names[s], (unsigned long long)calls);
+            continue;
+        }
+        int top = TRACE_HIST_BUCKETS - 1;
+        while (!merged[top]) top--;
+        fprintf(out, "%-24s %10llu %10.3f %9.3f %9.3f %9.3f %9.3f %9.3f\n", site_names[s],
+                (unsigned long long)calls, total / per_us / 1000.0,
+                percentile(merged, timed, 50) / per_us, percentile(merged, timed, 90) / per_us,
+                percentile(merged, timed, 99) / per_us, percentile(merged, timed, 99.9) / per_us,
+                bucket_value(top) / per_us);
+    }
+}
+
+#endif /* TETRIS_TRACE */
@@ -0,0 +1,62 @@
+#ifndef TETRIS_TRACE_H
+#define TETRIS_TRACE_H
+
+/* Scoped timers and call counters for finding where frame time goes.
+   Build with TETRIS_TRACE defined to turn them on; otherwise every macro
+   expands to nothing and the dump functions are empty inlines.
+
+   Each thread records into its own ring of events and its own per-site
+   histograms, so recording takes no lock. Timestamps are TSC ticks on
+   x86 and steady_clock nanoseconds elsewhere, converted once at dump
+   time. Dumps may run while other threads keep recording; events that
+   are overwritten during the copy are dropped. */
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define TRACE_MAX_SITES 64
+#define TRACE_RING_EVENTS 65536       /* per thread, power of two */
+#define TRACE_HIST_SUB_BITS 4         /* 16 linear steps per power of two */
+#define TRACE_HIST_BUCKETS 1024
+
+#ifdef TETRIS_TRACE
+
+int trace_site(const char* name);
+uint64_t trace_now(void);
+void trace_record(int site, uint64_t start, uint64_t end);
+void trace_count(int site);
+void trace_thread_name(const char* name);
+
+/* Chrome trace-event JSON (chrome://tracing, Perfetto) */
+int trace_write_chrome(const char* path);
+/* Per-site count and latency percentiles, merged over all threads */
+void trace_write_histograms(FILE* out);
+
+struct TraceScope {
+    int site;
+    uint64_t start;
+    explicit TraceScope(int s) : site(s), start(trace_now()) {}
+    ~TraceScope() { trace_record(site, start, trace_now()); }
+};
+
+#define TRACE_CAT2(a, b) a##b
+#define TRACE_CAT(a, b) TRACE_CAT2(a, b)
+#define TRACE_SCOPE(name) \
+    static const int TRACE_CAT(trace_site_, __LINE__) = trace_site(name); \
+    TraceScope TRACE_CAT(trace_scope_, __LINE__)(TRACE_CAT(trace_site_, __LINE__))
+#define TRACE_COUNT(name) \
+    do { static const int trace_site_id = trace_site(name); trace_count(trace_site_id); } while (0)
+#define TRACE_THREAD(name) trace_thread_name(name)
+
+#else
+
+static inline int trace_write_chrome(const char* path) { (void)path; return 0; }
+static inline void trace_write_histograms(FILE* out) { (void)out; }
+
+#define TRACE_SCOPE(name) ((void)0)
+#define TRACE_COUNT(name) ((void)0)
+#define TRACE_THREAD(name) ((void)0)
+
+#endif /* TETRIS_TRACE */
+
+#endif /* TETRIS_TRACE_H */
@@ -0,0 +1,327 @@
+// Bot weight tuner - genetic search scored by parallel headless self-play
+// Build: g++ -O2 -std=c++17 -pthread tetris_tuner.cpp tetris_bot.cpp tetris_eval_cache.cpp tetris_core.cpp -o tetris_tuner
+//        cl /O2 /std:c++17 /EHsc tetris_tuner.cpp tetris_bot.cpp tetris_eval_cache.cpp tetris_core.cpp
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#include "tetris_bot.h"
+
+#define MAX_POPULATION 256
+
+typedef struct {
+    BotWeights wt;
+    double fitness;
+} Candidate;
+
+typedef struct {
+    int population;
+    int games;
+    int max_pieces;
+    int generations;
+    int threads;
+    int depth;
+    int cache_mb;
+    uint32_t seed;
+    const char* checkpoint;
+    const char* resume;
+    const char* out;
+} TunerConfig;
+
+typedef struct {
+    int generation;
+    uint32_t rng;
+    int population;
+    Candidate pop[MAX_POPULATION];
+} TunerState;
+
+static double now_seconds(void) {
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+static float rand_uniform(uint32_t* rng) {
+    return (rng_next(rng) >> 8) * (1.0f / 16777216.0f);
+}
+
+/* Box-Muller; good enough for mutation noise */
+static float rand_gauss(uint32_t* rng) {
+    float u1 = rand_uniform(rng);
+    float u2 = rand_uniform(rng);
+    if (u1 < 1e-7f) u1 = 1e-7f;
+    return sqrtf(-2.0f * logf(u1)) * cosf(6.2831853f * u2);
+}
+
+/* Evaluation is scale-invariant, so keep weights on the unit sphere */
+static void normalize(BotWeights* wt) {
+    float len = 0.0f;
+    for (int i = 0; i < BOT_WEIGHT_COUNT; i++) len += wt->w[i] * wt->w[i];
+    len = sqrtf(len);
+    if (len < 1e-9f) return;
+    for (int i = 0; i < BOT_WEIGHT_COUNT; i++) wt->w[i] /= len;
+}
+
+static void init_population(TunerState* ts, int population, uint32_t seed) {
+    ts->generation = 0;
+    ts->rng = seed ? seed : 1;
+    ts->population = population;
+    ts->pop[0].wt = bot_default_weights;
+    normalize(&ts->pop[0].wt);
+    for (int i = 1; i < population; i++) {
+        for (int k = 0; k < BOT_WEIGHT_COUNT; k++)
+            ts->pop[i].wt.w[k] = rand_uniform(&ts->rng) * 2.0f - 1.0f;
+        normalize(&ts->pop[i].wt);
+    }
+    for (int i = 0; i < population; i++) ts->pop[i].fitness = 0.0;
+}
+
+/* Every candidate plays the same seeds in a generation so scores are comparable */
+static double score_population(TunerState* ts, const TunerConfig* cfg) {
+    int jobs = ts->population * cfg->games;
+    std::vector<int64_t> scores(jobs);
+    std::atomic<int> next_job(0);
+    uint32_t gen_seed = cfg->seed * 2654435761u + (uint32_t)ts->generation * 40503u + 1u;
+
+    /* Cached values depend on the weights, so each worker owns a cache
+       and clears it whenever it moves on to another candidate */
+    std::vector<EvalCache*> caches(cfg->threads, (EvalCache*)NULL);
+    if (cfg->depth >= 2 && cfg->cache_mb > 0) {
+        for (int t = 0; t < cfg->threads; t++)
+            caches[t] = eval_cache_create((size_t)cfg->cache_mb << 20);
+    }
+
+    auto worker = [&](int t) {
+        int cached_cand = -1;
+        for (;;) {
+            int job = next_job.fetch_add(1);
+            if (job >= jobs) break;
+            int cand = job / cfg->games;
+            int game = job % cfg->games;
+            if (caches[t] && cand != cached_cand) {
+                eval_cache_clear(caches[t]);
+                cached_cand = cand;
+            }
+            scores[job] = bot_play_game(gen_seed + (uint32_t)game * 7919u, &ts->pop[cand].wt,
+                                        cfg->depth, caches[t], cfg->max_pieces, NULL);
+        }
+    };
+
+    double t0 = now_seconds();
+    std::vector<std::thread> pool;
+    for (int t = 1; t < cfg->threads; t++) pool.emplace_back(worker, t);
+    worker(0);
+    for (auto& th : pool) th.join();
+    double elapsed = now_seconds() - t0;
+
+    EvalCacheStats total;
+    memset(&total, 0, sizeof(total));
+    for (int t = 0; t < cfg->threads; t++) {
+        if (!caches[t]) continue;
+        EvalCacheStats st;
+        eval_cache_stats(caches[t], &st);
+        total.lookups += st.lookups;
+        total.hits += st.hits;
+        total.lookup_ns += st.lookup_ns;
+        total.computes += st.computes;
+        total.compute_ns += st.compute_ns;
+        total.bytes += st.bytes;
+        eval_cache_destroy(caches[t]);
+    }
+    if (total.lookups) {
+        printf("        cache %.1f%% hits of %llu lookups, %.0f ns/lookup, ~%.0f ms saved\n",
+               eval_cache_hit_rate(&total) * 100.0, (unsigned long long)total.lookups,
+               (double)total.lookup_ns / total.lookups, eval_cache_saved_ms(&total));
+    }
+
+    for (int i = 0; i < ts->population; i++) {
+        double sum = 0.0;
+        for (int g = 0; g < cfg->games; g++) sum += scores[i * cfg->games + g];
+        ts->pop[i].fitness = sum / cfg->games;
+    }
+    return elapsed;
+}
+
+static int compare_fitness(const void* a, const void* b) {
+    double fa = ((const Candidate*)a)->fitness;
+    double fb = ((const Candidate*)b)->fitness;
+    return (fa < fb) - (fa > fb);
+}
+
+static const Candidate* tournament(TunerState* ts) {
+    const Candidate* best = NULL;
+    for (int i = 0; i < 3; i++) {
+        const Candidate* c = &ts->pop[rng_next(&ts->rng) % ts->population];
+        if (!best || c->fitness > best->fitness) best = c;
+    }
+    return best;
+}
+
+/* Keep the top quarter, refill with fitness-weighted crossover plus mutation */
+static void next_generation(TunerState* ts) {
+    qsort(ts->pop, ts->population, sizeof(Candidate), compare_fitness);
+    int elite = ts->population / 4;
+    if (elite < 1) elite = 1;
+    Candidate children[MAX_POPULATION];
+    for (int i = elite; i < ts->population; i++) {
+        const Candidate* a = tournament(ts);
+        const Candidate* b = tournament(ts);
+        double fa = a->fitness + 1.0, fb = b->fitness + 1.0;
+        float ta = (float)(fa / (fa + fb));
+        BotWeights wt;
+        for (int k = 0; k < BOT_WEIGHT_COUNT; k++)
+            wt.w[k] = a->wt.w[k] * ta + b->wt.w[k] * (1.0f - ta);
+        if (rand_uniform(&ts->rng) < 0.5f) {
+            int k = rng_next(&ts->rng) % BOT_WEIGHT_COUNT;
+            wt.w[k] += rand_gauss(&ts->rng) * 0.2f;
+        }
+        normalize(&wt);
+        children[i].wt = wt;
+        children[i].fitness = 0.0;
+    }
+    for (int i = elite; i < ts->population; i++) ts->pop[i] = children[i];
+    ts->generation++;
+}
+
+static int save_checkpoint(const char* path, const TunerState* ts) {
+    char tmp[1024];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE* f = fopen(tmp, "w");
+    if (!f) return 0;
+    fprintf(f, "tetris_tuner 1\n");
+    fprintf(f, "generation %d\nrng %u\npopulation %d\n", ts->generation, ts->rng, ts->population);
+    for (int i = 0; i < ts->population; i++) {
+        for (int k = 0; k < BOT_WEIGHT_COUNT; k++) fprintf(f, "%.9g ", ts->pop[i].wt.w[k]);
+        fprintf(f, "%.9g\n", ts->pop[i].fitness);
+    }
+    if (fclose(f) != 0) return 0;
+    /* Replace atomically so a crash leaves the old checkpoint or the new one */
+#ifdef _WIN32
+    return MoveFileExA(tmp, path, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    return rename(tmp, path) == 0;
+#endif
+}
+
+static int load_checkpoint(const char* path, TunerState* ts) {
+    FILE* f = fopen(path, "r");
+    if (!f) return 0;
+    int version = 0, ok = 1;
+    if (fscanf(f, "tetris_tuner %d generation %d rng %u population %d",
+               &version, &ts->generation, &ts->rng, &ts->population) != 4 ||
+        version != 1 || ts->population < 2 || ts->population > MAX_POPULATION) {
+        ok = 0;
+    }
+    for (int i = 0; ok && i < ts->population; i++) {
+        for (int k = 0; ok && k < BOT_WEIGHT_COUNT; k++)
+            ok = fscanf(f, "%f", &ts->pop[i].wt.w[k]) == 1;
+        if (ok) ok = fscanf(f, "%lf", &ts->pop[i].fitness) == 1;
+    }
+    fclose(f);
+    return ok;
+}
+
+static void usage(void) {
+    printf("Usage: tetris_tuner [options]\n"
+           "  --population N   candidates per generation (default 32)\n"
+           "  --games N        seeded games per candidate (default 16)\n"
+           "  --pieces N       piece limit per game (default 500)\n"
+           "  --generations N  generations to run (default 20)\n"
+           "  --threads N      worker threads (default: all cores)\n"
+           "  --depth N        1 = current piece, 2 = also the next piece (default 1)\n"
+           "  --cache-mb N     evaluation cache per thread for depth 2 (default 16, 0 = off)\n"
+           "  --seed N         base seed (default 1)\n"
+           "  --checkpoint F   write state to F after each generation\n"
+           "  --resume F       continue from checkpoint F\n"
+           "  --out F          write best weights to F (default tuned_weights.txt)\n");
+}
+
+int main(int argc, char** argv) {
+    TunerConfig cfg;
+    cfg.population = 32;
+    cfg.games = 16;
+    cfg.max_pieces = 500;
+    cfg.generations = 20;
+    cfg.threads = (int)std::thread::hardware_concurrency();
+    cfg.depth = 1;
+    cfg.cache_mb = 16;
+    cfg.seed = 1;
+    cfg.checkpoint = NULL;
+    cfg.resume = NULL;
+    cfg.out = "tuned_weights.txt";
+
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        const char* v = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!strcmp(a, "--help")) { usage(); return 0; }
+        if (!v) { usage(); return 1; }
+        if (!strcmp(a, "--population")) cfg.population = atoi(v);
+        else if (!strcmp(a, "--games")) cfg.games = atoi(v);
+        else if (!strcmp(a, "--pieces")) cfg.max_pieces = atoi(v);
+        else if (!strcmp(a, "--generations")) cfg.generations = atoi(v);
+        else if (!strcmp(a, "--threads")) cfg.threads = atoi(v);
+        else if (!strcmp(a, "--depth")) cfg.depth = atoi(v);
+        else if (!strcmp(a, "--cache-mb")) cfg.cache_mb = atoi(v);
+        else if (!strcmp(a, "--seed")) cfg.seed = (uint32_t)strtoul(v, NULL, 10);
+        else if (!strcmp(a, "--checkpoint")) cfg.checkpoint = v;
+        else if (!strcmp(a, "--resume")) cfg.resume = v;
+        else if (!strcmp(a, "--out")) cfg.out = v;
+        else { usage(); return 1; }
+        i++;
+    }
+    if (cfg.threads < 1) cfg.threads = 1;
+    if (cfg.games < 1) cfg.games = 1;
+    if (cfg.population < 2) cfg.population = 2;
+    if (cfg.population > MAX_POPULATION) cfg.population = MAX_POPULATION;
+
+    static TunerState ts;
+    if (cfg.resume) {
+        if (!load_checkpoint(cfg.resume, &ts)) {
+            fprintf(stderr, "cannot resume from %s\n", cfg.resume);
+            return 1;
+        }
+        printf("resumed %s at generation %d\n", cfg.resume, ts.generation);
+        /* The checkpoint holds a scored generation; breed from it first */
+        next_generation(&ts);
+    } else {
+        init_population(&ts, cfg.population, cfg.seed);
+    }
+
+    printf("population %d, %d games x %d pieces, %d threads\n",
+           ts.population, cfg.games, cfg.max_pieces, cfg.threads);
+
+    int last = ts.generation + cfg.generations;
+    while (ts.generation < last) {
+        double elapsed = score_population(&ts, &cfg);
+        int games = ts.population * cfg.games;
+
+        const Candidate* best = &ts.pop[0];
+        double mean = 0.0;
+        for (int i = 0; i < ts.population; i++) {
+            mean += ts.pop[i].fitness;
+            if (ts.pop[i].fitness > best->fitness) best = &ts.pop[i];
+        }
+        mean /= ts.population;
+
+        printf("gen %3d  %7.2fs  %6d games  %8.1f games/s  best %10.1f  mean %10.1f\n",
+               ts.generation, elapsed, games, games / (elapsed > 0 ? elapsed : 1e-9),
+               best->fitness, mean);
+        fflush(stdout);
+
+        bot_save_weights(cfg.out, &best->wt);
+        if (cfg.checkpoint && !save_checkpoint(cfg.checkpoint, &ts))
+            fprintf(stderr, "failed to write checkpoint %s\n", cfg.checkpoint);
+
+        if (ts.generation + 1 < last) next_generation(&ts);
+        else ts.generation++;
+    }
+
+    printf("best weights written to %s\n", cfg.out);
+    return 0;
+}
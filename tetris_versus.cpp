@@ -0,0 +1,194 @@
+#include "tetris_versus.h"
+#include <stddef.h>
+#include <string.h>
+
+/* Guideline-style: singles send nothing, tetrises four, long combos pay */
+const AttackTable attack_table_default = {
+    { 0, 0, 1, 2, 4 },
+    { 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 4, 5 },
+    1,
+    10
+};
+
+void versus_config_default(VersusConfig* cfg) {
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->attack = attack_table_default;
+    cfg->frame_ms = 16;
+    cfg->garbage_delay = 30;
+    cfg->garbage_cap = 8;
+    cfg->start_level = 1;
+}
+
+void versus_init(VersusMatch* m, const VersusConfig* cfg, int players, uint32_t seed) {
+    memset(m, 0, sizeof(*m));
+    if (players < 1) players = 1;
+    if (players > VERSUS_MAX_PLAYERS) players = VERSUS_MAX_PLAYERS;
+    m->cfg = *cfg;
+    m->players = players;
+    m->winner = -1;
+    uint32_t rng = seed ? seed : 1;
+    for (int i = 0; i < players; i++) {
+        VersusPlayer* p = &m->p[i];
+        state_init(&p->game, rng_next(&rng));
+        if (cfg->start_level > 1) {
+            p->game.level = cfg->start_level;
+            p->game.speed_ms = speed_for_level(cfg->start_level);
+        }
+        p->garbage_rng = rng_next(&rng) | 1;
+        p->alive = !p->game.game_over;
+    }
+}
+
+int versus_pending(const VersusMatch* m, int i) {
+    const VersusPlayer* p = &m->p[i];
+    int rows = 0;
+    for (int k = 0; k < p->queue_count; k++) rows += p->queue[(p->queue_head + k) % VERSUS_QUEUE].rows;
+    return rows;
+}
+
+static int board_empty(const int b[HEIGHT][WIDTH]) {
+    for (int y = 0; y < HEIGHT; y++)
+        for (int x = 0; x < WIDTH; x++)
+            if (b[y][x]) return 0;
+    return 1;
+}
+
+int versus_attack(const AttackTable* t, const int b[HEIGHT][WIDTH], int cleared, int* combo, int* last_tetris) {
+    if (!cleared) {
+        *combo = 0;
+        return 0;
+    }
+    ++*combo;
+    int step = *combo - 1 < VERSUS_COMBO_STEPS ? *combo - 1 : VERSUS_COMBO_STEPS - 1;
+    int attack = t->lines[cleared > 4 ? 4 : cleared] + t->combo[step];
+    if (cleared >= 4 && *last_tetris) attack += t->back_to_back;
+    *last_tetris = cleared >= 4;
+    if (board_empty(b)) attack += t->all_clear;
+    return attack;
+}
+
+/* Oldest packets first, including ones still in flight */
+static int cancel_pending(VersusPlayer* p, int attack) {
+    while (attack > 0 && p->queue_count) {
+        GarbagePacket* g = &p->queue[p->queue_head];
+        int n = attack < g->rows ? attack : g->rows;
+        g->rows -= n;
+        attack -= n;
+        p->cancelled += n;
+        if (!g->rows) {
+            p->queue_head = (p->queue_head + 1) % VERSUS_QUEUE;
+            p->queue_count--;
+        }
+    }
+    return attack;
+}
+
+/* Up to cap rows of due garbage, one hole column per packet */
+static void raise_garbage(VersusPlayer* p, uint32_t frame, int cap) {
+    GameState* s = &p->game;
+    while (cap > 0 && p->queue_count && p->queue[p->queue_head].ready_frame <= frame) {
+        GarbagePacket* g = &p->queue[p->queue_head];
+        int n = g->rows < cap ? g->rows : cap;
+        int hole = (int)(rng_next(&p->garbage_rng) % WIDTH);
+        if (board_insert_garbage(s->board, n, hole, VERSUS_GARBAGE_COLOR)) s->game_over = 1;
+        p->received += n;
+        g->rows -= n;
+        cap -= n;
+        if (!g->rows) {
+            p->queue_head = (p->queue_head + 1) % VERSUS_QUEUE;
+            p->queue_count--;
+        }
+    }
+    /* The piece that just spawned may be inside the new stack */
+    if (!board_fits(s->board, s->cur_piece, s->cur_x, s->cur_y, s->cur_rot)) s->game_over = 1;
+}
+
+/* After any move: a lock either attacks or lets garbage rise */
+static void after_move(VersusMatch* m, VersusPlayer* p, int placed, int lines) {
+    if (p->game.pieces_placed == placed) return;
+    int cleared = p->game.lines_total - lines;
+    int attack = versus_attack(&m->cfg.attack, p->game.board, cleared, &p->combo, &p->last_tetris);
+    if (attack) {
+        attack = cancel_pending(p, attack);
+        p->outgoing += attack;
+    } else if (!p->game.game_over) {
+        raise_garbage(p, m->frame, m->cfg.garbage_cap);
+    }
+}
+
+void versus_step_player(VersusMatch* m, int i, unsigned inputs) {
+    VersusPlayer* p = &m->p[i];
+    GameState* s = &p->game;
+    if (!p->alive || m->over) return;
+    for (int in = 0; in < INPUT_COUNT && !s->game_over; in++) {
+        if (!(inputs & VERSUS_INPUT(in))) continue;
+        int placed = s->pieces_placed, lines = s->lines_total;
+        state_input(s, in);
+        after_move(m, p, placed, lines);
+    }
+    p->gravity_ms += m->cfg.frame_ms;
+    while (!s->game_over && p->gravity_ms >= s->speed_ms) {
+        p->gravity_ms -= s->speed_ms;
+        int placed = s->pieces_placed, lines = s->lines_total;
+        state_tick(s);
+        after_move(m, p, placed, lines);
+    }
+    if (s->game_over) p->alive = 0;
+}
+
+void versus_exchange(VersusMatch* m) {
+    if (m->over) return;
+    for (int i = 0; i < m->players; i++) {
+        VersusPlayer* p = &m->p[i];
+        if (!p->outgoing) continue;
+        int target = -1;
+        for (int k = 1; k < m->players && target < 0; k++)
+            if (m->p[(i + k) % m->players].alive) target = (i + k) % m->players;
+        p->sent += p->outgoing;
+        if (target >= 0) {
+            VersusPlayer* t = &m->p[target];
+            uint32_t ready = m->frame + (uint32_t)m->cfg.garbage_delay;
+            if (t->queue_count == VERSUS_QUEUE) {
+                /* Full: the newest packet grows instead */
+                t->queue[(t->queue_head + VERSUS_QUEUE - 1) % VERSUS_QUEUE].rows += p->outgoing;
+            } else {
+                GarbagePacket* g = &t->queue[(t->queue_head + t->queue_count) % VERSUS_QUEUE];
+                g->rows = p->outgoing;
+                g->ready_frame = ready;
+                t->queue_count++;
+            }
+        }
+        p->outgoing = 0;
+    }
+    int alive = 0, last = -1;
+    for (int i = 0; i < m->players; i++)
+        if (m->p[i].alive) {
+            alive++;
+            last = i;
+        }
+    if (alive <= (m->players > 1 ? 1 : 0)) {
+        m->over = 1;
+        m->winner = alive == 1 ? last : -1;
+    }
+    m->frame++;
+}
+
+void versus_step(VersusMatch* m, const unsigned* inputs) {
+    for (int i = 0; i < m->players; i++) versus_step_player(m, i, inputs[i]);
+    versus_exchange(m);
+}
+
+void versus_copy(VersusMatch* dst, const VersusMatch* src) {
+    memcpy(dst, src, offsetof(VersusMatch, p) + (size_t)src->players * sizeof(VersusPlayer));
+}
+
+/* FNV-1a over the struct; versus_init zeroes the padding */
+uint64_t versus_hash(const VersusMatch* m) {
+    const unsigned char* b = (const unsigned char*)m;
+    uint64_t h = 1469598103934665603ull;
+    for (size_t i = 0; i < sizeof(*m); i++) {
+        h ^= b[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
@@ -0,0 +1,92 @@
+#ifndef TETRIS_VERSUS_H
+#define TETRIS_VERSUS_H
+
+/* Versus play: two or more boards in lockstep, where clearing lines
+   attacks an opponent with garbage rows. A match is one flat struct with
+   no pointers, so it can be copied, hashed and compared, and a step never
+   allocates.
+
+   A frame has two phases. versus_step_player touches only its own
+   player: inputs, gravity, locks, cancelling its attack against its own
+   pending garbage, and raising garbage that is due. versus_exchange then
+   hands every remaining attack to its target in player order. Threads may
+   run the first phase for different players at once; only the exchange
+   has to wait for all of them. Portable. */
+
+#include <stdint.h>
+#include "tetris_core.h"
+
+#define VERSUS_MAX_PLAYERS 8
+#define VERSUS_QUEUE 16           /* pending garbage packets per player */
+#define VERSUS_COMBO_STEPS 12
+#define VERSUS_GARBAGE_COLOR 7    /* renderers only know piece colours */
+
+/* One bit per INPUT_*, applied in INPUT_* order within a frame */
+#define VERSUS_INPUT(i) (1u << (i))
+
+/* Attack for a lock that cleared lines. Sits beside line_scores: the
+   same clear scores points and sends garbage. */
+typedef struct {
+    int lines[5];                 /* by lines cleared at once */
+    int combo[VERSUS_COMBO_STEPS];/* extra by clearing locks in a row, the
+                                     last entry repeating */
+    int back_to_back;             /* extra for a tetris after a tetris */
+    int all_clear;                /* extra for emptying the board */
+} AttackTable;
+
+extern const AttackTable attack_table_default;
+
+typedef struct {
+    AttackTable attack;
+    int frame_ms;                 /* simulated time per frame */
+    int garbage_delay;            /* frames before sent garbage can rise */
+    int garbage_cap;              /* most rows rising per locked piece */
+    int start_level;
+} VersusConfig;
+
+typedef struct {
+    int rows;
+    uint32_t ready_frame;
+} GarbagePacket;
+
+typedef struct {
+    GameState game;
+    int alive;
+    int gravity_ms;               /* time banked toward the next gravity step */
+    int combo;                    /* clearing locks in a row */
+    int last_tetris;              /* the last clear was four lines */
+    int outgoing;                 /* attack left after cancelling, this frame */
+    uint32_t garbage_rng;         /* picks hole columns */
+    GarbagePacket queue[VERSUS_QUEUE];
+    int queue_head, queue_count;
+    int sent, cancelled, received;
+} VersusPlayer;
+
+typedef struct {
+    VersusConfig cfg;
+    int players;
+    uint32_t frame;
+    int over;
+    int winner;                   /* -1 for a draw or while running */
+    VersusPlayer p[VERSUS_MAX_PLAYERS];
+} VersusMatch;
+
+void versus_config_default(VersusConfig* cfg);
+/* Attack for a lock, b being the board after the clear; combo and
+   last_tetris carry over between locks and start at 0 */
+int versus_attack(const AttackTable* t, const int b[HEIGHT][WIDTH], int cleared, int* combo, int* last_tetris);
+/* Every board gets its own piece sequence from seed */
+void versus_init(VersusMatch* m, const VersusConfig* cfg, int players, uint32_t seed);
+void versus_step_player(VersusMatch* m, int i, unsigned inputs);
+void versus_exchange(VersusMatch* m);
+/* Both phases, players in index order; inputs has one mask per player */
+void versus_step(VersusMatch* m, const unsigned* inputs);
+/* Copies the header and the players in use, not all VERSUS_MAX_PLAYERS:
+   the save and restore behind rollback */
+void versus_copy(VersusMatch* dst, const VersusMatch* src);
+/* Garbage waiting to rise on player i */
+int versus_pending(const VersusMatch* m, int i);
+/* Digest of the whole match, for checking that two runs agree */
+uint64_t versus_hash(const VersusMatch* m);
+
+#endif /* TETRIS_VERSUS_H */
@@ -0,0 +1,156 @@
+// Versus benchmark - bot players battle with garbage; every match is
+// replayed from its input log and rerun on worker threads, and all three
+// runs must end in the same state
+// Build: g++ -O2 -std=c++17 -pthread tetris_versus_bench.cpp tetris_versus.cpp tetris_bot.cpp tetris_eval_cache.cpp tetris_core.cpp -o tetris_versus_bench
+//        cl /O2 /std:c++17 /EHsc tetris_versus_bench.cpp tetris_versus.cpp tetris_bot.cpp tetris_eval_cache.cpp tetris_core.cpp
+// Usage: tetris_versus_bench --matches 20 --players 2 --threads 4
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "tetris_bot.h"
+#include "tetris_versus.h"
+
+#define MAX_FRAMES 200000         /* a match that runs longer is a draw */
+
+typedef struct {
+    uint64_t hash;
+    uint32_t frames;
+    int winner;
+    int sent, cancelled, received;
+    double step_us;               /* versus_step time per frame, bot excluded */
+} MatchResult;
+
+static int players = 2;
+static int input_frames = 2;
+static VersusConfig config;
+
+static void usage(void) {
+    printf("Usage: tetris_versus_bench [options]\n"
+           "  --matches N      matches to play (default 20)\n"
+           "  --players N      boards per match, 2 to %d (default 2)\n"
+           "  --threads N      threads for the parallel rerun (default 4)\n"
+           "  --input-frames N frames between bot inputs (default 2)\n"
+           "  --delay N        frames before garbage can rise (default 30)\n"
+           "  --seed N         first match seed (default 1)\n", VERSUS_MAX_PLAYERS);
+}
+
+static unsigned pilot_input(BotPilot* b, const GameState* s) {
+    int in = bot_pilot_input(b, s, &bot_default_weights);
+    return in < 0 ? 0 : VERSUS_INPUT(in);
+}
+
+static void finish(const VersusMatch* m, MatchResult* r) {
+    r->hash = versus_hash(m);
+    r->frames = m->frame;
+    r->winner = m->winner;
+    r->sent = r->cancelled = r->received = 0;
+    for (int i = 0; i < m->players; i++) {
+        r->sent += m->p[i].sent;
+        r->cancelled += m->p[i].cancelled;
+        r->received += m->p[i].received;
+    }
+}
+
+/* Bots play; log gets every frame's inputs when given */
+static void play(uint32_t seed, std::vector<unsigned>* log, MatchResult* r) {
+    VersusMatch m;
+    BotPilot pilot[VERSUS_MAX_PLAYERS];
+    unsigned inputs[VERSUS_MAX_PLAYERS];
+    memset(pilot, 0, sizeof(pilot));
+    versus_init(&m, &config, players, seed);
+    while (!m.over && m.frame < MAX_FRAMES) {
+        for (int i = 0; i < players; i++)
+            inputs[i] = m.frame % input_frames ? 0 : pilot_input(&pilot[i], &m.p[i].game);
+        if (log) log->insert(log->end(), inputs, inputs + players);
+        versus_step(&m, inputs);
+    }
+    finish(&m, r);
+}
+
+static void replay(uint32_t seed, const std::vector<unsigned>& log, MatchResult* r) {
+    VersusMatch m;
+    versus_init(&m, &config, players, seed);
+    auto t0 = std::chrono::steady_clock::now();
+    for (size_t f = 0; f + players <= log.size(); f += players) versus_step(&m, &log[f]);
+    double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+    finish(&m, r);
+    r->step_us = m.frame ? us / m.frame : 0.0;
+}
+
+int main(int argc, char** argv) {
+    int matches = 20, threads = 4;
+    uint32_t seed = 1;
+    versus_config_default(&config);
+
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        const char* v = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!strcmp(a, "--help")) { usage(); return 0; }
+        if (!v) { usage(); return 1; }
+        if (!strcmp(a, "--matches")) matches = atoi(v);
+        else if (!strcmp(a, "--players")) players = atoi(v);
+        else if (!strcmp(a, "--threads")) threads = atoi(v);
+        else if (!strcmp(a, "--input-frames")) input_frames = atoi(v);
+        else if (!strcmp(a, "--delay")) config.garbage_delay = atoi(v);
+        else if (!strcmp(a, "--seed")) seed = (uint32_t)strtoul(v, NULL, 10);
+        else { usage(); return 1; }
+        i++;
+    }
+    if (players < 2) players = 2;
+    if (players > VERSUS_MAX_PLAYERS) players = VERSUS_MAX_PLAYERS;
+    if (threads < 1) threads = 1;
+    if (input_frames < 1) input_frames = 1;
+    if (matches < 1) matches = 1;
+
+    std::vector<MatchResult> serial(matches), replayed(matches), parallel(matches);
+    std::vector<std::vector<unsigned>> logs(matches);
+    auto t0 = std::chrono::steady_clock::now();
+    for (int k = 0; k < matches; k++) play(seed + k, &logs[k], &serial[k]);
+    double serial_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    for (int k = 0; k < matches; k++) replay(seed + k, logs[k], &replayed[k]);
+
+    /* Matches share nothing, so threads simply take every nth one */
+    t0 = std::chrono::steady_clock::now();
+    std::vector<std::thread> pool;
+    for (int t = 0; t < threads; t++)
+        pool.emplace_back([&, t] {
+            for (int k = t; k < matches; k += threads) play(seed + k, NULL, &parallel[k]);
+        });
+    for (std::thread& t : pool) t.join();
+    double parallel_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    int wins[VERSUS_MAX_PLAYERS] = { 0 }, draws = 0, mismatches = 0;
+    uint64_t frames = 0, sent = 0, cancelled = 0, received = 0;
+    double step_us = 0.0;
+    for (int k = 0; k < matches; k++) {
+        const MatchResult* r = &serial[k];
+        if (r->hash != replayed[k].hash || r->hash != parallel[k].hash) {
+            printf("match %d (seed %u) diverged: %016llx %016llx %016llx\n", k, seed + k,
+                   (unsigned long long)r->hash, (unsigned long long)replayed[k].hash,
+                   (unsigned long long)parallel[k].hash);
+            mismatches++;
+        }
+        if (r->winner >= 0) wins[r->winner]++;
+        else draws++;
+        frames += r->frames;
+        sent += r->sent;
+        cancelled += r->cancelled;
+        received += r->received;
+        step_us += replayed[k].step_us * r->frames;
+    }
+
+    printf("%d matches of %d players, %llu frames (%.1f s of play each)\n", matches, players,
+           (unsigned long long)frames, frames * config.frame_ms / 1000.0 / matches);
+    printf("wins:");
+    for (int i = 0; i < players; i++) printf(" p%d %d", i + 1, wins[i]);
+    printf(", draws %d\n", draws);
+    printf("garbage: %llu rows sent, %llu cancelled, %llu risen\n", (unsigned long long)sent,
+           (unsigned long long)cancelled, (unsigned long long)received);
+    printf("versus_step %.3f us per frame; with bots %.2f s serial, %.2f s on %d threads\n",
+           frames ? step_us / frames : 0.0, serial_s, parallel_s, threads);
+    printf("%s\n", mismatches ? "DIVERGED" : "replay and threaded runs match");
+    return mismatches ? 1 : 0;
+}
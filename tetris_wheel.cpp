@@ -0,0 +1,90 @@
+#include "tetris_wheel.h"
+
+enum { WHEEL_IDLE = 0, WHEEL_ARMED, WHEEL_FIRING };
+
+static int32_t* list_of(TimerWheel* w, const WheelNode* n) {
+    return n->armed == WHEEL_FIRING ? &w->firing : &w->head[n->due & (WHEEL_SLOTS - 1)];
+}
+
+static void list_link(TimerWheel* w, int id, int32_t* head) {
+    WheelNode* n = &w->node[id];
+    n->prev = -1;
+    n->next = *head;
+    if (*head >= 0) w->node[*head].prev = id;
+    *head = id;
+}
+
+static void list_unlink(TimerWheel* w, int id) {
+    WheelNode* n = &w->node[id];
+    if (n->prev >= 0) w->node[n->prev].next = n->next;
+    else *list_of(w, n) = n->next;
+    if (n->next >= 0) w->node[n->next].prev = n->prev;
+}
+
+void wheel_init(TimerWheel* w, WheelNode* nodes, int node_count, uint64_t now) {
+    w->node = nodes;
+    for (int i = 0; i < node_count; i++) nodes[i].armed = WHEEL_IDLE;
+    for (int i = 0; i < WHEEL_SLOTS; i++) w->head[i] = -1;
+    w->firing = -1;
+    w->now = now;
+    w->count = 0;
+}
+
+void wheel_add(TimerWheel* w, int id, uint64_t due) {
+    WheelNode* n = &w->node[id];
+    if (n->armed) wheel_cancel(w, id);
+    if (due < w->now) due = w->now;
+    n->due = due;
+    n->armed = WHEEL_ARMED;
+    list_link(w, id, &w->head[due & (WHEEL_SLOTS - 1)]);
+    w->count++;
+}
+
+void wheel_cancel(TimerWheel* w, int id) {
+    WheelNode* n = &w->node[id];
+    if (!n->armed) return;
+    list_unlink(w, id);
+    n->armed = WHEEL_IDLE;
+    w->count--;
+}
+
+int wheel_advance(TimerWheel* w, uint64_t now, WheelFn fn, void* ctx) {
+    if (now < w->now) return 0;
+    uint64_t slots = now - w->now + 1;
+    if (slots > WHEEL_SLOTS) slots = WHEEL_SLOTS;
+    uint64_t start = w->now;
+    int fired = 0;
+    for (uint64_t s = 0; s < slots; s++) {
+        int32_t* head = &w->head[(start + s) & (WHEEL_SLOTS - 1)];
+        w->now = start + s + 1;       /* re-adds from the callbacks go past this slot */
+        /* Move the expired timers over, leave later turns in place */
+        for (int32_t id = *head; id >= 0;) {
+            int32_t next = w->node[id].next;
+            if (w->node[id].due <= now) {
+                list_unlink(w, id);
+                w->node[id].armed = WHEEL_FIRING;
+                list_link(w, id, &w->firing);
+            }
+            id = next;
+        }
+        while (w->firing >= 0) {
+            int id = w->firing;
+            uint64_t due = w->node[id].due;
+            list_unlink(w, id);
+            w->node[id].armed = WHEEL_IDLE;
+            w->count--;
+            fired++;
+            fn(id, due, ctx);
+        }
+    }
+    w->now = now + 1;
+    return fired;
+}
+
+uint64_t wheel_next(const TimerWheel* w, uint64_t limit) {
+    if (!w->count) return UINT64_MAX;
+    if (limit > WHEEL_SLOTS) limit = WHEEL_SLOTS;
+    for (uint64_t t = w->now; t < w->now + limit; t++)
+        if (w->head[t & (WHEEL_SLOTS - 1)] >= 0) return t;
+    return w->now + limit;
+}
@@ -0,0 +1,43 @@
+#ifndef TETRIS_WHEEL_H
+#define TETRIS_WHEEL_H
+
+/* Hashed timer wheel over a caller-owned array of nodes. Timers are small
+   integer ids (slab indices), times are in the caller's ticks; a timer
+   lands in slot due % WHEEL_SLOTS and is skipped until its time comes, so
+   deadlines further out than one turn still work. Adding, cancelling and
+   expiring are O(1) per timer. Single-threaded; portable. */
+
+#include <stdint.h>
+
+#define WHEEL_SLOTS 4096          /* power of two */
+
+typedef struct {
+    int32_t next, prev;           /* -1 ends the list */
+    uint64_t due;
+    int armed;
+} WheelNode;
+
+typedef struct {
+    WheelNode* node;
+    int32_t head[WHEEL_SLOTS];
+    int32_t firing;               /* expired timers not yet called back, so a
+                                     callback can still cancel any of them */
+    uint64_t now;                 /* every timer due before this has fired */
+    int count;
+} TimerWheel;
+
+typedef void (*WheelFn)(int id, uint64_t due, void* ctx);
+
+/* nodes: one per id, kept by the caller for as long as the wheel */
+void wheel_init(TimerWheel* w, WheelNode* nodes, int node_count, uint64_t now);
+/* Re-adding an armed id moves it; a due time in the past fires next advance */
+void wheel_add(TimerWheel* w, int id, uint64_t due);
+void wheel_cancel(TimerWheel* w, int id);
+/* Fires every timer due at or before now, in slot order. The callback may
+   add or cancel timers, including the one firing. Returns the count. */
+int wheel_advance(TimerWheel* w, uint64_t now, WheelFn fn, void* ctx);
+/* Earliest tick worth waking for, at most `limit` ticks ahead; UINT64_MAX
+   when nothing is armed */
+uint64_t wheel_next(const TimerWheel* w, uint64_t limit);
+
+#endif /* TETRIS_WHEEL_H */